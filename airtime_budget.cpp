@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include "airtime_budget.h"
+
+AirtimeBudget::AirtimeBudget(int framesPerSecond, int burst, int64_t maxDeferMs) :
+    m_rate(framesPerSecond > 0 ? framesPerSecond : 1),
+    m_capacity(int64_t(burst > 0 ? burst : 1) * 1000),
+    m_maxDefer(maxDeferMs)
+{
+}
+
+/*! Accounts \p frames of non-deferrable traffic on \p route.
+    The budget may become negative down to the burst size, which defers other
+    traffic on the route until it has recovered.
+ */
+void AirtimeBudget::consume(uint64_t route, int64_t now, int frames)
+{
+    Bucket *b = refill(route, now);
+
+    if (!b)
+    {
+        Bucket bucket;
+        bucket.route = route;
+        bucket.updated = now;
+        bucket.tokens = m_capacity;
+        m_buckets.push_back(bucket);
+        b = &m_buckets.back();
+    }
+
+    b->tokens -= int64_t(frames) * 1000;
+    if (b->tokens < -m_capacity)
+    {
+        b->tokens = -m_capacity;
+    }
+}
+
+/*! Takes \p frames of deferrable traffic from the budget of \p route.
+    \returns false if the traffic should be deferred.
+ */
+bool AirtimeBudget::acquire(uint64_t route, int64_t now, int frames)
+{
+    Bucket *b = refill(route, now);
+
+    if (!b)
+    {
+        return true; // idle route
+    }
+
+    const int64_t amount = int64_t(frames) * 1000;
+
+    if (b->tokens >= amount)
+    {
+        b->tokens -= amount;
+        b->deferredSince = -1;
+        return true;
+    }
+
+    if (b->deferredSince < 0)
+    {
+        b->deferredSince = now;
+        return false;
+    }
+
+    if (now - b->deferredSince >= m_maxDefer)
+    {
+        // fair share, the route is saturated but still gets a grant now and then
+        b->tokens -= amount;
+        if (b->tokens < -m_capacity)
+        {
+            b->tokens = -m_capacity;
+        }
+        b->deferredSince = -1;
+        return true;
+    }
+
+    return false;
+}
+
+/*! Returns true if deferrable traffic on \p route would be deferred now.
+ */
+bool AirtimeBudget::isThrottled(uint64_t route, int64_t now)
+{
+    const Bucket *b = refill(route, now);
+    return b && b->tokens < 1000;
+}
+
+/*! Refills the bucket of \p route up to \p now, buckets which are full again are removed.
+    \returns the bucket or nullptr if the route is idle.
+ */
+AirtimeBudget::Bucket *AirtimeBudget::refill(uint64_t route, int64_t now)
+{
+    for (size_t i = 0; i < m_buckets.size(); i++)
+    {
+        Bucket &b = m_buckets[i];
+        if (b.route != route)
+        {
+            continue;
+        }
+
+        if (now > b.updated)
+        {
+            b.tokens += (now - b.updated) * m_rate;
+            b.updated = now;
+        }
+
+        if (b.tokens >= m_capacity)
+        {
+            m_buckets[i] = m_buckets.back();
+            m_buckets.pop_back();
+            return nullptr;
+        }
+
+        return &b;
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef AIRTIME_BUDGET_H
+#define AIRTIME_BUDGET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*! \class AirtimeBudget
+
+    Token bucket per route to share airtime between traffic which can't be deferred,
+    like OTA image blocks requested by a device, and deferrable traffic like polling.
+
+    A route is identified by a 64-bit key, e.g. the MAC address of the first hop.
+    Only routes which carried non-deferrable traffic have a bucket, all other routes
+    have the full budget. A deferred route gets at least one grant per \c maxDeferMs
+    so that polling slows down but never stops on a busy route.
+
+    Times are monotonic ms, amounts are frames.
+ */
+class AirtimeBudget
+{
+public:
+    explicit AirtimeBudget(int framesPerSecond = 4, int burst = 8, int64_t maxDeferMs = 6000);
+
+    void consume(uint64_t route, int64_t now, int frames);
+    bool acquire(uint64_t route, int64_t now, int frames);
+    bool isThrottled(uint64_t route, int64_t now);
+    size_t size() const { return m_buckets.size(); }
+
+private:
+    struct Bucket
+    {
+        uint64_t route = 0;
+        int64_t updated = 0;
+        int64_t tokens = 0;         //! milli-frames
+        int64_t deferredSince = -1; //! -1 if not deferred
+    };
+
+    Bucket *refill(uint64_t route, int64_t now);
+
+    std::vector<Bucket> m_buckets; //! only a few routes are busy at any time
+    int64_t m_rate;                //! milli-frames per ms
+    int64_t m_capacity;            //! milli-frames
+    int64_t m_maxDefer;
+};
+
+#endif // AIRTIME_BUDGET_H
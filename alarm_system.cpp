@@ -8,6 +8,8 @@
  *
  */
 
+#include <QCoreApplication>
+#include <QPointer>
 #include <QTimer>
 #include <array>
 #include <deconz/timeref.h>
@@ -55,6 +57,7 @@ public:
     void updateArmStateAndPanelStatus();
     void updateTargetStateValues();
     void setSecondsRemaining(uint secs);
+    const std::string &code0Secret();
 
     AlarmSystem *q = nullptr;
     AS_DeviceTable *devTable = nullptr;
@@ -70,6 +73,10 @@ public:
     QTimer *timer = nullptr;
     deCONZ::SteadyTimeRef tState{0};
     AS_StateFunction curState = &AlarmSystemPrivate::stateDisarmed;
+
+    std::string code0; // cached scrypt PHC hash of code0
+    bool code0Loaded = false;
+    VerifyRateLimiter rateLimiter;
 };
 
 void AlarmSystemPrivate::setState(AS_StateFunction state)
@@ -82,6 +89,25 @@ void AlarmSystemPrivate::setState(AS_StateFunction state)
     updateArmStateAndPanelStatus();
 }
 
+/*! Returns the scrypt hash of code0, it's only loaded once from the database.
+ */
+const std::string &AlarmSystemPrivate::code0Secret()
+{
+    if (!code0Loaded)
+    {
+        DB_Secret sec;
+        sec.uniqueId = QString(AS_ID_CODE0).arg(q->id()).toStdString();
+
+        if (DB_LoadSecret(sec))
+        {
+            code0 = sec.secret;
+            code0Loaded = true;
+        }
+    }
+
+    return code0;
+}
+
 void AlarmSystemPrivate::startStateTimer()
 {
     tState = deCONZ::steadyTimeRef();
@@ -445,8 +471,11 @@ void AlarmSystem::didSetValue(ResourceItem *i)
 
     The verification is only done if an entry for \p srcExtAddress exists
     in the alarm system device table.
+    Attempts are rate limited per \p srcExtAddress, or \p rateLimitSource for
+    requests which don't originate from a device like REST-API clients.
+    Note: This blocks for the duration of a scrypt calculation, device requests should use verifyCode().
  */
-bool AlarmSystem::isValidCode(const QString &code, quint64 srcExtAddress)
+bool AlarmSystem::isValidCode(const QString &code, quint64 srcExtAddress, quint64 rateLimitSource)
 {
     if (srcExtAddress != 0)
     {
@@ -456,20 +485,75 @@ bool AlarmSystem::isValidCode(const QString &code, quint64 srcExtAddress)
         {
             return false;
         }
+
+        rateLimitSource = srcExtAddress;
     }
 
-    DB_Secret sec;
-    sec.uniqueId = QString(AS_ID_CODE0).arg(id()).toStdString();
+    const int64_t now = deCONZ::steadyTimeRef().ref;
+
+    if (!d->rateLimiter.begin(rateLimitSource, now))
+    {
+        DBG_Printf(DBG_INFO, "alarm system %u: code verification for 0x%016llX rate limited\n", id(), rateLimitSource);
+        return false;
+    }
+
+    const std::string &secret = d->code0Secret();
+    const bool result = !secret.empty() && CRYPTO_ScryptVerify(secret, code.toStdString());
+
+    d->rateLimiter.end(rateLimitSource, result, now);
+
+    return result;
+}
+
+/*! Verifies the \p code on the \p worker thread.
+
+    \p callback is invoked with the result on the main thread.
+    \returns false if the request is rejected right away, in this case \p callback isn't invoked.
+ */
+bool AlarmSystem::verifyCode(const QString &code, quint64 srcExtAddress, VerifyWorker *worker, std::function<void(bool)> callback)
+{
+    if (!worker || !callback || srcExtAddress == 0)
+    {
+        return false;
+    }
+
+    const AS_DeviceEntry &entry = d->devTable->get(srcExtAddress);
 
-    if (DB_LoadSecret(sec))
+    if (!isValid(entry) || entry.alarmSystemId != id())
     {
-        if (CRYPTO_ScryptVerify(sec.secret, code.toStdString()))
+        return false;
+    }
+
+    const std::string &secret = d->code0Secret();
+
+    if (secret.empty())
+    {
+        return false;
+    }
+
+    if (!d->rateLimiter.begin(srcExtAddress, deCONZ::steadyTimeRef().ref))
+    {
+        DBG_Printf(DBG_INFO, "alarm system %u: code verification for 0x%016llX rate limited\n", id(), srcExtAddress);
+        return false;
+    }
+
+    const std::string code0 = code.toStdString();
+    QPointer<AlarmSystem> self(this);
+
+    worker->submit([secret, code0]()
+    {
+        return CRYPTO_ScryptVerify(secret, code0);
+    },
+    [self, srcExtAddress, callback](bool result)
+    {
+        if (self)
         {
-            return true;
+            self->d->rateLimiter.end(srcExtAddress, result, deCONZ::steadyTimeRef().ref);
         }
-    }
+        callback(result);
+    });
 
-    return false;
+    return true;
 }
 
 AlarmSystemId AlarmSystem::id() const
@@ -578,6 +662,11 @@ bool AlarmSystem::setCode(int index, const QString &code)
 
     if (DB_StoreSecret(sec))
     {
+        if (index == 0)
+        {
+            d->code0 = sec.secret;
+            d->code0Loaded = true;
+        }
         setValue(RConfigConfigured, true);
         return true;
     }
@@ -599,10 +688,8 @@ void AlarmSystem::start()
     d->updateArmStateAndPanelStatus();
     d->updateTargetStateValues();
 
-    DB_Secret sec;
-    sec.uniqueId = QString(AS_ID_CODE0).arg(id()).toStdString();
-
-    bool configured = DB_LoadSecret(sec);
+    // also primes the secret cache for code verifications
+    const bool configured = !d->code0Secret().empty();
     item(RConfigConfigured)->setValue(configured);
 }
 
@@ -611,8 +698,23 @@ void AlarmSystem::timerFired()
     handleEvent(Event(RAlarmSystems, REventTimerFired, 0));
 }
 
-AlarmSystems::AlarmSystems()
+AlarmSystems::AlarmSystems() :
+    verifyWorker(std::make_shared<VerifyWorker>())
 {
+    std::weak_ptr<VerifyWorker> worker = verifyWorker;
+
+    // called from the worker thread, deliver results on the main thread
+    verifyWorker->setNotify([worker]()
+    {
+        QMetaObject::invokeMethod(qApp, [worker]()
+        {
+            auto w = worker.lock();
+            if (w)
+            {
+                w->processResults();
+            }
+        }, Qt::QueuedConnection);
+    });
 }
 
 AlarmSystems::~AlarmSystems()
@@ -12,7 +12,10 @@
 #define ALARM_SYSTEM_H
 
 #include <QObject>
+#include <functional>
+#include <memory>
 #include <vector>
+#include "crypto/verify_worker.h"
 #include "resource.h"
 
 /*! \class AlarmSystem
@@ -76,7 +79,8 @@ public:
     ~AlarmSystem();
     void handleEvent(const Event &event);
     void didSetValue(ResourceItem *i) override;
-    bool isValidCode(const QString &code, quint64 srcExtAddress);
+    bool isValidCode(const QString &code, quint64 srcExtAddress, quint64 rateLimitSource = 0);
+    bool verifyCode(const QString &code, quint64 srcExtAddress, VerifyWorker *worker, std::function<void(bool)> callback);
     AlarmSystemId id() const;
     const QString &idString() const;
     quint8 iasAcePanelStatus() const;
@@ -102,7 +106,7 @@ private:
 
 /*! \class AlarmSystems
 
-    RAII wrapper to hold \c AlarmSystem objects.
+    RAII wrapper to hold \c AlarmSystem objects and the worker which verifies their PIN codes.
  */
 class AlarmSystems
 {
@@ -111,6 +115,7 @@ public:
     ~AlarmSystems();
 
     std::vector<AlarmSystem*> alarmSystems;
+    std::shared_ptr<VerifyWorker> verifyWorker;
 };
 
 void DB_LoadAlarmSystems(AlarmSystems &alarmSystems, AS_DeviceTable *devTable, EventEmitter *eventEmitter);
@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2013-2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include <algorithm>
+#include "api_auth.h"
+
+ApiAuth::ApiAuth() :
+    needSaveDatabase(false),
+    state(StateNormal)
+{
+
+}
+
+/*! Set and process device type.
+ */
+void ApiAuth::setDeviceType(const QString &devtype)
+{
+    devicetype = devtype;
+}
+
+/*! Returns the position of the active auth for \p apikey in \p auths or -1 if not found.
+
+    Unknown keys are rejected without scanning \p auths, the index must be invalidated
+    on every change of the vector.
+ */
+int ApiAuthIndex::find(const std::vector<ApiAuth> &auths, const QString &apikey)
+{
+    if (m_size != auths.size())
+    {
+        rebuild(auths);
+    }
+
+    const auto i = m_index.constFind(apikey);
+
+    if (i != m_index.cend())
+    {
+        const size_t pos = size_t(i.value());
+
+        if (pos < auths.size() && auths[pos].apikey == apikey && auths[pos].state == ApiAuth::StateNormal)
+        {
+            return int(pos);
+        }
+    }
+
+    return -1;
+}
+
+void ApiAuthIndex::rebuild(const std::vector<ApiAuth> &auths)
+{
+    m_index.clear();
+    m_index.reserve(int(auths.size()));
+
+    for (size_t i = 0; i < auths.size(); i++)
+    {
+        // prefer active entries if a key exists multiple times
+        auto existing = m_index.find(auths[i].apikey);
+        if (existing == m_index.end() || auths[i].state == ApiAuth::StateNormal)
+        {
+            m_index.insert(auths[i].apikey, int(i));
+        }
+    }
+
+    m_size = auths.size();
+}
+
+/*! Copies the batched last use times into lastUseDate.
+
+    authorise() only stores a cheap steady time per request, this is converted
+    before the auth data is saved or shown.
+    \returns the number of updated entries.
+ */
+int API_FlushLastUse(std::vector<ApiAuth> &auths, qint64 nowMs, const QDateTime &nowUtc)
+{
+    int count = 0;
+
+    for (ApiAuth &auth : auths)
+    {
+        if (auth.lastUseMs == 0)
+        {
+            continue;
+        }
+
+        auth.lastUseDate = nowUtc.addMSecs(auth.lastUseMs - nowMs);
+        auth.lastUseMs = 0;
+        auth.needSaveDatabase = true;
+        count++;
+    }
+
+    return count;
+}
+
+/*! Marks up to \p budget keys which haven't been used since state.threshold as deleted.
+
+    The scan continues at state.cursor on the next call, so large whitelists are
+    processed across multiple event loop iterations.
+    \returns true if more entries need to be processed.
+ */
+bool API_PruneStep(std::vector<ApiAuth> &auths, ApiAuthPruneState &state, int budget)
+{
+    if (!state.active)
+    {
+        return false;
+    }
+
+    for (; state.cursor < auths.size() && budget > 0; state.cursor++, budget--)
+    {
+        ApiAuth &auth = auths[state.cursor];
+
+        if (auth.state != ApiAuth::StateNormal || auth.lastUseMs != 0 || auth.apikey == state.keepApikey)
+        {
+            continue;
+        }
+
+        if (auth.lastUseDate.isValid() && auth.lastUseDate < state.threshold)
+        {
+            auth.state = ApiAuth::StateDeleted;
+            auth.needSaveDatabase = true;
+            state.pruned++;
+        }
+    }
+
+    if (state.cursor >= auths.size())
+    {
+        state.active = false;
+    }
+
+    return state.active;
+}
+
+/*! Removes deleted entries which are already removed from the database.
+    \returns the number of removed entries.
+ */
+int API_CompactDeleted(std::vector<ApiAuth> &auths)
+{
+    const auto end = std::remove_if(auths.begin(), auths.end(), [](const ApiAuth &auth)
+    {
+        return auth.state == ApiAuth::StateDeleted && !auth.needSaveDatabase;
+    });
+
+    const int count = int(std::distance(end, auths.end()));
+    auths.erase(end, auths.end());
+    return count;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef API_AUTH_H
+#define API_AUTH_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QString>
+#include <cstdint>
+#include <vector>
+
+/*! \class ApiAuth
+
+    Helper to combine serval authorisation parameters.
+ */
+class ApiAuth
+{
+public:
+    enum State
+    {
+        StateNormal,
+        StateDeleted
+    };
+
+    ApiAuth();
+    void setDeviceType(const QString &devtype);
+
+    bool needSaveDatabase;
+    State state;
+    QString apikey; // also called username (10..32 chars)
+    QString devicetype;
+    QDateTime createDate;
+    QDateTime lastUseDate;
+    QString useragent;
+    qint64 lastUseMs = 0; // steady time of last use which isn't yet in lastUseDate, see API_FlushLastUse()
+};
+
+/*! \class ApiAuthIndex
+
+    Hash index from API key to the position in the apiAuths vector.
+
+    Code which adds, removes, reorders or renames entries calls invalidate(), the index is
+    then rebuilt on the next lookup. Hits are verified against the vector, a miss is final
+    so that unknown keys never cost a linear scan.
+ */
+class ApiAuthIndex
+{
+public:
+    int find(const std::vector<ApiAuth> &auths, const QString &apikey);
+    void invalidate() { m_size = SIZE_MAX; }
+
+private:
+    void rebuild(const std::vector<ApiAuth> &auths);
+
+    QHash<QString, int> m_index;
+    size_t m_size = SIZE_MAX; // size of vector when the index was built
+};
+
+/*! State of an incremental prune of unused API keys.
+ */
+struct ApiAuthPruneState
+{
+    bool active = false;
+    size_t cursor = 0;
+    QDateTime threshold; // keys not used since are deleted
+    QString keepApikey; // never prune the key of the requesting client
+    int pruned = 0;
+};
+
+int API_FlushLastUse(std::vector<ApiAuth> &auths, qint64 nowMs, const QDateTime &nowUtc);
+bool API_PruneStep(std::vector<ApiAuth> &auths, ApiAuthPruneState &state, int budget);
+int API_CompactDeleted(std::vector<ApiAuth> &auths);
+
+#endif // API_AUTH_H
@@ -0,0 +1,378 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include <algorithm>
+#include <cstring>
+#include "aps_capture.h"
+
+#define APS_CAPTURE_VERSION     1
+#define APS_CAPTURE_FLUSH_SIZE  4096
+#define APS_CAPTURE_FLUSH_TIME  5000 // ms
+
+#define APS_FLAG_SRC_EXT   0x01
+#define APS_FLAG_SRC_NWK   0x02
+#define APS_FLAG_GROUPCAST 0x04
+#define APS_FLAG_LINK      0x08
+
+static const uint8_t captureMagic[4] = { 'A', 'P', 'S', 'C' };
+
+static void putVarint(std::vector<uint8_t> &out, uint64_t val)
+{
+    while (val >= 0x80)
+    {
+        out.push_back(uint8_t(val | 0x80));
+        val >>= 7;
+    }
+    out.push_back(uint8_t(val));
+}
+
+static void putLE(std::vector<uint8_t> &out, uint64_t val, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+    {
+        out.push_back(uint8_t(val >> (i * 8)));
+    }
+}
+
+namespace {
+
+class CaptureStream
+{
+public:
+    CaptureStream(const uint8_t *data, size_t size) : m_data(data), m_size(size) { }
+
+    bool atEnd() const { return m_pos == m_size; }
+    bool ok() const { return m_ok; }
+
+    uint64_t varint()
+    {
+        uint64_t val = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            const uint8_t b = byte();
+            val |= uint64_t(b & 0x7F) << shift;
+            if ((b & 0x80) == 0)
+            {
+                return val;
+            }
+        }
+        m_ok = false;
+        return 0;
+    }
+
+    uint64_t le(int bytes)
+    {
+        uint64_t val = 0;
+        for (int i = 0; i < bytes; i++)
+        {
+            val |= uint64_t(byte()) << (i * 8);
+        }
+        return val;
+    }
+
+    uint8_t byte()
+    {
+        if (m_pos >= m_size)
+        {
+            m_ok = false;
+            return 0;
+        }
+        return m_data[m_pos++];
+    }
+
+    bool bytes(size_t n, std::vector<uint8_t> &out)
+    {
+        if (n > m_size - m_pos)
+        {
+            m_ok = false;
+            return false;
+        }
+        out.assign(m_data + m_pos, m_data + m_pos + n);
+        m_pos += n;
+        return true;
+    }
+
+private:
+    const uint8_t *m_data;
+    size_t m_size;
+    size_t m_pos = 0;
+    bool m_ok = true;
+};
+
+} // namespace
+
+void APS_EncodeCaptureHeader(std::vector<uint8_t> &out)
+{
+    out.insert(out.end(), captureMagic, captureMagic + sizeof(captureMagic));
+    out.push_back(APS_CAPTURE_VERSION);
+}
+
+/*! Appends \p rec to \p out, the time is stored relative to the previous record at \p prevTimeMs.
+ */
+void APS_EncodeCaptureRecord(const APS_CaptureRecord &rec, int64_t prevTimeMs, std::vector<uint8_t> &out)
+{
+    uint8_t flags = 0;
+    if (rec.srcExt)              { flags |= APS_FLAG_SRC_EXT; }
+    if (rec.srcNwk)              { flags |= APS_FLAG_SRC_NWK; }
+    if (rec.groupcast)           { flags |= APS_FLAG_GROUPCAST; }
+    if (rec.lqi || rec.rssi)     { flags |= APS_FLAG_LINK; }
+
+    putVarint(out, uint64_t(rec.timeMs > prevTimeMs ? rec.timeMs - prevTimeMs : 0));
+    out.push_back(flags);
+
+    if (flags & APS_FLAG_SRC_EXT)   { putLE(out, rec.srcExt, 8); }
+    if (flags & APS_FLAG_SRC_NWK)   { putLE(out, rec.srcNwk, 2); }
+    if (flags & APS_FLAG_GROUPCAST) { putLE(out, rec.dstGroup, 2); }
+    if (flags & APS_FLAG_LINK)
+    {
+        out.push_back(rec.lqi);
+        out.push_back(uint8_t(rec.rssi));
+    }
+
+    putLE(out, rec.profileId, 2);
+    putLE(out, rec.clusterId, 2);
+    out.push_back(rec.srcEndpoint);
+    out.push_back(rec.dstEndpoint);
+    putVarint(out, rec.asdu.size());
+    out.insert(out.end(), rec.asdu.begin(), rec.asdu.end());
+}
+
+/*! Decodes a complete capture log.
+    \returns false if the header is invalid or the log is truncated, \p records holds all complete records.
+ */
+bool APS_DecodeCapture(const uint8_t *data, size_t size, std::vector<APS_CaptureRecord> *records)
+{
+    if (size < sizeof(captureMagic) + 1 || !std::equal(captureMagic, captureMagic + sizeof(captureMagic), data))
+    {
+        return false;
+    }
+
+    if (data[sizeof(captureMagic)] != APS_CAPTURE_VERSION)
+    {
+        return false;
+    }
+
+    CaptureStream stream(data + sizeof(captureMagic) + 1, size - sizeof(captureMagic) - 1);
+    int64_t time = 0;
+
+    while (!stream.atEnd())
+    {
+        APS_CaptureRecord rec;
+
+        time += int64_t(stream.varint());
+        rec.timeMs = time;
+
+        const uint8_t flags = stream.byte();
+        if (flags & APS_FLAG_SRC_EXT)   { rec.srcExt = stream.le(8); }
+        if (flags & APS_FLAG_SRC_NWK)   { rec.srcNwk = uint16_t(stream.le(2)); }
+        if (flags & APS_FLAG_GROUPCAST)
+        {
+            rec.groupcast = true;
+            rec.dstGroup = uint16_t(stream.le(2));
+        }
+        if (flags & APS_FLAG_LINK)
+        {
+            rec.lqi = stream.byte();
+            rec.rssi = int8_t(stream.byte());
+        }
+
+        rec.profileId = uint16_t(stream.le(2));
+        rec.clusterId = uint16_t(stream.le(2));
+        rec.srcEndpoint = stream.byte();
+        rec.dstEndpoint = stream.byte();
+        stream.bytes(size_t(stream.varint()), rec.asdu);
+
+        if (!stream.ok())
+        {
+            return false; // truncated, e.g. capture still running
+        }
+
+        records->push_back(std::move(rec));
+    }
+
+    return true;
+}
+
+bool APS_ReadCapture(const char *path, std::vector<APS_CaptureRecord> *records)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> data;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+    {
+        data.insert(data.end(), buf, buf + n);
+    }
+    fclose(fp);
+
+    return APS_DecodeCapture(data.data(), data.size(), records);
+}
+
+APS_CaptureWriter::~APS_CaptureWriter()
+{
+    close();
+}
+
+/*! Opens the capture log at \p path for appending.
+
+    A previous capture is continued, e.g. after a restart. If it has another format or
+    already reached \p maxSize it's moved to <path>.1 first.
+ */
+bool APS_CaptureWriter::open(const char *path, size_t maxSize)
+{
+    close();
+
+    m_path = path;
+    m_maxSize = maxSize;
+    m_buf.clear();
+    m_size = 0;
+    m_prevTime = 0;
+    m_flushTime = 0;
+    m_count = 0;
+
+    FILE *fp = fopen(path, "rb");
+    if (fp)
+    {
+        std::vector<uint8_t> header;
+        APS_EncodeCaptureHeader(header);
+        uint8_t buf[8];
+        const bool valid = fread(buf, 1, header.size(), fp) == header.size() && memcmp(buf, header.data(), header.size()) == 0;
+        fseek(fp, 0, SEEK_END);
+        const long size = ftell(fp);
+        fclose(fp);
+
+        if (size > 0 && (!valid || size_t(size) >= maxSize))
+        {
+            return rotate();
+        }
+
+        m_size = size > 0 ? size_t(size) : 0;
+    }
+
+    m_fp = fopen(path, "ab");
+    if (!m_fp)
+    {
+        return false;
+    }
+
+    if (m_size == 0)
+    {
+        APS_EncodeCaptureHeader(m_buf);
+    }
+
+    return true;
+}
+
+/*! Moves the current log to <path>.1 and starts a new one.
+ */
+bool APS_CaptureWriter::rotate()
+{
+    if (m_fp)
+    {
+        fclose(m_fp);
+        m_fp = nullptr;
+    }
+
+    const std::string prev = m_path + ".1";
+    std::remove(prev.c_str()); // rename() doesn't replace files on Windows
+    std::rename(m_path.c_str(), prev.c_str());
+
+    m_fp = fopen(m_path.c_str(), "wb");
+    m_size = 0;
+
+    if (!m_fp)
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> header;
+    APS_EncodeCaptureHeader(header);
+    m_size = fwrite(header.data(), 1, header.size(), m_fp);
+    fflush(m_fp);
+    return true;
+}
+
+void APS_CaptureWriter::close()
+{
+    if (m_fp)
+    {
+        flush();
+        fclose(m_fp);
+        m_fp = nullptr;
+    }
+}
+
+/*! Appends \p rec, data is written in chunks or at least every few seconds.
+    The log is rotated once it reaches the size limit.
+ */
+void APS_CaptureWriter::write(const APS_CaptureRecord &rec)
+{
+    if (!m_fp)
+    {
+        return;
+    }
+
+    if (m_count == 0)
+    {
+        m_prevTime = rec.timeMs; // first record has delta 0
+        m_flushTime = rec.timeMs;
+    }
+
+    APS_EncodeCaptureRecord(rec, m_prevTime, m_buf);
+    m_prevTime = std::max(m_prevTime, rec.timeMs);
+    m_count++;
+
+    if (m_buf.size() >= APS_CAPTURE_FLUSH_SIZE || rec.timeMs - m_flushTime >= APS_CAPTURE_FLUSH_TIME)
+    {
+        flush();
+        m_flushTime = rec.timeMs;
+    }
+}
+
+void APS_CaptureWriter::flush()
+{
+    if (m_fp && !m_buf.empty())
+    {
+        m_size += fwrite(m_buf.data(), 1, m_buf.size(), m_fp);
+        fflush(m_fp);
+        m_buf.clear();
+
+        if (m_size >= m_maxSize)
+        {
+            rotate();
+        }
+    }
+}
+
+/*! Returns the latency at percentile \p p (0..100) in ns.
+ */
+int64_t APS_ReplayStats::percentile(double p) const
+{
+    if (latencyNs.empty())
+    {
+        return 0;
+    }
+
+    std::vector<int64_t> sorted = latencyNs;
+    size_t n = size_t(p / 100.0 * double(sorted.size() - 1) + 0.5);
+    n = std::min(n, sorted.size() - 1);
+    std::nth_element(sorted.begin(), sorted.begin() + long(n), sorted.end());
+    return sorted[n];
+}
+
+double APS_ReplayStats::meanQueueDepth() const
+{
+    return latencyNs.empty() ? 0 : double(sumQueueDepth) / double(latencyNs.size());
+}
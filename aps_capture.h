@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef APS_CAPTURE_H
+#define APS_CAPTURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#define APS_CAPTURE_MAX_SIZE (16 * 1024 * 1024) // bytes per file, one older file is kept
+
+/*! A recorded APS data indication.
+
+    Holds the fields of deCONZ::ApsDataIndication which are used by the plugin, so that
+    captures of real networks can be replayed offline.
+ */
+struct APS_CaptureRecord
+{
+    int64_t timeMs = 0; //! monotonic ms
+    uint64_t srcExt = 0;
+    uint16_t srcNwk = 0;
+    uint16_t dstGroup = 0;
+    uint16_t profileId = 0;
+    uint16_t clusterId = 0;
+    uint8_t srcEndpoint = 0;
+    uint8_t dstEndpoint = 0;
+    uint8_t lqi = 0;
+    int8_t rssi = 0;
+    bool groupcast = false; //! dstGroup is valid
+    std::vector<uint8_t> asdu;
+};
+
+/*! \class APS_CaptureWriter
+
+    Appends APS_CaptureRecord entries to a compact binary log.
+
+    File layout: "APSC" magic, version byte, then one record after another. A record
+    starts with the varint time delta to the previous record, followed by a flags byte
+    and the fields which are present. Numbers are little endian.
+
+    An existing log is continued. When a log reaches its size limit it's moved to
+    <path>.1, replacing an older one there, and a new log is started.
+ */
+class APS_CaptureWriter
+{
+public:
+    APS_CaptureWriter() = default;
+    ~APS_CaptureWriter();
+    APS_CaptureWriter(const APS_CaptureWriter&) = delete;
+    APS_CaptureWriter &operator=(const APS_CaptureWriter&) = delete;
+
+    bool open(const char *path, size_t maxSize = APS_CAPTURE_MAX_SIZE);
+    void close();
+    bool isOpen() const { return m_fp != nullptr; }
+    void write(const APS_CaptureRecord &rec);
+    size_t count() const { return m_count; }
+
+private:
+    void flush();
+    bool rotate();
+
+    FILE *m_fp = nullptr;
+    std::string m_path;
+    std::vector<uint8_t> m_buf;
+    size_t m_size = 0; //! bytes in the file
+    size_t m_maxSize = APS_CAPTURE_MAX_SIZE;
+    int64_t m_prevTime = 0;
+    int64_t m_flushTime = 0;
+    size_t m_count = 0;
+};
+
+/*! Processing time per frame and event queue depth of a replayed capture.
+ */
+struct APS_ReplayStats
+{
+    std::vector<int64_t> latencyNs; //! per frame
+    size_t maxQueueDepth = 0;
+    uint64_t sumQueueDepth = 0;
+
+    int64_t percentile(double p) const;
+    double meanQueueDepth() const;
+};
+
+void APS_EncodeCaptureHeader(std::vector<uint8_t> &out);
+void APS_EncodeCaptureRecord(const APS_CaptureRecord &rec, int64_t prevTimeMs, std::vector<uint8_t> &out);
+bool APS_DecodeCapture(const uint8_t *data, size_t size, std::vector<APS_CaptureRecord> *records);
+bool APS_ReadCapture(const char *path, std::vector<APS_CaptureRecord> *records);
+
+#endif // APS_CAPTURE_H
@@ -144,6 +144,17 @@ int ApsControllerWrapper::apsdeDataRequest(const deCONZ::ApsDataRequest &req)
     return m_apsCtrl->apsdeDataRequest(req);
 }
 
+/*! Tells the current ZCL Default Responder that the specific response is sent later,
+    e.g. after an asynchronous PIN code verification.
+ */
+void ApsControllerWrapper::deferZclResponse()
+{
+    if (m_zclDefaultResponder)
+    {
+        m_zclDefaultResponder->responseDeferred();
+    }
+}
+
 ZclDefaultResponder::ZclDefaultResponder(ApsControllerWrapper *apsCtrlWrapper, const deCONZ::ApsDataIndication &ind, const deCONZ::ZclFrame &zclFrame) :
     m_apsCtrlWrapper(apsCtrlWrapper),
     m_ind(ind),
@@ -199,3 +210,13 @@ void ZclDefaultResponder::checkApsdeDataRequest(const deCONZ::ApsDataRequest &re
         m_state = State::NoResponseNeeded;
     }
 }
+
+/*! The specific response will be sent after the indication handler returned, don't send a Default Response.
+ */
+void ZclDefaultResponder::responseDeferred()
+{
+    if (m_state == State::Watch)
+    {
+        m_state = State::NoResponseNeeded;
+    }
+}
@@ -32,6 +32,7 @@ public:
     explicit ZclDefaultResponder(ApsControllerWrapper *apsCtrlWrapper, const deCONZ::ApsDataIndication &ind, const deCONZ::ZclFrame &zclFrame);
     ~ZclDefaultResponder();
     void checkApsdeDataRequest(const deCONZ::ApsDataRequest &req);
+    void responseDeferred();
 
 private:
     enum class State
@@ -58,6 +59,7 @@ public:
     int apsdeDataRequest(const deCONZ::ApsDataRequest &req);
     void registerZclDefaultResponder(ZclDefaultResponder *resp) { m_zclDefaultResponder = resp; }
     void clearZclDefaultResponder() { m_zclDefaultResponder = nullptr; };
+    void deferZclResponse();
     deCONZ::ApsController *apsController() { return m_apsCtrl; }
 
 private:
@@ -10,21 +10,38 @@
 
 #include <QCryptographicHash>
 #include <QMessageAuthenticationCode>
+#include <QTcpSocket>
+#include <deconz/timeref.h>
 #include "crypto/password.h"
+#include "crypto/random.h"
 #include "de_web_plugin_private.h"
 
-ApiAuth::ApiAuth() :
-    needSaveDatabase(false),
-    state(StateNormal)
+/*! Returns the rate limiting source of a REST-API client.
+ */
+quint64 AUTH_RateLimitSource(const ApiRequest &req)
 {
+    if (!req.sock)
+    {
+        return 0;
+    }
 
+    // upper bits avoid collisions with device MAC addresses
+    return 0xFFFF000000000000ULL | qHash(req.sock->peerAddress());
 }
 
-/*! Set and process device type.
+/*! Returns a keyed digest of \p auth which can be cached in memory without revealing the credentials.
  */
-void ApiAuth::setDeviceType(const QString &devtype)
+static QByteArray authCacheDigest(const QString &auth)
 {
-    devicetype = devtype;
+    static QByteArray key;
+
+    if (key.isEmpty())
+    {
+        key.resize(32);
+        CRYPTO_RandomBytes(reinterpret_cast<unsigned char*>(key.data()), unsigned(key.size()));
+    }
+
+    return QMessageAuthenticationCode::hash(auth.toUtf8(), key, QCryptographicHash::Sha256);
 }
 
 /*! Init authentication.
@@ -66,8 +83,33 @@ void DeRestPluginPrivate::initAuthentication()
 
 /*! Use HTTP basic authentication or HMAC token to check if the request
     has valid credentials to create API key.
+
+    Failed credential checks are rate limited per client address. Requests without
+    credentials, like apps polling while the link button isn't pressed, aren't counted.
  */
 bool DeRestPluginPrivate::allowedToCreateApikey(const ApiRequest &req, ApiResponse &rsp, QVariantMap &map)
+{
+    if (!req.hdr.hasKey(QLatin1String("Authorization")) && !map.contains(QLatin1String("hmac-sha256")))
+    {
+        return verifyApikeyCredentials(req, rsp, map);
+    }
+
+    const quint64 source = AUTH_RateLimitSource(req);
+
+    if (!apikeyRateLimiter.begin(source, deCONZ::steadyTimeRef().ref))
+    {
+        DBG_Printf(DBG_INFO, "create API key rate limited for 0x%016llX\n", source);
+        rsp.httpStatus = HttpStatusForbidden;
+        rsp.list.append(errorToMap(ERR_UNAUTHORIZED_USER, "/", "too many failed attempts"));
+        return false;
+    }
+
+    const bool result = verifyApikeyCredentials(req, rsp, map);
+    apikeyRateLimiter.end(source, result, deCONZ::steadyTimeRef().ref);
+    return result;
+}
+
+bool DeRestPluginPrivate::verifyApikeyCredentials(const ApiRequest &req, ApiResponse &rsp, QVariantMap &map)
 {
     if (req.hdr.hasKey(QLatin1String("Authorization")))
     {
@@ -76,17 +118,22 @@ bool DeRestPluginPrivate::allowedToCreateApikey(const ApiRequest &req, ApiRespon
 
         if ((ls.size() > 1) && ls[0] == "Basic")
         {
+            // repeated requests with the same credentials skip crypt()
+            const QByteArray digest = authCacheDigest(auth);
+            if (!gwAdminAuthCache.isEmpty() && gwAdminAuthCacheHash == gwAdminPasswordHash && digest == gwAdminAuthCache)
+            {
+                return true;
+            }
+
             std::string pwhash = ls[1].toStdString();
             std::string enc = CRYPTO_EncryptGatewayPassword(pwhash);
 
-            if (enc == gwAdminPasswordHash)
+            if (enc == gwAdminPasswordHash || pwhash == gwAdminPasswordHash) // on Windows plain hash was stored
             {
+                gwAdminAuthCache = digest;
+                gwAdminAuthCacheHash = gwAdminPasswordHash;
                 return true;
             }
-            else if (pwhash == gwAdminPasswordHash)
-            {
-                return true; // on Windows plain hash was stored
-            }
 
             DBG_Printf(DBG_INFO, "Invalid admin password hash\n");
         }
@@ -149,54 +196,51 @@ void DeRestPluginPrivate::authorise(ApiRequest &req, ApiResponse &rsp)
         return;
     }
 
-    std::vector<ApiAuth>::iterator i = apiAuths.begin();
-    std::vector<ApiAuth>::iterator end = apiAuths.end();
+    const int pos = apiAuthIndex.find(apiAuths, apikey);
 
-    for (size_t pos = 0; i != end; ++i, pos++)
+    if (pos >= 0)
     {
-        if (apikey == i->apikey && i->state == ApiAuth::StateNormal)
-        {
-            apiAuthCurrent = pos;
-            i->lastUseDate = QDateTime::currentDateTimeUtc();
+        ApiAuth *i = &apiAuths[size_t(pos)];
+        apiAuthCurrent = size_t(pos);
+        // batched, converted into lastUseDate by API_FlushLastUse() before saving
+        i->lastUseMs = deCONZ::steadyTimeRef().ref;
 
-            // fill in useragent string if not already exist
-            if (i->useragent.isEmpty())
+        // fill in useragent string if not already exist
+        if (i->useragent.isEmpty())
+        {
+            if (req.hdr.hasKey(QLatin1String("User-Agent")))
             {
-                if (req.hdr.hasKey(QLatin1String("User-Agent")))
-                {
-                    i->useragent = req.hdr.value(QLatin1String("User-Agent"));
-                    DBG_Printf(DBG_HTTP, "set useragent '%s' for apikey '%s'\n", qPrintable(i->useragent), qPrintable(i->apikey));
-                }
+                i->useragent = req.hdr.value(QLatin1String("User-Agent"));
+                DBG_Printf(DBG_HTTP, "set useragent '%s' for apikey '%s'\n", qPrintable(i->useragent), qPrintable(i->apikey));
             }
+        }
 
-            if ((!(i->useragent.isEmpty()) && i->useragent.startsWith(QLatin1String("iConnect"))) || i->devicetype.startsWith(QLatin1String("iConnectHue")))
-            {
-                req.mode = ApiModeStrict;
-            }
-            else if (i->devicetype.startsWith(QLatin1String("Echo")))
-            {
-                req.mode = ApiModeEcho;
-            }
-            else if (i->devicetype.startsWith(QLatin1String("Hue Essentials")))
-            {
-                // supports deCONZ specifics
-            }
-            else if (i->devicetype.startsWith(QLatin1String("hue_")) ||
-                     i->devicetype.startsWith(QLatin1String("Hue ")) ||
-                     gwHueMode)
-            {
-                req.mode = ApiModeHue;
-            }
-            DBG_Printf(DBG_HTTP, "ApiMode: %d\n", req.mode);
+        if ((!(i->useragent.isEmpty()) && i->useragent.startsWith(QLatin1String("iConnect"))) || i->devicetype.startsWith(QLatin1String("iConnectHue")))
+        {
+            req.mode = ApiModeStrict;
+        }
+        else if (i->devicetype.startsWith(QLatin1String("Echo")))
+        {
+            req.mode = ApiModeEcho;
+        }
+        else if (i->devicetype.startsWith(QLatin1String("Hue Essentials")))
+        {
+            // supports deCONZ specifics
+        }
+        else if (i->devicetype.startsWith(QLatin1String("hue_")) ||
+                 i->devicetype.startsWith(QLatin1String("Hue ")) ||
+                 gwHueMode)
+        {
+            req.mode = ApiModeHue;
+        }
+        DBG_Printf(DBG_HTTP, "ApiMode: %d\n", req.mode);
 
-            i->needSaveDatabase = true;
-            if (!apiAuthSaveDatabaseTime.isValid() || apiAuthSaveDatabaseTime.elapsed() > (1000 * 60 * 30))
-            {
-                apiAuthSaveDatabaseTime.start();
-                queSaveDb(DB_AUTH, DB_HUGE_SAVE_DELAY);
-            }
-            req.auth = ApiAuthFull;
+        if (!apiAuthSaveDatabaseTime.isValid() || apiAuthSaveDatabaseTime.elapsed() > (1000 * 60 * 30))
+        {
+            apiAuthSaveDatabaseTime.start();
+            queSaveDb(DB_AUTH, DB_HUGE_SAVE_DELAY);
         }
+        req.auth = ApiAuthFull;
     }
 
 #if 0
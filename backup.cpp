@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023 dresden elektronik ingenieurtechnik gmbh.
+ * Copyright (c) 2021-2024 dresden elektronik ingenieurtechnik gmbh.
  * All rights reserved.
  *
  * The software in this package is published under the terms of the BSD
@@ -11,19 +11,22 @@
 #include <QCoreApplication>
 #include <QDateTime>
 #include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
 #include <QFile>
-#include <QProcess>
-#include <QTextStream>
+#include <QFileInfo>
+#include <QTimer>
 #include <array>
-#include <stack>
+#include <cstdio>
+#include <vector>
+#include <sqlite3.h>
 #include "deconz/aps_controller.h"
 #include "deconz/dbg_trace.h"
 #include "deconz/util.h"
 #include "backup.h"
 #include "json.h"
 #include "crypto/random.h"
-
-#define EXT_PROCESS_TIMEOUT 30000
+#include "utils/targz.h"
 
 using TmpFiles = std::array<const char*, 3>;
 
@@ -47,23 +50,438 @@ static bool cleanupTemporaryFiles(const QString &path, const TmpFiles &files)
     return true;
 }
 
-/*! Export the deCONZ network settings to a file.
+/*! State of the running asynchronous export.
+
+    The export is split in small steps which are processed by BAK_ExportStep() on the
+    event loop, so the REST-API and Zigbee processing continue while a backup is created.
  */
-bool BAK_ExportConfiguration(deCONZ::ApsController *apsCtrl)
+struct BAK_ExportContext
 {
-    if (!apsCtrl)
+    struct Entry
+    {
+        QString name; // name in archive
+        QString filePath; // source file or empty if data is used
+        QByteArray data;
+    };
+
+    BAK_ExportStatus status;
+    QElapsedTimer timer;
+    QString path;
+    QByteArray conf;
+    sqlite3 *srcDb = nullptr; // connection of the plugin, not owned
+    sqlite3 *dstDb = nullptr;
+    sqlite3_backup *backup = nullptr;
+    TarGzWriter tgz;
+    std::vector<Entry> entries;
+    size_t entryIndex = 0;
+    QFile entryFile;
+    bool entryStarted = false;
+    qint64 totalBytes = 0;
+    qint64 doneBytes = 0;
+};
+
+static BAK_ExportContext *exportCtx = nullptr;
+
+#define BAK_SNAPSHOT_FILE "/zll-backup.db"
+#define BAK_ARCHIVE_PART_FILE "/deCONZ.tar.gz.part"
+#define BAK_PAGES_PER_STEP 64
+#define BAK_BYTES_PER_STEP (64 * 1024)
+
+static void exportCloseSnapshot(BAK_ExportContext *ctx)
+{
+    if (ctx->backup)
+    {
+        sqlite3_backup_finish(ctx->backup);
+        ctx->backup = nullptr;
+    }
+
+    if (ctx->dstDb)
+    {
+        sqlite3_close(ctx->dstDb);
+        ctx->dstDb = nullptr;
+    }
+
+    ctx->srcDb = nullptr;
+}
+
+static void exportFinish(BAK_ExportContext *ctx, BAK_ExportState state)
+{
+    exportCloseSnapshot(ctx);
+
+    if (ctx->entryFile.isOpen())
+    {
+        ctx->entryFile.close();
+    }
+
+    if (state == BAK_ExportFailed)
+    {
+        ctx->tgz.abort();
+    }
+
+    cleanupTemporaryFiles(ctx->path, { BAK_SNAPSHOT_FILE, BAK_ARCHIVE_PART_FILE, nullptr });
+
+    ctx->status.state = state;
+    ctx->status.duration = ctx->timer.elapsed();
+    if (state == BAK_ExportDone)
+    {
+        ctx->status.progress = 100;
+    }
+
+    DBG_Printf(DBG_INFO, "backup: export %s after %d ms, %d bytes\n", BAK_ExportStateToString(state), int(ctx->status.duration), int(ctx->status.bytesWritten));
+}
+
+/*! Collects the files which go into the archive after the database snapshot is complete.
+ */
+static void exportCollectEntries(BAK_ExportContext *ctx)
+{
+    const QString &path = ctx->path;
+
+    ctx->entries.push_back({QLatin1String("deCONZ.conf"), QString(), ctx->conf});
+    ctx->entries.push_back({QLatin1String("zll.db"), path + QLatin1String(BAK_SNAPSHOT_FILE), {}});
+
+    if (QFile::exists(path + QLatin1String("/session.default")))
     {
+        ctx->entries.push_back({QLatin1String("session.default"), path + QLatin1String("/session.default"), {}});
+    }
+
+#ifdef Q_OS_LINUX
+    // homebridge files are read directly, no temporary copies needed
+    const QString homebridgePersistPath = "/home/pi/.homebridge/persist"; // TODO: get mainuser
+    const QStringList filters{ "AccessoryInfo*", "IdentifierCache*" };
+
+    const QDir dir(homebridgePersistPath);
+    if (dir.exists())
+    {
+        const QStringList files = dir.entryList(filters, QDir::Files);
+        for (int i = 0; i < files.size() && i < 2; i++)
+        {
+            ctx->entries.push_back({files.at(i), homebridgePersistPath + "/" + files.at(i), {}});
+        }
+    }
+
+    // add homebridge-install logfiles to archive
+    const QString logDir = path + QLatin1String("/homebridge-install-logfiles");
+    QDirIterator it(logDir, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext())
+    {
+        const QString filePath = it.next();
+        ctx->entries.push_back({QLatin1String("homebridge-install-logfiles") + filePath.mid(logDir.size()), filePath, {}});
+    }
+#endif
+
+    ctx->totalBytes = 0;
+    for (const auto &e : ctx->entries)
+    {
+        ctx->totalBytes += e.filePath.isEmpty() ? e.data.size() : QFileInfo(e.filePath).size();
+    }
+}
+
+/*! Snapshot step: copies a few database pages via the sqlite3 online backup API.
+ */
+static bool exportSnapshotStep(BAK_ExportContext *ctx)
+{
+    const int rc = sqlite3_backup_step(ctx->backup, BAK_PAGES_PER_STEP);
+
+    if (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED)
+    {
+        const int total = sqlite3_backup_pagecount(ctx->backup);
+        const int remaining = sqlite3_backup_remaining(ctx->backup);
+        if (total > 0)
+        {
+            ctx->status.progress = ((total - remaining) * 50) / total;
+        }
+        return true;
+    }
+
+    if (rc != SQLITE_DONE)
+    {
+        DBG_Printf(DBG_ERROR, "backup: database snapshot failed: %s\n", sqlite3_errstr(rc));
+        exportFinish(ctx, BAK_ExportFailed);
         return false;
     }
 
-    const QString path = deCONZ::getStorageLocation(deCONZ::ApplicationsDataLocation);
+    exportCloseSnapshot(ctx);
+    exportCollectEntries(ctx);
+
+    if (!ctx->tgz.open(ctx->path + QLatin1String(BAK_ARCHIVE_PART_FILE)))
+    {
+        exportFinish(ctx, BAK_ExportFailed);
+        return false;
+    }
+
+    ctx->status.state = BAK_ExportArchive;
+    ctx->status.progress = 50;
+    return true;
+}
+
+/*! Moves \p from to \p to, an existing \p to is replaced atomically where the platform supports it.
+ */
+static bool replaceFile(const QString &from, const QString &to)
+{
+    if (std::rename(QFile::encodeName(from).constData(), QFile::encodeName(to).constData()) == 0)
+    {
+        return true;
+    }
+
+    // Windows doesn't replace existing files
+    return (!QFile::exists(to) || QFile::remove(to)) && QFile::rename(from, to);
+}
+
+/*! Archive step: streams at most BAK_BYTES_PER_STEP bytes into the archive.
+ */
+static bool exportArchiveStep(BAK_ExportContext *ctx)
+{
+    qint64 budget = BAK_BYTES_PER_STEP;
+
+    while (budget > 0 && ctx->entryIndex < ctx->entries.size())
+    {
+        BAK_ExportContext::Entry &e = ctx->entries[ctx->entryIndex];
+
+        if (!ctx->entryStarted)
+        {
+            qint64 size = e.data.size();
+            qint64 mtime = QDateTime::currentSecsSinceEpoch();
+
+            if (!e.filePath.isEmpty())
+            {
+                ctx->entryFile.setFileName(e.filePath);
+                if (!ctx->entryFile.open(QIODevice::ReadOnly))
+                {
+                    DBG_Printf(DBG_INFO, "backup: skip %s, can't be opened\n", qPrintable(e.filePath));
+                    ctx->entryIndex++;
+                    continue;
+                }
+                size = ctx->entryFile.size();
+                mtime = QFileInfo(e.filePath).lastModified().toSecsSinceEpoch();
+            }
+
+            if (!ctx->tgz.beginFile(e.name, size, mtime))
+            {
+                exportFinish(ctx, BAK_ExportFailed);
+                return false;
+            }
+            ctx->entryStarted = true;
+        }
+
+        bool entryDone = false;
+
+        if (e.filePath.isEmpty())
+        {
+            if (!ctx->tgz.write(e.data.constData(), e.data.size()))
+            {
+                exportFinish(ctx, BAK_ExportFailed);
+                return false;
+            }
+            budget -= e.data.size();
+            ctx->doneBytes += e.data.size();
+            entryDone = true;
+        }
+        else
+        {
+            const QByteArray chunk = ctx->entryFile.read(budget);
+            if (!chunk.isEmpty() && !ctx->tgz.write(chunk.constData(), chunk.size()))
+            {
+                exportFinish(ctx, BAK_ExportFailed);
+                return false;
+            }
+            budget -= chunk.size();
+            ctx->doneBytes += chunk.size();
+            entryDone = ctx->entryFile.atEnd() || chunk.isEmpty();
+        }
+
+        if (entryDone)
+        {
+            if (ctx->entryFile.isOpen())
+            {
+                ctx->entryFile.close();
+            }
+
+            if (!ctx->tgz.endFile())
+            {
+                exportFinish(ctx, BAK_ExportFailed);
+                return false;
+            }
+            ctx->entryStarted = false;
+            ctx->entryIndex++;
+        }
+    }
+
+    ctx->status.bytesWritten = ctx->tgz.bytesWritten();
+    if (ctx->totalBytes > 0)
+    {
+        ctx->status.progress = 50 + int((ctx->doneBytes * 49) / ctx->totalBytes);
+    }
+
+    if (ctx->entryIndex < ctx->entries.size())
+    {
+        return true;
+    }
+
+    const QString archivePath = ctx->path + QLatin1String("/deCONZ.tar.gz");
+    if (!ctx->tgz.close() || !replaceFile(ctx->path + QLatin1String(BAK_ARCHIVE_PART_FILE), archivePath))
+    {
+        DBG_Printf(DBG_ERROR, "backup: failed to create %s\n", qPrintable(archivePath));
+        exportFinish(ctx, BAK_ExportFailed);
+        return false;
+    }
+
+    ctx->status.bytesWritten = QFileInfo(archivePath).size();
+    exportFinish(ctx, BAK_ExportDone);
+    return false;
+}
+
+const char *BAK_ExportStateToString(BAK_ExportState state)
+{
+    switch (state)
+    {
+    case BAK_ExportIdle: return "idle";
+    case BAK_ExportSnapshot: return "snapshot";
+    case BAK_ExportArchive: return "archive";
+    case BAK_ExportDone: return "done";
+    case BAK_ExportFailed: return "failed";
+    }
+
+    return "unknown";
+}
+
+/*! Starts exporting the database of connection \p db and related files in \p path into \p path/deCONZ.tar.gz.
 
-    // cleanup older files
-    if (!cleanupTemporaryFiles(path, { "/deCONZ.conf", "/deCONZ.tar", "/deCONZ.tar.gz" }))
+    The database is copied with the sqlite3 online backup API into a consistent snapshot.
+    \p db must be the connection the plugin writes through: sqlite applies these writes to
+    the pages already copied, while a write by any other connection restarts the copy.
+    The backup keeps \p db busy, sqlite3_close() returns SQLITE_BUSY until the snapshot is done.
+    \p conf is stored as deCONZ.conf in the archive.
+    \returns false if an export is already running or it can't be started.
+ */
+bool BAK_StartExport(const QString &path, const QByteArray &conf, sqlite3 *db)
+{
+    if (!exportCtx)
     {
+        exportCtx = new BAK_ExportContext;
+    }
+
+    BAK_ExportContext *ctx = exportCtx;
+
+    if (ctx->status.state == BAK_ExportSnapshot || ctx->status.state == BAK_ExportArchive)
+    {
+        DBG_Printf(DBG_INFO, "backup: export already running\n");
         return false;
     }
 
+    // cleanup older files, a previous deCONZ.tar.gz stays until the new one replaces it
+    if (!cleanupTemporaryFiles(path, { "/deCONZ.conf", "/deCONZ.tar", nullptr }) ||
+        !cleanupTemporaryFiles(path, { BAK_SNAPSHOT_FILE, BAK_ARCHIVE_PART_FILE, nullptr }))
+    {
+        return false;
+    }
+
+    ctx->status = BAK_ExportStatus();
+    ctx->timer.start();
+    ctx->path = path;
+    ctx->conf = conf;
+    ctx->entries.clear();
+    ctx->entryIndex = 0;
+    ctx->entryStarted = false;
+    ctx->totalBytes = 0;
+    ctx->doneBytes = 0;
+
+    const QByteArray dstPath = QString(path + QLatin1String(BAK_SNAPSHOT_FILE)).toUtf8();
+
+    ctx->srcDb = db;
+    if (!ctx->srcDb ||
+        sqlite3_open_v2(dstPath.constData(), &ctx->dstDb, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr) != SQLITE_OK)
+    {
+        DBG_Printf(DBG_ERROR, "backup: failed to open database for snapshot\n");
+        exportFinish(ctx, BAK_ExportFailed);
+        return false;
+    }
+
+    ctx->backup = sqlite3_backup_init(ctx->dstDb, "main", ctx->srcDb, "main");
+
+    if (!ctx->backup)
+    {
+        DBG_Printf(DBG_ERROR, "backup: failed to init snapshot: %s\n", sqlite3_errmsg(ctx->dstDb));
+        exportFinish(ctx, BAK_ExportFailed);
+        return false;
+    }
+
+    ctx->status.state = BAK_ExportSnapshot;
+    return true;
+}
+
+/*! Processes one step of a running export, should be called until it returns false.
+ */
+bool BAK_ExportStep()
+{
+    if (!exportCtx)
+    {
+        return false;
+    }
+
+    switch (exportCtx->status.state)
+    {
+    case BAK_ExportSnapshot: return exportSnapshotStep(exportCtx);
+    case BAK_ExportArchive: return exportArchiveStep(exportCtx);
+    default:
+        break;
+    }
+
+    return false;
+}
+
+/*! Processes all remaining steps of a running export.
+    \returns true if deCONZ.tar.gz was written.
+ */
+bool BAK_FinishExport()
+{
+    while (BAK_ExportStep())
+    {
+    }
+
+    return BAK_GetExportStatus().state == BAK_ExportDone;
+}
+
+BAK_ExportStatus BAK_GetExportStatus()
+{
+    if (exportCtx)
+    {
+        BAK_ExportStatus status = exportCtx->status;
+        if (status.state == BAK_ExportSnapshot || status.state == BAK_ExportArchive)
+        {
+            status.duration = exportCtx->timer.elapsed();
+        }
+        return status;
+    }
+
+    return {};
+}
+
+static void scheduleExportStep()
+{
+    QTimer::singleShot(0, qApp, []()
+    {
+        if (BAK_ExportStep())
+        {
+            scheduleExportStep();
+        }
+    });
+}
+
+/*! Starts exporting the deCONZ network settings and database to deCONZ.tar.gz.
+
+    The export runs asynchronously on the event loop, BAK_GetExportStatus() reports the progress.
+    \p db is the open database connection of the plugin, see BAK_StartExport().
+ */
+bool BAK_ExportConfiguration(deCONZ::ApsController *apsCtrl, sqlite3 *db)
+{
+    if (!apsCtrl)
+    {
+        return false;
+    }
+
+    const QString path = deCONZ::getStorageLocation(deCONZ::ApplicationsDataLocation);
+    QByteArray conf;
+
     {
         uint8_t deviceType = apsCtrl->getParameter(deCONZ::ParamDeviceType);
         uint16_t panId = apsCtrl->getParameter(deCONZ::ParamPANID);
@@ -131,162 +549,15 @@ bool BAK_ExportConfiguration(deCONZ::ApsController *apsCtrl)
             return false;
         }
 
-        // put config as JSON object in file
-        QFile configFile(path + "/deCONZ.conf");
-        if (configFile.open(QIODevice::ReadWrite))
-        {
-            QTextStream stream(&configFile);
-            stream << saveString << "\n";
-            configFile.close();
-        }
+        conf = saveString.toUtf8() + '\n';
     }
 
-    if (QFile::exists(path + "/deCONZ.conf"))
-    {
-        //create .tar
-        QProcess archProcess;
-
-#ifdef Q_OS_WIN
-        const QString appPath = qApp->applicationDirPath();
-        {
-            if (!QFile::exists(appPath + "/7za.exe"))
-            {
-                DBG_Printf(DBG_INFO, "7z not found: %s\n", qPrintable(appPath + "/7za.exe"));
-                return false;
-            }
-            QString cmd = appPath + "/7za.exe";
-            QStringList args;
-            args.append("a");
-            args.append(path + "/deCONZ.tar");
-            args.append(path + "/deCONZ.conf");
-            args.append(path + "/zll.db");
-            args.append(path + "/session.default");
-            archProcess.start(cmd, args);
-        }
-#endif
-
-#ifdef Q_OS_LINUX
-        // clean up old homebridge backup files
-        const QStringList filters{ "AccessoryInfo*", "IdentifierCache*" };
-
-        {
-            QDir appDir(path);
-            const QStringList files = appDir.entryList(filters);
-
-            for (const auto &f : files)
-            {
-                const QString filePath = path + "/" + f;
-                if (QFile::exists(filePath))
-                {
-                    if (QFile::remove(filePath))
-                    {
-                        DBG_Printf(DBG_INFO, "backup: removed temporary homebridge file %s\n", qPrintable(filePath));
-                    }
-                    else
-                    {
-                        DBG_Printf(DBG_ERROR, "backup: failed to remove temporary homebridge file %s\n", qPrintable(filePath));
-                        return false;
-                    }
-                }
-            }
-        }
-
-        // backup homebridge files
-        const QString homebridgePersistPath = "/home/pi/.homebridge/persist"; // TODO: get mainuser
-
-        QString FirstFileName ="";
-        QString SecondFileName ="";
-
-        QDir dir(homebridgePersistPath);
-        if (dir.exists())
-        {
-            QStringList files = dir.entryList(filters);
-
-            if (files.size() > 0)
-            {
-                FirstFileName = files.at(0);
-                DBG_Printf(DBG_INFO, "copy file: %s to backup directory\n", qPrintable(FirstFileName));
-                QFile accessoryFile(homebridgePersistPath + "/" + FirstFileName);
-                if (!accessoryFile.copy(path + "/" + FirstFileName))
-                {
-                    DBG_Printf(DBG_INFO, "copy file: %s failed. Do not include it in backup\n", qPrintable(FirstFileName));
-                    FirstFileName = "";
-                    return false;
-                }
-
-            }
-            if (files.size() > 1)
-            {
-                SecondFileName = files.at(1);
-                DBG_Printf(DBG_INFO, "copy file: %s to backup directory\n", qPrintable(SecondFileName));
-                QFile IdentifierFile(homebridgePersistPath + "/" + SecondFileName);
-                if (!IdentifierFile.copy(path + "/" + SecondFileName))
-                {
-                    DBG_Printf(DBG_INFO, "copy file: %s failed. Do not include it in backup\n", qPrintable(SecondFileName));
-                    SecondFileName = "";
-                    return false;
-                }
-            }
-        }
-
-        // add homebridge-install logfiles to archive
-        QString logfilesDirectories = "";
-        QDir homebridgeInstallLogDir(path + "/homebridge-install-logfiles");
-        if (homebridgeInstallLogDir.exists())
-        {
-            logfilesDirectories += QLatin1String("homebridge-install-logfiles");
-        }
-#endif
-#ifdef Q_OS_UNIX
-        {
-            QStringList args;
-            args.append("-cf");
-            args.append(path + "/deCONZ.tar");
-            args.append("-C");
-            args.append(path);
-            args.append("deCONZ.conf");
-            args.append("zll.db");
-            args.append("session.default");
-#ifdef Q_OS_LINUX
-            args.append(FirstFileName);
-            args.append(SecondFileName);
-            args.append(logfilesDirectories);
-#endif
-            archProcess.start("tar", args);
-        }
-#endif
-        archProcess.waitForFinished(EXT_PROCESS_TIMEOUT);
-        DBG_Printf(DBG_INFO, "%s\n", qPrintable(archProcess.readAllStandardOutput()));
-
-        //create .tar.gz
-        {
-            QProcess zipProcess;
-            QStringList args;
-#ifdef Q_OS_WIN
-            QString cmd = appPath + "/7za.exe";
-
-            args.append("a");
-            args.append(path + "/deCONZ.tar.gz");
-            args.append(path + "/deCONZ.tar");
-            zipProcess.start(cmd, args);
-#endif
-#ifdef Q_OS_UNIX
-            args.append("-k");
-            args.append("-f");
-            args.append(path + "/deCONZ.tar");
-            zipProcess.start("gzip", args);
-#endif
-            zipProcess.waitForFinished(EXT_PROCESS_TIMEOUT);
-            DBG_Printf(DBG_INFO, "%s\n", qPrintable(zipProcess.readAllStandardOutput()));
-        }
-    }
-
-    //cleanup
-    if (!cleanupTemporaryFiles(path, { "/deCONZ.conf", "/deCONZ.tar" }))
+    if (!BAK_StartExport(path, conf, db))
     {
         return false;
     }
 
+    scheduleExportStep();
     return true;
 }
 
@@ -333,53 +604,24 @@ bool BAK_ImportConfiguration(deCONZ::ApsController *apsCtrl)
      }
  #endif
 
-    if (QFile::exists(path + QLatin1String("/deCONZ.tar.gz")))
     {
-        // decompress .tar.gz
-        QProcess archProcess;
-        QStringList args;
+        // unpack .tar.gz (or plain .tar) in-process
+        QString archivePath = path + QLatin1String("/deCONZ.tar.gz");
+        if (!QFile::exists(archivePath))
+        {
+            archivePath = path + QLatin1String("/deCONZ.tar");
+        }
 
-#ifdef Q_OS_WIN
-        const QString appPath = qApp->applicationDirPath();
-        const QString cmd = appPath + "/7za.exe";
-        args.append("e");
-        args.append("-y");
-        args.append(path + "/deCONZ.tar.gz");
-        args.append("-o" + path);
-        archProcess.start(cmd, args);
-#endif
-#ifdef Q_OS_UNIX
-        args.append("-df");
-        args.append(path + "/deCONZ.tar.gz");
-        archProcess.start("gzip", args);
-#endif
-        archProcess.waitForFinished(EXT_PROCESS_TIMEOUT);
-        DBG_Printf(DBG_INFO, "%s\n", qPrintable(archProcess.readAllStandardOutput()));
-    }
-
-    if (QFile::exists(path + QLatin1String("/deCONZ.tar")))
-    {
-        // unpack .tar
-        QProcess zipProcess;
-        QStringList args;
-#ifdef Q_OS_WIN
-        const  QString appPath = qApp->applicationDirPath();
-        const QString cmd = appPath + "/7za.exe";
-        args.append("e");
-        args.append("-y");
-        args.append(path + "/deCONZ.tar");
-        args.append("-o" + path);
-        zipProcess.start(cmd, args);
-#endif
-#ifdef Q_OS_UNIX
-        args.append("-xf");
-        args.append(path + "/deCONZ.tar");
-        args.append("-C");
-        args.append(path);
-        zipProcess.start("tar", args);
-#endif
-        zipProcess.waitForFinished(EXT_PROCESS_TIMEOUT);
-        DBG_Printf(DBG_INFO, "%s\n", qPrintable(zipProcess.readAllStandardOutput()));
+        QStringList files;
+        if (QFile::exists(archivePath) && !TGZ_Extract(archivePath, path, &files))
+        {
+            DBG_Printf(DBG_ERROR, "backup: failed to extract %s\n", qPrintable(archivePath));
+        }
+
+        for (const auto &f : files)
+        {
+            DBG_Printf(DBG_INFO, "backup: extracted %s\n", qPrintable(f));
+        }
     }
 
     QVariantMap map;
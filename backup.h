@@ -11,11 +11,38 @@
 #ifndef BACKUP_H
 #define BACKUP_H
 
+#include <QByteArray>
+#include <QString>
+
 namespace deCONZ {
     class ApsController;
 }
 
-bool BAK_ExportConfiguration(deCONZ::ApsController *apsCtrl);
+struct sqlite3;
+
+enum BAK_ExportState
+{
+    BAK_ExportIdle,
+    BAK_ExportSnapshot, //! incremental sqlite3 backup of zll.db from the plugin connection
+    BAK_ExportArchive,  //! streaming files into deCONZ.tar.gz
+    BAK_ExportDone,
+    BAK_ExportFailed
+};
+
+struct BAK_ExportStatus
+{
+    BAK_ExportState state = BAK_ExportIdle;
+    int progress = 0; //! 0..100 %
+    qint64 bytesWritten = 0; //! size of the archive so far
+    qint64 duration = 0; //! milliseconds since start
+};
+
+bool BAK_ExportConfiguration(deCONZ::ApsController *apsCtrl, sqlite3 *db);
+bool BAK_StartExport(const QString &path, const QByteArray &conf, sqlite3 *db);
+bool BAK_ExportStep();
+bool BAK_FinishExport();
+BAK_ExportStatus BAK_GetExportStatus();
+const char *BAK_ExportStateToString(BAK_ExportState state);
 bool BAK_ImportConfiguration(deCONZ::ApsController *apsCtrl);
 bool BAK_ResetConfiguration(deCONZ::ApsController *apsCtrl, bool resetGW, bool deleteDB);
 
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include <algorithm>
+#include "binding_scheduler.h"
+
+size_t BindingTaskKeyHash::operator()(const BindingTaskKey &key) const
+{
+    // FNV-1a style mixing of all fields
+    uint64_t h = 14695981039346656037ULL;
+    const uint64_t parts[] = {
+        key.srcAddress,
+        key.dstAddress,
+        uint64_t(key.clusterId) | uint64_t(key.srcEndpoint) << 16 | uint64_t(key.dstEndpoint) << 24 |
+        uint64_t(key.dstAddrMode) << 32 | uint64_t(key.action) << 40
+    };
+
+    for (uint64_t p : parts)
+    {
+        h ^= p;
+        h *= 1099511628211ULL;
+        h ^= h >> 29;
+    }
+
+    return size_t(h);
+}
+
+/*! Adds \p key to the index.
+    \returns false if a task with the same key is already queued.
+ */
+bool BindingScheduler::insert(const BindingTaskKey &key)
+{
+    if (m_keys.empty())
+    {
+        m_tickRef = 0; // don't count the idle time before the first task
+    }
+    return m_keys.insert(key).second;
+}
+
+/*! Removes \p key from the index, must be called when the task is erased from the queue.
+ */
+void BindingScheduler::remove(const BindingTaskKey &key)
+{
+    m_keys.erase(key);
+}
+
+/*! Forgets all queued tasks and requests on-air.
+ */
+void BindingScheduler::clear()
+{
+    m_keys.clear();
+    m_tickRef = 0;
+    beginPass();
+}
+
+/*! Resets the on-air counters, the caller adds all tasks in progress afterwards.
+ */
+void BindingScheduler::beginPass()
+{
+    m_activePerDevice.clear();
+    m_active = 0;
+}
+
+/*! Returns true if another bind request to \p device may be sent.
+ */
+bool BindingScheduler::canStart(uint64_t device) const
+{
+    return m_active < MaxActive && active(device) < MaxActivePerDevice;
+}
+
+void BindingScheduler::addActive(uint64_t device)
+{
+    m_activePerDevice[device]++;
+    m_active++;
+}
+
+void BindingScheduler::removeActive(uint64_t device)
+{
+    auto i = m_activePerDevice.find(device);
+    if (i == m_activePerDevice.end())
+    {
+        return;
+    }
+
+    m_active--;
+    if (--i->second == 0)
+    {
+        m_activePerDevice.erase(i);
+    }
+}
+
+int BindingScheduler::active(uint64_t device) const
+{
+    const auto i = m_activePerDevice.find(device);
+    return i != m_activePerDevice.end() ? i->second : 0;
+}
+
+/*! Returns the full seconds passed since the previous call, the remainder is carried over.
+    The first call returns 0.
+ */
+int BindingScheduler::elapsedSeconds(int64_t nowMs)
+{
+    if (m_tickRef == 0 || nowMs < m_tickRef)
+    {
+        m_tickRef = nowMs;
+        return 0;
+    }
+
+    const int64_t dt = (nowMs - m_tickRef) / 1000;
+    m_tickRef += dt * 1000;
+    return int(dt);
+}
+
+/*! Removes \p zclSeq from the configure reporting requests of a bind task which await a response.
+    \returns true if \p zclSeq was the last outstanding request, the bind task is then finished.
+ */
+bool BS_ConfigureReportingAnswered(std::vector<uint8_t> &zclSeqNums, uint8_t zclSeq)
+{
+    const auto i = std::find(zclSeqNums.begin(), zclSeqNums.end(), zclSeq);
+    if (i == zclSeqNums.end())
+    {
+        return false; // response to another or an earlier request
+    }
+
+    zclSeqNums.erase(i);
+    return zclSeqNums.empty();
+}
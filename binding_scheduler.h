@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef BINDING_SCHEDULER_H
+#define BINDING_SCHEDULER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/*! Identity of a queued bind/unbind task, same fields as BindingTask::operator==().
+ */
+struct BindingTaskKey
+{
+    uint64_t srcAddress = 0;
+    uint64_t dstAddress = 0; //! group or extended address
+    uint16_t clusterId = 0;
+    uint8_t srcEndpoint = 0;
+    uint8_t dstEndpoint = 0;
+    uint8_t dstAddrMode = 0;
+    uint8_t action = 0;
+
+    bool operator==(const BindingTaskKey &rhs) const
+    {
+        return srcAddress == rhs.srcAddress && dstAddress == rhs.dstAddress &&
+               clusterId == rhs.clusterId && srcEndpoint == rhs.srcEndpoint &&
+               dstEndpoint == rhs.dstEndpoint && dstAddrMode == rhs.dstAddrMode &&
+               action == rhs.action;
+    }
+};
+
+struct BindingTaskKeyHash
+{
+    size_t operator()(const BindingTaskKey &key) const;
+};
+
+/*! \class BindingScheduler
+
+    Bookkeeping for the bind/unbind queue, the BindingTask storage stays with the caller.
+
+    - Queued tasks are indexed by their key, the duplicate check doesn't walk the queue.
+    - Bind requests on-air are limited per device (the ZDP destination, which is
+      the binding source) and network-wide.
+    - Task timeouts count real seconds, independent of how often the queue is processed.
+ */
+class BindingScheduler
+{
+public:
+    enum Limits
+    {
+        MaxActive = 6,
+        MaxActivePerDevice = 2
+    };
+
+    bool insert(const BindingTaskKey &key);
+    void remove(const BindingTaskKey &key);
+    bool contains(const BindingTaskKey &key) const { return m_keys.count(key) != 0; }
+    size_t size() const { return m_keys.size(); }
+    void clear();
+
+    void beginPass();
+    bool canStart(uint64_t device) const;
+    void addActive(uint64_t device);
+    void removeActive(uint64_t device);
+    int active() const { return m_active; }
+    int active(uint64_t device) const;
+
+    int elapsedSeconds(int64_t nowMs);
+
+private:
+    std::unordered_set<BindingTaskKey, BindingTaskKeyHash> m_keys;
+    std::unordered_map<uint64_t, int> m_activePerDevice;
+    int m_active = 0;
+    int64_t m_tickRef = 0;
+};
+
+bool BS_ConfigureReportingAnswered(std::vector<uint8_t> &zclSeqNums, uint8_t zclSeq);
+
+#endif // BINDING_SCHEDULER_H
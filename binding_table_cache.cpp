@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include <utility>
+#include "binding_table_cache.h"
+
+/*! Adds a page of a Mgmt_Bind_rsp.
+
+    Pages must arrive in order starting at index 0, otherwise the partial table is dropped.
+    \param entries - total number of binding table entries
+    \param records - binding table records of the page (after the list count field)
+    \returns true if the table is complete.
+ */
+bool BindingTableCache::addPage(uint64_t extAddress, uint8_t entries, uint8_t startIndex, uint8_t listCount,
+                                const uint8_t *records, size_t size, int64_t now)
+{
+    if (startIndex == 0)
+    {
+        m_pending[extAddress] = Pending();
+    }
+
+    auto i = m_pending.find(extAddress);
+    if (i == m_pending.end())
+    {
+        return false;
+    }
+
+    Pending &pending = i->second;
+
+    if (pending.nextIndex != startIndex || (listCount == 0 && startIndex < entries))
+    {
+        m_pending.erase(i); // gap or stalled, read again next time
+        return false;
+    }
+
+    pending.records.insert(pending.records.end(), records, records + size);
+    pending.nextIndex = uint8_t(pending.nextIndex + listCount);
+
+    if (pending.nextIndex < entries)
+    {
+        return false;
+    }
+
+    BindingTableCacheEntry &entry = m_tables[extAddress];
+    entry.records = std::move(pending.records);
+    entry.count = pending.nextIndex;
+    entry.timestamp = now;
+    m_pending.erase(i);
+    return true;
+}
+
+/*! Returns the cached table of \p extAddress if it's younger than MaxAge, otherwise nullptr.
+ */
+const BindingTableCacheEntry *BindingTableCache::fresh(uint64_t extAddress, int64_t now) const
+{
+    const BindingTableCacheEntry *entry = get(extAddress);
+
+    if (entry && entry->timestamp <= now && now - entry->timestamp < MaxAge)
+    {
+        return entry;
+    }
+
+    return nullptr;
+}
+
+const BindingTableCacheEntry *BindingTableCache::get(uint64_t extAddress) const
+{
+    const auto i = m_tables.find(extAddress);
+    return i != m_tables.end() ? &i->second : nullptr;
+}
+
+/*! Sets a table loaded from the database.
+ */
+void BindingTableCache::restore(uint64_t extAddress, const BindingTableCacheEntry &entry)
+{
+    m_tables[extAddress] = entry;
+}
+
+/*! Drops the cached table of \p extAddress after bindings were changed or the device rejoined.
+    \returns true if a table was cached.
+ */
+bool BindingTableCache::invalidate(uint64_t extAddress)
+{
+    m_pending.erase(extAddress);
+    return m_tables.erase(extAddress) != 0;
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef BINDING_TABLE_CACHE_H
+#define BINDING_TABLE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/*! The last complete binding table read from a device.
+ */
+struct BindingTableCacheEntry
+{
+    std::vector<uint8_t> records; //! ZDP Mgmt_Bind_rsp binding table records of all pages
+    int64_t timestamp = 0;        //! seconds since epoch when the last page was received
+    uint8_t count = 0;            //! number of records
+};
+
+/*! \class BindingTableCache
+
+    Assembles the pages of Mgmt_Bind_rsp into complete binding tables and keeps the
+    last-known table per device, so that unchanged tables don't need to be read again
+    after each restart.
+ */
+class BindingTableCache
+{
+public:
+    enum Constants
+    {
+        MaxAge = 24 * 3600 //! seconds until a cached table is read again
+    };
+
+    bool addPage(uint64_t extAddress, uint8_t entries, uint8_t startIndex, uint8_t listCount,
+                 const uint8_t *records, size_t size, int64_t now);
+    const BindingTableCacheEntry *fresh(uint64_t extAddress, int64_t now) const;
+    const BindingTableCacheEntry *get(uint64_t extAddress) const;
+    void restore(uint64_t extAddress, const BindingTableCacheEntry &entry);
+    bool invalidate(uint64_t extAddress);
+    size_t size() const { return m_tables.size(); }
+
+private:
+    struct Pending
+    {
+        std::vector<uint8_t> records;
+        uint8_t nextIndex = 0;
+    };
+
+    std::unordered_map<uint64_t, Pending> m_pending;
+    std::unordered_map<uint64_t, BindingTableCacheEntry> m_tables;
+};
+
+#endif // BINDING_TABLE_CACHE_H
@@ -13,10 +13,9 @@
 #include "device.h"
 #include "device_descriptions.h"
 #include "utils/utils.h"
+#include "zcl/configure_reporting.h"
 #include "zdp/zdp.h"
 
-#define MAX_ACTIVE_BINDING_TASKS 3
-
 /*! Constructor. */
 Binding::Binding() :
     srcAddress(0),
@@ -49,6 +48,58 @@ bool Binding::operator!=(const Binding &rhs) const
     return !(*this == rhs);
 }
 
+/*! Returns the key of the binding task, equal keys compare like BindingTask::operator==(). */
+static BindingTaskKey bindingTaskKey(const BindingTask &bt)
+{
+    BindingTaskKey key;
+    key.srcAddress = bt.binding.srcAddress;
+    key.dstAddress = bt.binding.dstAddress.ext;
+    key.clusterId = bt.binding.clusterId;
+    key.srcEndpoint = bt.binding.srcEndpoint;
+    key.dstEndpoint = bt.binding.dstEndpoint;
+    key.dstAddrMode = bt.binding.dstAddrMode;
+    key.action = uint8_t(bt.action);
+    return key;
+}
+
+/*! Returns the timeout in seconds of a binding task, sleeping end devices get more time. */
+static int bindingTaskTimeout(const BindingTask &bt)
+{
+    if (bt.restNode && bt.restNode->node() && !bt.restNode->node()->nodeDescriptor().receiverOnWhenIdle())
+    {
+        return BindingTask::TimeoutEndDevice;
+    }
+    return BindingTask::Timeout;
+}
+
+/*! Adds a legacy reporting configuration to the request of its manufacturer code in \p params.
+    The reportable change field which isn't at its default value holds the reportable change.
+ */
+static void addReportingRecord(std::vector<ZCL_ConfigureReportingParam> &params, const ConfigureReportingRequest &rq)
+{
+    ZCL_ConfigureReportingParam::Record rec{};
+    rec.attributeId = rq.attributeId;
+    rec.direction = rq.direction;
+    rec.dataType = rq.dataType;
+    rec.minInterval = rq.minInterval;
+    rec.maxInterval = rq.maxInterval;
+
+    if      (rq.reportableChange16bit != 0xFFFF)     { rec.reportableChange = rq.reportableChange16bit; }
+    else if (rq.reportableChange8bit != 0xFF)        { rec.reportableChange = rq.reportableChange8bit; }
+    else if (rq.reportableChange24bit != 0xFFFFFF)   { rec.reportableChange = rq.reportableChange24bit; }
+    else if (rq.reportableChange48bit != 0xFFFFFFFF) { rec.reportableChange = rq.reportableChange48bit; }
+
+    auto param = std::find_if(params.begin(), params.end(), [&rq](const auto &p) { return p.manufacturerCode == rq.manufacturerCode; });
+    if (param == params.end())
+    {
+        params.emplace_back();
+        param = params.end() - 1;
+        param->manufacturerCode = rq.manufacturerCode;
+    }
+
+    param->records.push_back(rec);
+}
+
 /*! Reads a binding entry from stream. */
 bool Binding::readFromStream(QDataStream &stream)
 {
@@ -188,6 +239,23 @@ bool DeRestPluginPrivate::readBindingTable(RestNodeBase *node, quint8 startIndex
         }
     }
 
+    if (startIndex == 0)
+    {
+        const BindingTableCacheEntry *cached = bindingTableCache.fresh(node->address().ext(), QDateTime::currentSecsSinceEpoch());
+        if (cached)
+        {
+            DBG_Printf(DBG_ZDP, "use cached binding table of 0x%016llX, %u entries\n", node->address().ext(), cached->count);
+
+            const QByteArray records = QByteArray::fromRawData(reinterpret_cast<const char*>(cached->records.data()), int(cached->records.size()));
+            QDataStream stream(records);
+            stream.setByteOrder(QDataStream::LittleEndian);
+
+            processBindingTableRecords(stream, cached->count);
+            finishBindingTableCheck(node->address().ext());
+            return true;
+        }
+    }
+
     BindingTableReader btReader;
     btReader.state = BindingTableReader::StateIdle;
     btReader.index = startIndex;
@@ -222,11 +290,17 @@ bool DeRestPluginPrivate::handleMgmtBindRspConfirm(const deCONZ::ApsDataConfirm
     {
         if (i->apsReq.id() == conf.id())
         {
-            if (i->state == BindingTableReader::StateWaitConfirm)
+            if (i->state == BindingTableReader::StateWaitConfirm && conf.status() == deCONZ::ApsSuccessStatus)
             {
                 i->time.start();
                 i->state = BindingTableReader::StateWaitResponse;
             }
+            else if (i->state == BindingTableReader::StateWaitConfirm)
+            {
+                DBG_Printf(DBG_ZDP, "Mgmt_Bind_req id: %d to 0x%016llX failed, APS status 0x%02X\n", conf.id(), i->apsReq.dstAddress().ext(), conf.status());
+                i->state = BindingTableReader::StateFinished;
+                bindingTableReaderTimer->start(0); // free the slot for the next reader
+            }
             return true;
         }
     }
@@ -320,7 +394,7 @@ void DeRestPluginPrivate::handleMgmtBindRspIndication(const deCONZ::ApsDataIndic
         {
             if (btReader->state == BindingTableReader::StateWaitResponse || btReader->state == BindingTableReader::StateWaitConfirm)
             {
-                // read more
+                // read more, right away
                 btReader->state = BindingTableReader::StateIdle;
                 btReader->index = startIndex + listCount;
             }
@@ -341,6 +415,37 @@ void DeRestPluginPrivate::handleMgmtBindRspIndication(const deCONZ::ApsDataIndic
         enqueueEvent({RDevices, REventBindingTable, status, ind.srcAddress().ext()}); // TODO(mpi): I think this event is obsolete and should be removed
     }
 
+    if (btReader)
+    {
+        bindingTableReaderTimer->start(0); // next page or next reader
+    }
+
+    const int recordsOffset = 5; // seq, status, entries, start index, list count
+    if (ind.asdu().size() >= recordsOffset &&
+        bindingTableCache.addPage(ind.srcAddress().ext(), entries, startIndex, listCount,
+                                  reinterpret_cast<const uint8_t*>(ind.asdu().constData()) + recordsOffset,
+                                  size_t(ind.asdu().size() - recordsOffset), QDateTime::currentSecsSinceEpoch()))
+    {
+        storeBindingTable(ind.srcAddress().ext());
+    }
+
+    processBindingTableRecords(stream, listCount);
+
+    // end, check remaining tasks
+    if (bend)
+    {
+        finishBindingTableCheck(ind.srcAddress().ext());
+    }
+}
+
+/*! Matches the records of a binding table against the binding queue.
+
+    Bind tasks of existing bindings are finished, unbind tasks in check state are started.
+    \param stream positioned at the first record
+    \param listCount number of records
+ */
+void DeRestPluginPrivate::processBindingTableRecords(QDataStream &stream, quint8 listCount)
+{
     while (listCount && !stream.atEnd())
     {
         Binding bnd;
@@ -390,33 +495,39 @@ void DeRestPluginPrivate::handleMgmtBindRspIndication(const deCONZ::ApsDataIndic
 
         listCount--;
     }
+}
 
-    // end, check remaining tasks
-    if (bend)
-    {
-        std::list<BindingTask>::iterator i = bindingQueue.begin();
-        std::list<BindingTask>::iterator end = bindingQueue.end();
+/*! Activates the binding tasks in check state of \p srcAddress after its full binding table was processed.
+ */
+void DeRestPluginPrivate::finishBindingTableCheck(quint64 srcAddress)
+{
+    std::list<BindingTask>::iterator i = bindingQueue.begin();
+    std::list<BindingTask>::iterator end = bindingQueue.end();
 
-        for (;i != end; ++i)
+    for (;i != end; ++i)
+    {
+        if (i->state == BindingTask::StateCheck &&
+            i->binding.srcAddress == srcAddress)
         {
-            if (i->state == BindingTask::StateCheck &&
-                i->binding.srcAddress == ind.srcAddress().ext())
+            // if binding was not found, activate binding task
+            if (i->action == BindingTask::ActionBind)
             {
-                // if binding was not found, activate binding task
-                if (i->action == BindingTask::ActionBind)
-                {
-                    DBG_Printf(DBG_ZDP, "binding 0x%04X, 0x%02X not found, start bind task\n", i->binding.clusterId, i->binding.dstEndpoint);
-                    i->state = BindingTask::StateIdle;
-                }
-                else if (i->action == BindingTask::ActionUnbind)
-                {
-                    // nothing to unbind
-                    DBG_Printf(DBG_ZDP, "binding 0x%04X, 0x%02X not found, remove unbind task\n", i->binding.clusterId, i->binding.dstEndpoint);
-                    i->state = BindingTask::StateFinished; // already existing
-                }
+                DBG_Printf(DBG_ZDP, "binding 0x%04X, 0x%02X not found, start bind task\n", i->binding.clusterId, i->binding.dstEndpoint);
+                i->state = BindingTask::StateIdle;
+            }
+            else if (i->action == BindingTask::ActionUnbind)
+            {
+                // nothing to unbind
+                DBG_Printf(DBG_ZDP, "binding 0x%04X, 0x%02X not found, remove unbind task\n", i->binding.clusterId, i->binding.dstEndpoint);
+                i->state = BindingTask::StateFinished; // already existing
             }
         }
     }
+
+    if (!bindingQueue.empty())
+    {
+        bindingTimer->start(0); // send the bind requests which were just activated
+    }
 }
 
 /*! Handle incoming ZCL configure reporting response.
@@ -450,65 +561,61 @@ void DeRestPluginPrivate::handleZclConfigureReportingResponseIndication(const de
 
         DBG_Assert(zclFrame.sequenceNumber() != 0);
 
-        QDataStream stream(zclFrame.payload());
-        stream.setByteOrder(QDataStream::LittleEndian);
+        // attributes of the request, the sequence number identifies the request
+        std::vector<ZCL_ReportingStatus> attrs;
+        std::vector<NodeValue*> vals;
 
-        if (zclFrame.payload().size() == 1)
+        for (NodeValue &val : restNode->zclValues())
         {
-            // Response contains a single status for all attributes
-            quint8 status;
-            stream >> status;
-
-            for (NodeValue &val : restNode->zclValues())
+            if (val.zclSeqNum == zclFrame.sequenceNumber() && val.clusterId == ind.clusterId())
             {
-                if (val.zclSeqNum != zclFrame.sequenceNumber())
-                {
-                    continue;
-                }
-
-                if (val.clusterId != ind.clusterId())
-                {
-                    continue;
-                }
+                attrs.push_back({val.attributeId, 0x00, deCONZ::ZclSuccessStatus});
+                vals.push_back(&val);
+            }
+        }
 
-                DBG_Printf(DBG_INFO, "ZCL configure reporting rsp seq: %u 0x%016llX for ep: 0x%02X cluster: 0x%04X attr: 0x%04X status: 0x%02X\n", zclFrame.sequenceNumber(), ind.srcAddress().ext(), ind.srcEndpoint(), ind.clusterId(), val.attributeId, status);
+        if (attrs.empty())
+        {
+            continue;
+        }
 
-                // mark as succefully configured
-                if (status == deCONZ::ZclSuccessStatus)
-                {
-                    val.timestampLastConfigured = now;
-                    val.zclSeqNum = 0; // clear
-                }
-            }
-            break;
+        const QByteArray &payload = zclFrame.payload();
+        if (!ZCL_ConfigureReportingRspStatus(reinterpret_cast<const uint8_t*>(payload.constData()), size_t(payload.size()), attrs.data(), attrs.size()))
+        {
+            DBG_Printf(DBG_INFO, "ZCL configure reporting rsp seq: %u 0x%016llX invalid payload\n", zclFrame.sequenceNumber(), ind.srcAddress().ext());
+            continue;
         }
 
-        while (!stream.atEnd())
+        for (size_t i = 0; i < attrs.size(); i++)
         {
-            // Response contains status per attribute
-            quint8 status;
-            quint8 direction;
-            quint16 attrId;
+            NodeValue &val = *vals[i];
+            const quint8 status = attrs[i].status;
 
-            stream >> status;
-            stream >> direction;
-            stream >> attrId;
+            DBG_Printf(DBG_INFO, "ZCL configure reporting rsp seq: %u 0x%016llX for ep: 0x%02X cluster: 0x%04X attr: 0x%04X status: 0x%02X\n", zclFrame.sequenceNumber(), ind.srcAddress().ext(), ind.srcEndpoint(), ind.clusterId(), val.attributeId, status);
 
-            NodeValue &val = restNode->getZclValue(ind.clusterId(), attrId, ind.srcEndpoint());
-            if (val.zclSeqNum == zclFrame.sequenceNumber() && val.clusterId == ind.clusterId())
+            if (status == deCONZ::ZclSuccessStatus)
             {
-                DBG_Printf(DBG_INFO, "ZCL configure reporting rsp seq: %u 0x%016llX for ep: 0x%02X cluster: 0x%04X attr: 0x%04X status: 0x%02X\n", zclFrame.sequenceNumber(), ind.srcAddress().ext(), ind.srcEndpoint(), ind.clusterId(), val.attributeId, status);
-
-                if (status == deCONZ::ZclSuccessStatus)
-                {
-                    // mark as succefully configured
-                    val.timestampLastConfigured = now;
-                    val.zclSeqNum = 0; // clear
-                }
+                // mark as succefully configured
+                val.timestampLastConfigured = now;
+                val.zclSeqNum = 0; // clear
             }
         }
     }
 
+    // the bind task was kept in progress until all its configure reporting requests are answered
+    for (BindingTask &bt : bindingQueue)
+    {
+        if (bt.state == BindingTask::StateInProgress &&
+            bt.action == BindingTask::ActionBind &&
+            bt.binding.srcAddress == ind.srcAddress().ext() &&
+            bt.binding.srcEndpoint == ind.srcEndpoint() &&
+            bt.binding.clusterId == ind.clusterId() &&
+            BS_ConfigureReportingAnswered(bt.zclSeqNums, zclFrame.sequenceNumber()))
+        {
+            bt.state = BindingTask::StateFinished;
+        }
+    }
+
     if (searchSensorsState == SearchSensorsActive && fastProbeAddr.hasExt() && bindingQueue.empty())
     {
         for (auto &s : sensors)
@@ -555,6 +662,10 @@ void DeRestPluginPrivate::handleBindAndUnbindRspIndication(const deCONZ::ApsData
             if (status == deCONZ::ZdpSuccess)
             {
                 DBG_Printf(DBG_INFO, "%s response success for 0x%016llx ep: 0x%02X cluster: 0x%04X\n", what, i->binding.srcAddress, i->binding.srcEndpoint, i->binding.clusterId);
+                if (bindingTableCache.invalidate(i->binding.srcAddress))
+                {
+                    deleteBindingTable(i->binding.srcAddress);
+                }
                 if (ind.clusterId() == ZDP_BIND_RSP_CLID)
                 {
                     if (sendConfigureReportingRequest(*i))
@@ -576,6 +687,45 @@ void DeRestPluginPrivate::handleBindAndUnbindRspIndication(const deCONZ::ApsData
     bindingTimer->start(0); // fast process of next binding requests
 }
 
+/*! Handle the APS confirm of a bind/unbind request.
+
+    A failed request is retried right away instead of waiting for the response timeout.
+    \param conf the APS confirm
+ */
+void DeRestPluginPrivate::handleBindingApsConfirm(const deCONZ::ApsDataConfirm &conf)
+{
+    if (conf.status() == deCONZ::ApsSuccessStatus || !conf.dstAddress().hasExt())
+    {
+        return;
+    }
+
+    for (BindingTask &bt : bindingQueue)
+    {
+        if (bt.state != BindingTask::StateInProgress ||
+            bt.apsReqId != conf.id() ||
+            bt.binding.srcAddress != conf.dstAddress().ext())
+        {
+            continue;
+        }
+
+        bt.retries--;
+        if (bt.retries > 0)
+        {
+            DBG_Printf(DBG_INFO_L2, "bind/unbind request to 0x%016llX failed, APS status 0x%02X, retry\n", bt.binding.srcAddress, conf.status());
+            bt.state = BindingTask::StateIdle;
+            bt.timeout = bindingTaskTimeout(bt);
+        }
+        else
+        {
+            DBG_Printf(DBG_INFO_L2, "giveup binding srcAddr: 0x%016llX, APS status 0x%02X\n", bt.binding.srcAddress, conf.status());
+            bt.state = BindingTask::StateFinished;
+        }
+
+        bindingTimer->start(0);
+        break;
+    }
+}
+
 /*! Sends a ZDP bind request.
     \param bt a binding task
  */
@@ -665,6 +815,7 @@ bool DeRestPluginPrivate::sendBindRequest(BindingTask &bt)
 
     if (apsCtrlWrapper.apsdeDataRequest(apsReq) == deCONZ::Success)
     {
+        bt.apsReqId = apsReq.id();
         return true;
     }
 
@@ -742,14 +893,9 @@ bool DeRestPluginPrivate::sendConfigureReportingRequest(BindingTask &bt, const s
         return false;
     }
 
-    if (zclSeq == 0) // don't use zero, simplify matching
-    {
-        zclSeq = 1;
-    }
-    const quint8 zclSeqNum = zclSeq++; // to match in configure reporting response handler
     LightNode *lightNode = dynamic_cast<LightNode*>(bt.restNode);
     QDateTime now = QDateTime::currentDateTime();
-    std::vector<ConfigureReportingRequest> out;
+    std::vector<ZCL_ConfigureReportingParam> params; // one per manufacturer code
 
     for (const ConfigureReportingRequest &rq : requests)
     {
@@ -772,10 +918,9 @@ bool DeRestPluginPrivate::sendConfigureReportingRequest(BindingTask &bt, const s
                     // and prevent further bind requests before reports arrive
                     val.timestampLastReport = QDateTime::currentDateTime();
                 }
-                val.zclSeqNum = zclSeqNum;
                 val.minInterval = rq.minInterval;
                 val.maxInterval = rq.maxInterval;
-                out.push_back(rq);
+                addReportingRecord(params, rq);
             }
         }
         else if (lightNode && rq.maxInterval != 0xffff /* disable reporting */)
@@ -790,96 +935,98 @@ bool DeRestPluginPrivate::sendConfigureReportingRequest(BindingTask &bt, const s
             deCONZ::NumericUnion dummy;
             dummy.u64 = 0;
             bt.restNode->setZclValue(NodeValue::UpdateByZclReport, bt.binding.srcEndpoint, bt.binding.clusterId, rq.attributeId, dummy);
-            val.zclSeqNum = zclSeqNum;
-            val.minInterval = rq.minInterval;
-            val.maxInterval = rq.maxInterval;
-            out.push_back(rq);
+            NodeValue &val2 = bt.restNode->getZclValue(bt.binding.clusterId, rq.attributeId, bt.binding.srcEndpoint);
+            val2.minInterval = rq.minInterval;
+            val2.maxInterval = rq.maxInterval;
+            addReportingRecord(params, rq);
         }
     }
 
-    if (out.empty())
+    if (params.empty())
     {
         return false;
     }
 
-    deCONZ::ApsDataRequest apsReq;
+    int sent = 0;
+    bt.zclSeqNums.clear();
 
-    // ZDP Header
-    apsReq.dstAddress() = bt.restNode->address();
-    apsReq.setDstAddressMode(deCONZ::ApsExtAddress);
-    apsReq.setDstEndpoint(bt.binding.srcEndpoint);
-    apsReq.setSrcEndpoint(endpoint());
-    apsReq.setProfileId(HA_PROFILE_ID);
-    apsReq.setRadius(0);
-    apsReq.setClusterId(bt.binding.clusterId);
-    apsReq.setTxOptions(deCONZ::ApsTxAcknowledgedTransmission);
+    for (const ZCL_ConfigureReportingParam &param : params)
+    {
+        // attributes of the same manufacturer code share a request as far as the APS payload allows
+        const std::vector<ZCL_ReportingFrame> frames = ZCL_PackReportingRecords(param, ZCL_CONFIGURE_REPORTING_MAX_PAYLOAD);
 
-    deCONZ::ZclFrame zclFrame;
-    zclFrame.setSequenceNumber(zclSeqNum);
-    zclFrame.setCommandId(deCONZ::ZclConfigureReportingId);
+        for (const ZCL_ReportingFrame &frame : frames)
+        {
+            if (zclSeq == 0) // don't use zero, simplify matching
+            {
+                zclSeq = 1;
+            }
+            const quint8 zclSeqNum = zclSeq++; // to match in configure reporting response handler
 
-    if (requests.front().manufacturerCode)
-    {
-        zclFrame.setFrameControl(deCONZ::ZclFCProfileCommand |
-                                 deCONZ::ZclFCManufacturerSpecific |
-                                 deCONZ::ZclFCDirectionClientToServer |
-                                 deCONZ::ZclFCDisableDefaultResponse);
-        zclFrame.setManufacturerCode(requests.front().manufacturerCode);
-    }
-    else
-    {
-        zclFrame.setFrameControl(deCONZ::ZclFCProfileCommand |
-                                 deCONZ::ZclFCDirectionClientToServer |
-                                 deCONZ::ZclFCDisableDefaultResponse);
-    }
+            deCONZ::ApsDataRequest apsReq;
 
-    { // payload
-        QDataStream stream(&zclFrame.payload(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
+            // ZDP Header
+            apsReq.dstAddress() = bt.restNode->address();
+            apsReq.setDstAddressMode(deCONZ::ApsExtAddress);
+            apsReq.setDstEndpoint(bt.binding.srcEndpoint);
+            apsReq.setSrcEndpoint(endpoint());
+            apsReq.setProfileId(HA_PROFILE_ID);
+            apsReq.setRadius(0);
+            apsReq.setClusterId(bt.binding.clusterId);
+            apsReq.setTxOptions(deCONZ::ApsTxAcknowledgedTransmission);
 
-        for (const ConfigureReportingRequest &rq : out)
-        {
-            stream << rq.direction;
-            stream << rq.attributeId;
-            stream << rq.dataType;
-            stream << rq.minInterval;
-            stream << rq.maxInterval;
+            deCONZ::ZclFrame zclFrame;
+            zclFrame.setSequenceNumber(zclSeqNum);
+            zclFrame.setCommandId(deCONZ::ZclConfigureReportingId);
 
-            if (rq.reportableChange16bit != 0xFFFF)
+            if (param.manufacturerCode)
             {
-                stream << rq.reportableChange16bit;
+                zclFrame.setFrameControl(deCONZ::ZclFCProfileCommand |
+                                         deCONZ::ZclFCManufacturerSpecific |
+                                         deCONZ::ZclFCDirectionClientToServer |
+                                         deCONZ::ZclFCDisableDefaultResponse);
+                zclFrame.setManufacturerCode(param.manufacturerCode);
             }
-            else if (rq.reportableChange8bit != 0xFF)
+            else
             {
-                stream << rq.reportableChange8bit;
+                zclFrame.setFrameControl(deCONZ::ZclFCProfileCommand |
+                                         deCONZ::ZclFCDirectionClientToServer |
+                                         deCONZ::ZclFCDisableDefaultResponse);
             }
-            else if (rq.reportableChange24bit != 0xFFFFFF)
-            {
-                stream << (qint8) (rq.reportableChange24bit & 0xFF);
-                stream << (qint8) ((rq.reportableChange24bit >> 8) & 0xFF);
-                stream << (qint8) ((rq.reportableChange24bit >> 16) & 0xFF);
+
+            { // payload
+                QByteArray &payload = zclFrame.payload();
+                payload.resize(frame.payloadSize);
+                size_t pos = 0;
+
+                for (size_t i : frame.records)
+                {
+                    const ZCL_ConfigureReportingParam::Record &rec = param.records[i];
+                    pos += ZCL_WriteReportingRecord(rec, reinterpret_cast<uint8_t*>(payload.data()) + pos, size_t(payload.size()) - pos);
+
+                    NodeValue &val = bt.restNode->getZclValue(bt.binding.clusterId, rec.attributeId, bt.binding.srcEndpoint);
+                    val.zclSeqNum = zclSeqNum;
+
+                    DBG_Printf(DBG_INFO_L2, "configure reporting rq seq %u for 0x%016llX, attribute 0x%04X/0x%04X\n", zclSeqNum, bt.restNode->address().ext(), bt.binding.clusterId, rec.attributeId);
+                }
+                DBG_Assert(pos == frame.payloadSize);
             }
-            else if (rq.reportableChange48bit != 0xFFFFFFFF)
+
+            { // ZCL frame
+                QDataStream stream(&apsReq.asdu(), QIODevice::WriteOnly);
+                stream.setByteOrder(QDataStream::LittleEndian);
+                zclFrame.writeToStream(stream);
+            }
+
+            if (apsCtrlWrapper.apsdeDataRequest(apsReq) == deCONZ::Success)
             {
-                stream << (qint8) (rq.reportableChange48bit & 0xFF);
-                stream << (qint8) ((rq.reportableChange48bit >> 8) & 0xFF);
-                stream << (qint8) ((rq.reportableChange48bit >> 16) & 0xFF);
-                stream << (qint8) ((rq.reportableChange48bit >> 24) & 0xFF);
-                stream << (qint8) 0x00;
-                stream << (qint8) 0x00;
+                bt.zclSeqNums.push_back(zclSeqNum);
+                sent++;
             }
-            DBG_Printf(DBG_INFO_L2, "configure reporting rq seq %u for 0x%016llX, attribute 0x%04X/0x%04X\n", zclSeqNum, bt.restNode->address().ext(), bt.binding.clusterId, rq.attributeId);
         }
     }
 
-    { // ZCL frame
-        QDataStream stream(&apsReq.asdu(), QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::LittleEndian);
-        zclFrame.writeToStream(stream);
-    }
-
-
-    if (apsCtrlWrapper.apsdeDataRequest(apsReq) == deCONZ::Success)
+    if (sent > 0)
     {
         queryTime = queryTime.addSecs(1);
         return true;
@@ -1325,8 +1472,7 @@ bool DeRestPluginPrivate::sendConfigureReportingRequest(BindingTask &bt)
             rq5.reportableChange8bit = 1;
             rq5.manufacturerCode = VENDOR_DANFOSS;
 
-            return sendConfigureReportingRequest(bt, {rq, rq2, rq3, rq4}) || // Use OR because of manuf. specific attributes
-                   sendConfigureReportingRequest(bt, {rq5});
+            return sendConfigureReportingRequest(bt, {rq, rq2, rq3, rq4, rq5}); // manufacturer specific attribute is sent in its own request
         }
         else if (modelId == QLatin1String("902010/32")) // Bitron thermostat
         {
@@ -3742,7 +3888,12 @@ void DeRestPluginPrivate::deleteGroupsWithDeviceMembership(const QString &id)
     }
 }
 
-/*! Process binding related tasks queue every one second. */
+/*! Process binding related tasks queue.
+
+    Runs every second to handle timeouts and is triggered right away by APS confirms,
+    ZDP and ZCL responses. All idle tasks are started as far as the on-air limits of
+    the binding scheduler allow.
+ */
 void DeRestPluginPrivate::bindingTimerFired()
 {
     if (bindingQueue.empty())
@@ -3754,23 +3905,34 @@ void DeRestPluginPrivate::bindingTimerFired()
     if (!q->pluginActive())
     {
         bindingQueue.clear();
+        bindingScheduler.clear();
         return;
     }
 
-    int active = 0;
+    const int elapsed = bindingScheduler.elapsedSeconds(deCONZ::steadyTimeRef().ref);
+
+    bindingScheduler.beginPass();
+    for (const BindingTask &bt : bindingQueue)
+    {
+        if (bt.state == BindingTask::StateInProgress)
+        {
+            bindingScheduler.addActive(bt.binding.srcAddress);
+        }
+    }
+
+    std::list<BindingTask> requeue; // checks to retry, moved to the end of the queue
     std::list<BindingTask>::iterator i = bindingQueue.begin();
-    std::list<BindingTask>::iterator end = bindingQueue.end();
 
-    for (; i != end; ++i)
+    while (i != bindingQueue.end())
     {
         if (i->state == BindingTask::StateIdle)
         {
-            if (active >= MAX_ACTIVE_BINDING_TASKS)
-            { /* do nothing */ }
+            if (!bindingScheduler.canStart(i->binding.srcAddress))
+            { /* wait for a free slot */ }
             else if (sendBindRequest(*i))
             {
                 i->state = BindingTask::StateInProgress;
-                break;
+                bindingScheduler.addActive(i->binding.srcAddress);
             }
             else if (i->retries < 5)
             {
@@ -3785,9 +3947,10 @@ void DeRestPluginPrivate::bindingTimerFired()
         }
         else if (i->state == BindingTask::StateInProgress)
         {
-            i->timeout--;
+            i->timeout -= elapsed;
             if (i->timeout < 0)
             {
+                bindingScheduler.removeActive(i->binding.srcAddress);
                 i->retries--;
                 if (i->retries > 0)
                 {
@@ -3800,11 +3963,7 @@ void DeRestPluginPrivate::bindingTimerFired()
                     {
                         DBG_Printf(DBG_INFO_L2, "binding/unbinding timeout srcAddr: 0x%016llX, retry\n", i->binding.srcAddress);
                         i->state = BindingTask::StateIdle;
-                        i->timeout = BindingTask::Timeout;
-                        if (i->restNode && i->restNode->node() && !i->restNode->node()->nodeDescriptor().receiverOnWhenIdle())
-                        {
-                            i->timeout = BindingTask::TimeoutEndDevice;
-                        }
+                        i->timeout = bindingTaskTimeout(*i);
                     }
                 }
                 else
@@ -3813,19 +3972,10 @@ void DeRestPluginPrivate::bindingTimerFired()
                     i->state = BindingTask::StateFinished;
                 }
             }
-            else
-            {
-                active++;
-            }
-        }
-        else if (i->state == BindingTask::StateFinished)
-        {
-            bindingQueue.erase(i);
-            break;
         }
         else if (i->state == BindingTask::StateCheck)
         {
-            i->timeout--;
+            i->timeout -= elapsed;
             if (i->timeout < 0)
             {
                 i->retries--;
@@ -3847,18 +3997,13 @@ void DeRestPluginPrivate::bindingTimerFired()
                     {
                         i->state = BindingTask::StateIdle;
                     }
-                    i->timeout = BindingTask::Timeout;
-                    if (i->restNode && i->restNode->node() && !i->restNode->node()->nodeDescriptor().receiverOnWhenIdle())
-                    {
-                        i->timeout = BindingTask::TimeoutEndDevice;
-                    }
+                    i->timeout = bindingTaskTimeout(*i);
 
                     DBG_Printf(DBG_INFO_L2, "%s check timeout, retries = %d (srcAddr: 0x%016llX cluster: 0x%04X)\n",
                                (i->action == BindingTask::ActionBind ? "bind" : "unbind"), i->retries, i->binding.srcAddress, i->binding.clusterId);
 
-                    bindingQueue.push_back(*i);
-                    bindingQueue.pop_front();
-                    break;
+                    requeue.splice(requeue.end(), bindingQueue, i++);
+                    continue;
                 }
                 else
                 {
@@ -3869,8 +4014,19 @@ void DeRestPluginPrivate::bindingTimerFired()
                 }
             }
         }
+
+        if (i->state == BindingTask::StateFinished)
+        {
+            bindingScheduler.remove(bindingTaskKey(*i));
+            i = bindingQueue.erase(i);
+            continue;
+        }
+
+        ++i;
     }
 
+    bindingQueue.splice(bindingQueue.end(), requeue);
+
     if (!bindingQueue.empty())
     {
         bindingTimer->start(1000);
@@ -3878,14 +4034,29 @@ void DeRestPluginPrivate::bindingTimerFired()
 }
 
 /*! Process ongoing binding table queries.
+
+    Up to maxBindingTableReaders queries to different devices run in parallel.
 */
 void DeRestPluginPrivate::bindingTableReaderTimerFired()
 {
+    int active = 0;
+    for (const BindingTableReader &btr : bindingTableReaders)
+    {
+        if (btr.state == BindingTableReader::StateWaitConfirm || btr.state == BindingTableReader::StateWaitResponse)
+        {
+            active++;
+        }
+    }
+
     std::vector<BindingTableReader>::iterator i = bindingTableReaders.begin();
 
     for (; i != bindingTableReaders.end(); )
     {
-        if (i->state == BindingTableReader::StateIdle)
+        if (i->state == BindingTableReader::StateIdle && active >= maxBindingTableReaders)
+        {
+            // wait for a free slot
+        }
+        else if (i->state == BindingTableReader::StateIdle)
         {
             deCONZ::ApsDataRequest &apsReq = i->apsReq;
 
@@ -3912,7 +4083,7 @@ void DeRestPluginPrivate::bindingTableReaderTimerFired()
                 DBG_Printf(DBG_ZDP, "Mgmt_Bind_req id: %d to 0x%016llX send\n", i->apsReq.id(), i->apsReq.dstAddress().ext());
                 i->time.start();
                 i->state = BindingTableReader::StateWaitConfirm;
-                break;
+                active++;
             }
             else
             {
@@ -3967,9 +4138,7 @@ bool DeRestPluginPrivate::queueBindingTask(const BindingTask &bindingTask)
         return false;
     }
 
-    const std::list<BindingTask>::const_iterator i = std::find(bindingQueue.begin(), bindingQueue.end(), bindingTask);
-
-    if (i == bindingQueue.end())
+    if (bindingScheduler.insert(bindingTaskKey(bindingTask)))
     {
         DBG_Printf(DBG_INFO_L2, "queue binding task for 0x%016llX, cluster 0x%04X\n", bindingTask.binding.srcAddress, bindingTask.binding.clusterId);
 
@@ -17,6 +17,7 @@
 #endif
 
 #include <array>
+#include <mutex>
 #include <QByteArray>
 #include <QString>
 #include "random.h"
@@ -65,6 +66,11 @@ static int wrap_EVP_PKEY_CTX_set_scrypt_p(EVP_PKEY_CTX *ctx, uint64_t p)
  */
 static int scryptDerive(const char *input, size_t inputLength, std::array<unsigned char, 64> &out, int N, int r, int p, const unsigned char *salt, size_t saltlen)
 {
+    // verifications run on a worker thread (VerifyWorker), serialize library loading
+    // and assign the shared function pointers only once
+    static std::mutex libMutex;
+    std::unique_lock<std::mutex> libLock(libMutex);
+
     void *libCrypto = U_library_open_ex("libcrypto");
     void *libSsl = U_library_open_ex("libssl");
 
@@ -79,8 +85,14 @@ static int scryptDerive(const char *input, size_t inputLength, std::array<unsign
 
     const auto lib_EVP_PKEY_CTX_new_id = reinterpret_cast<EVP_PKEY_CTX *(*)(int id, ENGINE *e)>(U_library_symbol(libCrypto, "EVP_PKEY_CTX_new_id"));
     const auto lib_EVP_PKEY_derive_init = reinterpret_cast<int (*)(EVP_PKEY_CTX *ctx)>(U_library_symbol(libCrypto, "EVP_PKEY_derive_init"));
-    lib_EVP_PKEY_CTX_ctrl = reinterpret_cast<int (*)(EVP_PKEY_CTX *ctx, int keytype, int optype, int cmd, int p1, void *p2)>(U_library_symbol(libCrypto, "EVP_PKEY_CTX_ctrl"));
-    lib_EVP_PKEY_CTX_ctrl_uint64 = reinterpret_cast<int (*)(EVP_PKEY_CTX *ctx, int keytype, int optype, int cmd, uint64_t value)>(U_library_symbol(libCrypto, "EVP_PKEY_CTX_ctrl_uint64"));
+    if (!lib_EVP_PKEY_CTX_ctrl)
+    {
+        lib_EVP_PKEY_CTX_ctrl = reinterpret_cast<int (*)(EVP_PKEY_CTX *ctx, int keytype, int optype, int cmd, int p1, void *p2)>(U_library_symbol(libCrypto, "EVP_PKEY_CTX_ctrl"));
+    }
+    if (!lib_EVP_PKEY_CTX_ctrl_uint64)
+    {
+        lib_EVP_PKEY_CTX_ctrl_uint64 = reinterpret_cast<int (*)(EVP_PKEY_CTX *ctx, int keytype, int optype, int cmd, uint64_t value)>(U_library_symbol(libCrypto, "EVP_PKEY_CTX_ctrl_uint64"));
+    }
     const auto lib_EVP_PKEY_derive = reinterpret_cast<int (*)(EVP_PKEY_CTX *ctx, unsigned char *key, size_t *keylen)>(U_library_symbol(libCrypto, "EVP_PKEY_derive"));
     const auto lib_EVP_PKEY_CTX_free = reinterpret_cast<void (*)(EVP_PKEY_CTX *ctx)>(U_library_symbol(libCrypto, "EVP_PKEY_CTX_free"));
 
@@ -122,6 +134,8 @@ static int scryptDerive(const char *input, size_t inputLength, std::array<unsign
         lib_EVP_PKEY_CTX_set_scrypt_p = wrap_EVP_PKEY_CTX_set_scrypt_p;
     }
 
+    libLock.unlock();
+
     int result = 0;
     EVP_PKEY_CTX *pctx;
 
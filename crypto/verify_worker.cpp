@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include <algorithm>
+#include "verify_worker.h"
+
+VerifyWorker::VerifyWorker() :
+    m_thread(&VerifyWorker::run, this)
+{
+}
+
+VerifyWorker::~VerifyWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_cond.notify_one();
+
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+void VerifyWorker::setNotify(std::function<void()> notify)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_notify = std::move(notify);
+}
+
+/*! Queues \p job, \p callback receives its result in processResults(). */
+void VerifyWorker::submit(Job job, Callback callback)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Item item;
+        item.job = std::move(job);
+        item.callback = std::move(callback);
+        m_queue.push_back(std::move(item));
+        m_pending++;
+    }
+    m_cond.notify_one();
+}
+
+/*! Invokes the callbacks of finished jobs, returns the number of processed results. */
+size_t VerifyWorker::processResults()
+{
+    std::deque<Item> done;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        done.swap(m_done);
+        m_pending -= std::min(m_pending, done.size());
+    }
+
+    for (Item &item : done)
+    {
+        if (item.callback)
+        {
+            item.callback(item.result);
+        }
+    }
+
+    return done.size();
+}
+
+size_t VerifyWorker::pendingCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pending;
+}
+
+void VerifyWorker::run()
+{
+    for (;;)
+    {
+        Item item;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock, [this]() { return m_quit || !m_queue.empty(); });
+
+            if (m_quit)
+            {
+                return;
+            }
+
+            item = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+
+        item.result = item.job ? item.job() : false;
+        item.job = nullptr; // release captured secrets early
+
+        std::function<void()> notify;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_done.push_back(std::move(item));
+            notify = m_notify;
+        }
+
+        if (notify)
+        {
+            notify();
+        }
+    }
+}
+
+bool VerifyRateLimiter::begin(uint64_t source, int64_t nowMs)
+{
+    auto i = m_sources.find(source);
+
+    if (i == m_sources.end())
+    {
+        if (m_sources.size() >= MaxSources)
+        {
+            evict(nowMs);
+        }
+        i = m_sources.emplace(source, Entry()).first;
+    }
+
+    Entry &e = i->second;
+
+    if (e.inFlight || nowMs < e.lockedUntil)
+    {
+        return false;
+    }
+
+    e.inFlight = true;
+    e.lastAttempt = nowMs;
+    return true;
+}
+
+void VerifyRateLimiter::end(uint64_t source, bool success, int64_t nowMs)
+{
+    const auto i = m_sources.find(source);
+    if (i == m_sources.end())
+    {
+        return;
+    }
+
+    if (success)
+    {
+        m_sources.erase(i);
+        return;
+    }
+
+    Entry &e = i->second;
+    e.inFlight = false;
+    e.failures++;
+
+    if (e.failures > FreeFailures)
+    {
+        const int shift = std::min(e.failures - FreeFailures - 1, 16);
+        const int64_t lockout = std::min<int64_t>(int64_t(LockoutMs) << shift, MaxLockoutMs);
+        e.lockedUntil = nowMs + lockout;
+    }
+}
+
+int64_t VerifyRateLimiter::lockedUntil(uint64_t source) const
+{
+    const auto i = m_sources.find(source);
+    return i != m_sources.end() ? i->second.lockedUntil : 0;
+}
+
+/*! Drops entries which are neither in flight nor locked, oldest first. */
+void VerifyRateLimiter::evict(int64_t nowMs)
+{
+    auto oldest = m_sources.end();
+
+    for (auto i = m_sources.begin(); i != m_sources.end(); ++i)
+    {
+        if (i->second.inFlight || nowMs < i->second.lockedUntil)
+        {
+            continue;
+        }
+
+        if (oldest == m_sources.end() || i->second.lastAttempt < oldest->second.lastAttempt)
+        {
+            oldest = i;
+        }
+    }
+
+    if (oldest != m_sources.end())
+    {
+        m_sources.erase(oldest);
+    }
+}
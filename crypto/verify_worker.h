@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef VERIFY_WORKER_H
+#define VERIFY_WORKER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+/*! \class VerifyWorker
+
+    Runs expensive credential checks like CRYPTO_ScryptVerify() on a background thread.
+
+    Jobs must not touch plugin state, they only get copies of the data they need.
+    The result callbacks are invoked by processResults() on the thread which owns the
+    worker (the main thread). The notify function is called from the worker thread
+    after a result is available and should schedule processResults(), e.g. with a
+    queued QMetaObject::invokeMethod().
+ */
+class VerifyWorker
+{
+public:
+    using Job = std::function<bool()>;
+    using Callback = std::function<void(bool)>;
+
+    VerifyWorker();
+    ~VerifyWorker();
+
+    void setNotify(std::function<void()> notify);
+    void submit(Job job, Callback callback);
+    size_t processResults();
+    size_t pendingCount() const;
+
+private:
+    struct Item
+    {
+        Job job;
+        Callback callback;
+        bool result = false;
+    };
+
+    void run();
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<Item> m_queue;
+    std::deque<Item> m_done;
+    std::function<void()> m_notify;
+    size_t m_pending = 0;
+    bool m_quit = false;
+    std::thread m_thread;
+};
+
+/*! \class VerifyRateLimiter
+
+    Limits verification attempts per source, e.g. the extended address of a keypad
+    or the IPv4 address of a REST client.
+
+    - Only one verification per source can be in flight.
+    - After FreeFailures failed attempts each further failure doubles a lockout period,
+      starting at LockoutMs up to MaxLockoutMs. A successful attempt resets the source.
+ */
+class VerifyRateLimiter
+{
+public:
+    enum Limits
+    {
+        FreeFailures = 3,
+        LockoutMs = 1000,
+        MaxLockoutMs = 5 * 60 * 1000,
+        MaxSources = 256
+    };
+
+    /*! Returns true if \p source may start a verification, which is then marked in flight. */
+    bool begin(uint64_t source, int64_t nowMs);
+    /*! Finishes a verification started with begin(). */
+    void end(uint64_t source, bool success, int64_t nowMs);
+    int64_t lockedUntil(uint64_t source) const;
+
+private:
+    struct Entry
+    {
+        int failures = 0;
+        int64_t lockedUntil = 0;
+        int64_t lastAttempt = 0;
+        bool inFlight = false;
+    };
+
+    void evict(int64_t nowMs);
+
+    std::unordered_map<uint64_t, Entry> m_sources;
+};
+
+#endif // VERIFY_WORKER_H
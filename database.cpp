@@ -15,6 +15,7 @@
 #include <QElapsedTimer>
 #include <unistd.h>
 #include "database.h"
+#include "db_preload.h"
 #include "de_web_plugin_private.h"
 #include "deconz/atom_table.h"
 #include "deconz/dbg_trace.h"
@@ -26,7 +27,10 @@
 #include "gateway.h"
 #endif
 #include "json.h"
+#include "metrics.h"
 #include "product_match.h"
+#include "stall_detector.h"
+#include "startup_profile.h"
 #include "utils/ArduinoJson.h"
 #include "utils/utils.h"
 
@@ -39,6 +43,7 @@ static const char *pragmaFreeListCount = "PRAGMA freelist_count";
 
 static sqlite3 *db = nullptr;
 static char sqlBuf[MAX_SQL_LEN];
+static DB_Preload dbPreload;
 
 static StaticJsonDocument<1024 * 1024 * 2> dbJson; /* 2 mega bytes*/
 
@@ -52,6 +57,7 @@ struct DB_Callback {
                     Local prototypes
 ******************************************************************************/
 static bool initAlarmSystemsTable();
+static int DB_ExecStartupQuery(const char *sql, DB_RowCallback callback, void *user, char **errmsg);
 static bool initSecretsTable();
 static bool setDbUserVersion(int userVersion);
 static int getDbPragmaInteger(const char *sql);
@@ -62,6 +68,7 @@ static bool upgradeDbToUserVersion7();
 static bool upgradeDbToUserVersion8();
 static bool upgradeDbToUserVersion9();
 static bool upgradeDbToUserVersion10();
+static bool upgradeDbToUserVersion11();
 static int sqliteLoadAuthCallback(void *user, int ncols, char **colval , char **colname);
 static int sqliteLoadConfigCallback(void *user, int ncols, char **colval , char **colname);
 static int sqliteLoadUserparameterCallback(void *user, int ncols, char **colval , char **colname);
@@ -196,6 +203,10 @@ void DeRestPluginPrivate::checkDbUserVersion()
         updated = upgradeDbToUserVersion10();
     }
     else if (userVersion == 10)
+    {
+        updated = upgradeDbToUserVersion11();
+    }
+    else if (userVersion == 11)
     {
         // latest version
     }
@@ -814,6 +825,46 @@ static bool upgradeDbToUserVersion10()
     return setDbUserVersion(10);
 }
 
+static bool upgradeDbToUserVersion11()
+{
+    DBG_Printf(DBG_INFO, "DB upgrade to user_version 11\n");
+
+    /*
+       The 'binding_tables' table holds the last complete binding table read
+       from a device as hex encoded ZDP binding table records.
+     */
+
+    // create tables
+    const char *sql[] = {
+        "CREATE TABLE if NOT EXISTS binding_tables ("
+        " device_id INTEGER REFERENCES devices(id) ON DELETE CASCADE,"
+        " entries INTEGER NOT NULL,"
+        " data TEXT NOT NULL,"
+        " timestamp INTEGER NOT NULL," // seconds since epoch
+        " PRIMARY KEY (device_id) ON CONFLICT REPLACE"
+        ")",
+        nullptr
+    };
+
+    for (int i = 0; sql[i] != nullptr; i++)
+    {
+        char *errmsg = nullptr;
+        int rc = sqlite3_exec(db, sql[i], nullptr, nullptr, &errmsg);
+
+        if (rc != SQLITE_OK)
+        {
+            if (errmsg)
+            {
+                DBG_Printf(DBG_ERROR_L2, "SQL exec failed: %s, error: %s (%d), line: %d\n", sql[i], errmsg, rc, __LINE__);
+                sqlite3_free(errmsg);
+            }
+            return false;
+        }
+    }
+
+    return setDbUserVersion(11);
+}
+
 /*! Stores a source route.
     Any existing source route with the same uuid will be replaced automatically.
  */
@@ -826,6 +877,8 @@ void DeRestPluginPrivate::storeSourceRoute(const deCONZ::SourceRoute &sourceRout
         return; // at least two hops (incl. destination)
     }
 
+    updateSourceRouteHop(sourceRoute);
+
     openDb();
     DBG_Assert(db);
     if (!db)
@@ -869,6 +922,11 @@ void DeRestPluginPrivate::deleteSourceRoute(const QString &uuid)
 {
     DBG_Assert(!uuid.isEmpty());
 
+    sourceRouteHops.erase(std::remove_if(sourceRouteHops.begin(), sourceRouteHops.end(), [&uuid](const SourceRouteHop &hop)
+    {
+        return hop.uuid == uuid;
+    }), sourceRouteHops.end());
+
     openDb();
     DBG_Assert(db);
     if (!db)
@@ -967,13 +1025,137 @@ void DeRestPluginPrivate::restoreSourceRoutes()
         }
         else if (apsCtrl && hops.size() > 1) // at least two items
         {
-            apsCtrl->activateSourceRoute(deCONZ::SourceRoute(sr.uuid(), sr.order(), hops));
+            const deCONZ::SourceRoute sourceRoute(sr.uuid(), sr.order(), hops);
+            updateSourceRouteHop(sourceRoute);
+            apsCtrl->activateSourceRoute(sourceRoute);
+        }
+    }
+
+    closeDb();
+}
+
+/*! Stores the cached binding table of \p extAddress.
+    An existing entry of the device will be replaced automatically.
+ */
+void DeRestPluginPrivate::storeBindingTable(quint64 extAddress)
+{
+    const BindingTableCacheEntry *entry = bindingTableCache.get(extAddress);
+
+    if (!entry)
+    {
+        return;
+    }
+
+    openDb();
+    DBG_Assert(db);
+    if (!db)
+    {
+        return;
+    }
+
+    const QByteArray data = QByteArray::fromRawData(reinterpret_cast<const char*>(entry->records.data()), int(entry->records.size())).toHex();
+    const auto sql = QString("INSERT INTO binding_tables (device_id,entries,data,timestamp)"
+                             " SELECT id, %2, '%3', %4 FROM devices WHERE mac = '%1';")
+                             .arg(generateUniqueId(extAddress, 0, 0))
+                             .arg(entry->count)
+                             .arg(QLatin1String(data))
+                             .arg(entry->timestamp);
+
+    char *errmsg = nullptr;
+    int rc = sqlite3_exec(db, sql.toUtf8().constData(), NULL, NULL, &errmsg);
+
+    if (rc != SQLITE_OK)
+    {
+        if (errmsg)
+        {
+            DBG_Printf(DBG_ERROR, "DB sqlite3_exec failed: %s, error: %s, line: %d\n", qPrintable(sql), errmsg, __LINE__);
+            sqlite3_free(errmsg);
+        }
+    }
+
+    closeDb();
+}
+
+/*! Deletes the stored binding table of \p extAddress. */
+void DeRestPluginPrivate::deleteBindingTable(quint64 extAddress)
+{
+    openDb();
+    DBG_Assert(db);
+    if (!db)
+    {
+        return;
+    }
+
+    char *errmsg = nullptr;
+    const auto sql = QString("DELETE FROM binding_tables WHERE device_id = (SELECT id FROM devices WHERE mac = '%1')")
+                             .arg(generateUniqueId(extAddress, 0, 0));
+    int rc = sqlite3_exec(db, sql.toUtf8().constData(), NULL, NULL, &errmsg);
+
+    if (rc != SQLITE_OK)
+    {
+        if (errmsg)
+        {
+            DBG_Printf(DBG_ERROR, "DB sqlite3_exec failed: %s, error: %s, line: %d\n", qPrintable(sql), errmsg, __LINE__);
+            sqlite3_free(errmsg);
         }
     }
 
     closeDb();
 }
 
+/*! Loads the stored binding tables into the binding table cache. */
+void DeRestPluginPrivate::restoreBindingTables()
+{
+    openDb();
+    DBG_Assert(db);
+    if (!db)
+    {
+        return;
+    }
+
+    const auto loadBindingTablesCallback = [](void *user, int ncols, char **colval , char **) -> int
+    {
+        auto *cache = static_cast<BindingTableCache*>(user);
+        DBG_Assert(cache);
+        DBG_Assert(ncols == 4);
+
+        const auto mac = QString("0x%1").arg(colval[0]).remove(':');
+
+        bool ok = false;
+        const quint64 extAddress = mac.toULongLong(&ok, 16);
+        const QByteArray data = QByteArray::fromHex(colval[2]);
+
+        if (ok && extAddress != 0)
+        {
+            BindingTableCacheEntry entry;
+            entry.count = static_cast<uint8_t>(QString(colval[1]).toUInt());
+            entry.timestamp = QString(colval[3]).toLongLong();
+            entry.records.assign(data.constBegin(), data.constEnd());
+            cache->restore(extAddress, entry);
+        }
+
+        return 0;
+    };
+
+    char *errmsg = nullptr;
+    const char *sql = "SELECT mac, entries, data, timestamp FROM binding_tables INNER JOIN devices WHERE device_id = devices.id";
+
+    int rc = sqlite3_exec(db, sql, loadBindingTablesCallback, &bindingTableCache, &errmsg);
+
+    if (rc != SQLITE_OK)
+    {
+        if (errmsg)
+        {
+            DBG_Printf(DBG_ERROR, "sqlite3_exec %s, error: %s, line: %d\n", sql, errmsg, __LINE__);
+            sqlite3_free(errmsg);
+        }
+    }
+
+    DBG_Printf(DBG_INFO, "DB restored %d binding tables\n", int(bindingTableCache.size()));
+
+    closeDb();
+}
+
 /*! Puts a new top level device entry in the db (mac address) or refreshes nwk address.
     Fills the dev.deviceId and dev.creationTime fields.
     \returns 1 on success, 0 on failure
@@ -1416,6 +1598,62 @@ void DeRestPluginPrivate::openDb()
 #endif
 }
 
+/*! Returns the connection opened by openDb() or nullptr if it is closed.
+ */
+sqlite3 *DB_Connection()
+{
+    return db;
+}
+
+/*! Statements of readDb() which are loaded on the preload worker, must match the loaders exactly.
+ */
+static const char *dbStartupQueries[] = {
+    "SELECT apikey,devicetype,createdate,lastusedate,useragent FROM auth",
+    "SELECT key,value FROM config2",
+    "SELECT key,value FROM userparameter",
+    "SELECT * FROM groups",
+    "SELECT * FROM resourcelinks",
+    "SELECT * FROM scenes",
+    "SELECT * FROM rules",
+    "SELECT * FROM schedules",
+    "SELECT * FROM sensors",
+    nullptr
+};
+
+/*! Starts loading the readDb() tables on a worker with a read-only connection.
+    Must be called after initDb() applied schema upgrades, the database must not be
+    written until DB_FinishPreload().
+ */
+void DB_StartPreload(const QString &path)
+{
+    std::vector<std::string> queries;
+    for (size_t i = 0; dbStartupQueries[i]; i++)
+    {
+        queries.push_back(dbStartupQueries[i]);
+    }
+
+    dbPreload.start(path.toStdString(), queries);
+}
+
+void DB_FinishPreload()
+{
+    dbPreload.finish();
+}
+
+/*! sqlite3_exec() on the main connection, or replay of the preloaded rows if \p sql was preloaded.
+    The callbacks run on the main thread in both cases.
+ */
+static int DB_ExecStartupQuery(const char *sql, DB_RowCallback callback, void *user, char **errmsg)
+{
+    DB_PreloadResult result;
+    if (dbPreload.take(sql, &result) && result.rc == SQLITE_OK)
+    {
+        return DB_ReplayRows(result, callback, user);
+    }
+
+    return sqlite3_exec(db, sql, callback, user, errmsg);
+}
+
 /*! Reads all data sets from sqlite database.
  */
 void DeRestPluginPrivate::readDb()
@@ -1427,18 +1665,19 @@ void DeRestPluginPrivate::readDb()
         return;
     }
 
-    loadAuthFromDb();
-    loadConfigFromDb();
-    loadUserparameterFromDb();
-    loadAllGroupsFromDb();
-    loadAllResourcelinksFromDb();
-    loadAllScenesFromDb();
-    loadAllRulesFromDb();
-    loadAllSchedulesFromDb();
-    loadAllSensorsFromDb();
+    { SP_Scope startupScope(SP_LoadAuth); loadAuthFromDb(); }
+    { SP_Scope startupScope(SP_LoadConfig); loadConfigFromDb(); }
+    { SP_Scope startupScope(SP_LoadUserparameter); loadUserparameterFromDb(); }
+    { SP_Scope startupScope(SP_LoadGroups); loadAllGroupsFromDb(); }
+    { SP_Scope startupScope(SP_LoadResourcelinks); loadAllResourcelinksFromDb(); }
+    { SP_Scope startupScope(SP_LoadScenes); loadAllScenesFromDb(); }
+    { SP_Scope startupScope(SP_LoadRules); loadAllRulesFromDb(); }
+    { SP_Scope startupScope(SP_LoadSchedules); loadAllSchedulesFromDb(); }
+    { SP_Scope startupScope(SP_LoadSensors); loadAllSensorsFromDb(); }
 #ifdef USE_GATEWAY_API
     loadAllGatewaysFromDb();
 #endif
+    DB_FinishPreload();
 }
 
 /*! Sqlite callback to load authorisation data.
@@ -1497,6 +1736,7 @@ static int sqliteLoadAuthCallback(void *user, int ncols, char **colval , char **
     if (!auth.apikey.isEmpty() && !auth.devicetype.isEmpty())
     {
         d->apiAuths.push_back(auth);
+        d->apiAuthIndex.invalidate();
     }
 
     return 0;
@@ -1519,7 +1759,7 @@ void DeRestPluginPrivate::loadAuthFromDb()
     QString sql = QString(QLatin1String("SELECT apikey,devicetype,createdate,lastusedate,useragent FROM auth"));
 
     DBG_Printf(DBG_INFO_L2, "sql exec %s\n", qPrintable(sql));
-    rc = sqlite3_exec(db, qPrintable(sql), sqliteLoadAuthCallback, this, &errmsg);
+    rc = DB_ExecStartupQuery(qPrintable(sql), sqliteLoadAuthCallback, this, &errmsg);
 
     if (rc != SQLITE_OK)
     {
@@ -2079,7 +2319,7 @@ void DeRestPluginPrivate::loadConfigFromDb()
         QString sql = QString("SELECT key,value FROM %1").arg(configTable);
 
         DBG_Printf(DBG_INFO_L2, "sql exec %s\n", qPrintable(sql));
-        rc = sqlite3_exec(db, qPrintable(sql), sqliteLoadConfigCallback, this, &errmsg);
+        rc = DB_ExecStartupQuery(qPrintable(sql), sqliteLoadConfigCallback, this, &errmsg);
 
         if (rc != SQLITE_OK)
         {
@@ -2186,7 +2426,7 @@ void DeRestPluginPrivate::loadUserparameterFromDb()
         QString sql = QString("SELECT key,value FROM %1").arg("userparameter");
 
         DBG_Printf(DBG_INFO_L2, "sql exec %s\n", qPrintable(sql));
-        rc = sqlite3_exec(db, qPrintable(sql), sqliteLoadUserparameterCallback, this, &errmsg);
+        rc = DB_ExecStartupQuery(qPrintable(sql), sqliteLoadUserparameterCallback, this, &errmsg);
 
         if (rc != SQLITE_OK)
         {
@@ -2329,7 +2569,7 @@ void DeRestPluginPrivate::loadAllGroupsFromDb()
     QString sql = QString("SELECT * FROM groups");
 
     DBG_Printf(DBG_INFO_L2, "sql exec %s\n", qPrintable(sql));
-    rc = sqlite3_exec(db, qPrintable(sql), sqliteLoadAllGroupsCallback, this, &errmsg);
+    rc = DB_ExecStartupQuery(qPrintable(sql), sqliteLoadAllGroupsCallback, this, &errmsg);
 
     if (rc != SQLITE_OK)
     {
@@ -2426,7 +2666,7 @@ void DeRestPluginPrivate::loadAllResourcelinksFromDb()
     QString sql = QString("SELECT * FROM resourcelinks");
 
     DBG_Printf(DBG_INFO_L2, "sql exec %s\n", qPrintable(sql));
-    rc = sqlite3_exec(db, qPrintable(sql), sqliteLoadAllResourcelinksCallback, this, &errmsg);
+    rc = DB_ExecStartupQuery(qPrintable(sql), sqliteLoadAllResourcelinksCallback, this, &errmsg);
 
     if (rc != SQLITE_OK)
     {
@@ -2527,7 +2767,7 @@ void DeRestPluginPrivate::loadAllScenesFromDb()
     QString sql = QString("SELECT * FROM scenes");
 
     DBG_Printf(DBG_INFO_L2, "sql exec %s\n", qPrintable(sql));
-    rc = sqlite3_exec(db, qPrintable(sql), sqliteLoadAllScenesCallback, this, &errmsg);
+    rc = DB_ExecStartupQuery(qPrintable(sql), sqliteLoadAllScenesCallback, this, &errmsg);
 
     if (rc != SQLITE_OK)
     {
@@ -2623,7 +2863,7 @@ void DeRestPluginPrivate::loadAllSchedulesFromDb()
     QString sql = QString("SELECT * FROM schedules");
 
     DBG_Printf(DBG_INFO_L2, "sql exec %s\n", qPrintable(sql));
-    rc = sqlite3_exec(db, qPrintable(sql), sqliteLoadAllSchedulesCallback, this, &errmsg);
+    rc = DB_ExecStartupQuery(qPrintable(sql), sqliteLoadAllSchedulesCallback, this, &errmsg);
 
     if (rc != SQLITE_OK)
     {
@@ -3106,8 +3346,8 @@ void DeRestPluginPrivate::loadLightNodeFromDb(LightNode *lightNode)
     // check for unique IDs
     if (!lightNode->id().isEmpty())
     {
-        std::vector<LightNode>::iterator i = nodes.begin();
-        std::vector<LightNode>::iterator end = nodes.end();
+        SlabVector<LightNode>::iterator i = nodes.begin();
+        SlabVector<LightNode>::iterator end = nodes.end();
 
         for (; i != end; ++i)
         {
@@ -3378,7 +3618,7 @@ void DeRestPluginPrivate::loadAllRulesFromDb()
     QString sql = QString("SELECT * FROM rules");
 
     DBG_Printf(DBG_INFO_L2, "sql exec %s\n", qPrintable(sql));
-    rc = sqlite3_exec(db, qPrintable(sql), sqliteLoadAllRulesCallback, this, &errmsg);
+    rc = DB_ExecStartupQuery(qPrintable(sql), sqliteLoadAllRulesCallback, this, &errmsg);
 
     if (rc != SQLITE_OK)
     {
@@ -4523,7 +4763,7 @@ static int sqliteLoadAllSensorsCallback(void *user, int ncols, char **colval , c
 
                 sensor.address().setExt(extAddr);
                 // append to cache if not already known
-                sensor.setHandle(R_CreateResourceHandle(&sensor, d->sensors.size()));
+                sensor.setHandle(R_CreateResourceHandle(&sensor, d->sensors.size(), d->sensors.generation(d->sensors.size())));
                 d->sensors.push_back(sensor);
                 d->updateSensorEtag(&d->sensors.back());
 
@@ -4562,7 +4802,7 @@ void DeRestPluginPrivate::loadAllSensorsFromDb()
     QString sql = QString("SELECT * FROM sensors");
 
     DBG_Printf(DBG_INFO_L2, "sql exec %s\n", qPrintable(sql));
-    rc = sqlite3_exec(db, qPrintable(sql), sqliteLoadAllSensorsCallback, this, &errmsg);
+    rc = DB_ExecStartupQuery(qPrintable(sql), sqliteLoadAllSensorsCallback, this, &errmsg);
 
     if (rc != SQLITE_OK)
     {
@@ -4655,8 +4895,8 @@ int getFreeLightId()
     std::vector<int> lightIds(plugin->nodes.size());
 
     { // append all ids from nodes known at runtime
-        std::vector<LightNode>::const_iterator i = plugin->nodes.begin();
-        std::vector<LightNode>::const_iterator end = plugin->nodes.end();
+        SlabVector<LightNode>::const_iterator i = plugin->nodes.begin();
+        SlabVector<LightNode>::const_iterator end = plugin->nodes.end();
         for (;i != end; ++i)
         {
             lightIds.push_back(i->id().toUInt());
@@ -4887,36 +5127,35 @@ void DeRestPluginPrivate::saveApiKey(QString apikey)
     int rc;
     char *errmsg;
 
-    std::vector<ApiAuth>::iterator i = apiAuths.begin();
-    std::vector<ApiAuth>::iterator end = apiAuths.end();
+    const int pos = apiAuthIndex.find(apiAuths, apikey);
 
-    for (; i != end; ++i)
+    if (pos < 0)
     {
-        if (i->apikey == apikey)
-        {
-            DBG_Assert(i->createDate.timeSpec() == Qt::UTC);
-            DBG_Assert(i->lastUseDate.timeSpec() == Qt::UTC);
+        return;
+    }
 
-            QString sql = QString(QLatin1String("REPLACE INTO auth (apikey, devicetype, createdate, lastusedate, useragent) VALUES ('%1', '%2', '%3', '%4', '%5')"))
-                    .arg(i->apikey)
-                    .arg(i->devicetype)
-                    .arg(i->createDate.toString("yyyy-MM-ddTHH:mm:ss"))
-                    .arg(i->lastUseDate.toString("yyyy-MM-ddTHH:mm:ss"))
-                    .arg(i->useragent);
+    const ApiAuth *i = &apiAuths[size_t(pos)];
 
-            DBG_Printf(DBG_INFO_L2, "DB sql exec %s\n", qPrintable(sql));
-            errmsg = NULL;
-            rc = sqlite3_exec(db, sql.toUtf8().constData(), NULL, NULL, &errmsg);
+    DBG_Assert(i->createDate.timeSpec() == Qt::UTC);
+    DBG_Assert(i->lastUseDate.timeSpec() == Qt::UTC);
 
-            if (rc != SQLITE_OK)
-            {
-                if (errmsg)
-                {
-                    DBG_Printf(DBG_ERROR, "DB sqlite3_exec failed: %s, error: %s\n", qPrintable(sql), errmsg);
-                    sqlite3_free(errmsg);
-                }
-            }
-            return;
+    QString sql = QString(QLatin1String("REPLACE INTO auth (apikey, devicetype, createdate, lastusedate, useragent) VALUES ('%1', '%2', '%3', '%4', '%5')"))
+            .arg(i->apikey)
+            .arg(i->devicetype)
+            .arg(i->createDate.toString("yyyy-MM-ddTHH:mm:ss"))
+            .arg(i->lastUseDate.toString("yyyy-MM-ddTHH:mm:ss"))
+            .arg(i->useragent);
+
+    DBG_Printf(DBG_INFO_L2, "DB sql exec %s\n", qPrintable(sql));
+    errmsg = NULL;
+    rc = sqlite3_exec(db, sql.toUtf8().constData(), NULL, NULL, &errmsg);
+
+    if (rc != SQLITE_OK)
+    {
+        if (errmsg)
+        {
+            DBG_Printf(DBG_ERROR, "DB sqlite3_exec failed: %s, error: %s\n", qPrintable(sql), errmsg);
+            sqlite3_free(errmsg);
         }
     }
 }
@@ -4925,6 +5164,7 @@ void DeRestPluginPrivate::saveApiKey(QString apikey)
  */
 void DeRestPluginPrivate::saveDb()
 {
+    SD_Scope stallScope(SD_SaveDb);
     DBG_Assert(db != 0);
 
     if (!db)
@@ -4993,6 +5233,8 @@ void DeRestPluginPrivate::saveDb()
     // dump authorisation data
     if (saveDatabaseItems & DB_AUTH)
     {
+        API_FlushLastUse(apiAuths, deCONZ::steadyTimeRef().ref, QDateTime::currentDateTimeUtc());
+
         std::vector<ApiAuth>::iterator i = apiAuths.begin();
         std::vector<ApiAuth>::iterator end = apiAuths.end();
 
@@ -5051,6 +5293,13 @@ void DeRestPluginPrivate::saveDb()
             }
         }
 
+        // deleted entries are gone from the database now, don't keep them in memory
+        if (!apiAuthPrune.active && API_CompactDeleted(apiAuths) > 0)
+        {
+            apiAuthIndex.invalidate();
+            apiAuthCurrent = apiAuths.size(); // position might have changed
+        }
+
         saveDatabaseItems &= ~DB_AUTH;
     }
 
@@ -5271,8 +5520,8 @@ void DeRestPluginPrivate::saveDb()
     // save nodes
     if (saveDatabaseItems & DB_LIGHTS)
     {
-        std::vector<LightNode>::iterator i = nodes.begin();
-        std::vector<LightNode>::iterator end = nodes.end();
+        SlabVector<LightNode>::iterator i = nodes.begin();
+        SlabVector<LightNode>::iterator end = nodes.end();
 
         for (; i != end; ++i)
         {
@@ -5713,8 +5962,8 @@ void DeRestPluginPrivate::saveDb()
     // save/delete sensors
     if (saveDatabaseItems & DB_SENSORS)
     {
-        std::vector<Sensor>::iterator i = sensors.begin();
-        std::vector<Sensor>::iterator end = sensors.end();
+        SlabVector<Sensor>::iterator i = sensors.begin();
+        SlabVector<Sensor>::iterator end = sensors.end();
 
         for (; i != end; ++i)
         {
@@ -5846,6 +6095,7 @@ void DeRestPluginPrivate::saveDb()
 
     if (rc == SQLITE_OK)
     {
+        MET_ObserveUs(MET_DbTransaction, measTimer.nsecsElapsed() / 1000);
         DBG_Printf(DBG_INFO_L2, "DB saved in %ld ms\n", (long)measTimer.elapsed());
 
         if (saveDatabaseItems & DB_SYNC)
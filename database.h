@@ -25,6 +25,8 @@ namespace deCONZ {
     class Address;
 }
 
+struct sqlite3;
+
 struct DB_Secret
 {
     std::string uniqueId;
@@ -57,6 +59,10 @@ struct DB_AlarmSystemDevice
 bool DB_StoreSecret(const DB_Secret &secret);
 bool DB_LoadSecret(DB_Secret &secret);
 
+sqlite3 *DB_Connection();
+void DB_StartPreload(const QString &path);
+void DB_FinishPreload();
+
 bool DB_StoreAlarmSystem(const DB_AlarmSystem &alarmSys);
 bool DB_StoreAlarmSystemResourceItem(const DB_AlarmSystemResourceItem &item);
 std::vector<DB_AlarmSystemResourceItem> DB_LoadAlarmSystemResourceItems(int alarmSystemId);
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include <sqlite3.h>
+#include "db_preload.h"
+#include "startup_profile.h"
+
+DB_Preload::~DB_Preload()
+{
+    finish();
+}
+
+/*! Starts the worker which runs \p queries in order on a read-only connection to \p path.
+ */
+void DB_Preload::start(const std::string &path, const std::vector<std::string> &queries)
+{
+    finish();
+
+    m_queries = queries;
+    m_results.clear();
+    m_results.resize(queries.size());
+    m_taken.assign(queries.size(), 0);
+    m_done = 0;
+    m_quit = false;
+
+    m_thread = std::thread(&DB_Preload::run, this, path);
+}
+
+/*! Waits until the rows of \p sql are loaded and moves them into \p result.
+    \returns false if \p sql isn't preloaded or was already taken, the caller then queries the database itself.
+ */
+bool DB_Preload::take(const char *sql, DB_PreloadResult *result)
+{
+    if (!m_thread.joinable())
+    {
+        return false;
+    }
+
+    size_t i = 0;
+    for (; i < m_queries.size(); i++)
+    {
+        if (!m_taken[i] && m_queries[i] == sql)
+        {
+            break;
+        }
+    }
+
+    if (i == m_queries.size())
+    {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cond.wait(lock, [this, i]() { return m_done > i; });
+
+    m_taken[i] = 1;
+    *result = std::move(m_results[i]);
+    return true;
+}
+
+/*! Stops the worker and drops results which weren't taken.
+ */
+void DB_Preload::finish()
+{
+    if (!m_thread.joinable())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+
+    m_thread.join();
+    m_queries.clear();
+    m_results.clear();
+    m_taken.clear();
+}
+
+static int preloadCallback(void *user, int ncols, char **colval, char **colname)
+{
+    DB_PreloadResult *result = static_cast<DB_PreloadResult*>(user);
+
+    if (result->columns.empty())
+    {
+        for (int i = 0; i < ncols; i++)
+        {
+            result->columns.push_back(colname[i] ? colname[i] : "");
+        }
+    }
+
+    for (int i = 0; i < ncols; i++)
+    {
+        result->values.push_back(colval[i] ? colval[i] : "");
+        result->isNull.push_back(colval[i] ? 0 : 1);
+    }
+
+    return 0;
+}
+
+void DB_Preload::run(std::string path)
+{
+    SP_Scope startupScope(SP_DbPreload);
+    sqlite3 *db = nullptr;
+    int rc = sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr);
+
+    if (rc == SQLITE_OK)
+    {
+        sqlite3_busy_timeout(db, 1000);
+    }
+
+    for (size_t i = 0; i < m_queries.size(); i++)
+    {
+        DB_PreloadResult result;
+        result.sql = m_queries[i];
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_quit)
+            {
+                break;
+            }
+        }
+
+        if (rc == SQLITE_OK)
+        {
+            result.rc = sqlite3_exec(db, result.sql.c_str(), preloadCallback, &result, nullptr);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_results[i] = std::move(result);
+            m_done = i + 1;
+        }
+        m_cond.notify_all();
+    }
+
+    sqlite3_close(db);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_done = m_queries.size(); // unblock take() after an early quit
+    }
+    m_cond.notify_all();
+}
+
+/*! Calls a sqlite3_exec() \p callback for each row of \p result.
+    \returns the rc of the preloaded statement or SQLITE_ABORT if the callback returned non zero.
+ */
+int DB_ReplayRows(const DB_PreloadResult &result, DB_RowCallback callback, void *user)
+{
+    if (result.rc != SQLITE_OK || !callback)
+    {
+        return result.rc;
+    }
+
+    const size_t ncols = result.columns.size();
+    std::vector<char*> colname(ncols);
+    std::vector<char*> colval(ncols);
+
+    for (size_t i = 0; i < ncols; i++)
+    {
+        colname[i] = const_cast<char*>(result.columns[i].c_str());
+    }
+
+    for (size_t row = 0; row < result.rowCount(); row++)
+    {
+        for (size_t i = 0; i < ncols; i++)
+        {
+            const size_t n = row * ncols + i;
+            colval[i] = result.isNull[n] ? nullptr : const_cast<char*>(result.values[n].c_str());
+        }
+
+        if (callback(user, int(ncols), colval.data(), colname.data()) != 0)
+        {
+            return SQLITE_ABORT;
+        }
+    }
+
+    return SQLITE_OK;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef DB_PRELOAD_H
+#define DB_PRELOAD_H
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*! Rows of one SELECT statement as plain strings, in the form sqlite3_exec() passes them to a callback.
+ */
+struct DB_PreloadResult
+{
+    std::string sql;
+    int rc = -1; //! SQLITE_OK on success
+    std::vector<std::string> columns;
+    std::vector<std::string> values; //! row major, columns.size() values per row
+    std::vector<char> isNull;
+    size_t rowCount() const { return columns.empty() ? 0 : values.size() / columns.size(); }
+};
+
+/*! \class DB_Preload
+
+    Runs the startup SELECT statements on a worker thread with its own read-only connection,
+    while the main thread continues with other startup work like loading DDFs.
+
+    The loaders on the main thread take() the rows of their statement and replay them into their
+    existing sqlite3_exec() callbacks with DB_ReplayRows(), so all objects are still constructed on
+    the main thread. The database must not be written until all results were taken or finish()
+    was called, a reader holds a shared lock.
+ */
+class DB_Preload
+{
+public:
+    DB_Preload() = default;
+    ~DB_Preload();
+
+    DB_Preload(const DB_Preload&) = delete;
+    DB_Preload &operator=(const DB_Preload&) = delete;
+
+    void start(const std::string &path, const std::vector<std::string> &queries);
+    bool take(const char *sql, DB_PreloadResult *result);
+    void finish();
+    bool isActive() const { return m_thread.joinable(); }
+
+private:
+    void run(std::string path);
+
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::vector<std::string> m_queries;
+    std::vector<DB_PreloadResult> m_results;
+    std::vector<char> m_taken;
+    size_t m_done = 0;
+    bool m_quit = false;
+    std::thread m_thread;
+};
+
+typedef int (*DB_RowCallback)(void *user, int ncols, char **colval, char **colname);
+int DB_ReplayRows(const DB_PreloadResult &result, DB_RowCallback callback, void *user);
+
+#endif // DB_PRELOAD_H
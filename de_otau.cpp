@@ -208,10 +208,12 @@ void DeRestPluginPrivate::otauDataIndication(const deCONZ::ApsDataIndication &in
         // remember last activity time
         otauIdleTotalCounter = idleTotalCounter;
         updateOtaTicks = true;
+        enqueueEvent(Event(RDevices, REventOtauBlock, 0, device->key())); // airtime of the route
     }
     else if (zclFrame.commandId() == OTAU_IMAGE_PAGE_REQUEST_CMD_ID)
     {
         updateOtaTicks = true;
+        enqueueEvent(Event(RDevices, REventOtauBlock, 0, device->key()));
     }
     else
     {
@@ -251,11 +253,6 @@ bool DeRestPluginPrivate::isOtauBusy()
     return false;
 }
 
-bool DEV_OtauBusy()
-{
-    return plugin->isOtauBusy();
-}
-
 /*! Returns true if otau is activated.
  */
 bool DeRestPluginPrivate::isOtauActive()
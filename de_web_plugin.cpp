@@ -35,6 +35,7 @@
 #include <QJsonParseError>
 #include <cmath>
 #include "alarm_system_device_table.h"
+#include "aps_capture.h"
 #include "database.h"
 #include "deconz/u_assert.h"
 #include "deconz/atom_table.h"
@@ -52,6 +53,7 @@
 #include "ias_ace.h"
 #include "ias_zone.h"
 #include "json.h"
+#include "metrics.h"
 #include "poll_control.h"
 #include "poll_manager.h"
 #include "product_match.h"
@@ -59,6 +61,8 @@
 #include "rest_devices.h"
 #include "rest_alarmsystems.h"
 #include "read_files.h"
+#include "stall_detector.h"
+#include "startup_profile.h"
 #include "tuya.h"
 #include "utils/utils.h"
 #include "utils/scratchmem.h"
@@ -589,9 +593,11 @@ const deCONZ::Node *getCoreNode(uint64_t extAddress)
  */
 DeRestPluginPrivate::DeRestPluginPrivate(QObject *parent) :
     QObject(parent),
-    apsCtrlWrapper(deCONZ::ApsController::instance())
+    apsCtrlWrapper(deCONZ::ApsController::instance()),
+    timerWheel(deCONZ::steadyTimeRef().ref, TW_TICK_MS)
 {
     plugin = this;
+    SP_Start();
     ScratchMemInit();
 
     DEV_SetTestManaged(deCONZ::appArgumentNumeric("--dev-test-managed", 0));
@@ -617,7 +623,10 @@ DeRestPluginPrivate::DeRestPluginPrivate(QObject *parent) :
 
     alarmSystems.reset(new AlarmSystems);
 
-    deviceJs = new DeviceJs();
+    {
+        SP_Scope startupScope(SP_JsInit);
+        deviceJs = new DeviceJs();
+    }
 
     deviceDescriptions = new DeviceDescriptions(this);
     connect(deviceDescriptions, &DeviceDescriptions::eventNotify, eventEmitter, &EventEmitter::enqueueEvent);
@@ -672,14 +681,32 @@ DeRestPluginPrivate::DeRestPluginPrivate(QObject *parent) :
     udpSock = 0;
     haEndpoint = 0;
     gwGroupSendDelay = deCONZ::appArgumentNumeric("--group-delay", GROUP_SEND_DELAY);
+    maxBindingTableReaders = qMax(1, deCONZ::appArgumentNumeric("--binding-table-readers", MAX_BINDING_TABLE_READERS));
+
+    if (deCONZ::appArgumentNumeric("--aps-capture", 0) == 1)
+    {
+        // record incoming indications for offline replay, see tests/407-aps-replay.cpp
+        const QString path = deCONZ::getStorageLocation(deCONZ::ApplicationsDataLocation) + QLatin1String("/aps_capture.bin");
+        apsCapture = new APS_CaptureWriter;
+        if (apsCapture->open(qPrintable(path)))
+        {
+            DBG_Printf(DBG_INFO, "APS capture to %s\n", qPrintable(path));
+        }
+        else
+        {
+            DBG_Printf(DBG_ERROR, "APS capture failed to open %s\n", qPrintable(path));
+            delete apsCapture;
+            apsCapture = nullptr;
+        }
+    }
     gwLinkButton = false;
     gwWebSocketNotifyAll = true;
     gwdisablePermitJoinAutoOff = false;
     gwLightLastSeenInterval = 60;
 
-    // preallocate memory to get consistent pointers
-    nodes.reserve(300);
-    sensors.reserve(150);
+    // preallocate chunks, addresses of nodes and sensors are stable anyway
+    nodes.reserve(256);
+    sensors.reserve(128);
 
     fastProbeTimer = new QTimer(this);
     fastProbeTimer->setInterval(500);
@@ -713,21 +740,36 @@ DeRestPluginPrivate::DeRestPluginPrivate(QObject *parent) :
     searchLightsTimeout = 0;
 
     // sensors
-    sensorCheckIter = 0;
     searchSensorsState = SearchSensorsIdle;
     searchSensorsTimeout = 0;
 
     ttlDataBaseConnection = 0;
-    openDb();
-    initDb();
+    {
+        SP_Scope startupScope(SP_DbOpen);
+        openDb();
+    }
+    {
+        SP_Scope startupScope(SP_DbInit);
+        initDb();
+    }
+
+    // readDb() tables load on a worker while the DDFs are read
+    DB_StartPreload(sqliteDatabaseName);
 
-    deviceDescriptions->prepare();
+    {
+        SP_Scope startupScope(SP_DdfScan);
+        deviceDescriptions->prepare();
+    }
     deviceDescriptions->readAll();
 
     readDb();
+    restoreBindingTables();
 
-    DB_LoadAlarmSystemDevices(alarmSystemDeviceTable.get());
-    DB_LoadAlarmSystems(*alarmSystems, alarmSystemDeviceTable.get(), eventEmitter);
+    {
+        SP_Scope startupScope(SP_LoadAlarmSystems);
+        DB_LoadAlarmSystemDevices(alarmSystemDeviceTable.get());
+        DB_LoadAlarmSystems(*alarmSystems, alarmSystemDeviceTable.get(), eventEmitter);
+    }
     AS_InitDefaultAlarmSystem(*alarmSystems, alarmSystemDeviceTable.get(), eventEmitter);
 
     closeDb();
@@ -834,13 +876,24 @@ DeRestPluginPrivate::DeRestPluginPrivate(QObject *parent) :
     connect(fastRuleCheckTimer, SIGNAL(timeout()),
             this, SLOT(fastRuleCheckTimerFired()));
 
-    checkSensorsTimer = new QTimer(this);
-    checkSensorsTimer->setSingleShot(false);
-    checkSensorsTimer->setInterval(CHECK_SENSOR_INTERVAL);
-    connect(checkSensorsTimer, SIGNAL(timeout()),
-            this, SLOT(checkSensorStateTimerFired()));
-    checkSensorsTimer->start();
-    sensorCheckFast = 0;
+    SD_Init(SD_DEFAULT_THRESHOLD_MS);
+    stallHeartbeatTimer = new QTimer(this);
+    stallHeartbeatTimer->setTimerType(Qt::PreciseTimer);
+    connect(stallHeartbeatTimer, SIGNAL(timeout()),
+            this, SLOT(stallHeartbeatTimerFired()));
+    stallHeartbeatTimer->start(SD_HEARTBEAT_INTERVAL_MS);
+
+    memoryStatsTimer = new QTimer(this);
+    connect(memoryStatsTimer, SIGNAL(timeout()),
+            this, SLOT(memoryStatsTimerFired()));
+    memoryStatsTimer->start(MEM_SAMPLE_INTERVAL_MS);
+
+    timerWheelTimer = new QTimer(this);
+    timerWheelTimer->setSingleShot(true);
+    timerWheelTimer->setTimerType(Qt::PreciseTimer);
+    connect(timerWheelTimer, SIGNAL(timeout()),
+            this, SLOT(timerWheelFired()));
+    armTimerWheel(); // durations restored from database
 
     bindingTimer = new QTimer(this);
     bindingTimer->setSingleShot(true);
@@ -945,6 +998,8 @@ DeRestPluginPrivate::~DeRestPluginPrivate()
     upnpTimer->stop();
     delete deviceJs;
     deviceJs = nullptr;
+    delete apsCapture;
+    apsCapture = nullptr;
     eventEmitter = nullptr;
     ScratchMemDestroy();
 }
@@ -1216,6 +1271,26 @@ void DeRestPluginPrivate::apsdeDataIndicationDevice(const deCONZ::ApsDataIndicat
     }
 }
 
+/*! Appends \p ind to the APS capture log.
+ */
+static void APS_CaptureIndication(APS_CaptureWriter *capture, const deCONZ::ApsDataIndication &ind)
+{
+    APS_CaptureRecord rec;
+    rec.timeMs = deCONZ::steadyTimeRef().ref;
+    rec.srcExt = ind.srcAddress().hasExt() ? ind.srcAddress().ext() : 0;
+    rec.srcNwk = ind.srcAddress().hasNwk() ? ind.srcAddress().nwk() : 0;
+    rec.groupcast = ind.dstAddressMode() == deCONZ::ApsGroupAddress;
+    rec.dstGroup = rec.groupcast ? ind.dstAddress().group() : 0;
+    rec.profileId = ind.profileId();
+    rec.clusterId = ind.clusterId();
+    rec.srcEndpoint = ind.srcEndpoint();
+    rec.dstEndpoint = ind.dstEndpoint();
+    rec.lqi = ind.linkQuality();
+    rec.rssi = ind.rssi();
+    rec.asdu.assign(ind.asdu().constBegin(), ind.asdu().constEnd());
+    capture->write(rec);
+}
+
 /*! APSDE-DATA.indication callback.
     \param ind - the indication primitive
     \note Will be called from the main application for each incoming indication.
@@ -1223,12 +1298,18 @@ void DeRestPluginPrivate::apsdeDataIndicationDevice(const deCONZ::ApsDataIndicat
  */
 void DeRestPluginPrivate::apsdeDataIndication(const deCONZ::ApsDataIndication &ind)
 {
+    SD_Scope stallScope(SD_ApsIndication);
     Q_Q(DeRestPlugin);
     if (!q->pluginActive())
     {
         return;
     }
 
+    if (apsCapture)
+    {
+        APS_CaptureIndication(apsCapture, ind);
+    }
+
     deCONZ::ZclFrame zclFrame;
     ZclDefaultResponder zclDefaultResponder(&apsCtrlWrapper, ind, zclFrame);
 
@@ -1521,8 +1602,10 @@ void DeRestPluginPrivate::apsdeDataIndication(const deCONZ::ApsDataIndication &i
  */
 void DeRestPluginPrivate::apsdeDataConfirm(const deCONZ::ApsDataConfirm &conf)
 {
+    SD_Scope stallScope(SD_ApsConfirm);
     pollManager->apsdeDataConfirm(conf);
     DA_ApsRequestConfirmed(conf);
+    handleBindingApsConfirm(conf);
 
     if (conf.dstAddress().hasExt())
     {
@@ -1547,6 +1630,7 @@ void DeRestPluginPrivate::apsdeDataConfirm(const deCONZ::ApsDataConfirm &conf)
             DBG_Printf(DBG_INFO_L2, "Erase task req-id: %u, type: %d zcl seqno: %u send time %d, profileId: 0x%04X, clusterId: 0x%04X\n",
                        task.req.id(), task.taskType, task.zclFrame.sequenceNumber(), idleTotalCounter - task.sendTime, task.req.profileId(), task.req.clusterId());
         }
+        taskScheduler.markConfirmed(task.taskId, deCONZ::steadyTimeRef().ref);
         runningTasks.erase(i);
         processTasks();
         break;
@@ -1749,13 +1833,12 @@ void DeRestPluginPrivate::gpProcessButtonEvent(const deCONZ::GpDataIndication &i
         }
         else if (btnAction == S_BUTTON_ACTION_INITIAL_PRESS)
         {
-            sensor->durationDue = now.addMSecs(500); // enable generation of x001 (hold)
-            checkSensorsTimer->start(CHECK_SENSOR_FAST_INTERVAL);
+            setSensorDurationDue(sensor, now.addMSecs(500)); // enable generation of x001 (hold)
             btn = btnMapped + S_BUTTON_ACTION_INITIAL_PRESS;
         }
         else if (btnAction == S_BUTTON_ACTION_SHORT_RELEASED)
         {
-            sensor->durationDue = QDateTime(); // disable generation of x001 (hold)
+            setSensorDurationDue(sensor, QDateTime()); // disable generation of x001 (hold)
             const quint32 action = item->toNumber() & 0x03; // last action
 
             if (action == S_BUTTON_ACTION_HOLD || // hold already triggered -> long release
@@ -2128,7 +2211,7 @@ void DeRestPluginPrivate::gpDataIndication(const deCONZ::GpDataIndication &ind)
             updateSensorEtag(&sensorNode);
 
             sensorNode.setNeedSaveDatabase(true);
-            sensorNode.setHandle(R_CreateResourceHandle(&sensorNode, sensors.size()));
+            sensorNode.setHandle(R_CreateResourceHandle(&sensorNode, sensors.size(), sensors.generation(sensors.size())));
             sensors.push_back(sensorNode);
 
             sensor = &sensors.back();
@@ -3091,7 +3174,7 @@ void DeRestPluginPrivate::addLightNode(const deCONZ::Node *node)
 
         DBG_Printf(DBG_INFO, "LightNode %u: %s added\n", lightNode.id().toUInt(), qPrintable(lightNode.name()));
 
-        lightNode.setHandle(R_CreateResourceHandle(&lightNode, nodes.size()));
+        lightNode.setHandle(R_CreateResourceHandle(&lightNode, nodes.size(), nodes.generation(nodes.size())));
         nodes.push_back(lightNode);
         lightNode2 = &nodes.back();
         device->addSubDevice(lightNode2);
@@ -3261,8 +3344,8 @@ void DeRestPluginPrivate::nodeZombieStateChanged(const deCONZ::Node *node)
     }
 
     { // lights
-        std::vector<LightNode>::iterator i = nodes.begin();
-        std::vector<LightNode>::iterator end = nodes.end();
+        SlabVector<LightNode>::iterator i = nodes.begin();
+        SlabVector<LightNode>::iterator end = nodes.end();
 
         for (; i != end; ++i)
         {
@@ -3305,8 +3388,8 @@ void DeRestPluginPrivate::nodeZombieStateChanged(const deCONZ::Node *node)
     }
 
     { // sensors
-        std::vector<Sensor>::iterator i = sensors.begin();
-        std::vector<Sensor>::iterator end = sensors.end();
+        SlabVector<Sensor>::iterator i = sensors.begin();
+        SlabVector<Sensor>::iterator end = sensors.end();
 
         for (; i != end; ++i)
         {
@@ -4004,8 +4087,8 @@ LightNode *DeRestPluginPrivate::getLightNodeForAddress(const deCONZ::Address &ad
 int DeRestPluginPrivate::getNumberOfEndpoints(quint64 extAddr)
 {
     int count = 0;
-    std::vector<LightNode>::iterator i;
-    std::vector<LightNode>::iterator end = nodes.end();
+    SlabVector<LightNode>::iterator i;
+    SlabVector<LightNode>::iterator end = nodes.end();
 
     for (i = nodes.begin(); i != end; ++i)
     {
@@ -4022,15 +4105,27 @@ int DeRestPluginPrivate::getNumberOfEndpoints(quint64 extAddr)
  */
 LightNode *DeRestPluginPrivate::getLightNodeForId(const QString &id)
 {
-    std::vector<LightNode>::iterator i;
-    std::vector<LightNode>::iterator end = nodes.end();
+    SlabVector<LightNode>::iterator i;
+    SlabVector<LightNode>::iterator end = nodes.end();
 
     if (id.length() < MIN_UNIQUEID_LENGTH)
     {
+        // indexes are stable, so a cached index only needs to be verified
+        const auto cached = lightIdCache.constFind(id);
+        if (cached != lightIdCache.cend() && *cached < nodes.size())
+        {
+            LightNode &lightNode = nodes[*cached];
+            if (lightNode.id() == id && lightNode.state() == LightNode::StateNormal)
+            {
+                return &lightNode;
+            }
+        }
+
         for (i = nodes.begin(); i != end; ++i)
         {
             if (i->id() == id && i->state() == LightNode::StateNormal)
             {
+                lightIdCache.insert(id, i.index());
                 return &*i;
             }
         }
@@ -4837,12 +4932,11 @@ void DeRestPluginPrivate::checkSensorButtonEvent(Sensor *sensor, const deCONZ::A
 
                             if (buttonMap.button == (S_BUTTON_1 + S_BUTTON_ACTION_INITIAL_PRESS))
                             {
-                                sensor->durationDue = now.addMSecs(500); // enable generation of 1001 (hold)
-                                checkSensorsTimer->start(CHECK_SENSOR_FAST_INTERVAL);
+                                setSensorDurationDue(sensor, now.addMSecs(500)); // enable generation of 1001 (hold)
                             }
                             else if (buttonMap.button == (S_BUTTON_1 + S_BUTTON_ACTION_SHORT_RELEASED))
                             {
-                                sensor->durationDue = QDateTime(); // disable generation of 1001 (hold)
+                                setSensorDurationDue(sensor, QDateTime()); // disable generation of 1001 (hold)
 
                                 ResourceItem *item = sensor->item(RStateButtonEvent);
                                 if (item && (item->toNumber() == (S_BUTTON_1 + S_BUTTON_ACTION_INITIAL_PRESS) ||
@@ -5350,7 +5444,7 @@ void DeRestPluginPrivate::checkSensorButtonEvent(Sensor *sensor, const deCONZ::A
                         ResourceItem *item2 = sensor->item(RConfigDuration);
                         if (item2 && item2->toNumber() > 0)
                         {
-                            sensor->durationDue = QDateTime::currentDateTime().addSecs(item2->toNumber());
+                            setSensorDurationDue(sensor, QDateTime::currentDateTime().addSecs(item2->toNumber()));
                         }
                     }
                     break;
@@ -5424,8 +5518,8 @@ void DeRestPluginPrivate::addSensorNode(const deCONZ::Node *node, const deCONZ::
     }
 
     { // check existing sensors
-        std::vector<Sensor>::iterator i = sensors.begin();
-        std::vector<Sensor>::iterator end = sensors.end();
+        SlabVector<Sensor>::iterator i = sensors.begin();
+        SlabVector<Sensor>::iterator end = sensors.end();
 
         bool pollControlInitialized = false;
 
@@ -6944,8 +7038,8 @@ void DeRestPluginPrivate::addSensorNode(const deCONZ::Node *node, const SensorFi
     if (node->endpoints().size() == 1)
     {
         quint8 ep = node->endpoints()[0];
-        std::vector<Sensor>::iterator i = sensors.begin();
-        std::vector<Sensor>::iterator end = sensors.end();
+        SlabVector<Sensor>::iterator i = sensors.begin();
+        SlabVector<Sensor>::iterator end = sensors.end();
 
         for (; i != end; ++i)
         {
@@ -7915,7 +8009,7 @@ void DeRestPluginPrivate::addSensorNode(const deCONZ::Node *node, const SensorFi
     else
     {
         DBG_Printf(DBG_INFO, "SensorNode %s: %s added\n", qPrintable(sensorNode.id()), qPrintable(sensorNode.name()));
-        sensorNode.setHandle(R_CreateResourceHandle(&sensorNode, sensors.size()));
+        sensorNode.setHandle(R_CreateResourceHandle(&sensorNode, sensors.size(), sensors.generation(sensors.size())));
         sensors.push_back(sensorNode);
         sensor2 = &sensors.back();
         updateSensorEtag(sensor2);
@@ -8123,8 +8217,8 @@ void DeRestPluginPrivate::updateSensorNode(const deCONZ::NodeEvent &event)
         return; // don't process further
     }
 
-    std::vector<Sensor>::iterator i = sensors.begin();
-    std::vector<Sensor>::iterator end = sensors.end();
+    SlabVector<Sensor>::iterator i = sensors.begin();
+    SlabVector<Sensor>::iterator end = sensors.end();
 
     for (; i != end; ++i)
     {
@@ -9130,14 +9224,14 @@ void DeRestPluginPrivate::updateSensorNode(const deCONZ::NodeEvent &event)
                                             updateType == NodeValue::UpdateByZclReport)
                                         {
                                             // prevent setting presence back to false, when report.maxInterval > config.duration
-                                            i->durationDue = item->lastSet().addSecs(val.maxInterval);
+                                            setSensorDurationDue(&*i, item->lastSet().addSecs(val.maxInterval));
                                         }
                                         else
                                         {
                                             ResourceItem *item2 = i->item(RConfigDuration);
                                             if (item2 && item2->toNumber() > 0)
                                             {
-                                                i->durationDue = item->lastSet().addSecs(item2->toNumber());
+                                                setSensorDurationDue(&*i, item->lastSet().addSecs(item2->toNumber()));
                                             }
                                         }
                                     }
@@ -9177,7 +9271,7 @@ void DeRestPluginPrivate::updateSensorNode(const deCONZ::NodeEvent &event)
                                         {
                                             item->setValue(true);
                                             enqueueEvent(Event(RSensors, RStateVibration, i->id(), item));
-                                            i->durationDue = item->lastSet().addSecs(65);
+                                            setSensorDurationDue(&*i, item->lastSet().addSecs(65));
                                             updated = true;
                                         }
                                     }
@@ -9374,8 +9468,8 @@ bool DeRestPluginPrivate::isDeviceSupported(const deCONZ::Node *node, const QStr
  */
 Sensor *DeRestPluginPrivate::getSensorNodeForAddress(quint64 extAddr)
 {
-    std::vector<Sensor>::iterator i = sensors.begin();
-    std::vector<Sensor>::iterator end = sensors.end();
+    SlabVector<Sensor>::iterator i = sensors.begin();
+    SlabVector<Sensor>::iterator end = sensors.end();
 
     for (; i != end; ++i)
     {
@@ -9468,8 +9562,8 @@ Sensor *DeRestPluginPrivate::getSensorNodeForAddressEndpointAndCluster(const deC
  */
 Sensor *DeRestPluginPrivate::getSensorNodeForFingerPrint(quint64 extAddr, const SensorFingerprint &fingerPrint, const QString &type)
 {
-    std::vector<Sensor>::iterator i = sensors.begin();
-    std::vector<Sensor>::iterator end = sensors.end();
+    SlabVector<Sensor>::iterator i = sensors.begin();
+    SlabVector<Sensor>::iterator end = sensors.end();
 
     for (; i != end; ++i)
     {
@@ -9538,10 +9632,23 @@ Sensor *DeRestPluginPrivate::getSensorNodeForUniqueId(const QString &uniqueId)
  */
 Sensor *DeRestPluginPrivate::getSensorNodeForId(const QString &id)
 {
-    for (Sensor &s : sensors)
+    // indexes are stable, so a cached index only needs to be verified
+    const auto cached = sensorIdCache.constFind(id);
+    if (cached != sensorIdCache.cend() && *cached < sensors.size())
+    {
+        Sensor &s = sensors[*cached];
+        if (s.deletedState() == Sensor::StateNormal && s.id() == id)
+        {
+            return &s;
+        }
+    }
+
+    for (size_t i = 0; i < sensors.size(); i++)
     {
+        Sensor &s = sensors[i];
         if (s.deletedState() == Sensor::StateNormal && s.id() == id)
         {
+            sensorIdCache.insert(id, i);
             return &s;
         }
     }
@@ -9986,8 +10093,8 @@ bool DeRestPluginPrivate::processZclAttributes(Sensor *sensorNode)
             if (ok && readBindingTable(sensorNode, 0))
             {
                 // only read binding table once per node even if multiple devices/sensors are implemented
-                std::vector<Sensor>::iterator i = sensors.begin();
-                std::vector<Sensor>::iterator end = sensors.end();
+                SlabVector<Sensor>::iterator i = sensors.begin();
+                SlabVector<Sensor>::iterator end = sensors.end();
 
                 for (; i != end; ++i)
                 {
@@ -10804,8 +10911,8 @@ void DeRestPluginPrivate::setAttributeOnOffGroup(Group *group, uint8_t onOff)
         changed = true;
     }
 
-    std::vector<LightNode>::iterator i = nodes.begin();
-    std::vector<LightNode>::iterator end = nodes.end();
+    SlabVector<LightNode>::iterator i = nodes.begin();
+    SlabVector<LightNode>::iterator end = nodes.end();
 
     for (; i != end; ++i)
     {
@@ -11005,8 +11112,8 @@ bool DeRestPluginPrivate::storeScene(Group *group, uint8_t sceneId)
         }
     }
 #if 0
-    std::vector<LightNode>::iterator i = nodes.begin();
-    std::vector<LightNode>::iterator end = nodes.end();
+    SlabVector<LightNode>::iterator i = nodes.begin();
+    SlabVector<LightNode>::iterator end = nodes.end();
     for (; i != end; ++i)
     {
         LightNode *lightNode = &(*i);
@@ -11059,8 +11166,8 @@ bool DeRestPluginPrivate::modifyScene(Group *group, uint8_t sceneId)
         return false;
     }
 
-    std::vector<LightNode>::iterator i = nodes.begin();
-    std::vector<LightNode>::iterator end = nodes.end();
+    SlabVector<LightNode>::iterator i = nodes.begin();
+    SlabVector<LightNode>::iterator end = nodes.end();
     for (; i != end; ++i)
     {
         LightNode *lightNode = &(*i);
@@ -11109,8 +11216,8 @@ bool DeRestPluginPrivate::removeScene(Group *group, uint8_t sceneId)
         }
     }
 
-    std::vector<LightNode>::iterator i = nodes.begin();
-    std::vector<LightNode>::iterator end = nodes.end();
+    SlabVector<LightNode>::iterator i = nodes.begin();
+    SlabVector<LightNode>::iterator end = nodes.end();
     for (; i != end; ++i)
     {
         LightNode *lightNode = &(*i);
@@ -11419,6 +11526,109 @@ void DeRestPluginPrivate::storeRecoverOnOffBri(LightNode *lightNode)
     recoverOnOff.push_back(rc);
 }
 
+/*! Returns the TaskScheduler destination key of an APS request.
+    Group and NWK only destinations are tagged to not collide with extended addresses.
+ */
+static uint64_t taskDestinationKey(const deCONZ::ApsDataRequest &req)
+{
+    if (req.dstAddressMode() == deCONZ::ApsGroupAddress)
+    {
+        return 0x10000 | req.dstAddress().group();
+    }
+
+    if (req.dstAddress().hasExt())
+    {
+        return req.dstAddress().ext();
+    }
+
+    return 0x20000 | req.dstAddress().nwk();
+}
+
+/*! Returns the key of commands which supersede each other or 0 if the task must never be replaced.
+    Unique per destination: endpoints, cluster, task type, tx options, profile and payload size.
+ */
+static uint64_t taskCoalesceKey(const TaskItem &task)
+{
+    switch (task.taskType)
+    {
+    case TaskSetLevel:
+        // latest Move to Level wins, e.g. slider bursts, see taskCoalesceTailOnly()
+        if (task.zclFrame.commandId() != 0x00 && task.zclFrame.commandId() != 0x04)
+        {
+            return 0;
+        }
+        break;
+    case TaskGetSceneMembership:
+    case TaskGetGroupMembership:
+    case TaskGetGroupIdentifiers:
+    case TaskStoreScene:
+    case TaskRemoveScene:
+    case TaskRemoveAllScenes:
+    case TaskReadAttributes:
+    case TaskWriteAttribute:
+    case TaskViewScene:
+    case TaskTuyaRequest:
+    case TaskAddScene:
+        return 0;
+    default:
+        break;
+    }
+
+    if (task.req.asdu().size() > UINT8_MAX)
+    {
+        return 0;
+    }
+
+    uint64_t key = task.req.dstEndpoint();
+    key = (key << 8) | task.req.srcEndpoint();
+    key = (key << 16) | task.req.clusterId();
+    key = (key << 8) | (uint8_t(task.taskType) + 1); // never 0
+    if (task.taskType == TaskSetLevel && task.zclFrame.commandId() == 0x04)
+    {
+        key |= 0x80; // Move to Level (with On/Off) doesn't supersede a plain Move to Level
+    }
+    key = (key << 8) | uint8_t(task.req.asdu().size());
+    key = (key << 8) | uint8_t(task.req.txOptions());
+    key = (key << 8) | uint8_t(task.req.profileId() ^ (task.req.profileId() >> 8));
+    return key;
+}
+
+/*! Returns true if \p task may only supersede the last queued task of its destination.
+    Move to Level commands must not overtake On/Off commands which were queued after them.
+ */
+static bool taskCoalesceTailOnly(const TaskItem &task)
+{
+    return task.taskType == TaskSetLevel;
+}
+
+/*! Returns the priority class of a task, reads are background work, everything else
+    depends on who created the task (REST-API client or rule/schedule).
+ */
+static TaskPriority taskPriority(const TaskItem &task, TaskPriority context)
+{
+    switch (task.taskType)
+    {
+    case TaskGetHue:
+    case TaskGetColor:
+    case TaskGetSat:
+    case TaskGetLevel:
+    case TaskGetOnOff:
+    case TaskGetColorLoop:
+    case TaskReadAttributes:
+    case TaskGetGroupMembership:
+    case TaskGetGroupIdentifiers:
+    case TaskGetSceneMembership:
+    case TaskViewScene:
+    case TaskViewGroup:
+    case TaskSyncTime:
+        return TaskPriorityPoll;
+    default:
+        break;
+    }
+
+    return context;
+}
+
 /*! Adds a task to the queue.
     \return true - on success
  */
@@ -11446,59 +11656,55 @@ bool DeRestPluginPrivate::addTask(const TaskItem &task)
         }
     }
 
-    const uint MaxTasks = 20;
+    int supersededTaskId = -1;
+    const TaskPriority prio = taskPriority(task, taskPriorityContext);
+    const bool groupcast = task.req.dstAddressMode() == deCONZ::ApsGroupAddress;
 
-    std::list<TaskItem>::iterator i = tasks.begin();
-    std::list<TaskItem>::iterator end = tasks.end();
+    if (!taskScheduler.enqueue(task.taskId, taskDestinationKey(task.req), groupcast, prio, taskCoalesceKey(task), &supersededTaskId, taskCoalesceTailOnly(task)))
+    {
+        DBG_Assert(supersededTaskId == -1); // a task without scheduler entry would never be sent
+        DBG_Printf(DBG_INFO, "failed to add task %d type: %d, too many tasks\n", task.taskId, task.taskType);
+        return false;
+    }
 
-    if ((task.taskType != TaskSetLevel) &&
-        (task.taskType != TaskGetSceneMembership) &&
-        (task.taskType != TaskGetGroupMembership) &&
-        (task.taskType != TaskGetGroupIdentifiers) &&
-        (task.taskType != TaskStoreScene) &&
-        (task.taskType != TaskRemoveScene) &&
-        (task.taskType != TaskRemoveAllScenes) &&
-        (task.taskType != TaskReadAttributes) &&
-        (task.taskType != TaskWriteAttribute) &&
-        (task.taskType != TaskViewScene) &&
-        (task.taskType != TaskTuyaRequest) &&
-        (task.taskType != TaskAddScene))
+    if (supersededTaskId != -1)
     {
-        for (; i != end; ++i)
+        const auto i = taskIndex.find(supersededTaskId);
+        DBG_Assert(i != taskIndex.end());
+        if (i != taskIndex.end())
         {
-            if (i->taskType == task.taskType)
-            {
-                if ((i->req.dstAddress() ==  task.req.dstAddress()) &&
-                    (i->req.dstEndpoint() ==  task.req.dstEndpoint()) &&
-                    (i->req.srcEndpoint() ==  task.req.srcEndpoint()) &&
-                    (i->req.profileId() ==  task.req.profileId()) &&
-                    (i->req.clusterId() ==  task.req.clusterId()) &&
-                    (i->req.txOptions() ==  task.req.txOptions()) &&
-                    (i->req.asdu().size() ==  task.req.asdu().size()))
-
-                {
-                    DBG_Printf(DBG_INFO, "Replace task %d type %d in queue cluster 0x%04X with newer task %d of same type. %zu runnig tasks\n", i->taskId, task.taskType, task.req.clusterId(), task.taskId, runningTasks.size());
-                    *i = task;
-                    return true;
-                }
-            }
+            DBG_Printf(DBG_INFO, "Replace task %d type %d in queue cluster 0x%04X with newer task %d of same type. %zu runnig tasks\n", supersededTaskId, task.taskType, task.req.clusterId(), task.taskId, runningTasks.size());
+            // the send order is up to the scheduler, so the list entry can be reused
+            std::list<TaskItem>::iterator t = i->second;
+            taskIndex.erase(i);
+            *t = task;
+            taskIndex[task.taskId] = t;
+            return true;
         }
     }
 
-    if (tasks.size() < MaxTasks) {
-        tasks.push_back(task);
-        return true;
-    }
-
-    DBG_Printf(DBG_INFO, "failed to add task %d type: %d, too many tasks\n", task.taskId, task.taskType);
+    tasks.push_back(task);
+    taskIndex[task.taskId] = std::prev(tasks.end());
+    return true;
+}
 
-    return false;
+/*! Removes a not yet sent task from the queue.
+ */
+void DeRestPluginPrivate::eraseTask(std::list<TaskItem>::iterator i)
+{
+    taskScheduler.remove(i->taskId);
+    taskIndex.erase(i->taskId);
+    tasks.erase(i);
 }
 
 /*! Fires the next APS-DATA.request.
+
+    The TaskScheduler picks the task based on priority class, round-robin between
+    destinations and the on-air budget of the destination.
  */
 void DeRestPluginPrivate::processTasks()
 {
+    SD_Scope stallScope(SD_Timer);
     if (!apsCtrl)
     {
         return;
@@ -11514,6 +11720,8 @@ void DeRestPluginPrivate::processTasks()
         DBG_Printf(DBG_INFO, "Not in network cleanup %zu tasks\n", (runningTasks.size() + tasks.size()));
         runningTasks.clear();
         tasks.clear();
+        taskIndex.clear();
+        taskScheduler.clear();
         return;
     }
 
@@ -11522,8 +11730,7 @@ void DeRestPluginPrivate::processTasks()
         return;
     }
 
-    if (runningTasks.size() >= MAX_BACKGROUND_TASKS)
-    {
+    {   // drop requests which never got a confirm
         std::list<TaskItem>::iterator j = runningTasks.begin();
         std::list<TaskItem>::iterator jend = runningTasks.end();
 
@@ -11534,168 +11741,142 @@ void DeRestPluginPrivate::processTasks()
             if (dt > 120)
             {
                 DBG_Printf(DBG_INFO, "drop request %u send time %d, cluster 0x%04X, after %d seconds\n", j->req.id(), j->sendTime, j->req.clusterId(), dt);
+                taskScheduler.markDropped(j->taskId);
                 runningTasks.erase(j);
                 return;
             }
-
         }
+    }
 
-        DBG_Printf(DBG_INFO, "%zu running tasks, wait\n", runningTasks.size());
+    if (runningTasks.size() >= MAX_BACKGROUND_TASKS)
+    {
+        DBG_Printf(DBG_INFO_L2, "%zu running tasks, wait\n", runningTasks.size());
         return;
     }
 
-    QTime now = QTime::currentTime();
-    std::list<TaskItem>::iterator i = tasks.begin();
-    std::list<TaskItem>::iterator end = tasks.end();
+    const QTime now = QTime::currentTime();
 
-    for (; i != end; ++i)
+    const int taskId = taskScheduler.selectNext([this, &now](int id)
     {
-        if (i->lightNode)
+        const auto t = taskIndex.find(id);
+        if (t == taskIndex.end())
         {
-            // drop dead unicasts
-            if (!i->lightNode->isAvailable() || !i->lightNode->lastRx().isValid())
-            {
-                DBG_Printf(DBG_INFO, "drop request to zombie (rx = %u)\n", (uint)i->lightNode->lastRx().isValid());
-                tasks.erase(i);
-                return;
-            }
+            return false;
         }
 
-        // send only few requests to a destination at a time
-        int onAir = 0;
-        const int maxOnAir = i->req.dstAddressMode() == deCONZ::ApsGroupAddress ? 6 : 2;
-        std::list<TaskItem>::iterator j = runningTasks.begin();
-        std::list<TaskItem>::iterator jend = runningTasks.end();
-
-        bool ok = true;
-        if (i->ordered && std::distance(tasks.begin(), i) > 0) // previous not processed yet
-        {
-            ok = false;
-        }
+        const TaskItem &task = *t->second;
 
-        for (; ok && j != jend; ++j)
+        if (task.ordered) // previous not processed yet
         {
-            if (i->ordered && i->taskId == (j->taskId + 1)) // previous running
+            if (taskIndex.find(task.taskId - 1) != taskIndex.end())
             {
-                ok = false;
-                break;
+                return false;
             }
 
-            if (i->req.dstAddressMode() == deCONZ::ApsGroupAddress &&
-                j->req.dstAddressMode() == deCONZ::ApsGroupAddress)
+            const auto prev = std::find_if(runningTasks.cbegin(), runningTasks.cend(), [&task](const TaskItem &j)
             {
-                onAir++;
+                return task.taskId == (j.taskId + 1);
+            });
 
-                if (onAir >= maxOnAir)
-                {
-                    ok = false;
-                    break;
-                }
+            if (prev != runningTasks.cend())
+            {
+                return false;
             }
-            else if (i->req.dstAddress() == j->req.dstAddress())
+        }
+
+        if (task.req.dstAddressMode() == deCONZ::ApsGroupAddress)
+        {
+            const Group *group = getGroupForId(task.req.dstAddress().group());
+
+            if (group && group->sendTime.isValid())
             {
-                onAir++;
-                int dt = idleTotalCounter - j->sendTime;
-                if (dt < 5 || onAir >= maxOnAir)
+                const int diff = group->sendTime.msecsTo(now);
+                if (diff > 0 && diff <= gwGroupSendDelay)
                 {
-                    if (dt > 120)
-                    {
-                        DBG_Printf(DBG_INFO, "drop request %u send time %d, cluster 0x%04X, onAir %d after %d seconds\n", j->req.id(), j->sendTime, j->req.clusterId(), onAir, dt);
-                        runningTasks.erase(j);
-                        return;
-                    }
-                    else
-                    {
-                        //DBG_Printf(DBG_INFO, "request %u send time %d, cluster 0x%04X, onAir %d\n", i->req.id(), j->sendTime, j->req.clusterId(), onAir);
-                        DBG_Printf(DBG_INFO, "delay sending request %u dt %d ms to " FMT_MAC ", ep: 0x%02X cluster: 0x%04X onAir: %d\n", i->req.id(), dt, FMT_MAC_CAST(i->req.dstAddress().ext()), i->req.dstEndpoint(), i->req.clusterId(), onAir);
-                        ok = false;
-                    }
-                    break;
+                    DBG_Printf(DBG_INFO_L2, "delayed group sending\n");
+                    return false;
                 }
             }
         }
 
-        if (!ok) // destination already busy
+        return true;
+    });
+
+    if (taskId < 0)
+    {
+        return;
+    }
+
+    const auto t = taskIndex.find(taskId);
+    DBG_Assert(t != taskIndex.end());
+    if (t == taskIndex.end())
+    {
+        taskScheduler.remove(taskId);
+        return;
+    }
+
+    std::list<TaskItem>::iterator i = t->second;
+
+    if (i->lightNode)
+    {
+        // drop dead unicasts
+        if (!i->lightNode->isAvailable() || !i->lightNode->lastRx().isValid())
         {
+            DBG_Printf(DBG_INFO, "drop request to zombie (rx = %u)\n", (uint)i->lightNode->lastRx().isValid());
+            eraseTask(i);
+            return;
         }
-        else
-        {
-            bool pushRunning = (i->req.state() != deCONZ::FireAndForgetState);
+    }
 
-            // groupcast tasks
-            if (i->req.dstAddressMode() == deCONZ::ApsGroupAddress)
-            {
-                Group *group = getGroupForId(i->req.dstAddress().group());
+    const bool pushRunning = (i->req.state() != deCONZ::FireAndForgetState);
+    Group *group = nullptr;
 
-                if (group)
-                {
-                    int diff = group->sendTime.msecsTo(now);
+    // groupcast tasks
+    if (i->req.dstAddressMode() == deCONZ::ApsGroupAddress)
+    {
+        group = getGroupForId(i->req.dstAddress().group());
 
-                    if (!group->sendTime.isValid() || (diff <= 0) || (diff > gwGroupSendDelay))
-                    {
-                        i->sendTime = idleTotalCounter;
-                        if (apsCtrlWrapper.apsdeDataRequest(i->req) == deCONZ::Success)
-                        {
-                            group->sendTime = now;
-                            if (pushRunning)
-                            {
-                                runningTasks.push_back(*i);
-                            }
-                            tasks.erase(i);
-                            return;
-                        }
-                    }
-                    else
-                    {
-                        DBG_Printf(DBG_INFO, "delayed group sending\n");
-                    }
-                }
-                else
-                {
-                    DBG_Printf(DBG_INFO, "drop request to unknown group\n");
-                    tasks.erase(i);
-                    return;
-                }
-            }
-            // unicast/broadcast tasks
-            else
-            {
-                if (i->lightNode && !i->lightNode->isAvailable())
-                {
-                    DBG_Printf(DBG_INFO, "drop request to zombie\n");
-                    tasks.erase(i);
-                    return;
-                }
-                else
-                {
+        if (!group)
+        {
+            DBG_Printf(DBG_INFO, "drop request to unknown group\n");
+            eraseTask(i);
+            return;
+        }
+    }
 
-                    i->sendTime = idleTotalCounter;
-                    int ret = apsCtrlWrapper.apsdeDataRequest(i->req);
+    i->sendTime = idleTotalCounter;
+    const int ret = apsCtrlWrapper.apsdeDataRequest(i->req);
 
-                    if (ret == deCONZ::Success)
-                    {
-                        if (pushRunning)
-                        {
-                            runningTasks.push_back(*i);
-                        }
-                        tasks.erase(i);
-                        return;
-                    }
-                    else if (ret == deCONZ::ErrorNodeIsZombie)
-                    {
-                        DBG_Printf(DBG_INFO, "drop request to zombie\n");
-                        tasks.erase(i);
-                        return;
-                    }
-                    else
-                    {
-                        DBG_Printf(DBG_INFO, "enqueue APS request failed with error %d, drop\n", ret);
-                        tasks.erase(i);
-                        return;
-                    }
-                }
-            }
+    if (ret == deCONZ::Success)
+    {
+        if (group)
+        {
+            group->sendTime = now;
+        }
+
+        taskScheduler.markSent(i->taskId, deCONZ::steadyTimeRef().ref, pushRunning);
+        taskIndex.erase(t);
+
+        if (pushRunning)
+        {
+            runningTasks.push_back(*i);
         }
+        tasks.erase(i);
+    }
+    else if (group)
+    {
+        // keep the groupcast queued and retry later
+        DBG_Printf(DBG_INFO, "enqueue APS groupcast failed with error %d, retry\n", ret);
+    }
+    else if (ret == deCONZ::ErrorNodeIsZombie)
+    {
+        DBG_Printf(DBG_INFO, "drop request to zombie\n");
+        eraseTask(i);
+    }
+    else
+    {
+        DBG_Printf(DBG_INFO, "enqueue APS request failed with error %d, drop\n", ret);
+        eraseTask(i);
     }
 }
 
@@ -12532,6 +12713,7 @@ void DeRestPluginPrivate::handleSceneClusterIndication(const deCONZ::ApsDataIndi
                             {
                                 LightState state;
                                 state.setLightId(lightNode->id());
+                                state.setLightHandle(lightNode->handle());
                                 ResourceItem *item = lightNode->item(RStateOn);
                                 DBG_Assert(item != 0);
                                 if (item)
@@ -12947,6 +13129,7 @@ void DeRestPluginPrivate::handleSceneClusterIndication(const deCONZ::ApsDataIndi
                 {
                     LightState newLightState;
                     newLightState.setLightId(lightNode->id());
+                    newLightState.setLightHandle(lightNode->handle());
                     newLightState.setTransitionTime(transitionTime * 10);
                     newLightState.tVerified.start();
                     if (hasOnOff) { newLightState.setOn(onOff); }
@@ -13305,11 +13488,11 @@ void DeRestPluginPrivate::handleOnOffClusterIndication(const deCONZ::ApsDataIndi
                 item = s.item(RConfigDuration);
                 if (item && item->toNumber() > 0)
                 {
-                    s.durationDue = QDateTime::currentDateTime().addSecs(item->toNumber());
+                    setSensorDurationDue(&s, QDateTime::currentDateTime().addSecs(item->toNumber()));
                 }
                 else if (delay > 0)
                 {
-                    s.durationDue = QDateTime::currentDateTime().addSecs(delay);
+                    setSensorDurationDue(&s, QDateTime::currentDateTime().addSecs(delay));
                 }
             }
         }
@@ -13343,8 +13526,8 @@ void DeRestPluginPrivate::handleOnOffClusterIndication(const deCONZ::ApsDataIndi
         updateGroupEtag(group);
 
         // check each light if colorloop needs to be disabled
-        std::vector<LightNode>::iterator l = nodes.begin();
-        std::vector<LightNode>::iterator lend = nodes.end();
+        SlabVector<LightNode>::iterator l = nodes.begin();
+        SlabVector<LightNode>::iterator lend = nodes.end();
 
         for (; l != lend; ++l)
         {
@@ -13537,8 +13720,8 @@ void DeRestPluginPrivate::taskToLocalData(const TaskItem &task)
             group = &dummyGroup;
         }
 
-        std::vector<LightNode>::iterator i = nodes.begin();
-        std::vector<LightNode>::iterator end = nodes.end();
+        SlabVector<LightNode>::iterator i = nodes.begin();
+        SlabVector<LightNode>::iterator end = nodes.end();
 
         for (; i != end; ++i)
         {
@@ -14925,6 +15108,16 @@ void DeRestPlugin::idleTimerFired()
         d->idleLimit--;
     }
 
+    if (d->httpKeepAlive.size() > 0)
+    {
+        std::vector<void*> expired;
+        d->httpKeepAlive.expire(deCONZ::steadyTimeRef().ref, &expired);
+        for (void *conn : expired)
+        {
+            static_cast<QTcpSocket*>(conn)->disconnectFromHost(); // idle keep-alive connection
+        }
+    }
+
     ResourceItem *localTime = d->config.item(RConfigLocalTime);
     if (localTime)
     {
@@ -15418,8 +15611,8 @@ void DeRestPlugin::idleTimerFired()
  */
 void DeRestPlugin::refreshAll()
 {
-//    std::vector<LightNode>::iterator i = d->nodes.begin();
-//    std::vector<LightNode>::iterator end = d->nodes.end();
+//    SlabVector<LightNode>::iterator i = d->nodes.begin();
+//    SlabVector<LightNode>::iterator end = d->nodes.end();
 
 //    for (; i != end; ++i)
 //    {
@@ -15646,6 +15839,10 @@ bool DeRestPlugin::isHttpTarget(const QHttpRequestHeader &hdr)
             return true;
         }
     }
+    else if (hdr.pathAt(0) == QLatin1String("metrics"))
+    {
+        return true;
+    }
     else if (hdr.hasKey(QLatin1String("Upgrade")) && hdr.value(QLatin1String("Upgrade")) == QLatin1String("websocket"))
     {
         return true;
@@ -15654,6 +15851,21 @@ bool DeRestPlugin::isHttpTarget(const QHttpRequestHeader &hdr)
     return false;
 }
 
+/*! Writes the Connection header of a response, see HttpKeepAlive.
+ */
+static void writeConnectionHeader(QTextStream &stream, bool keepAlive, int remaining)
+{
+    if (keepAlive)
+    {
+        stream << "Connection: keep-alive\r\n";
+        stream << "Keep-Alive: timeout=" << (HTTP_KEEPALIVE_IDLE_TIMEOUT / 1000) << ", max=" << remaining << "\r\n";
+    }
+    else
+    {
+        stream << "Connection: close\r\n";
+    }
+}
+
 /*! Broker for any incoming REST API request.
     \param hdr - http request header
     \param sock - the client socket
@@ -15662,6 +15874,8 @@ bool DeRestPlugin::isHttpTarget(const QHttpRequestHeader &hdr)
  */
 int DeRestPlugin::handleHttpRequest(const QHttpRequestHeader &hdr, QTcpSocket *sock)
 {
+    SD_Scope stallScope(SD_HttpRequest);
+
     if (hdr.hasKey(QLatin1String("Upgrade")) && hdr.value(QLatin1String("Upgrade")) == QLatin1String("websocket"))
     {
         d->webSocketServer->handleExternalTcpSocket(hdr, sock);
@@ -15670,6 +15884,7 @@ int DeRestPlugin::handleHttpRequest(const QHttpRequestHeader &hdr, QTcpSocket *s
 
     QString content;
     QTextStream stream(sock);
+    bool bodyComplete = true; // otherwise the rest of the body would be parsed as next request
 
     ScratchMemRewind(0);
     ScratchMemWaypoint swp;
@@ -15690,9 +15905,22 @@ int DeRestPlugin::handleHttpRequest(const QHttpRequestHeader &hdr, QTcpSocket *s
     {
         // handle later as fileupload
         DBG_Printf(DBG_HTTP, "form data\n");
+        bodyComplete = false;
+    }
+    else if (hdr.hasKey(QLatin1String("Content-Length")))
+    {
+        // only read the body of this request, pipelined requests remain in the socket
+        const qint64 contentLength = qint64(hdr.contentLength());
+        bodyComplete = sock->bytesAvailable() >= contentLength;
+        content = QString::fromUtf8(sock->read(contentLength));
+        if (DBG_IsEnabled(DBG_HTTP) && !content.isEmpty())
+        {
+            DBG_Printf(DBG_HTTP, "Text Data: \t%s\n", qPrintable(content));
+        }
     }
     else if (!stream.atEnd())
     {
+        bodyComplete = false; // length unknown
         content = stream.readAll();
         if (DBG_IsEnabled(DBG_HTTP))
         {
@@ -15700,6 +15928,39 @@ int DeRestPlugin::handleHttpRequest(const QHttpRequestHeader &hdr, QTcpSocket *s
         }
     }
 
+    int keepAliveRemaining = 0;
+    bool keepAlive = false;
+    {
+        const bool known = d->httpKeepAlive.contains(sock);
+        bool clientKeepAlive = false;
+        if (!bodyComplete)
+        {
+            DBG_Printf(DBG_HTTP, "HTTP close connection, request body not fully received\n");
+        }
+        else if (hdr.hasKey(QLatin1String("Connection")))
+        {
+            const QLatin1String connection = hdr.value(QLatin1String("Connection"));
+            clientKeepAlive = HTTP_WantsKeepAlive(hdr.majorVersion(), hdr.minorVersion(), connection.data(), size_t(connection.size()));
+        }
+        else
+        {
+            clientKeepAlive = HTTP_WantsKeepAlive(hdr.majorVersion(), hdr.minorVersion(), nullptr, 0);
+        }
+
+        keepAlive = d->httpKeepAlive.request(sock, deCONZ::steadyTimeRef().ref, clientKeepAlive, &keepAliveRemaining);
+
+        if (keepAlive && !known)
+        {
+            connect(sock, &QTcpSocket::disconnected, this, [this, sock]() { d->httpKeepAlive.remove(sock); });
+            connect(sock, &QObject::destroyed, this, [this, sock]() { d->httpKeepAlive.remove(sock); });
+        }
+        else if (!keepAlive)
+        {
+            // close after the response was written, the socket might be deleted until then
+            QTimer::singleShot(0, sock, [sock]() { sock->disconnectFromHost(); });
+        }
+    }
+
     // we might be behind a proxy, do simple check
     if (d->gwAnnounceVital < 0 && d->gwProxyPort == 0)
     {
@@ -15718,6 +15979,7 @@ int DeRestPlugin::handleHttpRequest(const QHttpRequestHeader &hdr, QTcpSocket *s
     rsp.contentType = HttpContentHtml;
 
     int ret = REQ_NOT_HANDLED;
+    MET_ScopedTimer restTimer(MET_HistogramNone); // set for /api requests
 
     d->authorise(req, rsp);
 
@@ -15733,10 +15995,8 @@ int DeRestPlugin::handleHttpRequest(const QHttpRequestHeader &hdr, QTcpSocket *s
         stream << "HTTP/1.1 200 OK\r\n";
         stream << "Cache-Control: no-store, no-cache, must-revalidate, post-check=0, pre-check=0\r\n";
         stream << "Pragma: no-cache\r\n";
-        // TODO(mpi): Connection: close is likely not what we want since a new connection needs to be
-        //            established after the preflight request. Needs to be verified.
-        stream << "Connection: close\r\n";
-        stream << "Access-Control-Max-Age: 0\r\n";
+        writeConnectionHeader(stream, keepAlive, keepAliveRemaining);
+        stream << "Access-Control-Max-Age: " << HTTP_CORS_MAX_AGE << "\r\n";
         stream << "Access-Control-Allow-Origin: " << origin << " \r\n";
         stream << "Access-Control-Allow-Credentials: true\r\n";
         stream << "Access-Control-Allow-Methods: POST, GET, OPTIONS, PUT, DELETE\r\n";
@@ -15803,6 +16063,7 @@ int DeRestPlugin::handleHttpRequest(const QHttpRequestHeader &hdr, QTcpSocket *s
         stream << "HTTP/1.1 " << rspStatus << "\r\n";
         stream << "Content-type: text/html\r\n";
         stream << "Content-Length: 0\r\n";
+        writeConnectionHeader(stream, keepAlive, keepAliveRemaining);
         stream << "Access-Control-Max-Age: 0\r\n";
         stream << "Access-Control-Allow-Origin: *\r\n";
         stream << "Access-Control-Allow-Methods: POST, GET, OPTIONS, PUT, DELETE\r\n";
@@ -15824,17 +16085,70 @@ int DeRestPlugin::handleHttpRequest(const QHttpRequestHeader &hdr, QTcpSocket *s
         stream << "HTTP/1.1 " << HttpStatusOk << "\r\n";
         stream << "Content-Type: application/xml\r\n";
         stream << "Content-Length: " << QString::number(d->descriptionXml.size()) << "\r\n";
-        stream << "Connection: close\r\n";
+        writeConnectionHeader(stream, keepAlive, keepAliveRemaining);
         stream << "\r\n";
         stream << d->descriptionXml.constData();
         stream.flush();
         return 0;
     }
+    else if (hdr.pathComponentsCount() == 1 && hdr.pathAt(0) == QLatin1String("metrics") && hdr.httpMethod() == HttpGet)
+    {
+        // scraped from localhost or with "Authorization: Bearer <apikey>"
+        bool authorized = req.auth == ApiAuthLocal;
+        if (!authorized && hdr.hasKey(QLatin1String("Authorization")))
+        {
+            const QString auth(hdr.value(QLatin1String("Authorization")));
+            if (auth.startsWith(QLatin1String("Bearer ")))
+            {
+                authorized = d->apiAuthIndex.find(d->apiAuths, auth.mid(7).trimmed()) >= 0;
+            }
+        }
+
+        if (!authorized)
+        {
+            stream << "HTTP/1.1 " << HttpStatusUnauthorized << "\r\n";
+            stream << "Content-Length: 0\r\n";
+            writeConnectionHeader(stream, keepAlive, keepAliveRemaining);
+            stream << "\r\n";
+            stream.flush();
+            return 0;
+        }
+
+        // gauges which are cheaper to sample than to track
+        MET_Set(MET_ApsTasksQueued, int64_t(d->tasks.size()));
+        MET_Set(MET_ApsTasksOnAir, int64_t(d->runningTasks.size()));
+        MET_Set(MET_ApsUnconfirmed, int64_t(DA_ApsUnconfirmedRequests()));
+        MET_Set(MET_DbWriteQueueDepth, int64_t(d->dbQueryQueue.size()));
+
+        std::string metrics;
+        MET_WritePrometheus(metrics);
+
+        stream << "HTTP/1.1 " << HttpStatusOk << "\r\n";
+        stream << "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n";
+        stream << "Content-Length: " << static_cast<unsigned>(metrics.size()) << "\r\n";
+        writeConnectionHeader(stream, keepAlive, keepAliveRemaining);
+        stream << "\r\n";
+        stream.flush();
+        sock->write(metrics.data(), qint64(metrics.size()));
+        sock->flush();
+        return 0;
+    }
 
     else if (hdr.pathComponentsCount() > 0 && hdr.pathAt(0) == QLatin1String("api"))
     {
+        TaskPriorityScope taskPriorityScope(d->taskPriorityContext, TaskPriorityUser);
         bool resourceExist = true;
 
+        if (hdr.pathComponentsCount() >= 3)
+        {
+            const QLatin1String apiModule = hdr.pathAt(2);
+            restTimer.setHistogram(MET_RestModuleHistogram(apiModule.data(), size_t(apiModule.size())));
+        }
+        else
+        {
+            restTimer.setHistogram(MET_RestConfig); // GET /api/<apikey> and unauthorized /api
+        }
+
         if (hdr.pathComponentsCount() >= 2 && (req.auth == ApiAuthFull || req.auth == ApiAuthInternal))
         {
             // GET /api/<apikey>
@@ -16004,6 +16318,7 @@ int DeRestPlugin::handleHttpRequest(const QHttpRequestHeader &hdr, QTcpSocket *s
     // Always return content length header, even if it is 0. Some clients like curl
     // might hang overwise, waiting for data until the connection timeout hits.
     stream << "Content-Length: " << rsp.contentLength << "\r\n";
+    writeConnectionHeader(stream, keepAlive, keepAliveRemaining);
 
     if (rsp.fileName)
     {
@@ -16029,6 +16344,11 @@ int DeRestPlugin::handleHttpRequest(const QHttpRequestHeader &hdr, QTcpSocket *s
         DBG_Printf(DBG_HTTP, "%s\n", qPrintable(str));
     }
 
+    if (ret != REQ_NOT_HANDLED)
+    {
+        SP_Milestone(SP_FirstRestResponse);
+    }
+
     return 0;
 }
 
@@ -16037,7 +16357,7 @@ int DeRestPlugin::handleHttpRequest(const QHttpRequestHeader &hdr, QTcpSocket *s
  */
 void DeRestPlugin::clientGone(QTcpSocket *sock)
 {
-    (void)sock;
+    d->httpKeepAlive.remove(sock);
 }
 
 bool DeRestPlugin::pluginActive() const
@@ -16170,14 +16490,14 @@ Resource *DEV_GetResource(Resource::Handle hnd)
     {
         if (hnd.type == 's')
         {
-            if (hnd.index < plugin->sensors.size())
+            if (plugin->sensors.isValid(hnd.index, hnd.generation))
             {
                 result = &plugin->sensors[hnd.index];
             }
         }
         else if (hnd.type == 'l')
         {
-            if (hnd.index < plugin->nodes.size())
+            if (plugin->nodes.isValid(hnd.index, hnd.generation))
             {
                 result = &plugin->nodes[hnd.index];
             }
@@ -16210,7 +16530,7 @@ Resource *DEV_AddResource(const Sensor &sensor)
     {
         plugin->sensors.push_back(sensor);
         r = &plugin->sensors.back();
-        r->setHandle(R_CreateResourceHandle(r, plugin->sensors.size() - 1));
+        r->setHandle(R_CreateResourceHandle(r, plugin->sensors.size() - 1, plugin->sensors.generation(plugin->sensors.size() - 1)));
 
         if (plugin->searchSensorsState == DeRestPluginPrivate::SearchSensorsActive || plugin->permitJoinFlag)
         {
@@ -16235,7 +16555,7 @@ Resource *DEV_AddResource(const LightNode &lightNode)
     {
         plugin->nodes.push_back(lightNode);
         r = &plugin->nodes.back();
-        r->setHandle(R_CreateResourceHandle(r, plugin->nodes.size() - 1));
+        r->setHandle(R_CreateResourceHandle(r, plugin->nodes.size() - 1, plugin->nodes.generation(plugin->nodes.size() - 1)));
 
         if (plugin->searchLightsState == DeRestPluginPrivate::SearchLightsActive || plugin->permitJoinFlag)
         {
@@ -16571,6 +16891,55 @@ uint8_t DEV_ResolveDestinationEndpoint(uint64_t extAddr, uint8_t hintEp, uint16_
     return hintEp;
 }
 
+/*! Remembers the first hop of \p sourceRoute, an entry with the same uuid is replaced.
+ */
+void DeRestPluginPrivate::updateSourceRouteHop(const deCONZ::SourceRoute &sourceRoute)
+{
+    if (sourceRoute.hops().size() <= 1)
+    {
+        return;
+    }
+
+    auto i = std::find_if(sourceRouteHops.begin(), sourceRouteHops.end(), [&sourceRoute](const SourceRouteHop &hop)
+    {
+        return hop.uuid == sourceRoute.uuid();
+    });
+
+    if (i == sourceRouteHops.end())
+    {
+        sourceRouteHops.push_back({});
+        i = sourceRouteHops.end() - 1;
+    }
+
+    i->uuid = sourceRoute.uuid();
+    i->destination = sourceRoute.hops().back().ext();
+    i->firstHop = sourceRoute.hops().front().ext();
+    i->order = sourceRoute.order();
+}
+
+/*! Returns the key of the route to \p extAddress.
+    This is the first hop of the preferred source route, or the device itself if no source route is known.
+ */
+quint64 DeRestPluginPrivate::routeKey(quint64 extAddress) const
+{
+    const SourceRouteHop *result = nullptr;
+
+    for (const SourceRouteHop &hop : sourceRouteHops)
+    {
+        if (hop.destination == extAddress && (!result || hop.order < result->order))
+        {
+            result = &hop;
+        }
+    }
+
+    return result ? result->firstHop : extAddress;
+}
+
+DeviceKey DEV_RouteKey(DeviceKey deviceKey)
+{
+    return plugin->routeKey(deviceKey);
+}
+
 /* Returns number of APS requests currently in the queue. */
 int DEV_ApsQueueSize()
 {
@@ -16582,6 +16951,32 @@ int DEV_ApsQueueSize()
 #endif
 }
 
+/*! Measures the event loop latency, stalls are attributed by SD_Scope markers.
+ */
+void DeRestPluginPrivate::stallHeartbeatTimerFired()
+{
+    const int64_t latencyUs = SD_Heartbeat();
+    MET_ObserveUs(MET_EventLoopLatency, latencyUs);
+
+    const SD_Stats stats = SD_GetStats();
+    if (stats.thresholdUs > 0 && latencyUs >= stats.thresholdUs)
+    {
+        DBG_Printf(DBG_INFO, "event loop stalled for %d ms\n", int(latencyUs / 1000));
+    }
+}
+
+/*! Samples the memory usage for the growth figures of GET /api/<apikey>/config/memory.
+ */
+void DeRestPluginPrivate::memoryStatsTimerFired()
+{
+    MEM_Report report;
+    collectMemoryUsage(report);
+    memoryHistory.add(deCONZ::steadyTimeRef().ref, report);
+
+    const int64_t growth = memoryHistory.totalGrowthPerDay();
+    DBG_Printf(DBG_INFO, "memory accounted %u kB, growth %d kB/day\n", unsigned(report.totalBytes() / 1024), int(growth / 1024));
+}
+
 void DeRestPluginPrivate::pollSwUpdateStateTimerFired()
 {
     if (gwSwUpdateState != swUpdateState.transferring &&
@@ -17,12 +17,14 @@
 #include <QElapsedTimer>
 #include <stdint.h>
 #include <deque>
+#include <unordered_map>
 #include <memory>
 #include <sqlite3.h>
 #include <deconz.h>
 #include "device.h"
 #include "aps_controller_wrapper.h"
 #include "alarm_system.h"
+#include "api_auth.h"
 #include "resource.h"
 #include "daylight.h"
 #include "event_emitter.h"
@@ -31,14 +33,22 @@
 #include "rest_api.h"
 #include "rest_node_base.h"
 #include "light_node.h"
+#include "memory_stats.h"
 #include "group.h"
 #include "group_info.h"
+#include "http_keepalive.h"
 #include "scene.h"
 #include "sensor.h"
 #include "resourcelinks.h"
 #include "rule.h"
 #include "bindings.h"
+#include "binding_scheduler.h"
+#include "binding_table_cache.h"
+#include "schedule_queue.h"
+#include "timer_wheel.h"
+#include "task_scheduler.h"
 #include "websocket_server.h"
+#include "utils/slabvector.h"
 
 // enable domain specific string literals
 using namespace deCONZ::literals;
@@ -63,10 +73,7 @@ using namespace deCONZ::literals;
 #define PERMIT_JOIN_SEND_INTERVAL (1000 * 60)
 #define SET_ENDPOINTCONFIG_DURATION (1000 * 16) // time deCONZ needs to update Endpoints
 #define OTA_LOW_PRIORITY_TIME (60 * 2)
-#define CHECK_SENSOR_FAST_ROUNDS 3
-#define CHECK_SENSOR_FAST_INTERVAL 100
-#define CHECK_SENSOR_INTERVAL      1000
-#define CHECK_SENSORS_MAX          10
+#define TW_TICK_MS                 100 // timer wheel resolution
 #define CHECK_ZB_GOOD_INTERVAL     60
 
 // wifi managed flags
@@ -383,6 +390,7 @@ using namespace deCONZ::literals;
 
 #define MAX_GROUP_SEND_DELAY 5000 // ms between to requests to the same group
 #define GROUP_SEND_DELAY 50 // default ms between to requests to the same group
+#define MAX_BINDING_TABLE_READERS 4 // default parallel Mgmt_Bind_req queries
 #define MAX_TASKS_PER_NODE 2
 #define MAX_BACKGROUND_TASKS 5
 
@@ -410,7 +418,9 @@ using namespace deCONZ::literals;
 #define FW_PLATFORM_R21           0x00000700UL
 
 // schedules
-#define SCHEDULE_CHECK_PERIOD 1000
+#define SCHEDULE_CHECK_PERIOD 1000 // min. ms between two triggered schedules
+#define SCHEDULE_MIN_CHECK_PERIOD 10
+#define SCHEDULE_MAX_CHECK_PERIOD 60000
 
 // save database items
 #define DB_LIGHTS         0x00000001
@@ -662,8 +672,10 @@ inline bool checkMacAndVendor(const deCONZ::Node *node, quint16 vendor)
 
 quint8 zclNextSequenceNumber();
 const deCONZ::Node *getCoreNode(uint64_t extAddress);
+quint64 AUTH_RateLimitSource(const ApiRequest &req);
 
 // Forward declarations
+class APS_CaptureWriter;
 class DeviceDescriptions;
 class DeviceWidget;
 class DeviceJs;
@@ -813,6 +825,17 @@ enum TaskType
     TaskHueEffect = 44
 };
 
+/*! Owner of a timer wheel timer, kept in the upper bits of the timer tag. */
+enum TimerWheelKind
+{
+    TimerSensorDuration = 1 //! Sensor::durationDue, tag holds the sensors slot
+};
+
+#define TW_TAG(kind, generation, index) ((uint64_t(kind) << 56) | (uint64_t(generation) << 32) | uint64_t(uint32_t(index)))
+#define TW_TAG_KIND(tag)       unsigned((tag) >> 56)
+#define TW_TAG_GENERATION(tag) uint16_t((tag) >> 32)
+#define TW_TAG_INDEX(tag)      size_t(uint32_t(tag))
+
 enum XmasLightStripMode
 {
     ModeWhite = 0,
@@ -840,6 +863,16 @@ enum XmasLightStripEffect
     EffectGlow = 0x0f
 };
 
+/*! First hop of a source route, devices behind the same hop share airtime.
+ */
+struct SourceRouteHop
+{
+    QString uuid;
+    quint64 destination = 0;
+    quint64 firstHop = 0;
+    int order = 0;
+};
+
 struct TaskItem
 {
     TaskItem()
@@ -899,31 +932,6 @@ private:
     static int _taskCounter;
 };
 
-/*! \class ApiAuth
-
-    Helper to combine serval authorisation parameters.
- */
-class ApiAuth
-{
-public:
-    enum State
-    {
-        StateNormal,
-        StateDeleted
-    };
-
-    ApiAuth();
-    void setDeviceType(const QString &devtype);
-
-    bool needSaveDatabase;
-    State state;
-    QString apikey; // also called username (10..32 chars)
-    QString devicetype;
-    QDateTime createDate;
-    QDateTime lastUseDate;
-    QString useragent;
-};
-
 /*! \class ApiConfig
 
     Provide config to the resource system.
@@ -964,6 +972,7 @@ public:
     // REST API authorisation
     void initAuthentication();
     bool allowedToCreateApikey(const ApiRequest &req, ApiResponse &rsp, QVariantMap &map);
+    bool verifyApikeyCredentials(const ApiRequest &req, ApiResponse &rsp, QVariantMap &map);
     void authorise(ApiRequest &req, ApiResponse &rsp);
 
 #ifdef USE_GATEWAY_API
@@ -991,17 +1000,24 @@ public:
     int getChallenge(const ApiRequest &req, ApiResponse &rsp);
     int modifyConfig(const ApiRequest &req, ApiResponse &rsp);
     int deleteUser(const ApiRequest &req, ApiResponse &rsp);
+    int pruneUsers(const ApiRequest &req, ApiResponse &rsp);
+    void pruneUsersStep();
     int updateSoftware(const ApiRequest &req, ApiResponse &rsp);
     int restartGateway(const ApiRequest &req, ApiResponse &rsp);
     int restartApp(const ApiRequest &req, ApiResponse &rsp);
     int shutDownGateway(const ApiRequest &req, ApiResponse &rsp);
     int updateFirmware(const ApiRequest &req, ApiResponse &rsp);
     int exportConfig(const ApiRequest &req, ApiResponse &rsp);
+    int getExportStatus(const ApiRequest &req, ApiResponse &rsp);
     int importConfig(const ApiRequest &req, ApiResponse &rsp);
     int resetConfig(const ApiRequest &req, ApiResponse &rsp);
     int changePassword(const ApiRequest &req, ApiResponse &rsp);
     int deletePassword(const ApiRequest &req, ApiResponse &rsp);
     int getWifiState(const ApiRequest &req, ApiResponse &rsp);
+    int getStalls(const ApiRequest &req, ApiResponse &rsp);
+    int getMemoryUsage(const ApiRequest &req, ApiResponse &rsp);
+    void collectMemoryUsage(MEM_Report &report);
+    int getStartupTimings(const ApiRequest &req, ApiResponse &rsp);
     int configureWifi(const ApiRequest &req, ApiResponse &rsp);
     int restoreWifiConfig(const ApiRequest &req, ApiResponse &rsp);
     int putWifiScanResult(const ApiRequest &req, ApiResponse &rsp);
@@ -1066,6 +1082,7 @@ public:
 
     // REST API schedules
     void initSchedules();
+    void scheduleQueueChanged();
     int handleSchedulesApi(const ApiRequest &req, ApiResponse &rsp);
     int getAllSchedules(const ApiRequest &req, ApiResponse &rsp);
     int createSchedule(const ApiRequest &req, ApiResponse &rsp);
@@ -1230,6 +1247,11 @@ public Q_SLOTS:
     void storeSourceRoute(const deCONZ::SourceRoute &sourceRoute);
     void deleteSourceRoute(const QString &uuid);
     void restoreSourceRoutes();
+    void updateSourceRouteHop(const deCONZ::SourceRoute &sourceRoute);
+    quint64 routeKey(quint64 extAddress) const;
+    void restoreBindingTables();
+    void storeBindingTable(quint64 extAddress);
+    void deleteBindingTable(quint64 extAddress);
 
     // touchlink
     void touchlinkDisconnectNetwork();
@@ -1279,7 +1301,12 @@ public Q_SLOTS:
     void searchSensorsTimerFired();
     void checkInstaModelId(Sensor *sensor);
     void delayedFastEnddeviceProbe(const deCONZ::NodeEvent *event = nullptr);
-    void checkSensorStateTimerFired();
+    void timerWheelFired();
+    void stallHeartbeatTimerFired();
+    void memoryStatsTimerFired();
+    void armTimerWheel();
+    void setSensorDurationDue(Sensor *sensor, const QDateTime &due);
+    void checkSensorDuration(Sensor *sensor);
 
     // events
     void handleEvent(const Event &e);
@@ -1391,6 +1418,7 @@ public:
 
     // Task interface
     bool addTask(const TaskItem &task);
+    void eraseTask(std::list<TaskItem>::iterator i);
     bool addTaskMoveLevel(TaskItem &task, bool withOnOff, bool upDirection, quint8 rate);
     bool addTaskSetOnOff(TaskItem &task, quint8 cmd, quint16 ontime, quint8 flags = 0);
     bool addTaskSetBrightness(TaskItem &task, uint8_t bri, bool withOnOff);
@@ -1467,7 +1495,10 @@ public:
     void handleIeeeAddressReqIndication(const deCONZ::ApsDataIndication &ind);
     void handleNwkAddressReqIndication(const deCONZ::ApsDataIndication &ind);
     void handleMgmtBindRspIndication(const deCONZ::ApsDataIndication &ind);
+    void processBindingTableRecords(QDataStream &stream, quint8 listCount);
+    void finishBindingTableCheck(quint64 srcAddress);
     void handleBindAndUnbindRspIndication(const deCONZ::ApsDataIndication &ind);
+    void handleBindingApsConfirm(const deCONZ::ApsDataConfirm &conf);
     void handleMgmtLeaveRspIndication(const deCONZ::ApsDataIndication &ind);
     void handleMgmtLqiRspIndication(const deCONZ::ApsDataIndication &ind);
     void handleXalClusterIndication(const deCONZ::ApsDataIndication &ind, deCONZ::ZclFrame &zclFrame);
@@ -1582,8 +1613,13 @@ public:
     QElapsedTimer apiAuthSaveDatabaseTime;
     size_t apiAuthCurrent;
     std::vector<ApiAuth> apiAuths;
+    ApiAuthIndex apiAuthIndex;
+    ApiAuthPruneState apiAuthPrune;
     QString gwAdminUserName;
     std::string gwAdminPasswordHash;
+    QByteArray gwAdminAuthCache; // keyed digest of the last verified Authorization header
+    std::string gwAdminAuthCacheHash; // gwAdminPasswordHash the cache entry belongs to
+    VerifyRateLimiter apikeyRateLimiter;
 
     struct SwUpdateState {
      QString noUpdate;
@@ -1749,6 +1785,8 @@ public:
     // schedules
     QTimer *scheduleTimer;
     std::vector<Schedule> schedules;
+    ScheduleQueue scheduleQueue; // next check time per schedule index
+    bool scheduleQueueDirty = true;
     TaskItem taskScheduleTimer;
 
     // window covering
@@ -1973,21 +2011,29 @@ public:
     size_t sensorIter;
     size_t lightAttrIter;
     size_t sensorAttrIter;
-    size_t sensorCheckIter;
-    int sensorCheckFast;
     DeviceContainer m_devices;
     std::vector<Group> groups;
-    std::vector<LightNode> nodes;
+    SlabVector<LightNode> nodes; // stable addresses, pointers remain valid after push_back()
     std::vector<Rule> rules;
     QString daylightSensorId;
     size_t daylightOffsetIter = 0;
     std::vector<DL_Result> daylightTimes;
-    std::vector<Sensor> sensors;
+    SlabVector<Sensor> sensors; // stable addresses, pointers remain valid after push_back()
+    QHash<QString, size_t> sensorIdCache; // id -> index in sensors, verified on lookup
+    QHash<QString, size_t> lightIdCache; // id -> index in nodes, verified on lookup
     std::list<TaskItem> tasks;
+    std::unordered_map<int, std::list<TaskItem>::iterator> taskIndex; // taskId -> queued task
+    TaskScheduler taskScheduler;
+    TaskPriority taskPriorityContext = TaskPriorityPoll; // priority class of tasks created in current scope, raised by REST-API and rule handlers
     std::list<TaskItem> runningTasks;
     QTimer *taskTimer;
     QTimer *groupTaskTimer;
-    QTimer *checkSensorsTimer;
+    TimerWheel timerWheel; // per-item deadlines, see TimerWheelKind
+    std::vector<uint64_t> timerWheelTags; // expired timers
+    QTimer *timerWheelTimer = nullptr;
+    QTimer *stallHeartbeatTimer = nullptr;
+    QTimer *memoryStatsTimer = nullptr;
+    MEM_History memoryHistory;
     uint8_t zclSeq;
     bool joinedMulticastGroup;
     QTimer *upnpTimer;
@@ -1998,12 +2044,23 @@ public:
     // events
     EventEmitter *eventEmitter = nullptr;
 
+    // source routes
+    std::vector<SourceRouteHop> sourceRouteHops;
+
+    APS_CaptureWriter *apsCapture = nullptr; // --aps-capture=1
+
+    // persistent REST API connections
+    HttpKeepAlive httpKeepAlive;
+
     // bindings
     bool gwReportingEnabled;
     QTimer *bindingTimer;
     QTimer *bindingTableReaderTimer;
     std::list<BindingTask> bindingQueue; // bind/unbind queue
+    BindingScheduler bindingScheduler; // duplicate index and on-air limits of bindingQueue
     std::vector<BindingTableReader> bindingTableReaders;
+    BindingTableCache bindingTableCache; // last-known binding table per device
+    int maxBindingTableReaders; // parallel Mgmt_Bind_req queries
 
     DeviceDescriptions *deviceDescriptions = nullptr;
     DeviceJs *deviceJs = nullptr;
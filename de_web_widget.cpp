@@ -128,6 +128,10 @@ void DeRestWidget::readBindingTableTriggered()
         if (restNode)
         {
             restNode->setMgmtBindSupported(true);
+            if (plugin->d->bindingTableCache.invalidate(restNode->address().ext())) // force reading from device
+            {
+                plugin->d->deleteBindingTable(restNode->address().ext()); // don't restore the stale table after a restart
+            }
             plugin->d->readBindingTable(restNode, 0);
         }
     }
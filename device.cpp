@@ -22,6 +22,7 @@
 #include "event.h"
 #include "event_emitter.h"
 #include "utils/utils.h"
+#include "zcl/configure_reporting.h"
 #include "zcl/zcl.h"
 #include "zdp/zdp.h"
 
@@ -133,8 +134,8 @@ public:
     Device *q = nullptr; //! reference to public interface
     deCONZ::ApsController *apsCtrl = nullptr; //! opaque instance pointer forwarded to external functions
 
-    /*! sub-devices are not yet referenced via pointers since these may become dangling.
-        This is a helper to query the actual sub-device Resource* on demand via Resource::Handle.
+    /*! Sub-devices are referenced via Resource::Handle which is checked against the slot generation
+        of the SlabVector container, this is a helper to query the actual sub-device Resource* on demand.
     */
     std::array<Resource::Handle, MaxSubResources> subResourceHandles;
     std::vector<Resource*> subResources;
@@ -1662,13 +1663,15 @@ void DEV_ConfigureReportingHandler(Device *device, const Event &event)
         param.manufacturerCode = d->binding.readReportParam.manufacturerCode;
         param.endpoint = bnd.srcEndpoint;
 
+        size_t payloadSize = 0;
+
         for (size_t i = d->binding.configIter; i < d->binding.reportIter && i < bnd.reporting.size(); i++)
         {
             const DDF_ZclReport &report = bnd.reporting[i];
-            d->binding.configIter++;
 
             if (report.manufacturerCode != param.manufacturerCode)
             {
+                d->binding.configIter++;
                 continue;
             }
 
@@ -1682,12 +1685,15 @@ void DEV_ConfigureReportingHandler(Device *device, const Event &event)
             record.reportableChange = report.reportableChange;
             record.timeout = 0; // TODO
 
-            param.records.push_back(record);
-
-            if (param.records.size() == ZCL_ConfigureReportingParam::MaxRecords)
+            const size_t recordSize = ZCL_ConfigureReportingRecordSize(record);
+            if (!param.records.empty() && payloadSize + recordSize > ZCL_CONFIGURE_REPORTING_MAX_PAYLOAD)
             {
-                break; // prevent too large APS frames
+                break; // prevent too large APS frames, the remaining records follow in the next request
             }
+
+            d->binding.configIter++;
+            payloadSize += recordSize;
+            param.records.push_back(record);
         }
 
         d->binding.zclResult.isEnqueued = false;
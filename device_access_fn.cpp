@@ -15,7 +15,11 @@
 #include "device_descriptions.h"
 #include "device_js/device_js.h"
 #include "ias_zone.h"
+#include "metrics.h"
 #include "resource.h"
+#include "tuya_dp.h"
+#include "xiaomi_special.h"
+#include "zcl/attribute_view.h"
 #include "zcl/zcl.h"
 
 
@@ -108,16 +112,6 @@ enum TuyaCommandId : unsigned char
     TUYA_MCU_SYNC_TIME           = 0x24
 };
 
-enum TuyaDataType : unsigned char
-{
-    TuyaDataTypeRaw              = 0x00,
-    TuyaDataTypeBool             = 0x01,
-    TuyaDataTypeValue            = 0x02,
-    TuyaDataTypeString           = 0x03,
-    TuyaDataTypeEnum             = 0x04,
-    TuyaDataTypeBitmap           = 0x05
-};
-
 enum DA_Constants
 {
     BroadcastEndpoint = 255, //! Accept incoming commands from any endpoint.
@@ -361,6 +355,55 @@ bool evalZclAttribute(Resource *r, ResourceItem *item, const deCONZ::ApsDataIndi
     return false;
 }
 
+/*! Returns the decoded attribute records of a read attributes response or report.
+
+    parseZclAttribute() is called for every item watching a cluster, e.g. 6 items
+    for a report with 6 attributes. The payload is only decoded for the first call,
+    further calls for the same frame use the cached result.
+ */
+const ZCL_AttributeView &DA_ZclAttributeView(const deCONZ::ZclFrame &zclFrame)
+{
+    static QByteArray lastPayload;
+    static quint8 lastCommandId = 0;
+    static ZCL_AttributeView view;
+
+    const QByteArray &payload = zclFrame.payload();
+
+    if (lastCommandId == zclFrame.commandId() && (payload.constData() == lastPayload.constData() || payload == lastPayload))
+    {
+        return view;
+    }
+
+    lastPayload = payload;
+    lastCommandId = zclFrame.commandId();
+    ZCL_DecodeAttributeRecords(reinterpret_cast<const uint8_t*>(payload.constData()), size_t(payload.size()),
+                               zclFrame.commandId() == deCONZ::ZclReadAttributesResponseId, &view);
+    return view;
+}
+
+/*! Reads the value of \p rec in the payload of \p zclFrame into \p attr.
+ */
+static bool readZclAttributeValue(deCONZ::ZclAttribute &attr, const deCONZ::ZclFrame &zclFrame, const ZCL_AttributeRecord &rec)
+{
+    const QByteArray value = QByteArray::fromRawData(zclFrame.payload().constData() + rec.offset, rec.length);
+    QDataStream stream(value);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    return attr.readFromStream(stream);
+}
+
+static bool hasZclParamAttribute(const ZCL_Param &param, quint16 attrId)
+{
+    for (size_t i = 0; i < param.attributeCount; i++)
+    {
+        if (param.attributes[i] == attrId)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 /*! Evaluates an items Javascript expression for a received ZCL frame.
  */
 bool evalZclFrame(Resource *r, ResourceItem *item, const deCONZ::ApsDataIndication &ind, const deCONZ::ZclFrame &zclFrame, const QVariant &parseParameters)
@@ -639,6 +682,41 @@ bool parseZclAttribute(Resource *r, ResourceItem *item, const deCONZ::ApsDataInd
         return result;
     }
 
+    const ZCL_AttributeView &view = DA_ZclAttributeView(zclFrame);
+
+    if (view.complete)
+    {
+        for (unsigned i = 0; i < view.count; i++)
+        {
+            const ZCL_AttributeRecord &rec = view.records[i];
+
+            if (rec.status != deCONZ::ZclSuccessStatus || !hasZclParamAttribute(zclParam, rec.id))
+            {
+                continue;
+            }
+
+            deCONZ::ZclAttribute attr(rec.id, rec.dataType, QLatin1String(""), deCONZ::ZclReadWrite, true);
+
+            if (!readZclAttributeValue(attr, zclFrame, rec))
+            {
+                break;
+            }
+
+            if (evalZclAttribute(r, item, ind, zclFrame, int(i), attr, parseParameters))
+            {
+                if (zclFrame.commandId() == deCONZ::ZclReportAttributesId)
+                {
+                    item->setLastZclReport(deCONZ::steadyTimeRef().ref);
+                }
+                result = true;
+            }
+        }
+
+        return result;
+    }
+
+    // fallback for payloads with data types the view can't handle
+
     QDataStream stream(zclFrame.payload());
     stream.setByteOrder(QDataStream::LittleEndian);
 
@@ -682,6 +760,57 @@ bool parseZclAttribute(Resource *r, ResourceItem *item, const deCONZ::ApsDataInd
     return result;
 }
 
+/*! Maps the type of a decoded Tuya datapoint to the ZCL data type used for JS Attr.val.
+ */
+static quint8 tuyaToZclDataType(const TY_DataPoint &dp)
+{
+    switch (dp.type)
+    {
+    case TuyaDataTypeRaw:    return deCONZ::ZclOctedString;
+    case TuyaDataTypeString: return deCONZ::ZclCharacterString;
+    case TuyaDataTypeBool:   return deCONZ::ZclBoolean;
+    case TuyaDataTypeValue:  return deCONZ::Zcl32BitInt;
+    case TuyaDataTypeBitmap: return dp.length == 4 ? deCONZ::Zcl32BitUint : dp.length == 2 ? deCONZ::Zcl16BitUint : deCONZ::Zcl8BitUint;
+    default:
+        break;
+    }
+
+    return deCONZ::Zcl8BitUint;
+}
+
+/*! Returns the decoded datapoints of a Tuya frame.
+
+    parseTuyaData() is called for every item of a sub-device with a "tuya" parse
+    function, e.g. 20+ times per frame for a TRV. The frame is only decoded for the
+    first call, further calls with the same payload use the cached result.
+ */
+static const TY_DataPoints &tuyaDataPoints(const deCONZ::ZclFrame &zclFrame)
+{
+    static QByteArray lastPayload;
+    static TY_DataPoints dps;
+
+    const QByteArray &payload = zclFrame.payload();
+
+    if (payload.constData() == lastPayload.constData() || payload == lastPayload)
+    {
+        return dps;
+    }
+
+    lastPayload = payload;
+    TY_DecodeDataPoints(reinterpret_cast<const uint8_t*>(payload.constData()), size_t(payload.size()), &dps);
+
+    const char *rt = zclFrame.commandId() == TY_DATA_REPORT ? "REPORT" : "RESPONSE";
+
+    for (unsigned i = 0; i < dps.count; i++)
+    {
+        const TY_DataPoint &dp = dps.dp[i];
+        DBG_Printf(DBG_INFO, "TY_DATA_%s: seq %u, dpid: 0x%02X, type: 0x%02X, length: %u, val: %d\n",
+                   rt, dps.seq, dp.dpid, dp.type, dp.length, int(dp.value));
+    }
+
+    return dps;
+}
+
 /*! A generic function to parse Tuya private cluster values from response/report commands.
     The item->parseParameters() is expected to be an object (given in the device description file).
 
@@ -730,99 +859,42 @@ bool parseTuyaData(Resource *r, ResourceItem *item, const deCONZ::ApsDataIndicat
         item->setZclProperties(param);
     }
 
-    quint16 seq;
-    quint8 dpid;
-    quint8 dataType;
-    quint16 dataLength;
-    quint8 zclDataType = 0;
-    const auto &zclParam = item->zclParam();
-
-    QDataStream stream(zclFrame.payload());
-    stream.setByteOrder(QDataStream::BigEndian); // tuya is big endian!
-
-    stream >> seq;
+    const TY_DataPoints &dps = tuyaDataPoints(zclFrame);
+    const TY_DataPoint *dp = TY_FindDataPoint(dps, quint8(item->zclParam().attributes[0]));
 
-    int attrIndex = 0;
-    while (!stream.atEnd()) // a message can contain multiple datapoints
+    if (!dp)
     {
-        stream >> dpid;
-        stream >> dataType;
-        stream >> dataLength;
-
-        if (stream.status() != QDataStream::Ok)
-        {
-            return result;
-        }
+        return result;
+    }
 
-        deCONZ::NumericUnion num;
-        num.u64 = 0;
+    // map datapoint into ZCL attribute
+    deCONZ::ZclAttribute attr(dp->dpid, tuyaToZclDataType(*dp), QLatin1String(""), deCONZ::ZclReadWrite, true);
 
-        switch (dataType)
-        {
-        case TuyaDataTypeRaw:
-        {
-            // Not setting value because need to much ressource.
-            zclDataType = deCONZ::ZclCharacterString;
-        }
+    switch (dp->type)
+    {
+    case TuyaDataTypeRaw:
+        attr.setValue(QVariant(zclFrame.payload().mid(dp->offset, dp->length)));
         break;
-            
-        case TuyaDataTypeString:
-            return result; // TODO implement?
-
-        case TuyaDataTypeBool:
-        { stream >> num.u8; zclDataType = deCONZ::ZclBoolean; }
-            break;
-
-        case TuyaDataTypeEnum:
-        { stream >> num.u8; zclDataType = deCONZ::Zcl8BitUint; }
-            break;
 
-        case TuyaDataTypeValue: // docs aren't clear, assume signed
-        {  stream >> num.s32; zclDataType = deCONZ::Zcl32BitInt; }
-            break;
-
-        case TuyaDataTypeBitmap:
-        {
-            switch (dataLength)
-            {
-            case 1: { stream >> num.u8;  zclDataType = deCONZ::Zcl8BitUint; } break;
-            case 2: { stream >> num.u16; zclDataType = deCONZ::Zcl16BitUint; } break;
-            case 4: { stream >> num.u32; zclDataType = deCONZ::Zcl32BitUint; } break;
-            }
-        }
-            break;
-
-        default:
-            return result; // unkown datatype
-        }
-
-        if (dpid == zclParam.attributes[0])
-        {
-            // map datapoint into ZCL attribute
-            deCONZ::ZclAttribute attr(dpid, zclDataType, QLatin1String(""), deCONZ::ZclReadWrite, true);
-
-            if (zclDataType == deCONZ::Zcl32BitInt)
-            {
-                attr.setValue(qint64(num.s32));
-            }
-            else
-            {
-                attr.setValue(quint64(num.u32));
-            }
+    case TuyaDataTypeString:
+        attr.setValue(QVariant(QString::fromUtf8(zclFrame.payload().constData() + dp->offset, dp->length)));
+        break;
 
-            if (evalZclAttribute(r, item, ind, zclFrame, attrIndex, attr, parseParameters))
-            {
-                item->setLastZclReport(deCONZ::steadyTimeRef().ref);
-                result = true;
-            }
-        }
+    case TuyaDataTypeValue:
+        attr.setValue(qint64(dp->value));
+        break;
 
-        attrIndex++;
+    default:
+        attr.setValue(quint64(dp->value));
+        break;
+    }
 
-        const char *rt = zclFrame.commandId() == TY_DATA_REPORT ? "REPORT" : "RESPONSE";
+    const int attrIndex = int(dp - &dps.dp[0]);
 
-        DBG_Printf(DBG_INFO, "TY_DATA_%s: seq %u, dpid: 0x%02X, type: 0x%02X, length: %u, val: %d\n",
-                   rt, seq, dpid, dataType, dataLength, num.s32);
+    if (evalZclAttribute(r, item, ind, zclFrame, attrIndex, attr, parseParameters))
+    {
+        item->setLastZclReport(deCONZ::steadyTimeRef().ref);
+        result = true;
     }
 
     return result;
@@ -1090,6 +1162,29 @@ bool writeTuyaData(const Resource *r, const ResourceItem *item, deCONZ::ApsContr
     return result;
 }
 
+/*! Returns the decoded Xiaomi special report of \p zclFrame.
+
+    parseXiaomiSpecial() is called for every mapped item, e.g. battery, temperature,
+    humidity and pressure. The TLV structure is only decoded for the first call,
+    further calls with the same payload use the cached result.
+ */
+const XM_SpecialReport &DA_XiaomiSpecialReport(const deCONZ::ZclFrame &zclFrame)
+{
+    static QByteArray lastPayload;
+    static XM_SpecialReport report;
+
+    const QByteArray &payload = zclFrame.payload();
+
+    if (payload.constData() == lastPayload.constData() || payload == lastPayload)
+    {
+        return report;
+    }
+
+    lastPayload = payload;
+    XM_DecodeSpecialReport(reinterpret_cast<const uint8_t*>(payload.constData()), size_t(payload.size()), &report);
+    return report;
+}
+
 /*! Extracts manufacturer specific Xiaomi ZCL attribute from report commands to basic cluster.
 
     \param zclFrame - Contains the special report with attribute 0xff01, 0xff02 or 0x00f7.
@@ -1100,83 +1195,24 @@ deCONZ::ZclAttribute parseXiaomiZclTag(const quint8 rtag, const deCONZ::ZclFrame
 {
     deCONZ::ZclAttribute result;
 
-    quint16 attrId = 0;
-    quint8 dataType = 0;
-    quint8 length = 0;
-    quint16 structElements = 0;
-
-    QDataStream stream(zclFrame.payload());
-    stream.setByteOrder(QDataStream::LittleEndian);
-    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    const XM_Tag *tag = XM_FindTag(DA_XiaomiSpecialReport(zclFrame), rtag);
 
-    while (attrId == 0 && !stream.atEnd())
-    {
-        quint16 a;
-        stream >> a;
-        stream >> dataType;
-
-        if (dataType == deCONZ::ZclCharacterString || dataType == deCONZ::ZclOctedString)
-        {
-            stream >> length;
-        }
-
-        if (a == 0xff01 && dataType == deCONZ::ZclCharacterString)
-        {
-            attrId = a;
-        }
-        else if (a == 0xff02 && dataType == 0x4c /*deCONZ::ZclStruct*/)
-        {
-            attrId = a;
-            stream >> structElements;
-        }
-        else if (a == 0x00f7 && dataType == deCONZ::ZclOctedString)
-        {
-            attrId = a;
-        }
-
-        if (dataType == deCONZ::ZclCharacterString && attrId != 0xff01)
-        {
-            for (; length > 0; length--) // skip string attribute
-            {
-                quint8 dummy;
-                stream >> dummy;
-            }
-        }
-    }
-
-    if (stream.atEnd() || attrId == 0)
+    if (!tag)
     {
         return result;
     }
 
-    quint8 tag = 0;
-
-    while (!stream.atEnd())
-    {
-        if (attrId == 0xff01 || attrId == 0x00f7)
-        {
-            stream >> tag;
-        }
-
-        stream >> dataType;
-
-        deCONZ::ZclAttribute atmp(tag, dataType, QLatin1String(""), deCONZ::ZclRead, true);
-
-        if (!atmp.readFromStream(stream))
-        {
-            return result;
-        }
+    // only the value of the requested tag is read, without copying the payload
+    const QByteArray value = QByteArray::fromRawData(zclFrame.payload().constData() + tag->offset, tag->length);
+    QDataStream stream(value);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
 
-        if (tag == rtag)
-        {
-            result = atmp;
-            break;
-        }
+    deCONZ::ZclAttribute atmp(tag->tag, tag->dataType, QLatin1String(""), deCONZ::ZclRead, true);
 
-        if (structElements > 0)
-        {
-            tag++; // running struct index
-        }
+    if (atmp.readFromStream(stream))
+    {
+        result = atmp;
     }
 
     return result;
@@ -2118,6 +2154,7 @@ struct DA_ReqBusy
 {
     uint64_t dstExtAddr;
     int64_t tref;
+    int64_t sendTimeMs; // for the confirm latency metric
     uint16_t clusterId;
     uint8_t dstEndpoint;
     uint8_t apsRequestId;
@@ -2169,7 +2206,8 @@ void DA_ApsRequestEnqueued(const deCONZ::ApsDataRequest &req)
         return;
     }
 
-    const int64_t now = deCONZ::steadyTimeRef().ref / 1000;
+    const int64_t nowMs = deCONZ::steadyTimeRef().ref;
+    const int64_t now = nowMs / 1000;
 
     for (unsigned i = 0; i < APS_BUSY_TABLE_SIZE; i++)
     {
@@ -2193,6 +2231,7 @@ void DA_ApsRequestEnqueued(const deCONZ::ApsDataRequest &req)
             e->apsRequestId = req.id();
             e->clusterId = req.clusterId();
             e->tref = now;
+            e->sendTimeMs = nowMs;
             DBG_Assert(_DA_ApsUnconfirmedCount < APS_BUSY_TABLE_SIZE);
             if (_DA_ApsUnconfirmedCount < APS_BUSY_TABLE_SIZE)
             {
@@ -2223,6 +2262,7 @@ void DA_ApsRequestConfirmed(const deCONZ::ApsDataConfirm &conf)
             if (e->dstExtAddr != conf.dstAddress().ext()) continue;
             if (e->dstEndpoint != conf.dstEndpoint()) continue;
 
+            MET_ObserveUs(MET_ApsConfirmLatency, (deCONZ::steadyTimeRef().ref - e->sendTimeMs) * 1000);
             memset(e, 0, sizeof(*e));
             _DA_ApsUnconfirmedCount--;
             return;
@@ -17,6 +17,8 @@
 
 class Resource;
 class ResourceItem;
+struct XM_SpecialReport;
+struct ZCL_AttributeView;
 
 namespace deCONZ {
     class ApsController;
@@ -42,6 +44,8 @@ typedef bool (*WriteFunction_t)(const Resource *r, const ResourceItem *item, deC
 // temporary expose parseTuyaData for check in tuya.cpp
 bool parseTuyaData(Resource *r, ResourceItem *item, const deCONZ::ApsDataIndication &ind, const deCONZ::ZclFrame &zclFrame, const QVariant &parseParameters);
 ParseFunction_t DA_GetParseFunction(const QVariant &params);
+const XM_SpecialReport &DA_XiaomiSpecialReport(const deCONZ::ZclFrame &zclFrame);
+const ZCL_AttributeView &DA_ZclAttributeView(const deCONZ::ZclFrame &zclFrame);
 ReadFunction_t DA_GetReadFunction(const QVariant &params);
 WriteFunction_t DA_GetWriteFunction(const QVariant &params);
 
@@ -8,6 +8,7 @@
  *
  */
 
+#include <algorithm>
 #include <array>
 #include <QDirIterator>
 #include <QFile>
@@ -31,13 +32,17 @@
 #include "device_ddf_init.h"
 #include "device_descriptions.h"
 #include "device_js/device_js.h"
+#include "utils/parallel_for.h"
 #include "utils/scratchmem.h"
 #include "json.h"
+#include "memory_stats.h"
+#include "startup_profile.h"
 #include "event.h"
 #include "resource.h"
 
 #define DDF_MAX_PATH_LENGTH 1024
 #define DDF_MAX_PUBLIC_KEYS 64
+#define DDF_PARSE_BATCH_SIZE 64 // parsed JSON documents kept in memory at once
 
 #define HND_MIN_LOAD_COUNTER 1
 #define HND_MAX_LOAD_COUNTER 15
@@ -93,6 +98,17 @@ public:
     int n_devIdentifiers = 0;
 };
 
+/*! Device DDF file which is read and parsed by a worker thread in readAllRawJson().
+ */
+struct DDF_RawFile
+{
+    QString path;
+    deCONZ::StorageLocation location;
+    QByteArray data;
+    QJsonDocument doc;
+    QJsonParseError error{};
+};
+
 struct ConstantEntry
 {
     AT_AtomIndex key;
@@ -157,6 +173,8 @@ static int DDF_ReadFileInMemory(DDF_ParseContext *pctx);
 static int DDF_ReadConstantsJson(DDF_ParseContext *pctx, std::vector<ConstantEntry> & constants);
 static DeviceDescription::Item DDF_ReadItemFile(DDF_ParseContext *pctx);
 static DeviceDescription DDF_ReadDeviceFile(DDF_ParseContext *pctx);
+static DeviceDescription DDF_ReadDeviceDocument(DDF_ParseContext *pctx, const QJsonDocument &doc, const QJsonParseError &error);
+static void DDF_ReadRawFile(DDF_RawFile *raw);
 static DDF_SubDeviceDescriptor DDF_ReadSubDeviceFile(DDF_ParseContext *pctx);
 static DeviceDescription DDF_MergeGenericItems(const std::vector<DeviceDescription::Item> &genericItems, const DeviceDescription &ddf);
 static int DDF_MergeGenericBundleItems(DeviceDescription &ddf, DDF_ParseContext *pctx);
@@ -1838,6 +1856,108 @@ const std::vector<DDF_SubDeviceDescriptor> &DeviceDescriptions::getSubDevices()
     return d_ptr2->subDevices;
 }
 
+static size_t DDF_StringBytes(const QString &str)
+{
+    return MEM_SharedArrayBytes(size_t(str.capacity()), sizeof(QChar));
+}
+
+static size_t DDF_StringListBytes(const QStringList &list)
+{
+    size_t bytes = MEM_SharedArrayBytes(size_t(list.size()), sizeof(void*));
+    for (const QString &str : list)
+    {
+        bytes += DDF_StringBytes(str);
+    }
+    return bytes;
+}
+
+/*! Rough estimate of parse/read/write parameters, a map node is about 48 bytes. */
+static size_t DDF_VariantBytes(const QVariant &var)
+{
+    size_t bytes = 0;
+
+    if (var.type() == QVariant::Map)
+    {
+        const QVariantMap map = var.toMap();
+        for (auto i = map.cbegin(); i != map.cend(); ++i)
+        {
+            bytes += 48 + DDF_StringBytes(i.key()) + DDF_VariantBytes(i.value());
+        }
+    }
+    else if (var.type() == QVariant::List)
+    {
+        const QVariantList list = var.toList();
+        bytes += MEM_SharedArrayBytes(size_t(list.size()), sizeof(void*));
+        for (const QVariant &v : list)
+        {
+            bytes += MEM_HeapBytes(sizeof(QVariant)) + DDF_VariantBytes(v);
+        }
+    }
+    else if (var.type() == QVariant::String)
+    {
+        bytes += DDF_StringBytes(var.toString());
+    }
+
+    return bytes;
+}
+
+static size_t DDF_ItemBytes(const DeviceDescription::Item &item)
+{
+    return DDF_StringBytes(item.description) +
+           DDF_VariantBytes(item.parseParameters) +
+           DDF_VariantBytes(item.readParameters) +
+           DDF_VariantBytes(item.writeParameters) +
+           DDF_VariantBytes(item.defaultValue);
+}
+
+/*! Adds the memory of loaded descriptions (MEM_DdfDescriptions) and of the
+    bundle bookkeeping (MEM_DdfBundles) to \p report.
+ */
+void DeviceDescriptions::memoryUsage(MEM_Report &report) const
+{
+    Q_D(const DeviceDescriptions);
+
+    size_t bytes = MEM_VectorBytes(d->descriptions) + MEM_VectorBytes(d->genericItems) +
+                   MEM_VectorBytes(d->constants2) + MEM_VectorBytes(d->subDevices) +
+                   MEM_VectorBytes(d->readFunctions) + MEM_VectorBytes(d->writeFunctions) +
+                   MEM_VectorBytes(d->parseFunctions);
+
+    for (const DeviceDescription::Item &item : d->genericItems)
+    {
+        bytes += DDF_ItemBytes(item);
+    }
+
+    for (const DeviceDescription &ddf : d->descriptions)
+    {
+        bytes += DDF_StringListBytes(ddf.modelIds) + DDF_StringListBytes(ddf.manufacturerNames) +
+                 MEM_VectorBytes(ddf.modelidAtomIndices) + MEM_VectorBytes(ddf.mfnameAtomIndices) +
+                 DDF_StringBytes(ddf.path) + DDF_StringBytes(ddf.vendor) + DDF_StringBytes(ddf.product) +
+                 DDF_StringBytes(ddf.status) + DDF_StringBytes(ddf.matchExpr) +
+                 MEM_VectorBytes(ddf.subDevices) + MEM_VectorBytes(ddf.bindings);
+
+        for (const DDF_Binding &bnd : ddf.bindings)
+        {
+            bytes += MEM_VectorBytes(bnd.reporting);
+        }
+
+        for (const DeviceDescription::SubDevice &sub : ddf.subDevices)
+        {
+            bytes += DDF_StringBytes(sub.type) + DDF_StringBytes(sub.restApi) + DDF_StringListBytes(sub.uniqueId) +
+                     DDF_VariantBytes(sub.meta) + MEM_VectorBytes(sub.items) + MEM_VectorBytes(sub.buttonEvents);
+
+            for (const DeviceDescription::Item &item : sub.items)
+            {
+                bytes += DDF_ItemBytes(item);
+            }
+        }
+    }
+
+    report.add(MEM_DdfDescriptions, bytes, d->descriptions.size());
+
+    // the scratch arena is reserved once and mainly used to parse bundles
+    report.add(MEM_DdfBundles, MEM_VectorBytes(d->ddfLoadRecords) + MEM_VectorBytes(d->publicKeys) + ScratchMemSize(), d->ddfLoadRecords.size());
+}
+
 static void DDF_UpdateItemHandlesForIndex(std::vector<DeviceDescription> &descriptions, uint loadCounter, size_t index)
 {
     U_ASSERT(index < descriptions.size());
@@ -2016,8 +2136,14 @@ JSON_Schema DDF_GetJsonSchema(uint8_t *data, unsigned dataSize)
  */
 void DeviceDescriptions::readAll()
 {
-    readAllRawJson();
-    readAllBundles();
+    {
+        SP_Scope startupScope(SP_DdfParse);
+        readAllRawJson();
+    }
+    {
+        SP_Scope startupScope(SP_DdfBundles);
+        readAllBundles();
+    }
 }
 
 /*! Reads all scheduled raw JSON DDF files.
@@ -2050,6 +2176,7 @@ void DeviceDescriptions::readAllRawJson()
     DBG_MEASURE_START(DDF_ReadRawJson);
 
     std::vector<DDF_SubDeviceDescriptor> subDevices;
+    std::vector<DDF_RawFile> rawFiles;
 
     std::array<deCONZ::StorageLocation, 2> locations = { deCONZ::DdfLocation, deCONZ::DdfUserLocation};
 
@@ -2158,160 +2285,187 @@ void DeviceDescriptions::readAllRawJson()
                 }
                 else
                 {
-                    if (DDF_ReadFileInMemory(pctx))
+                    DDF_RawFile raw;
+                    raw.path = filePath;
+                    raw.location = locations[dit];
+                    rawFiles.push_back(std::move(raw));
+                }
+            }
+        }
+    }
+
+    // device DDFs are read and parsed on worker threads, the objects are constructed here in the same order
+    for (size_t batch = 0; batch < rawFiles.size(); batch += DDF_PARSE_BATCH_SIZE)
+    {
+        const size_t count = std::min<size_t>(DDF_PARSE_BATCH_SIZE, rawFiles.size() - batch);
+        ParallelFor(count, ParallelThreadCount(), [&rawFiles, batch](size_t i) { DDF_ReadRawFile(&rawFiles[batch + i]); });
+
+        for (size_t i = batch; i < batch + count; i++)
+        {
+            DDF_RawFile &raw = rawFiles[i];
+
+            {
+                U_SStream ss;
+                U_sstream_init(&ss, pctx->filePath, sizeof(pctx->filePath));
+                U_sstream_put_str(&ss, raw.path.toUtf8().data());
+                pctx->filePathLength = ss.pos;
+            }
+            pctx->fileData = reinterpret_cast<uint8_t*>(raw.data.data());
+            pctx->fileDataSize = unsigned(raw.data.size());
+
+            DeviceDescription result = DDF_ReadDeviceDocument(pctx, raw.doc, raw.error);
+            if (result.isValid())
+            {
+                result.storageLocation = raw.location;
+                if (U_Sha256(pctx->fileData, pctx->fileDataSize, (unsigned char*)&result.sha256Hash[0]) == 0)
+                {
+                    DBG_Printf(DBG_DDF, "DDF failed to create SHA-256 hash of DDF\n");
+                }
+
+                unsigned j = 0;
+                unsigned k = 0;
+                bool found = false;
+
+                /*
+                 * Check if this DDF is already loaded.
+                 */
+                for (j = 0; j < d->descriptions.size(); j++)
+                {
+                    const DeviceDescription &ddf = d->descriptions[j];
+
+                    for (k = 0; k < 8; k++)
                     {
-                        DeviceDescription result = DDF_ReadDeviceFile(pctx);
-                        if (result.isValid())
+                        if (ddf.sha256Hash[k] != result.sha256Hash[k])
                         {
-                            result.storageLocation = locations[dit];
-                            if (U_Sha256(pctx->fileData, pctx->fileDataSize, (unsigned char*)&result.sha256Hash[0]) == 0)
-                            {
-                                DBG_Printf(DBG_DDF, "DDF failed to create SHA-256 hash of DDF\n");
-                            }
+                            break;
+                        }
+                    }
 
-                            unsigned j = 0;
-                            unsigned k = 0;
-                            bool found = false;
+                    if (k == 8)
+                    {
+                        found = true;
+                        break;
+                    }
+                }
+
+                if (!found)
+                {
+                    /*
+                     * Further check if the DDF is scheduled for loading.
+                     * That is when an actual possibly matching device exists in the setup.
+                     */
+                    bool scheduled = false;
+                    if (result.manufacturerNames.size() == result.modelIds.size())
+                    {
+                        for (j = 0; j < result.manufacturerNames.size(); j++)
+                        {
+                            AT_AtomIndex mfnameIndex;
+                            AT_AtomIndex modelidIndex;
+                            uint32_t mfnameLowerCaseHash = 0;
+
+                            mfnameIndex.index = 0;
+                            modelidIndex.index = 0;
 
                             /*
-                             * Check if this DDF is already loaded.
+                             * Try to get atoms for the mfname/modelid pair.
+                             * Note: If they don't exist, this isn't the pair we are looking for!
+                             * We don't add atoms for all strings found in DDFs to safe memory.
                              */
-                            for (j = 0; j < d->descriptions.size(); j++)
-                            {
-                                const DeviceDescription &ddf = d->descriptions[j];
 
-                                for (k = 0; k < 8; k++)
+                            {
+                                const QByteArray m = constantToString(result.manufacturerNames[j]).toUtf8();
+                                if (AT_GetAtomIndex(m.constData(), (unsigned)m.size(), &mfnameIndex) != 1)
                                 {
-                                    if (ddf.sha256Hash[k] != result.sha256Hash[k])
+                                    if (m.startsWith('$'))
+                                    {
+                                        DBG_Printf(DBG_DDF, "DDF failed to resolve constant %s\n", m.data());
+                                        // continue here anyway as long as modelid matches
+                                    }
+                                    else
                                     {
-                                        break;
+                                        continue;
                                     }
                                 }
+                                else
+                                {
+                                    mfnameLowerCaseHash = DDF_AtomLowerCaseStringHash(mfnameIndex);
+                                }
+                            }
 
-                                if (k == 8)
+                            {
+                                const QByteArray m = constantToString(result.modelIds[j]).toUtf8();
+                                if (AT_GetAtomIndex(m.constData(), (unsigned)m.size(), &modelidIndex) != 1)
                                 {
-                                    found = true;
-                                    break;
+                                    continue;
                                 }
                             }
 
-                            if (!found)
+                            for (k = 0; k < d->ddfLoadRecords.size(); k++)
                             {
-                                /*
-                                 * Further check if the DDF is scheduled for loading.
-                                 * That is when an actual possibly matching device exists in the setup.
-                                 */
-                                bool scheduled = false;
-                                if (result.manufacturerNames.size() == result.modelIds.size())
+                                if (modelidIndex.index == d->ddfLoadRecords[k].modelid.index)
                                 {
-                                    for (j = 0; j < result.manufacturerNames.size(); j++)
+                                    if (mfnameLowerCaseHash == 0)
                                     {
-                                        AT_AtomIndex mfnameIndex;
-                                        AT_AtomIndex modelidIndex;
-                                        uint32_t mfnameLowerCaseHash = 0;
-
-                                        mfnameIndex.index = 0;
-                                        modelidIndex.index = 0;
-
-                                        /*
-                                         * Try to get atoms for the mfname/modelid pair.
-                                         * Note: If they don't exist, this isn't the pair we are looking for!
-                                         * We don't add atoms for all strings found in DDFs to safe memory.
-                                         */
-
-                                        {
-                                            const QByteArray m = constantToString(result.manufacturerNames[j]).toUtf8();
-                                            if (AT_GetAtomIndex(m.constData(), (unsigned)m.size(), &mfnameIndex) != 1)
-                                            {
-                                                if (m.startsWith('$'))
-                                                {
-                                                    DBG_Printf(DBG_DDF, "DDF failed to resolve constant %s\n", m.data());
-                                                    // continue here anyway as long as modelid matches
-                                                }
-                                                else
-                                                {
-                                                    continue;
-                                                }
-                                            }
-                                            else
-                                            {
-                                                mfnameLowerCaseHash = DDF_AtomLowerCaseStringHash(mfnameIndex);
-                                            }
-                                        }
-
-                                        {
-                                            const QByteArray m = constantToString(result.modelIds[j]).toUtf8();
-                                            if (AT_GetAtomIndex(m.constData(), (unsigned)m.size(), &modelidIndex) != 1)
-                                            {
-                                                continue;
-                                            }
-                                        }
-
-                                        for (k = 0; k < d->ddfLoadRecords.size(); k++)
-                                        {
-                                            if (modelidIndex.index == d->ddfLoadRecords[k].modelid.index)
-                                            {
-                                                if (mfnameLowerCaseHash == 0)
-                                                {
-                                                    // ignore for now, in worst case we load a DDF to memory which isn't used
-                                                    U_ASSERT(0);
-                                                }
-                                                else if (mfnameLowerCaseHash != d->ddfLoadRecords[k].mfnameLowerCaseHash)
-                                                {
-                                                    continue;
-                                                }
-                                                scheduled = true;
-                                                break;
-                                            }
-                                        }
-
-                                        if (scheduled)
-                                        {
-                                            break;
-                                        }
+                                        // ignore for now, in worst case we load a DDF to memory which isn't used
+                                        U_ASSERT(0);
                                     }
+                                    else if (mfnameLowerCaseHash != d->ddfLoadRecords[k].mfnameLowerCaseHash)
+                                    {
+                                        continue;
+                                    }
+                                    scheduled = true;
+                                    break;
                                 }
-                                else
-                                {
-                                    DBG_Printf(DBG_DDF, "DDF ignore %s due unequal manufacturername/modelid array sizes\n", pctx->filePath);
-                                }
+                            }
 
-                                if (scheduled)
-                                {
-                                    /*
-                                     * The DDF is of interest, now register all atoms for faster lookups.
-                                     */
-                                    for (const auto &mfname : result.manufacturerNames)
-                                    {
-                                        const QString m = DeviceDescriptions::instance()->constantToString(mfname);
+                            if (scheduled)
+                            {
+                                break;
+                            }
+                        }
+                    }
+                    else
+                    {
+                        DBG_Printf(DBG_DDF, "DDF ignore %s due unequal manufacturername/modelid array sizes\n", pctx->filePath);
+                    }
 
-                                        AT_AtomIndex ati;
-                                        if (AT_AddAtom(m.toUtf8().data(), m.size(), &ati) && ati.index != 0)
-                                        {
-                                            result.mfnameAtomIndices.push_back(ati.index);
-                                        }
-                                    }
+                    if (scheduled)
+                    {
+                        /*
+                         * The DDF is of interest, now register all atoms for faster lookups.
+                         */
+                        for (const auto &mfname : result.manufacturerNames)
+                        {
+                            const QString m = DeviceDescriptions::instance()->constantToString(mfname);
 
-                                    for (const auto &modelId : result.modelIds)
-                                    {
-                                        const QString m = DeviceDescriptions::instance()->constantToString(modelId);
+                            AT_AtomIndex ati;
+                            if (AT_AddAtom(m.toUtf8().data(), m.size(), &ati) && ati.index != 0)
+                            {
+                                result.mfnameAtomIndices.push_back(ati.index);
+                            }
+                        }
 
-                                        AT_AtomIndex ati;
-                                        if (AT_AddAtom(m.toUtf8().data(), m.size(), &ati) && ati.index != 0)
-                                        {
-                                            result.modelidAtomIndices.push_back(ati.index);
-                                        }
-                                    }
+                        for (const auto &modelId : result.modelIds)
+                        {
+                            const QString m = DeviceDescriptions::instance()->constantToString(modelId);
 
-                                    DBG_Printf(DBG_DDF, "DDF cache raw JSON DDF %s\n", pctx->filePath);
-                                    d->descriptions.push_back(std::move(result));
-                                    DDF_UpdateItemHandlesForIndex(d->descriptions, d->loadCounter, d->descriptions.size() - 1);
-                                }
+                            AT_AtomIndex ati;
+                            if (AT_AddAtom(m.toUtf8().data(), m.size(), &ati) && ati.index != 0)
+                            {
+                                result.modelidAtomIndices.push_back(ati.index);
                             }
                         }
+
+                        DBG_Printf(DBG_DDF, "DDF cache raw JSON DDF %s\n", pctx->filePath);
+                        d->descriptions.push_back(std::move(result));
+                        DDF_UpdateItemHandlesForIndex(d->descriptions, d->loadCounter, d->descriptions.size() - 1);
                     }
                 }
             }
+
+            raw = DDF_RawFile(); // release the parsed JSON early
+            pctx->fileData = nullptr;
+            pctx->fileDataSize = 0;
         }
     }
 
@@ -2855,6 +3009,7 @@ void DeviceDescriptions::readAllBundles()
                 if (DDFB_FindChunk(&bs, "SIGN", &chunkSize) == 1)
                 {
                     U_bstream_init(&bs, &bs.data[bs.pos], chunkSize);
+                    SP_Scope startupScope(SP_DdfSignatures);
                     DDF_ProcessSignatures(pctx, d->publicKeys, &bs, ddfbHash);
                 }
 
@@ -4075,6 +4230,34 @@ static DeviceDescription DDF_ReadDeviceFile(DDF_ParseContext *pctx)
     QJsonParseError error;
     QJsonDocument doc = QJsonDocument::fromJson(data, &error);
 
+    return DDF_ReadDeviceDocument(pctx, doc, error);
+}
+
+/*! Reads and parses a device DDF file, runs on a worker thread.
+    Only Qt file and JSON classes are used here, they are reentrant.
+ */
+static void DDF_ReadRawFile(DDF_RawFile *raw)
+{
+    QFile f(raw->path);
+    if (f.open(QFile::ReadOnly))
+    {
+        raw->data = f.readAll();
+    }
+
+    if (raw->data.size() > 64)
+    {
+        raw->doc = QJsonDocument::fromJson(raw->data, &raw->error);
+    }
+    else
+    {
+        raw->error.error = QJsonParseError::IllegalValue;
+    }
+}
+
+/*! Creates the DeviceDescription of a parsed DDF, must run on the main thread.
+ */
+static DeviceDescription DDF_ReadDeviceDocument(DDF_ParseContext *pctx, const QJsonDocument &doc, const QJsonParseError &error)
+{
     if (error.error != QJsonParseError::NoError)
     {
         DBG_Printf(DBG_DDF, "DDF failed to read %s, err: %s, offset: %d\n", pctx->filePath, qPrintable(error.errorString()), error.offset);
@@ -4333,8 +4516,9 @@ uint8_t DDF_GetSubDeviceOrder(const QString &type)
 }
 
 /*! Creates a unique Resource handle.
+    \p generation is the slot generation of \p containerIndex for SlabVector based containers.
  */
-Resource::Handle R_CreateResourceHandle(const Resource *r, size_t containerIndex)
+Resource::Handle R_CreateResourceHandle(const Resource *r, size_t containerIndex, quint16 generation)
 {
     Q_ASSERT(r->prefix() != nullptr);
     if (r->item(RAttrUniqueId)->toString().isEmpty())
@@ -4347,6 +4531,7 @@ Resource::Handle R_CreateResourceHandle(const Resource *r, size_t containerIndex
     result.index = containerIndex;
     result.type = r->prefix()[1];
     result.order = 0;
+    result.generation = generation;
 
     Q_ASSERT(result.type == 's' || result.type == 'l' || result.type == 'd' || result.type == 'g');
     Q_ASSERT(isValid(result));
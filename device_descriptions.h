@@ -19,6 +19,7 @@
 #define SUBDEVICE_DEFAULT_ORDER  200
 
 class Event;
+struct MEM_Report;
 
 class DDF_ZclReport
 {
@@ -275,6 +276,7 @@ public:
     const std::vector<DDF_FunctionDescriptor> &getReadFunctions() const;
     const std::vector<DDF_FunctionDescriptor> &getWriteFunctions() const;
     const std::vector<DDF_SubDeviceDescriptor> &getSubDevices() const;
+    void memoryUsage(MEM_Report &report) const;
 
     static DeviceDescriptions *instance();
 
@@ -305,7 +307,7 @@ private:
 bool DDF_IsStatusEnabled(const QString &status);
 void DDF_AnnoteZclParse1(int line, const char* file, const Resource *resource, ResourceItem *item, quint8 ep, quint16 clusterId, quint16 attributeId, const char *eval);
 const DeviceDescription::Item &DDF_GetItem(const ResourceItem *item);
-Resource::Handle R_CreateResourceHandle(const Resource *r, size_t containerIndex);
+Resource::Handle R_CreateResourceHandle(const Resource *r, size_t containerIndex, quint16 generation = 0);
 
 void DEV_ReloadDeviceIdendifier(unsigned atomIndexMfname, unsigned atomIndexModelid);
 
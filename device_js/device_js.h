@@ -112,6 +112,7 @@ public:
     void reset();
     void clearItemsSet();
     QString errorString() const;
+    size_t memoryUsage() const;
     static DeviceJs *instance();
     const std::vector<ResourceItem*> &itemsSet() const;
 
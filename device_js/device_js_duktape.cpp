@@ -20,7 +20,9 @@
 #include "deconz/aps.h"
 #include "deconz/dbg_trace.h"
 #include "device.h"
+#include "metrics.h"
 #include "resource.h"
+#include "stall_detector.h"
 #include "utils/utils.h"
 
 #define U_UNUSED(x) (void)x
@@ -1117,6 +1119,7 @@ void DeviceJS_ResourceItemValueChanged(ResourceItem *item)
 
 JsEvalResult DeviceJs::evaluate(const QString &expr)
 {
+    SD_Scope stallScope(SD_JsEvaluate);
     duk_context *ctx;
 
     ctx = d->dukContext;
@@ -1162,7 +1165,13 @@ JsEvalResult DeviceJs::evaluate(const QString &expr)
         U_ASSERT(ret == 1);
     }
 
-    if (duk_peval_string(ctx, expr.toUtf8().constData()) != 0)
+    int rc;
+    {
+        MET_ScopedTimer metTimer(MET_JsEval);
+        rc = duk_peval_string(ctx, expr.toUtf8().constData());
+    }
+
+    if (rc != 0)
     {
         d->errString = duk_safe_to_string(ctx, -1);
         return JsEvalResult::Error;
@@ -1329,4 +1338,10 @@ QString DeviceJs::errorString() const
     return d->errString;
 }
 
+/*! Reserved arena plus the snapshot of the initialized context. */
+size_t DeviceJs::memoryUsage() const
+{
+    return size_t(d->arena._total_size) + d->initial_context.capacity();
+}
+
 #endif // USE_DUKTAPE_JS_ENGINE
@@ -12,18 +12,26 @@
 #include <QTimer>
 #include <deconz/dbg_trace.h>
 #include <deconz/timeref.h>
+#include "airtime_budget.h"
 #include "event.h"
+#include "metrics.h"
 #include "resource.h"
+#include "stall_detector.h"
+#include "startup_profile.h"
 #include "device_tick.h"
 
 #define DEV_TICK_BOOT_TIME 8000
 #define TICK_INTERVAL_JOIN 500
 #define TICK_INTERVAL_IDLE 1000
-#define TICK_INTERVAL_IDLE_OTAU 6000
 #define TICK_INTERVAL_POLL_TIMOUT 10000
+#define ROUTE_FRAMES_PER_SECOND 4   // airtime share of a route for polling and OTA
+#define ROUTE_FRAMES_BURST 8
+#define ROUTE_MAX_DEFER 6000        // a busy route still gets one poll in this time
+#define POLL_FRAMES 2
+#define OTAU_BLOCK_FRAMES 2         // image block request and response
 
 extern int DEV_ApsQueueSize();
-extern bool DEV_OtauBusy();
+extern DeviceKey DEV_RouteKey(DeviceKey deviceKey);
 
 struct JoinDevice
 {
@@ -49,7 +57,10 @@ public:
     DeviceTick *q = nullptr;
     QTimer *timer = nullptr;
     size_t devIter = 0;
+    int64_t cycleStart = 0; // time when devIter wrapped around
     const DeviceContainer *devices = nullptr;
+    AirtimeBudget airtime{ROUTE_FRAMES_PER_SECOND, ROUTE_FRAMES_BURST, ROUTE_MAX_DEFER};
+    std::vector<DeviceKey> deferredDevices; // skipped due to a busy route, oldest first
     // for logging
     DeviceKey curDeviceKey = 0;
     bool curDeviceManaged = false;
@@ -82,6 +93,13 @@ DeviceTick::~DeviceTick()
  */
 void DeviceTick::handleEvent(const Event &event)
 {
+    if (event.what() == REventOtauBlock)
+    {
+        // OTA traffic can't be deferred, account it for the route of the device
+        d->airtime.consume(DEV_RouteKey(event.deviceKey()), deCONZ::steadyTimeRef().ref, OTAU_BLOCK_FRAMES);
+        return;
+    }
+
     d->stateHandler(d, event);
 }
 
@@ -89,6 +107,7 @@ void DeviceTick::handleEvent(const Event &event)
  */
 void DeviceTick::timoutFired()
 {
+    SD_Scope stallScope(SD_DeviceTick);
     d->stateHandler(d, Event(RLocal, REventStateTimeout, 0));
 }
 
@@ -130,28 +149,102 @@ static void DT_StateInit(DeviceTickPrivate *d, const Event &event)
     }
 }
 
+/*! Emits REventPoll for \p device.
+ */
+static void DT_PollDevice(DeviceTickPrivate *d, Device *device)
+{
+    d->curDeviceKey = device->key();
+    d->curDeviceManaged = device->managed();
+    emit d->q->eventNotify(Event(device->prefix(), REventPoll, 0, device->key()));
+}
+
+/*! Polls the oldest deferred device whose route has airtime left.
+ */
+static bool DT_PollDeferredDevice(DeviceTickPrivate *d, int64_t now)
+{
+    for (auto i = d->deferredDevices.begin(); i != d->deferredDevices.end(); )
+    {
+        const DeviceKey deviceKey = *i;
+        const auto dev = std::find_if(d->devices->cbegin(), d->devices->cend(), [deviceKey](const auto &device)
+        {
+            return device->key() == deviceKey;
+        });
+
+        if (dev == d->devices->cend() || !(*dev)->reachable())
+        {
+            i = d->deferredDevices.erase(i);
+            continue;
+        }
+
+        if (d->airtime.acquire(DEV_RouteKey(deviceKey), now, POLL_FRAMES))
+        {
+            d->deferredDevices.erase(i);
+            DT_PollDevice(d, dev->get());
+            return true;
+        }
+
+        ++i;
+    }
+
+    return false;
+}
+
 /*! Emits REventPoll to the next device in DT_StateIdle.
+
+    Devices on a route which is busy with OTA traffic are deferred until the route has
+    airtime left, the remaining devices are polled at normal pace.
  */
 static bool DT_PollNextIdleDevice(DeviceTickPrivate *d)
 {
     const auto devCount = d->devices->size();
+    const int64_t now = deCONZ::steadyTimeRef().ref;
 
     if (devCount == 0)
     {
         return false;
     }
 
-    d->devIter %= devCount;
-
-    const auto &device = d->devices->at(d->devIter);
-    d->devIter++;
-    Q_ASSERT(device);
+    if (DT_PollDeferredDevice(d, now))
+    {
+        return true;
+    }
 
-    if (device->reachable())
+    for (size_t n = 0; n < devCount; n++)
     {
-        d->curDeviceKey = device->key();
-        d->curDeviceManaged = device->managed();
-        emit d->q->eventNotify(Event(device->prefix(), REventPoll, 0, device->key()));
+        if (d->devIter >= devCount)
+        {
+            if (d->cycleStart != 0)
+            {
+                MET_ObserveUs(MET_DeviceTickCycle, (now - d->cycleStart) * 1000);
+                SP_Milestone(SP_FirstPollCycle);
+            }
+            d->cycleStart = now;
+        }
+
+        d->devIter %= devCount;
+
+        const auto &device = d->devices->at(d->devIter);
+        d->devIter++;
+        Q_ASSERT(device);
+
+        if (!device->reachable())
+        {
+            return false;
+        }
+
+        const auto deferred = std::find(d->deferredDevices.cbegin(), d->deferredDevices.cend(), device->key());
+        if (deferred != d->deferredDevices.cend())
+        {
+            continue;
+        }
+
+        if (!d->airtime.acquire(DEV_RouteKey(device->key()), now, POLL_FRAMES))
+        {
+            d->deferredDevices.push_back(device->key());
+            continue;
+        }
+
+        DT_PollDevice(d, device.get());
         return true;
     }
 
@@ -173,7 +266,6 @@ static void DT_StateIdle(DeviceTickPrivate *d, const Event &event)
     {
         if (event.what() == REventStateTimeout)
         {
-            int timeout = DEV_OtauBusy() ? TICK_INTERVAL_IDLE_OTAU : TICK_INTERVAL_IDLE;
             if (DA_ApsUnconfirmedRequests() < 4)
             {
                 if (DT_PollNextIdleDevice(d))
@@ -182,7 +274,7 @@ static void DT_StateIdle(DeviceTickPrivate *d, const Event &event)
                     return;
                 }
             }
-            DT_StartTimer(d, timeout);
+            DT_StartTimer(d, TICK_INTERVAL_IDLE);
         }
         else if (event.what() == REventStateEnter)
         {
@@ -11,7 +11,10 @@
 #include <QTimer>
 #include <QElapsedTimer>
 #include "event_emitter.h"
+#include "memory_stats.h"
+#include "metrics.h"
 #include "rest_node_base.h"
+#include "stall_detector.h"
 #include "de_web_plugin_private.h"
 
 static EventEmitter *instance_ = nullptr;
@@ -106,8 +109,12 @@ EventEmitter::~EventEmitter()
 
 void EventEmitter::process()
 {
+    SD_Scope stallScope(SD_EventQueue);
     QElapsedTimer t;
     t.start();
+    uint64_t count = 0;
+
+    MET_Set(MET_EventQueueDepth, int64_t(m_urgentQueue.size() + m_queue.size() - m_pos));
 
     while (t.elapsed() < 10 && (m_urgentQueue.size() || m_queue.size()))
     {
@@ -118,6 +125,7 @@ void EventEmitter::process()
             // which would invalidate the event reference
             const Event ev = m_urgentQueue[i];
             emit eventNotify(ev);
+            count++;
             i++;
 
             if (i == m_urgentQueue.size())
@@ -133,6 +141,7 @@ void EventEmitter::process()
             m_pos++;
             const Event ev = m_queue[m_pos - 1];
             emit eventNotify(ev);
+            count++;
             if (m_pos == m_queue.size())
             {
                 m_queue.clear();
@@ -140,6 +149,30 @@ void EventEmitter::process()
             }
         }
     }
+
+    if (count > 0)
+    {
+        MET_Add(MET_EventsProcessed, count);
+        MET_ObserveUs(MET_EventProcessing, t.nsecsElapsed() / 1000);
+    }
+}
+
+/*! Queue capacity and the ids of queued events, for MEM_EventQueue. */
+void EventEmitter::memoryUsage(MEM_Report &report) const
+{
+    size_t bytes = MEM_VectorBytes(m_queue) + MEM_VectorBytes(m_urgentQueue);
+
+    for (size_t i = m_pos; i < m_queue.size(); i++)
+    {
+        bytes += MEM_SharedArrayBytes(size_t(m_queue[i].id().capacity()), sizeof(QChar));
+    }
+
+    for (const Event &e : m_urgentQueue)
+    {
+        bytes += MEM_SharedArrayBytes(size_t(e.id().capacity()), sizeof(QChar));
+    }
+
+    report.add(MEM_EventQueue, bytes, m_queue.size() - m_pos + m_urgentQueue.size());
 }
 
 void EventEmitter::timerFired()
@@ -16,6 +16,7 @@
 #include "event.h"
 
 class QTimer;
+struct MEM_Report;
 
 void enqueueEvent(const Event &event);
 
@@ -26,6 +27,7 @@ class EventEmitter : public QObject
 public:
     explicit EventEmitter(QObject *parent = nullptr);
     ~EventEmitter();
+    void memoryUsage(MEM_Report &report) const;
 
 public Q_SLOTS:
     void process();
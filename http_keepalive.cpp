@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include <algorithm>
+#include <cctype>
+#include "http_keepalive.h"
+
+HttpKeepAlive::HttpKeepAlive(int64_t idleTimeoutMs, int maxRequests) :
+    m_idleTimeout(idleTimeoutMs),
+    m_maxRequests(maxRequests > 0 ? maxRequests : 1)
+{
+}
+
+/*! Registers a request on \p conn.
+    \p remaining is set to the number of further requests allowed on the connection.
+    \returns false if the connection should be closed after the response.
+ */
+bool HttpKeepAlive::request(void *conn, int64_t now, bool clientKeepAlive, int *remaining)
+{
+    auto i = std::find_if(m_conns.begin(), m_conns.end(), [conn](const Connection &c) { return c.conn == conn; });
+
+    if (i == m_conns.end())
+    {
+        if (!clientKeepAlive)
+        {
+            *remaining = 0;
+            return false;
+        }
+
+        Connection c;
+        c.conn = conn;
+        m_conns.push_back(c);
+        i = m_conns.end() - 1;
+    }
+
+    i->lastRequest = now;
+    i->requests++;
+    *remaining = m_maxRequests - i->requests;
+
+    if (!clientKeepAlive || *remaining <= 0)
+    {
+        *remaining = 0;
+        m_conns.erase(i);
+        return false;
+    }
+
+    return true;
+}
+
+/*! Forgets \p conn, e.g. after it was closed by the client.
+ */
+void HttpKeepAlive::remove(void *conn)
+{
+    m_conns.erase(std::remove_if(m_conns.begin(), m_conns.end(), [conn](const Connection &c) { return c.conn == conn; }), m_conns.end());
+}
+
+/*! Removes connections idle for longer than the timeout and appends them to \p expired.
+ */
+void HttpKeepAlive::expire(int64_t now, std::vector<void*> *expired)
+{
+    for (auto i = m_conns.begin(); i != m_conns.end(); )
+    {
+        if (now - i->lastRequest >= m_idleTimeout)
+        {
+            expired->push_back(i->conn);
+            i = m_conns.erase(i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+bool HttpKeepAlive::contains(void *conn) const
+{
+    return std::any_of(m_conns.cbegin(), m_conns.cend(), [conn](const Connection &c) { return c.conn == conn; });
+}
+
+static bool hasToken(const char *str, size_t length, const char *token, size_t tokenLength)
+{
+    for (size_t i = 0; str && i + tokenLength <= length; i++)
+    {
+        size_t n = 0;
+        for (; n < tokenLength; n++)
+        {
+            if (std::tolower(static_cast<unsigned char>(str[i + n])) != token[n])
+            {
+                break;
+            }
+        }
+
+        if (n == tokenLength)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*! Returns true if the client of a HTTP/\p major.\p minor request wants a persistent connection.
+    \p connection is the value of the Connection header or nullptr if there is none.
+
+    Persistent connections are the default for HTTP/1.1 unless the "close" token is sent,
+    HTTP/1.0 clients have to ask for them with the "keep-alive" token.
+ */
+bool HTTP_WantsKeepAlive(int major, int minor, const char *connection, size_t length)
+{
+    static const char closeToken[] = "close";
+    static const char keepAliveToken[] = "keep-alive";
+
+    if (hasToken(connection, length, closeToken, sizeof(closeToken) - 1))
+    {
+        return false;
+    }
+
+    if (major > 1 || (major == 1 && minor >= 1))
+    {
+        return true;
+    }
+
+    return hasToken(connection, length, keepAliveToken, sizeof(keepAliveToken) - 1);
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef HTTP_KEEPALIVE_H
+#define HTTP_KEEPALIVE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define HTTP_KEEPALIVE_IDLE_TIMEOUT  15000 // ms
+#define HTTP_KEEPALIVE_MAX_REQUESTS  100
+#define HTTP_CORS_MAX_AGE            3600 // s, Chromium caps at 7200
+
+/*! \class HttpKeepAlive
+
+    Bookkeeping of persistent REST API connections.
+
+    A connection is identified by an opaque pointer, e.g. the QTcpSocket. It stays open
+    while the client doesn't ask to close it, the number of requests is below \c maxRequests
+    and it isn't idle for longer than \c idleTimeoutMs. Times are monotonic ms.
+ */
+class HttpKeepAlive
+{
+public:
+    explicit HttpKeepAlive(int64_t idleTimeoutMs = HTTP_KEEPALIVE_IDLE_TIMEOUT, int maxRequests = HTTP_KEEPALIVE_MAX_REQUESTS);
+
+    bool request(void *conn, int64_t now, bool clientKeepAlive, int *remaining);
+    void remove(void *conn);
+    void expire(int64_t now, std::vector<void*> *expired);
+    bool contains(void *conn) const;
+    size_t size() const { return m_conns.size(); }
+    int64_t idleTimeout() const { return m_idleTimeout; }
+
+private:
+    struct Connection
+    {
+        void *conn = nullptr;
+        int64_t lastRequest = 0;
+        int requests = 0;
+    };
+
+    std::vector<Connection> m_conns; //! a handful of browser connections
+    int64_t m_idleTimeout;
+    int m_maxRequests;
+};
+
+bool HTTP_WantsKeepAlive(int major, int minor, const char *connection, size_t length);
+
+#endif // HTTP_KEEPALIVE_H
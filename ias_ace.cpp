@@ -92,7 +92,20 @@ static const std::array<QLatin1String, 11> IAS_PanelStates = {
     QLatin1String("arming_away")
 };
 
-static void sendArmResponse(const deCONZ::ApsDataIndication &ind, deCONZ::ZclFrame &zclFrame, quint8 armMode, ApsControllerWrapper &apsCtrlWrapper);
+/*! Addressing of an arm command, kept to send the response after the PIN code verification.
+ */
+struct IAS_ArmRequest
+{
+    deCONZ::Address srcAddress;
+    deCONZ::ApsAddressMode srcAddressMode;
+    quint16 profileId;
+    quint16 clusterId;
+    quint8 srcEndpoint;
+    quint8 seqNo;
+    quint8 armMode;
+};
+
+static void sendArmResponse(const IAS_ArmRequest &armReq, quint8 armRsp, ApsControllerWrapper &apsCtrlWrapper);
 static void sendGetPanelStatusResponse(const deCONZ::ApsDataIndication &ind, deCONZ::ZclFrame &zclFrame, quint8 panelStatus, quint8 secs, ApsControllerWrapper &apsCtrlWrapper);
 
 QLatin1String IAS_PanelStatusToString(quint8 panelStatus)
@@ -117,18 +130,15 @@ int IAS_PanelStatusFromString(const QString &panelStatus)
     return -1;
 }
 
-static quint8 handleArmCommand(AlarmSystem *alarmSys, quint8 armMode, const QString &pinCode, quint64 srcAddress)
+/*! Applies the arm command after the PIN code was verified.
+ */
+static quint8 handleArmCommand(AlarmSystem *alarmSys, quint8 armMode)
 {
     if (!alarmSys || armMode > IAS_ACE_ARM_MODE_ARM_ALL_ZONES)
     {
         return IAS_ACE_ARM_NOTF_NOT_READY_TO_ARM;
     }
 
-    if (!alarmSys->isValidCode(pinCode, srcAddress))
-    {
-        return IAS_ACE_ARM_NOTF_INVALID_ARM_DISARM_CODE;
-    }
-
     const quint8 armMode0 = alarmSys->targetArmMode();
 
     if (armMode0 == IAS_ACE_ARM_MODE_DISARM && armMode == armMode0)
@@ -149,6 +159,29 @@ static quint8 handleArmCommand(AlarmSystem *alarmSys, quint8 armMode, const QStr
     return armMode;
 }
 
+static bool setArmAction(Sensor *sensor, quint8 armRsp, quint8 armMode)
+{
+    ResourceItem *actionItem = sensor->item(RStateAction);
+
+    if (actionItem && armRsp < IAS_ArmResponse.size())
+    {
+        actionItem->setValue(QString(IAS_ArmResponse[armRsp]));
+        enqueueEvent(Event(sensor->prefix(), actionItem->descriptor().suffix, sensor->id(), armMode));
+        return true;
+    }
+
+    return false;
+}
+
+static void updateSensorState(Sensor *sensor)
+{
+    sensor->updateStateTimestamp();
+    enqueueEvent(Event(RSensors, RStateLastUpdated, sensor->id()));
+    plugin->updateSensorEtag(sensor);
+    sensor->setNeedSaveDatabase(true);
+    plugin->queSaveDb(DB_SENSORS, DB_SHORT_SAVE_DELAY);
+}
+
 void IAS_IasAceClusterIndication(const deCONZ::ApsDataIndication &ind, deCONZ::ZclFrame &zclFrame, AlarmSystems *alarmSystems, ApsControllerWrapper &apsCtrlWrapper)
 {
     if (zclFrame.isDefaultResponse())
@@ -203,25 +236,48 @@ void IAS_IasAceClusterIndication(const deCONZ::ApsDataIndication &ind, deCONZ::Z
         
         DBG_Printf(DBG_IAS, "[IAS ACE] 0x%016llX arm command received, arm mode: 0x%02X, code length: %d\n", ind.srcAddress().ext(), armMode, (int)armCode.size());
 
+        const IAS_ArmRequest armReq{ind.srcAddress(), ind.srcAddressMode(), ind.profileId(), ind.clusterId(), ind.srcEndpoint(), zclFrame.sequenceNumber(), armMode};
+
         AlarmSystem *alarmSys = AS_GetAlarmSystemForDevice(ind.srcAddress().ext(), *alarmSystems);
 
         if (alarmSys)
         {
-            armRsp = handleArmCommand(alarmSys, armMode, armCode, ind.srcAddress().ext());
-        }
+            // scrypt takes tens of milliseconds, verify on the worker thread and respond when done
+            const AlarmSystemId alarmSystemId = alarmSys->id();
+            const QString uniqueId = sensor->uniqueId();
+            ApsControllerWrapper *wrapper = &apsCtrlWrapper;
 
-        {
-            ResourceItem *actionItem = sensor->item(RStateAction);
+            const bool queued = alarmSys->verifyCode(armCode, ind.srcAddress().ext(), alarmSystems->verifyWorker.get(),
+                                                     [armReq, alarmSystemId, uniqueId, alarmSystems, wrapper](bool valid)
+            {
+                quint8 rsp = IAS_ACE_ARM_NOTF_INVALID_ARM_DISARM_CODE;
+
+                if (valid)
+                {
+                    rsp = handleArmCommand(AS_GetAlarmSystem(alarmSystemId, *alarmSystems), armReq.armMode);
+                }
+
+                Sensor *s = plugin->getSensorNodeForUniqueId(uniqueId);
+                if (s && setArmAction(s, rsp, armReq.armMode))
+                {
+                    updateSensorState(s);
+                }
+
+                sendArmResponse(armReq, rsp, *wrapper);
+            });
 
-            if (actionItem && armRsp < IAS_ArmResponse.size())
+            if (queued)
             {
-                actionItem->setValue(QString(IAS_ArmResponse[armRsp]));
-                enqueueEvent(Event(sensor->prefix(), actionItem->descriptor().suffix, sensor->id(), armMode));
-                stateUpdated = true;
+                apsCtrlWrapper.deferZclResponse();
+                return;
             }
+
+            // unknown device or rate limited
+            armRsp = IAS_ACE_ARM_NOTF_INVALID_ARM_DISARM_CODE;
         }
 
-        sendArmResponse(ind, zclFrame, armRsp, apsCtrlWrapper);
+        stateUpdated = setArmAction(sensor, armRsp, armMode);
+        sendArmResponse(armReq, armRsp, apsCtrlWrapper);
     }
     else if (zclFrame.commandId() == IAS_ACE_CMD_GET_PANEL_STATUS)
     {
@@ -268,19 +324,15 @@ void IAS_IasAceClusterIndication(const deCONZ::ApsDataIndication &ind, deCONZ::Z
     
     if (stateUpdated)
     {
-        sensor->updateStateTimestamp();
-        enqueueEvent(Event(RSensors, RStateLastUpdated, sensor->id()));
-        plugin->updateSensorEtag(sensor);
-        sensor->setNeedSaveDatabase(true);
-        plugin->queSaveDb(DB_SENSORS, DB_SHORT_SAVE_DELAY);
+        updateSensorState(sensor);
     }
 }
 
-static void sendArmResponse(const deCONZ::ApsDataIndication &ind, deCONZ::ZclFrame &zclFrame, quint8 armMode, ApsControllerWrapper &apsCtrlWrapper)
+static void sendArmResponse(const IAS_ArmRequest &armReq, quint8 armRsp, ApsControllerWrapper &apsCtrlWrapper)
 {
-    DBG_Assert(armMode <= IAS_ACE_ARM_NOTF_ALREADY_DISARMED);
+    DBG_Assert(armRsp <= IAS_ACE_ARM_NOTF_ALREADY_DISARMED);
 
-    if (armMode > IAS_ACE_ARM_NOTF_ALREADY_DISARMED)
+    if (armRsp > IAS_ACE_ARM_NOTF_ALREADY_DISARMED)
     {
         return;
     }
@@ -288,14 +340,14 @@ static void sendArmResponse(const deCONZ::ApsDataIndication &ind, deCONZ::ZclFra
     deCONZ::ApsDataRequest req;
     deCONZ::ZclFrame outZclFrame;
 
-    req.setProfileId(ind.profileId());
-    req.setClusterId(ind.clusterId());
-    req.setDstAddressMode(ind.srcAddressMode());
-    req.dstAddress() = ind.srcAddress();
-    req.setDstEndpoint(ind.srcEndpoint());
+    req.setProfileId(armReq.profileId);
+    req.setClusterId(armReq.clusterId);
+    req.setDstAddressMode(armReq.srcAddressMode);
+    req.dstAddress() = armReq.srcAddress;
+    req.setDstEndpoint(armReq.srcEndpoint);
     req.setSrcEndpoint(plugin->endpoint());
 
-    outZclFrame.setSequenceNumber(zclFrame.sequenceNumber());
+    outZclFrame.setSequenceNumber(armReq.seqNo);
     outZclFrame.setCommandId(IAS_ACE_CMD_ARM_RESPONSE);
 
     outZclFrame.setFrameControl(deCONZ::ZclFCClusterCommand |
@@ -306,7 +358,7 @@ static void sendArmResponse(const deCONZ::ApsDataIndication &ind, deCONZ::ZclFra
         QDataStream stream(&outZclFrame.payload(), QIODevice::WriteOnly);
         stream.setByteOrder(QDataStream::LittleEndian);
 
-        stream << armMode;
+        stream << armRsp;
     }
 
     { // ZCL frame
@@ -317,7 +369,7 @@ static void sendArmResponse(const deCONZ::ApsDataIndication &ind, deCONZ::ZclFra
 
     if (apsCtrlWrapper.apsdeDataRequest(req) != deCONZ::Success)
     {
-        DBG_Printf(DBG_IAS, "[IAS ACE] 0x%016llX failed to send IAS ACE arm reponse.\n", ind.srcAddress().ext());
+        DBG_Printf(DBG_IAS, "[IAS ACE] 0x%016llX failed to send IAS ACE arm reponse.\n", armReq.srcAddress.ext());
     }
 }
 
@@ -116,11 +116,11 @@ static void IAS_QueueRestorePresence(Sensor *const sensor, const ResourceItem &p
     const ResourceItem *const duration = sensor->item(RConfigDuration);
     if (val.maxInterval > 0)
     {
-        sensor->durationDue = presence.lastSet().addSecs(val.maxInterval);
+        plugin->setSensorDurationDue(sensor, presence.lastSet().addSecs(val.maxInterval));
     }
     else if (duration && duration->toNumber() > 0)
     {
-        sensor->durationDue = presence.lastSet().addSecs(duration->toNumber());
+        plugin->setSensorDurationDue(sensor, presence.lastSet().addSecs(duration->toNumber()));
     }
 }
 
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include <cstdio>
+#include "memory_stats.h"
+
+#ifdef __linux__
+  #include <unistd.h>
+#endif
+
+size_t MEM_Report::totalBytes() const
+{
+    size_t total = 0;
+    for (const MEM_Usage &u : usage)
+    {
+        total += u.bytes;
+    }
+    return total;
+}
+
+void MEM_History::add(int64_t timeMs, const MEM_Report &report)
+{
+    MEM_Sample &sample = m_samples[m_pos];
+    sample.timeMs = timeMs;
+    for (int i = 0; i < MEM_CategoryMax; i++)
+    {
+        sample.bytes[i] = report.usage[i].bytes;
+    }
+
+    m_pos = (m_pos + 1) % MEM_HISTORY_SIZE;
+    if (m_count < MEM_HISTORY_SIZE)
+    {
+        m_count++;
+    }
+}
+
+const MEM_Sample &MEM_History::at(size_t i) const
+{
+    const size_t oldest = m_count < MEM_HISTORY_SIZE ? 0 : m_pos;
+    return m_samples[(oldest + i) % MEM_HISTORY_SIZE];
+}
+
+/*! Bytes per day between the oldest and the newest sample, negative if shrinking.
+ */
+int64_t MEM_History::growthPerDay(MEM_Category category) const
+{
+    if (m_count < 2)
+    {
+        return 0;
+    }
+
+    const MEM_Sample &first = at(0);
+    const MEM_Sample &last = at(m_count - 1);
+    const int64_t span = last.timeMs - first.timeMs;
+
+    if (span <= 0)
+    {
+        return 0;
+    }
+
+    const int64_t delta = int64_t(last.bytes[category]) - int64_t(first.bytes[category]);
+    return int64_t(double(delta) * (24 * 3600 * 1000.0) / double(span));
+}
+
+int64_t MEM_History::totalGrowthPerDay() const
+{
+    int64_t total = 0;
+    for (int i = 0; i < MEM_CategoryMax; i++)
+    {
+        total += growthPerDay(MEM_Category(i));
+    }
+    return total;
+}
+
+/*! Size of a heap block including the allocator overhead.
+
+    Modelled after glibc malloc on 64-bit: 8 bytes chunk header, 16 byte alignment and
+    32 bytes minimum chunk size. Good enough for other allocators to spot trends.
+ */
+size_t MEM_HeapBytes(size_t size)
+{
+    if (size == 0)
+    {
+        return 0;
+    }
+
+    const size_t chunk = (size + sizeof(size_t) + 15) & ~size_t(15);
+    return chunk < 32 ? 32 : chunk;
+}
+
+/*! Heap memory of an implicitly shared Qt array like QString and QByteArray.
+    \p capacity in elements, the terminating zero and the 24 byte QArrayData header are added.
+ */
+size_t MEM_SharedArrayBytes(size_t capacity, size_t elementSize)
+{
+    if (capacity == 0)
+    {
+        return 0; // shared null
+    }
+
+    return MEM_HeapBytes(24 + (capacity + 1) * elementSize);
+}
+
+/*! Resident set size of the process, 0 if not supported.
+ */
+size_t MEM_ProcessResidentBytes()
+{
+#ifdef __linux__
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (!f)
+    {
+        return 0;
+    }
+
+    unsigned long pages = 0;
+    unsigned long resident = 0;
+    const int n = fscanf(f, "%lu %lu", &pages, &resident);
+    fclose(f);
+
+    if (n != 2)
+    {
+        return 0;
+    }
+
+    return size_t(resident) * size_t(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
+
+const char *MEM_CategoryName(MEM_Category category)
+{
+    switch (category)
+    {
+    case MEM_ResourceItems:    return "resourceitems";
+    case MEM_AtomTable:        return "atomtable";
+    case MEM_DdfDescriptions:  return "ddf";
+    case MEM_DdfBundles:       return "ddfbundles";
+    case MEM_DuktapeArena:     return "duktape";
+    case MEM_EventQueue:       return "eventqueue";
+    case MEM_WebsocketBuffers: return "websocket";
+    case MEM_DbQueryQueue:     return "dbqueue";
+    case MEM_Scenes:           return "scenes";
+    case MEM_Groups:           return "groups";
+    default:
+        break;
+    }
+
+    return "unknown";
+}
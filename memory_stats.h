@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef MEMORY_STATS_H
+#define MEMORY_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*! Per subsystem memory accounting.
+
+    The figures are estimates collected on demand by walking the owning containers,
+    so there is no bookkeeping in the hot paths. Heap blocks are accounted with the
+    allocator overhead, see MEM_HeapBytes().
+
+    A MEM_History of periodic samples gives the growth per category, which makes slow
+    leaks on long running gateways visible before they run out of memory.
+ */
+
+#define MEM_HISTORY_SIZE 48
+#define MEM_SAMPLE_INTERVAL_MS (60 * 60 * 1000) // with MEM_HISTORY_SIZE covers two days
+
+enum MEM_Category
+{
+    MEM_ResourceItems,
+    MEM_AtomTable,
+    MEM_DdfDescriptions,
+    MEM_DdfBundles,
+    MEM_DuktapeArena,
+    MEM_EventQueue,
+    MEM_WebsocketBuffers,
+    MEM_DbQueryQueue,
+    MEM_Scenes,
+    MEM_Groups,
+    MEM_CategoryMax
+};
+
+struct MEM_Usage
+{
+    size_t bytes = 0;
+    size_t count = 0; //! items, atoms, descriptions, events ... depending on the category
+};
+
+struct MEM_Report
+{
+    MEM_Usage usage[MEM_CategoryMax];
+
+    void add(MEM_Category category, size_t bytes, size_t count = 1)
+    {
+        usage[category].bytes += bytes;
+        usage[category].count += count;
+    }
+
+    size_t totalBytes() const;
+};
+
+struct MEM_Sample
+{
+    int64_t timeMs = 0;
+    size_t bytes[MEM_CategoryMax] = {};
+};
+
+/*! \class MEM_History
+
+    Ring buffer of the last MEM_HISTORY_SIZE samples.
+ */
+class MEM_History
+{
+public:
+    void add(int64_t timeMs, const MEM_Report &report);
+    size_t size() const { return m_count; }
+    const MEM_Sample &at(size_t i) const; //! oldest first
+    int64_t growthPerDay(MEM_Category category) const;
+    int64_t totalGrowthPerDay() const;
+
+private:
+    MEM_Sample m_samples[MEM_HISTORY_SIZE];
+    size_t m_count = 0;
+    size_t m_pos = 0;
+};
+
+size_t MEM_HeapBytes(size_t size);
+size_t MEM_SharedArrayBytes(size_t capacity, size_t elementSize);
+size_t MEM_ProcessResidentBytes();
+const char *MEM_CategoryName(MEM_Category category);
+
+/*! Heap memory of a std::vector, not including the elements own allocations. */
+template <typename T>
+size_t MEM_VectorBytes(const std::vector<T> &vec)
+{
+    return vec.capacity() == 0 ? 0 : MEM_HeapBytes(vec.capacity() * sizeof(T));
+}
+
+#endif // MEMORY_STATS_H
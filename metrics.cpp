@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include "metrics.h"
+
+#define MET_MAX_BUCKETS 11
+
+/*! Bucket upper bounds in microseconds, 0 terminates a set before MET_MAX_BUCKETS.
+ */
+static const int64_t bucketsFast[MET_MAX_BUCKETS] = { // CPU bound work
+    100, 500, 1000, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000
+};
+
+static const int64_t bucketsRadio[MET_MAX_BUCKETS] = { // APS confirms
+    50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000, 30000000, 60000000, 0
+};
+
+static const int64_t bucketsCycle[MET_MAX_BUCKETS] = { // device poll cycles
+    1000000, 5000000, 10000000, 30000000, 60000000, 120000000, 300000000, 600000000, 1800000000, 3600000000, 0
+};
+
+struct MET_Descriptor
+{
+    const char *name;
+    const char *help;
+    const char *module; // label value of the REST histograms
+    const int64_t *buckets;
+};
+
+static const MET_Descriptor counterDesc[MET_CounterMax] = {
+    { "deconz_events_processed_total", "Events processed by the event queue.", nullptr, nullptr },
+    { "deconz_websocket_messages_total", "Websocket messages sent to all clients.", nullptr, nullptr },
+    { "deconz_websocket_bytes_sent_total", "Websocket bytes sent to all clients.", nullptr, nullptr }
+};
+
+static const MET_Descriptor gaugeDesc[MET_GaugeMax] = {
+    { "deconz_event_queue_depth", "Events waiting in the event queue.", nullptr, nullptr },
+    { "deconz_aps_tasks_queued", "APS tasks waiting to be sent.", nullptr, nullptr },
+    { "deconz_aps_tasks_on_air", "APS tasks sent and waiting for the confirm.", nullptr, nullptr },
+    { "deconz_aps_unconfirmed_requests", "APS requests in the core APS queue.", nullptr, nullptr },
+    { "deconz_db_write_queue_depth", "SQL statements waiting for the next database save.", nullptr, nullptr },
+    { "deconz_websocket_clients", "Connected websocket clients.", nullptr, nullptr }
+};
+
+static const char restHelp[] = "REST API request handling time by module.";
+
+static const MET_Descriptor histDesc[MET_HistogramMax] = {
+    { "deconz_event_processing_seconds", "Time spent per event queue run.", nullptr, bucketsFast },
+    { "deconz_aps_confirm_latency_seconds", "Time from APS request to confirm.", nullptr, bucketsRadio },
+    { "deconz_device_tick_cycle_seconds", "Time to poll all devices once.", nullptr, bucketsCycle },
+    { "deconz_db_transaction_seconds", "Duration of database save transactions.", nullptr, bucketsFast },
+    { "deconz_js_eval_seconds", "Duktape evaluation time of DDF expressions.", nullptr, bucketsFast },
+    { "deconz_event_loop_latency_seconds", "Delay of the event loop heartbeat timer.", nullptr, bucketsFast },
+    { "deconz_rest_request_seconds", restHelp, "lights", bucketsFast },
+    { "deconz_rest_request_seconds", restHelp, "groups", bucketsFast },
+    { "deconz_rest_request_seconds", restHelp, "sensors", bucketsFast },
+    { "deconz_rest_request_seconds", restHelp, "devices", bucketsFast },
+    { "deconz_rest_request_seconds", restHelp, "config", bucketsFast },
+    { "deconz_rest_request_seconds", restHelp, "rules", bucketsFast },
+    { "deconz_rest_request_seconds", restHelp, "schedules", bucketsFast },
+    { "deconz_rest_request_seconds", restHelp, "scenes", bucketsFast },
+    { "deconz_rest_request_seconds", restHelp, "other", bucketsFast }
+};
+
+struct MET_HistogramData
+{
+    std::atomic<uint64_t> buckets[MET_MAX_BUCKETS + 1]; // not cumulative, last is +Inf
+    std::atomic<uint64_t> sumUs;
+};
+
+static std::atomic<uint64_t> counters[MET_CounterMax];
+static std::atomic<int64_t> gauges[MET_GaugeMax];
+static MET_HistogramData histograms[MET_HistogramMax];
+
+void MET_Add(MET_Counter counter, uint64_t n)
+{
+    counters[counter].fetch_add(n, std::memory_order_relaxed);
+}
+
+void MET_Set(MET_Gauge gauge, int64_t value)
+{
+    gauges[gauge].store(value, std::memory_order_relaxed);
+}
+
+void MET_ObserveUs(MET_Histogram hist, int64_t us)
+{
+    if (hist <= MET_HistogramNone || hist >= MET_HistogramMax)
+    {
+        return;
+    }
+
+    if (us < 0)
+    {
+        us = 0;
+    }
+
+    const int64_t *bounds = histDesc[hist].buckets;
+    int i = 0;
+    for (; i < MET_MAX_BUCKETS && bounds[i] != 0 && us > bounds[i]; i++)
+    { }
+
+    if (i < MET_MAX_BUCKETS && bounds[i] == 0)
+    {
+        i = MET_MAX_BUCKETS; // +Inf
+    }
+
+    histograms[hist].buckets[i].fetch_add(1, std::memory_order_relaxed);
+    histograms[hist].sumUs.fetch_add(uint64_t(us), std::memory_order_relaxed);
+}
+
+/*! Maps the REST API module of /api/<apikey>/<module> to its histogram.
+ */
+MET_Histogram MET_RestModuleHistogram(const char *module, size_t length)
+{
+    for (int h = MET_RestLights; h < MET_RestOther; h++)
+    {
+        const char *name = histDesc[h].module;
+        if (strlen(name) == length && memcmp(name, module, length) == 0)
+        {
+            return MET_Histogram(h);
+        }
+    }
+
+    return MET_RestOther;
+}
+
+uint64_t MET_CounterValue(MET_Counter counter)
+{
+    return counters[counter].load(std::memory_order_relaxed);
+}
+
+int64_t MET_GaugeValue(MET_Gauge gauge)
+{
+    return gauges[gauge].load(std::memory_order_relaxed);
+}
+
+uint64_t MET_HistogramCount(MET_Histogram hist)
+{
+    uint64_t count = 0;
+    for (const auto &bucket : histograms[hist].buckets)
+    {
+        count += bucket.load(std::memory_order_relaxed);
+    }
+    return count;
+}
+
+void MET_Reset()
+{
+    for (auto &c : counters) { c.store(0, std::memory_order_relaxed); }
+    for (auto &g : gauges) { g.store(0, std::memory_order_relaxed); }
+    for (auto &h : histograms)
+    {
+        for (auto &bucket : h.buckets) { bucket.store(0, std::memory_order_relaxed); }
+        h.sumUs.store(0, std::memory_order_relaxed);
+    }
+}
+
+static void writeHeader(std::string &out, const MET_Descriptor &desc, const char *type)
+{
+    out += "# HELP ";
+    out += desc.name;
+    out += ' ';
+    out += desc.help;
+    out += "\n# TYPE ";
+    out += desc.name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+/*! Appends all metrics in Prometheus text exposition format 0.0.4.
+ */
+void MET_WritePrometheus(std::string &out)
+{
+    char buf[160];
+
+    for (int i = 0; i < MET_CounterMax; i++)
+    {
+        writeHeader(out, counterDesc[i], "counter");
+        snprintf(buf, sizeof(buf), "%s %llu\n", counterDesc[i].name, (unsigned long long)counters[i].load(std::memory_order_relaxed));
+        out += buf;
+    }
+
+    for (int i = 0; i < MET_GaugeMax; i++)
+    {
+        writeHeader(out, gaugeDesc[i], "gauge");
+        snprintf(buf, sizeof(buf), "%s %lld\n", gaugeDesc[i].name, (long long)gauges[i].load(std::memory_order_relaxed));
+        out += buf;
+    }
+
+    for (int i = 0; i < MET_HistogramMax; i++)
+    {
+        const MET_Descriptor &desc = histDesc[i];
+        if (i == 0 || strcmp(histDesc[i - 1].name, desc.name) != 0)
+        {
+            writeHeader(out, desc, "histogram");
+        }
+
+        char label[48] = "";
+        char labelSep[48] = "";
+        if (desc.module)
+        {
+            snprintf(label, sizeof(label), "{module=\"%s\"}", desc.module);
+            snprintf(labelSep, sizeof(labelSep), "module=\"%s\",", desc.module);
+        }
+
+        // buckets are read once, so that +Inf and _count are consistent within a scrape
+        uint64_t cumulative = 0;
+        for (int b = 0; b < MET_MAX_BUCKETS + 1; b++)
+        {
+            const bool inf = b == MET_MAX_BUCKETS;
+            if (!inf && desc.buckets[b] == 0)
+            {
+                continue;
+            }
+
+            cumulative += histograms[i].buckets[b].load(std::memory_order_relaxed);
+            if (inf)
+            {
+                snprintf(buf, sizeof(buf), "%s_bucket{%sle=\"+Inf\"} %llu\n", desc.name, labelSep, (unsigned long long)cumulative);
+            }
+            else
+            {
+                snprintf(buf, sizeof(buf), "%s_bucket{%sle=\"%g\"} %llu\n", desc.name, labelSep, double(desc.buckets[b]) / 1e6, (unsigned long long)cumulative);
+            }
+            out += buf;
+        }
+
+        snprintf(buf, sizeof(buf), "%s_sum%s %.6f\n", desc.name, label, double(histograms[i].sumUs.load(std::memory_order_relaxed)) / 1e6);
+        out += buf;
+        snprintf(buf, sizeof(buf), "%s_count%s %llu\n", desc.name, label, (unsigned long long)cumulative);
+        out += buf;
+    }
+}
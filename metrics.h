@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*! Internal health metrics exported in Prometheus text format by GET /metrics.
+
+    The set of series is fixed at compile time to keep the cardinality low, there are no
+    per device or per resource labels. Updates are relaxed atomic operations, so the
+    metrics are always on and may be updated from worker threads.
+ */
+
+enum MET_Counter
+{
+    MET_EventsProcessed,
+    MET_WebsocketMessages,
+    MET_WebsocketBytesSent,
+    MET_CounterMax
+};
+
+enum MET_Gauge
+{
+    MET_EventQueueDepth,
+    MET_ApsTasksQueued,
+    MET_ApsTasksOnAir,
+    MET_ApsUnconfirmed,
+    MET_DbWriteQueueDepth,
+    MET_WebsocketClients,
+    MET_GaugeMax
+};
+
+enum MET_Histogram
+{
+    MET_HistogramNone = -1,
+    MET_EventProcessing,
+    MET_ApsConfirmLatency,
+    MET_DeviceTickCycle,
+    MET_DbTransaction,
+    MET_JsEval,
+    MET_EventLoopLatency,
+    // deconz_rest_request_seconds{module="..."}
+    MET_RestLights,
+    MET_RestGroups,
+    MET_RestSensors,
+    MET_RestDevices,
+    MET_RestConfig,
+    MET_RestRules,
+    MET_RestSchedules,
+    MET_RestScenes,
+    MET_RestOther,
+    MET_HistogramMax
+};
+
+void MET_Add(MET_Counter counter, uint64_t n = 1);
+void MET_Set(MET_Gauge gauge, int64_t value);
+void MET_ObserveUs(MET_Histogram hist, int64_t us);
+MET_Histogram MET_RestModuleHistogram(const char *module, size_t length);
+void MET_WritePrometheus(std::string &out);
+void MET_Reset();
+
+uint64_t MET_CounterValue(MET_Counter counter);
+int64_t MET_GaugeValue(MET_Gauge gauge);
+uint64_t MET_HistogramCount(MET_Histogram hist);
+
+/*! Observes the lifetime of the object in a histogram.
+ */
+class MET_ScopedTimer
+{
+public:
+    explicit MET_ScopedTimer(MET_Histogram hist) :
+        m_hist(hist),
+        m_start(std::chrono::steady_clock::now())
+    { }
+
+    ~MET_ScopedTimer()
+    {
+        if (m_hist != MET_HistogramNone)
+        {
+            MET_ObserveUs(m_hist, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start).count());
+        }
+    }
+
+    MET_ScopedTimer(const MET_ScopedTimer&) = delete;
+    MET_ScopedTimer &operator=(const MET_ScopedTimer&) = delete;
+
+    /*! The histogram might only be known after the request was parsed. */
+    void setHistogram(MET_Histogram hist) { m_hist = hist; }
+
+private:
+    MET_Histogram m_hist;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+#endif // METRICS_H
@@ -99,7 +99,7 @@ void DeRestPluginPrivate::handleOccupancySensingClusterIndication(const deCONZ::
                         {
                             // prevent setting presence back to false, when report.maxInterval > config.duration
                             // Add 3 seconds grace time for late reports
-                            sensor->durationDue = item->lastSet().addSecs(val.maxInterval + 3);
+                            setSensorDurationDue(sensor, item->lastSet().addSecs(val.maxInterval + 3));
                         }
                         else
                         {
@@ -107,7 +107,7 @@ void DeRestPluginPrivate::handleOccupancySensingClusterIndication(const deCONZ::
                             if (item2 && item2->toNumber() > 0)
                             {
                                 // If occupied state is not reportable, add duration seconds after a occupied = true to automatically set to false
-                                sensor->durationDue = item->lastSet().addSecs(item2->toNumber());
+                                setSensorDurationDue(sensor, item->lastSet().addSecs(item2->toNumber()));
                             }
                         }
                     }
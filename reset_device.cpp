@@ -39,8 +39,8 @@ void DeRestPluginPrivate::checkResetState()
         return;
     }
 
-    std::vector<LightNode>::iterator i = nodes.begin();
-    std::vector<LightNode>::iterator end = nodes.end();
+    SlabVector<LightNode>::iterator i = nodes.begin();
+    SlabVector<LightNode>::iterator end = nodes.end();
 
     for (; i != end; ++i)
     {
@@ -110,8 +110,8 @@ void DeRestPluginPrivate::checkResetState()
     }
 
     const auto now = QDateTime::currentDateTime();
-    std::vector<Sensor>::iterator si = sensors.begin();
-    std::vector<Sensor>::iterator si_end = sensors.end();
+    SlabVector<Sensor>::iterator si = sensors.begin();
+    SlabVector<Sensor>::iterator si_end = sensors.end();
 
     for (; si != si_end; ++si)
     {
@@ -231,8 +231,8 @@ void DeRestPluginPrivate::handleMgmtLeaveRspIndication(const deCONZ::ApsDataIndi
         if (status == deCONZ::ZdpSuccess || status == deCONZ::ZdpNotSupported)
         {
             // set retryCount and isAvailable for all endpoints of that device
-            std::vector<LightNode>::iterator i;
-            std::vector<LightNode>::iterator end = nodes.end();
+            SlabVector<LightNode>::iterator i;
+            SlabVector<LightNode>::iterator end = nodes.end();
 
             for (i = nodes.begin(); i != end; ++i)
             {
@@ -246,8 +246,8 @@ void DeRestPluginPrivate::handleMgmtLeaveRspIndication(const deCONZ::ApsDataIndi
                 }
             }
 
-            std::vector<Sensor>::iterator s;
-            std::vector<Sensor>::iterator send = sensors.end();
+            SlabVector<Sensor>::iterator s;
+            SlabVector<Sensor>::iterator send = sensors.end();
 
             for (s = sensors.begin(); s != send; ++s)
             {
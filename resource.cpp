@@ -14,6 +14,7 @@
 #include <deconz/dbg_trace.h>
 #include <deconz/u_time.h>
 #include <utils/stringcache.h>
+#include "memory_stats.h"
 #include "resource.h"
 
 const char *RAlarmSystems = "/alarmsystems";
@@ -37,6 +38,7 @@ const char *REventDeleted = "event/deleted";
 const char *REventDeviceAlarm = "event/devicealarm";
 const char *REventDeviceAnnounce = "event/device.anounce";
 const char *REventNodeDescriptor = "event/node.descriptor";
+const char *REventOtauBlock = "event/otau.block";
 const char *REventPermitjoinDisabled = "event/permit.join.disabled";
 const char *REventPermitjoinEnabled = "event/permit.join.enabled";
 const char *REventPermitjoinRunning = "event/permit.join.running";
@@ -1593,6 +1595,19 @@ void ResourceItem::setIsPublic(bool isPublic)
     m_isPublic = isPublic;
 }
 
+/*! Heap memory owned by the item, the item itself lives in the resource. */
+size_t ResourceItem::memoryUsage() const
+{
+    size_t bytes = MEM_VectorBytes(m_rulesInvolved);
+
+    if (m_str)
+    {
+        bytes += MEM_HeapBytes(sizeof(QString)) + MEM_SharedArrayBytes(size_t(m_str->capacity()), sizeof(QChar));
+    }
+
+    return bytes;
+}
+
 /*! Initial main constructor. */
 Resource::Resource(const char *prefix) :
     m_prefix(prefix)
@@ -1833,6 +1848,19 @@ int Resource::itemCount() const
     return m_rItems.size();
 }
 
+/*! Heap memory of the resource items and pending state changes. */
+size_t Resource::memoryUsage() const
+{
+    size_t bytes = MEM_VectorBytes(m_rItems) + MEM_VectorBytes(m_stateChanges);
+
+    for (const ResourceItem &item : m_rItems)
+    {
+        bytes += item.memoryUsage();
+    }
+
+    return bytes;
+}
+
 ResourceItem *Resource::itemForIndex(size_t idx)
 {
     if (idx < m_rItems.size())
@@ -79,6 +79,7 @@ extern const char *REventDDFInitResponse;
 extern const char *REventValidGroup;
 extern const char *REventCheckGroupAnyOn;
 extern const char *REventNodeDescriptor;
+extern const char *REventOtauBlock;
 extern const char *REventActiveEndpoints;
 extern const char *REventSimpleDescriptor;
 extern const char *REventStartTimer;
@@ -529,6 +530,7 @@ public:
     ValueSource valueSource() const { return m_valueSource; }
     void setDdfItemHandle(quint32 handle) { m_ddfItemHandle = handle; }
     quint32 ddfItemHandle() const { return m_ddfItemHandle; }
+    size_t memoryUsage() const;
 
 private:
     ResourceItem() = delete;
@@ -590,6 +592,7 @@ public:
         // 'S' Sensor
         char type = 0;
         quint8 order = 0;
+        quint16 generation = 0; // slot generation in SlabVector container
     };
 
     Resource(const char *prefix);
@@ -613,6 +616,7 @@ public:
     bool setValue(const char *suffix, const QVariant &val, bool forceUpdate = false);
     int itemCount() const;
     ResourceItem *itemForIndex(size_t idx);
+    size_t memoryUsage() const;
     const ResourceItem *itemForIndex(size_t idx) const;
     void addStateChange(const StateChange &stateChange);
     std::vector<StateChange> &stateChanges() { return m_stateChanges; }
@@ -481,7 +481,7 @@ static int putAlarmSystemArmMode(const ApiRequest &req, ApiResponse &rsp, AlarmS
 
     const QString code0 = map.value(QLatin1String("code0")).toString();
 
-    if (!alarmSys->isValidCode(code0, 0))
+    if (!alarmSys->isValidCode(code0, 0, AUTH_RateLimitSource(req)))
     {
         rsp.list.append(errInvalidValue(id, "attr/code0", code0)); // use attr/ since this gets stripped away
         rsp.httpStatus = HttpStatusBadRequest;
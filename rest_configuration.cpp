@@ -30,7 +30,13 @@
 #include "backup.h"
 #include "crypto/password.h"
 #include "crypto/random.h"
+#include "database.h"
 #include "gateway.h"
+#include "device_descriptions.h"
+#include "device_js/device_js.h"
+#include "utils/stringcache.h"
+#include "stall_detector.h"
+#include "startup_profile.h"
 #include "utils/utils.h"
 #ifdef Q_OS_LINUX
   #include <unistd.h>
@@ -768,6 +774,11 @@ int DeRestPluginPrivate::handleConfigFullApi(const ApiRequest &req, ApiResponse
     {
         return deleteUser(req, rsp);
     }
+    // POST /api/<apikey>/config/whitelist/prune
+    else if ((req.path.size() == 5) && (req.hdr.method() == "POST") && (req.path[2] == "config") && (req.path[3] == "whitelist") && (req.path[4] == "prune"))
+    {
+        return pruneUsers(req, rsp);
+    }
     // POST /api/<apikey>/config/update
     else if ((req.path.size() == 4) && (req.hdr.method() == "POST") && (req.path[2] == "config") && (req.path[3] == "update"))
     {
@@ -798,6 +809,11 @@ int DeRestPluginPrivate::handleConfigFullApi(const ApiRequest &req, ApiResponse
     {
         return exportConfig(req, rsp);
     }
+    // GET /api/<apikey>/config/export
+    else if ((req.path.size() == 4) && (req.hdr.method() == "GET") && (req.path[2] == "config") && (req.path[3] == "export"))
+    {
+        return getExportStatus(req, rsp);
+    }
     // POST /api/<apikey>/config/import
     else if ((req.path.size() == 4) && (req.hdr.method() == "POST") && (req.path[2] == "config") && (req.path[3] == "import"))
     {
@@ -818,6 +834,21 @@ int DeRestPluginPrivate::handleConfigFullApi(const ApiRequest &req, ApiResponse
     {
         return changePassword(req, rsp);
     }
+    // GET /api/<apikey>/config/stalls
+    else if ((req.path.size() == 4) && (req.hdr.method() == "GET") && (req.path[2] == "config") && (req.path[3] == "stalls"))
+    {
+        return getStalls(req, rsp);
+    }
+    // GET /api/<apikey>/config/memory
+    else if ((req.path.size() == 4) && (req.hdr.method() == "GET") && (req.path[2] == "config") && (req.path[3] == "memory"))
+    {
+        return getMemoryUsage(req, rsp);
+    }
+    // GET /api/<apikey>/config/startup
+    else if ((req.path.size() == 4) && (req.hdr.method() == "GET") && (req.path[2] == "config") && (req.path[3] == "startup"))
+    {
+        return getStartupTimings(req, rsp);
+    }
 
     return REQ_NOT_HANDLED;
 }
@@ -882,17 +913,7 @@ int DeRestPluginPrivate::createUser(const ApiRequest &req, ApiResponse &rsp)
         auth.apikey = map["username"].toString();
 
         // check if this apikey is already known
-        std::vector<ApiAuth>::const_iterator i = apiAuths.begin();
-        std::vector<ApiAuth>::const_iterator end = apiAuths.end();
-
-        for (; i != end; ++i)
-        {
-            if (auth.apikey == i->apikey && i->state == ApiAuth::StateNormal)
-            {
-                found = true;
-                break;
-            }
-        }
+        found = apiAuthIndex.find(apiAuths, auth.apikey) >= 0;
     }
     else
     {
@@ -939,6 +960,7 @@ int DeRestPluginPrivate::createUser(const ApiRequest &req, ApiResponse &rsp)
         auth.lastUseDate = QDateTime::currentDateTimeUtc();
         auth.needSaveDatabase = true;
         apiAuths.push_back(auth);
+        apiAuthIndex.invalidate();
         queSaveDb(DB_AUTH, DB_SHORT_SAVE_DELAY);
         updateEtag(gwConfigEtag);
         DBG_Printf(DBG_INFO, "created username: %s, devicetype: %s\n", qPrintable(auth.apikey), qPrintable(auth.devicetype));
@@ -973,6 +995,8 @@ void DeRestPluginPrivate::configToMap(const ApiRequest &req, QVariantMap &map)
     map["ipaddress"] = gwIPAddress;
     map["netmask"] = gwNetMask;
 
+    API_FlushLastUse(apiAuths, deCONZ::steadyTimeRef().ref, QDateTime::currentDateTimeUtc());
+
     std::vector<ApiAuth>::const_iterator i = apiAuths.begin();
     std::vector<ApiAuth>::const_iterator end = apiAuths.end();
     for (; i != end; ++i)
@@ -1221,8 +1245,8 @@ int DeRestPluginPrivate::getFullState(const ApiRequest &req, ApiResponse &rsp)
 
     // lights
     {
-        std::vector<LightNode>::iterator i = nodes.begin();
-        std::vector<LightNode>::iterator end = nodes.end();
+        SlabVector<LightNode>::iterator i = nodes.begin();
+        SlabVector<LightNode>::iterator end = nodes.end();
 
         for (; i != end; ++i)
         {
@@ -1280,8 +1304,8 @@ int DeRestPluginPrivate::getFullState(const ApiRequest &req, ApiResponse &rsp)
 
     // sensors
     {
-        std::vector<Sensor>::iterator i = sensors.begin();
-        std::vector<Sensor>::iterator end = sensors.end();
+        SlabVector<Sensor>::iterator i = sensors.begin();
+        SlabVector<Sensor>::iterator end = sensors.end();
 
         for (; i != end; ++i)
         {
@@ -2317,28 +2341,26 @@ int DeRestPluginPrivate::deleteUser(const ApiRequest &req, ApiResponse &rsp)
 {
     QString username2 = req.path[4];
 
-    std::vector<ApiAuth>::iterator i = apiAuths.begin();
-    std::vector<ApiAuth>::iterator end = apiAuths.end();
-
     // TODO compare error not found on hue bridge
 
-    for (; i != end; ++i)
+    const int pos = apiAuthIndex.find(apiAuths, username2);
+
+    if (pos >= 0)
     {
-        if (username2 == i->apikey && i->state == ApiAuth::StateNormal)
-        {
-            i->needSaveDatabase = true;
-            i->state = ApiAuth::StateDeleted;
-            queSaveDb(DB_AUTH, DB_LONG_SAVE_DELAY);
+        ApiAuth &auth = apiAuths[size_t(pos)];
+        auth.needSaveDatabase = true;
+        auth.state = ApiAuth::StateDeleted;
+        apiAuthIndex.invalidate();
+        queSaveDb(DB_AUTH, DB_LONG_SAVE_DELAY);
 
-            QVariantMap rspItem;
-            rspItem["success"] = QString("/config/whitelist/%1 deleted.").arg(username2);
-            rsp.list.append(rspItem);
-            rsp.httpStatus = HttpStatusOk;
+        QVariantMap rspItem;
+        rspItem["success"] = QString("/config/whitelist/%1 deleted.").arg(username2);
+        rsp.list.append(rspItem);
+        rsp.httpStatus = HttpStatusOk;
 
-            updateEtag(gwConfigEtag);
+        updateEtag(gwConfigEtag);
 
-            return REQ_READY_SEND;
-        }
+        return REQ_READY_SEND;
     }
 
     rsp.str = "[]"; // empty
@@ -2346,6 +2368,79 @@ int DeRestPluginPrivate::deleteUser(const ApiRequest &req, ApiResponse &rsp)
     return REQ_READY_SEND;
 }
 
+/*! POST /api/<apikey>/config/whitelist/prune
+    Deletes all API keys which haven't been used for "days" days, except the one of the request.
+    The whitelist is processed in small steps to not block the event loop.
+    \return REQ_READY_SEND
+ */
+int DeRestPluginPrivate::pruneUsers(const ApiRequest &req, ApiResponse &rsp)
+{
+    bool ok;
+    QVariant var = Json::parse(req.content, ok);
+    QVariantMap map = var.toMap();
+
+    if (!ok || map.isEmpty())
+    {
+        rsp.httpStatus = HttpStatusBadRequest;
+        rsp.list.append(errorToMap(ERR_INVALID_JSON, QLatin1String("/config/whitelist/prune"), QLatin1String("body contains invalid JSON")));
+        return REQ_READY_SEND;
+    }
+
+    const int days = map.value(QLatin1String("days")).toInt(&ok);
+
+    if (!ok || days < 1)
+    {
+        rsp.httpStatus = HttpStatusBadRequest;
+        rsp.list.append(errorToMap(ERR_INVALID_VALUE, QLatin1String("/config/whitelist/prune"), QString("invalid value, %1, for parameter, days").arg(map.value(QLatin1String("days")).toString())));
+        return REQ_READY_SEND;
+    }
+
+    const bool running = apiAuthPrune.active;
+
+    // last use times must be up to date before comparing
+    API_FlushLastUse(apiAuths, deCONZ::steadyTimeRef().ref, QDateTime::currentDateTimeUtc());
+
+    apiAuthPrune.active = true;
+    apiAuthPrune.cursor = 0;
+    apiAuthPrune.threshold = QDateTime::currentDateTimeUtc().addDays(-days);
+    apiAuthPrune.keepApikey = req.apikey();
+    apiAuthPrune.pruned = 0;
+
+    if (!running)
+    {
+        QTimer::singleShot(0, this, &DeRestPluginPrivate::pruneUsersStep);
+    }
+
+    QVariantMap rspItem;
+    QVariantMap rspItemState;
+    rspItemState[QLatin1String("/config/whitelist/prune")] = QLatin1String("started");
+    rspItem[QLatin1String("success")] = rspItemState;
+    rsp.list.append(rspItem);
+    rsp.httpStatus = HttpStatusOk;
+
+    return REQ_READY_SEND;
+}
+
+/*! Processes a chunk of the whitelist prune started by pruneUsers().
+ */
+void DeRestPluginPrivate::pruneUsersStep()
+{
+    if (API_PruneStep(apiAuths, apiAuthPrune, 50))
+    {
+        QTimer::singleShot(0, this, &DeRestPluginPrivate::pruneUsersStep);
+        return;
+    }
+
+    DBG_Printf(DBG_INFO, "pruned %d unused API keys\n", apiAuthPrune.pruned);
+
+    if (apiAuthPrune.pruned > 0)
+    {
+        apiAuthIndex.invalidate();
+        queSaveDb(DB_AUTH, DB_SHORT_SAVE_DELAY);
+        updateEtag(gwConfigEtag);
+    }
+}
+
 /*! POST /api/<apikey>/config/update
     \return REQ_READY_SEND
             REQ_NOT_HANDLED
@@ -2479,12 +2574,27 @@ int DeRestPluginPrivate::updateFirmware(const ApiRequest &req, ApiResponse &rsp)
 }
 
 /*! POST /api/<apikey>/config/export
+
+    Writes deCONZ.tar.gz and answers "success" once it is complete, clients download
+    the archive right after this request. The database stays open and is copied
+    into a consistent snapshot.
+
+    With the body {"async": true} the export runs in background and the answer is "started",
+    the progress can be queried via GET /config/export until the state is "done".
+    A previous deCONZ.tar.gz is kept until the new archive replaces it.
     \return REQ_READY_SEND
             REQ_NOT_HANDLED
  */
 int DeRestPluginPrivate::exportConfig(const ApiRequest &req, ApiResponse &rsp)
 {
-    Q_UNUSED(req)
+    bool async = false;
+
+    if (!req.content.isEmpty())
+    {
+        bool ok;
+        const QVariantMap map = Json::parse(req.content, ok).toMap();
+        async = ok && map.value(QLatin1String("async")).toBool();
+    }
 
     if (!isInNetwork())
     {
@@ -2493,22 +2603,25 @@ int DeRestPluginPrivate::exportConfig(const ApiRequest &req, ApiResponse &rsp)
         return REQ_READY_SEND;
     }
 
-    ttlDataBaseConnection = 0;
-    closeDb();
-
-    if (dbIsOpen())
+    // flush pending changes so that the snapshot is up to date,
+    // the connection stays open until the snapshot is done
+    openDb();
+    if (saveDatabaseItems != 0)
     {
-        DBG_Printf(DBG_ERROR, "backup: failed to export - database busy\n");
-        rsp.httpStatus = HttpStatusServiceUnavailable;
-        return REQ_READY_SEND;
+        saveDb();
     }
 
-    if (BAK_ExportConfiguration(deCONZ::ApsController::instance()))
+    // a running export is completed for a synchronous request
+    const BAK_ExportState state = BAK_GetExportStatus().state;
+    const bool running = state == BAK_ExportSnapshot || state == BAK_ExportArchive;
+
+    if ((running || BAK_ExportConfiguration(deCONZ::ApsController::instance(), DB_Connection())) &&
+        (async || BAK_FinishExport()))
     {
         rsp.httpStatus = HttpStatusOk;
         QVariantMap rspItem;
         QVariantMap rspItemState;
-        rspItemState["/config/export"] = "success";
+        rspItemState["/config/export"] = async ? "started" : "success";
         rspItem["success"] = rspItemState;
         rsp.list.append(rspItem);
     }
@@ -2520,6 +2633,25 @@ int DeRestPluginPrivate::exportConfig(const ApiRequest &req, ApiResponse &rsp)
     return REQ_READY_SEND;
 }
 
+/*! GET /api/<apikey>/config/export
+    \return REQ_READY_SEND
+            REQ_NOT_HANDLED
+ */
+int DeRestPluginPrivate::getExportStatus(const ApiRequest &req, ApiResponse &rsp)
+{
+    Q_UNUSED(req)
+
+    const BAK_ExportStatus status = BAK_GetExportStatus();
+
+    rsp.map["state"] = QLatin1String(BAK_ExportStateToString(status.state));
+    rsp.map["progress"] = status.progress;
+    rsp.map["size"] = double(status.bytesWritten);
+    rsp.map["duration"] = double(status.duration);
+    rsp.httpStatus = HttpStatusOk;
+
+    return REQ_READY_SEND;
+}
+
 /*! POST /api/<apikey>/config/import
     \return REQ_READY_SEND
             REQ_NOT_HANDLED
@@ -2862,6 +2994,180 @@ int DeRestPluginPrivate::getWifiState(const ApiRequest &req, ApiResponse &rsp)
     return REQ_READY_SEND;
 }
 
+/*! GET /api/<apikey>/config/stalls
+    Returns the worst event loop stalls, see stall_detector.h.
+    \return REQ_READY_SEND
+ */
+int DeRestPluginPrivate::getStalls(const ApiRequest &req, ApiResponse &rsp)
+{
+    Q_UNUSED(req)
+
+    std::vector<SD_Stall> stalls;
+    SD_GetStalls(stalls);
+    const SD_Stats stats = SD_GetStats();
+
+    QVariantList list;
+    for (const SD_Stall &stall : stalls)
+    {
+        QVariantMap item;
+        QStringList path;
+        for (const SD_Handler handler : stall.path)
+        {
+            if (handler == SD_HandlerNone)
+            {
+                break;
+            }
+            path.append(QLatin1String(SD_HandlerName(handler)));
+        }
+
+        item[QLatin1String("duration")] = double(stall.durationUs / 1000); // ms
+        item[QLatin1String("handler")] = path.isEmpty() ? QLatin1String("unknown") : path.last();
+        item[QLatin1String("path")] = path;
+        item[QLatin1String("time")] = QDateTime::fromMSecsSinceEpoch(stall.timestamp, Qt::UTC).toString(QLatin1String("yyyy-MM-ddTHH:mm:ss")); // ISO 8601
+        list.append(item);
+    }
+
+    rsp.map[QLatin1String("threshold")] = double(stats.thresholdUs / 1000);
+    rsp.map[QLatin1String("maxlatency")] = double(stats.maxLatencyUs / 1000);
+    rsp.map[QLatin1String("count")] = double(stats.stalls);
+    rsp.map[QLatin1String("stalls")] = list;
+    rsp.httpStatus = HttpStatusOk;
+
+    return REQ_READY_SEND;
+}
+
+/*! Estimates the memory of the major subsystems, see memory_stats.h.
+ */
+void DeRestPluginPrivate::collectMemoryUsage(MEM_Report &report)
+{
+    for (const LightNode &l : nodes)
+    {
+        report.add(MEM_ResourceItems, l.memoryUsage(), size_t(l.itemCount()));
+    }
+
+    for (const Sensor &s : sensors)
+    {
+        report.add(MEM_ResourceItems, s.memoryUsage(), size_t(s.itemCount()));
+    }
+
+    for (const auto &device : m_devices)
+    {
+        report.add(MEM_ResourceItems, device->memoryUsage(), size_t(device->itemCount()));
+    }
+
+    unsigned atoms = 0;
+    const unsigned long atomBytes = StringCacheMemoryUsage(&atoms);
+    report.add(MEM_AtomTable, atomBytes, atoms);
+
+    if (deviceDescriptions)
+    {
+        deviceDescriptions->memoryUsage(report);
+    }
+
+    if (deviceJs)
+    {
+        report.add(MEM_DuktapeArena, deviceJs->memoryUsage());
+    }
+
+    if (eventEmitter)
+    {
+        eventEmitter->memoryUsage(report);
+    }
+
+    if (webSocketServer)
+    {
+        webSocketServer->memoryUsage(report);
+    }
+
+    // mostly zcl_values inserts between two database saves
+    size_t dbQueueBytes = MEM_VectorBytes(dbQueryQueue);
+    for (const QString &sql : dbQueryQueue)
+    {
+        dbQueueBytes += MEM_SharedArrayBytes(size_t(sql.capacity()), sizeof(QChar));
+    }
+    report.add(MEM_DbQueryQueue, dbQueueBytes, dbQueryQueue.size());
+
+    report.add(MEM_Groups, MEM_VectorBytes(groups), 0);
+    for (const Group &group : groups)
+    {
+        report.add(MEM_Groups, group.memoryUsage() + MEM_SharedArrayBytes(size_t(group.name().capacity()), sizeof(QChar)));
+
+        report.add(MEM_Scenes, MEM_VectorBytes(group.scenes), group.scenes.size());
+        for (const Scene &scene : group.scenes)
+        {
+            report.add(MEM_Scenes, MEM_VectorBytes(scene.lights()) + MEM_SharedArrayBytes(size_t(scene.name.capacity()), sizeof(QChar)), 0);
+        }
+    }
+}
+
+/*! GET /api/<apikey>/config/memory
+    Returns the estimated memory per subsystem and its growth per day.
+    \return REQ_READY_SEND
+ */
+int DeRestPluginPrivate::getMemoryUsage(const ApiRequest &req, ApiResponse &rsp)
+{
+    Q_UNUSED(req)
+
+    MEM_Report report;
+    collectMemoryUsage(report);
+
+    QVariantMap categories;
+    for (int i = 0; i < MEM_CategoryMax; i++)
+    {
+        const MEM_Category category = MEM_Category(i);
+        QVariantMap item;
+        item[QLatin1String("bytes")] = double(report.usage[i].bytes);
+        item[QLatin1String("count")] = double(report.usage[i].count);
+        item[QLatin1String("growthperday")] = double(memoryHistory.growthPerDay(category));
+        categories[QLatin1String(MEM_CategoryName(category))] = item;
+    }
+
+    rsp.map[QLatin1String("categories")] = categories;
+    rsp.map[QLatin1String("total")] = double(report.totalBytes());
+    rsp.map[QLatin1String("rss")] = double(MEM_ProcessResidentBytes());
+    rsp.map[QLatin1String("samples")] = double(memoryHistory.size());
+    rsp.httpStatus = HttpStatusOk;
+
+    return REQ_READY_SEND;
+}
+
+/*! GET /api/<apikey>/config/startup
+    Returns the cold-start phase timings in milliseconds, see startup_profile.h.
+    Phases which weren't reached yet are omitted.
+    \return REQ_READY_SEND
+ */
+int DeRestPluginPrivate::getStartupTimings(const ApiRequest &req, ApiResponse &rsp)
+{
+    Q_UNUSED(req)
+
+    QVariantMap phases;
+    for (int i = 0; i < SP_PhaseMax; i++)
+    {
+        const SP_Phase phase = SP_Phase(i);
+        const SP_Timing timing = SP_GetTiming(phase);
+
+        if (timing.startUs < 0)
+        {
+            continue;
+        }
+
+        QVariantMap item;
+        item[QLatin1String("start")] = double(timing.startUs) / 1000;
+        if (!SP_IsMilestone(phase))
+        {
+            item[QLatin1String("duration")] = double(timing.durationUs) / 1000;
+            item[QLatin1String("count")] = double(timing.count);
+        }
+        phases[QLatin1String(SP_PhaseName(phase))] = item;
+    }
+
+    rsp.map[QLatin1String("phases")] = phases;
+    rsp.map[QLatin1String("uptime")] = double(SP_ElapsedUs() / 1000);
+    rsp.httpStatus = HttpStatusOk;
+
+    return REQ_READY_SEND;
+}
+
 /*! PUT /api/config/wifi
     \return REQ_READY_SEND
             REQ_NOT_HANDLED
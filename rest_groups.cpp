@@ -632,8 +632,8 @@ int DeRestPluginPrivate::setGroupAttributes(const ApiRequest &req, ApiResponse &
 
             // for each node which are currently in the group but not in the list send a remove group command (unicast)
             // note: nodes which are currently switched off will not be removed from the group
-            std::vector<LightNode>::iterator j = nodes.begin();
-            std::vector<LightNode>::iterator jend = nodes.end();
+            SlabVector<LightNode>::iterator j = nodes.begin();
+            SlabVector<LightNode>::iterator jend = nodes.end();
             for (; j != jend; ++j)
             {
                 if (lids.contains(j->id()))
@@ -869,8 +869,8 @@ int DeRestPluginPrivate::setGroupState(const ApiRequest &req, ApiResponse &rsp)
                 addTaskSetColorLoop(task, false, 15);
                 group->setColorLoopActive(false); // deactivate colorloop if active
             }
-            std::vector<LightNode>::iterator i = nodes.begin();
-            std::vector<LightNode>::iterator end = nodes.end();
+            SlabVector<LightNode>::iterator i = nodes.begin();
+            SlabVector<LightNode>::iterator end = nodes.end();
 
             for (; i != end; ++i)
             {
@@ -1285,8 +1285,8 @@ int DeRestPluginPrivate::setGroupState(const ApiRequest &req, ApiResponse &rsp)
         int briInc = map["bri_inc"].toInt(&ok);
         if (hasWrap && map["wrap"].type() == QVariant::Bool && map["wrap"].toBool() == true)
         {
-            std::vector<LightNode>::iterator i = nodes.begin();
-            std::vector<LightNode>::iterator end = nodes.end();
+            SlabVector<LightNode>::iterator i = nodes.begin();
+            SlabVector<LightNode>::iterator end = nodes.end();
 
             // Find the highest and lowest brightness lights
             int hiBri = -1, loBri = 255;
@@ -1476,8 +1476,8 @@ int DeRestPluginPrivate::setGroupState(const ApiRequest &req, ApiResponse &rsp)
                     if (ok && (map["colorloopspeed"].type() == QVariant::Double) && (speed < 256) && (speed > 0))
                     {
                         // ok
-                        std::vector<LightNode>::iterator i = nodes.begin();
-                        std::vector<LightNode>::iterator end = nodes.end();
+                        SlabVector<LightNode>::iterator i = nodes.begin();
+                        SlabVector<LightNode>::iterator end = nodes.end();
 
                         for (; i != end; ++i)
                         {
@@ -1519,8 +1519,8 @@ int DeRestPluginPrivate::setGroupState(const ApiRequest &req, ApiResponse &rsp)
     }
 
     { // update lights state
-        std::vector<LightNode>::iterator i = nodes.begin();
-        std::vector<LightNode>::iterator end = nodes.end();
+        SlabVector<LightNode>::iterator i = nodes.begin();
+        SlabVector<LightNode>::iterator end = nodes.end();
 
         for (; i != end; ++i)
         {
@@ -1784,8 +1784,8 @@ int DeRestPluginPrivate::deleteGroup(const ApiRequest &req, ApiResponse &rsp)
 
     // for each node which is part of this group send a remove group request (will be unicast)
     // note: nodes which are curently switched off will not be removed!
-    std::vector<LightNode>::iterator i = nodes.begin();
-    std::vector<LightNode>::iterator end = nodes.end();
+    SlabVector<LightNode>::iterator i = nodes.begin();
+    SlabVector<LightNode>::iterator end = nodes.end();
 
     for (; i != end; ++i)
     {
@@ -1936,8 +1936,8 @@ bool DeRestPluginPrivate::groupToMap(const ApiRequest &req, const Group *group,
 
     // append lights which are known members in this group
     QVariantList lights;
-    std::vector<LightNode>::const_iterator i = nodes.begin();
-    std::vector<LightNode>::const_iterator end = nodes.end();
+    SlabVector<LightNode>::const_iterator i = nodes.begin();
+    SlabVector<LightNode>::const_iterator end = nodes.end();
 
     for (; i != end; ++i)
     {
@@ -2144,8 +2144,8 @@ int DeRestPluginPrivate::createScene(const ApiRequest &req, ApiResponse &rsp)
         scene.name = tr("Scene %1").arg(scene.id);
     }
 
-    std::vector<LightNode>::iterator ni = nodes.begin();
-    std::vector<LightNode>::iterator nend = nodes.end();
+    SlabVector<LightNode>::iterator ni = nodes.begin();
+    SlabVector<LightNode>::iterator nend = nodes.end();
     for (; ni != nend; ++ni)
     {
         LightNode *lightNode = &(*ni);
@@ -2161,6 +2161,7 @@ int DeRestPluginPrivate::createScene(const ApiRequest &req, ApiResponse &rsp)
 
             LightState state;
             state.setLightId(lightNode->id());
+            state.setLightHandle(lightNode->handle());
             state.setTransitionTime(10);
             ResourceItem *item = lightNode->item(RStateOn);
             DBG_Assert(item != 0);
@@ -2552,8 +2553,8 @@ int DeRestPluginPrivate::storeScene(const ApiRequest &req, ApiResponse &rsp)
     }
 
     // search for lights that have their scenes capacity reached or need to be updated
-    std::vector<LightNode>::iterator ni = nodes.begin();
-    std::vector<LightNode>::iterator nend = nodes.end();
+    SlabVector<LightNode>::iterator ni = nodes.begin();
+    SlabVector<LightNode>::iterator nend = nodes.end();
     for (; ni != nend; ++ni)
     {
         LightNode *lightNode = &*ni;
@@ -2574,6 +2575,7 @@ int DeRestPluginPrivate::storeScene(const ApiRequest &req, ApiResponse &rsp)
         {
             LightState lsnew;
             lsnew.setLightId(lightNode->id());
+            lsnew.setLightHandle(lightNode->handle());
 
             /*if (lightNode->sceneCapacity() <= 0)
             {
@@ -2734,26 +2736,67 @@ static void gledoptoSetColorTemperatureInSceneHack(DeRestPluginPrivate *d, Light
     d->addTaskSetColorTemperature(task, static_cast<double>(lightNode->item(RStateCt)->toNumber()));
 }
 
+/*! Returns the LightNode of a scene member.
+    The resolved handle is kept in \p ls, so the id lookup is only done when the handle
+    isn't set yet or the light was moved to another slot.
+ */
+static LightNode *recallSceneLightNode(DeRestPluginPrivate *d, LightState &ls)
+{
+    const Resource::Handle hnd = ls.lightHandle();
+    if (isValid(hnd) && hnd.type == 'l')
+    {
+        Resource *r = DEV_GetResource(hnd);
+        if (r)
+        {
+            return static_cast<LightNode*>(r);
+        }
+    }
+
+    LightNode *lightNode = d->getLightNodeForId(ls.lid());
+    ls.setLightHandle(lightNode ? lightNode->handle() : Resource::Handle{});
+    return lightNode;
+}
+
+/*! Sets the predicted scene value of \p item.
+    The first changed item of a light is remembered in \p first to emit one event per light,
+    other items only get their own event when rules depend on them.
+    \return true if the value has changed
+ */
+static bool recallSceneSetItem(LightNode *lightNode, ResourceItem *item, qint64 val, ResourceItem **first)
+{
+    if (!item || item->toNumber() == val)
+    {
+        return false;
+    }
+
+    item->setValue(val);
+
+    if (!*first)
+    {
+        *first = item;
+    }
+    else if (!item->rulesInvolved().empty())
+    {
+        enqueueEvent(Event(RLights, item->descriptor().suffix, lightNode->id(), item));
+    }
+
+    return true;
+}
+
 /*! Checks the lights states in a scene:
     - Creates unicast tasks for colorloop turn on/off
     - Creates unicast tasks for IKEA lights which are off in a scene -> hack.
     - Sets group.on according to the light states
+    The predicted light states are set at once and published with one event per light.
 */
 static void recallSceneCheckGroupChanges(DeRestPluginPrivate *d, Group *group, Scene *scene)
 {
     bool groupOn = false;
-    bool groupOnChanged = false;
-    bool groupBriChanged = false;
-    bool groupHueSatChanged = false;
-    bool groupCtChanged = false;
-    bool groupColorModeChanged = false;
+    bool groupChanged = false;
 
-    auto ls = scene->lights().cbegin();
-    const auto lsend = scene->lights().cend();
-
-    for (; ls != lsend; ++ls)
+    for (LightState &ls : scene->lights())
     {
-        LightNode *lightNode = d->getLightNodeForId(ls->lid());
+        LightNode *lightNode = recallSceneLightNode(d, ls);
 
         if (!lightNode || lightNode->state() != LightNode::StateNormal || !lightNode->isAvailable())
         {
@@ -2761,8 +2804,9 @@ static void recallSceneCheckGroupChanges(DeRestPluginPrivate *d, Group *group, S
         }
 
         bool changed = false;
+        ResourceItem *first = nullptr;
 
-        if (ls->on())
+        if (ls.on())
         {
             groupOn = true;
         }
@@ -2771,7 +2815,7 @@ static void recallSceneCheckGroupChanges(DeRestPluginPrivate *d, Group *group, S
         {
             lightNode->removeStateChangesForItem(RStateOn);
 
-            if (!ls->on())
+            if (!ls.on())
             {
                 ikeaTurnLightOffInSceneHack(d, lightNode);
             }
@@ -2779,7 +2823,7 @@ static void recallSceneCheckGroupChanges(DeRestPluginPrivate *d, Group *group, S
 
         {
             const bool supportsColorLoop = lightNode->supportsColorLoop();
-            const bool colorLoopActive = ls->on() && supportsColorLoop && ls->colorloopActive();
+            const bool colorLoopActive = ls.on() && supportsColorLoop && ls.colorloopActive();
             if (supportsColorLoop && lightNode->isColorLoopActive() != colorLoopActive)
             {
                 // this is called in rare cases to turn colorloop on/off for supported lights
@@ -2795,107 +2839,90 @@ static void recallSceneCheckGroupChanges(DeRestPluginPrivate *d, Group *group, S
 
                 if (lightNode->isColorLoopActive())
                 {
-                    lightNode->setColorLoopSpeed(ls->colorloopTime());
+                    lightNode->setColorLoopSpeed(ls.colorloopTime());
                 }
 
-                d->addTaskSetColorLoop(task2, colorLoopActive, ls->colorloopTime());
+                d->addTaskSetColorLoop(task2, colorLoopActive, ls.colorloopTime());
                 changed = true;
             }
         }
 
         // TODO the following is fake, better let ZCL reporting and Poll manager let this figure out?!
 
-        ResourceItem *item = lightNode->item(RStateOn);
-        if (item && item->toBool() != ls->on())
+        if (recallSceneSetItem(lightNode, lightNode->item(RStateOn), ls.on(), &first))
         {
-            item->setValue(ls->on());
-            enqueueEvent(Event(RLights, RStateOn, lightNode->id(), item));
             changed = true;
-            groupOnChanged = true;
+            groupChanged = true;
         }
 
-        item = lightNode->item(RStateBri);
-        if (item && ls->bri() != item->toNumber())
+        if (recallSceneSetItem(lightNode, lightNode->item(RStateBri), ls.bri(), &first))
         {
-            item->setValue(ls->bri());
-            enqueueEvent(Event(RLights, RStateBri, lightNode->id(), item));
             changed = true;
-            groupBriChanged = true;
+            groupChanged = true;
         }
 
-        item = lightNode->item(RStateColorMode);
+        ResourceItem *item = lightNode->item(RStateColorMode);
         if (item)
         {
-            if (ls->colorMode() != item->toString())
+            if (ls.colorMode() != item->toString())
             {
-                item->setValue(ls->colorMode());
-                enqueueEvent(Event(RLights, RStateColorMode, lightNode->id()));
+                item->setValue(ls.colorMode());
+                if (!first)
+                {
+                    first = item;
+                }
                 changed = true;
-                groupColorModeChanged = true;
+                groupChanged = true;
             }
 
-            if (ls->colorMode() == QLatin1String("xy"))
+            if (ls.colorMode() == QLatin1String("xy"))
             {
-                item = lightNode->item(RStateX);
-                if (item && ls->x() != item->toNumber())
-                {
-                    item->setValue(ls->x());
-                    enqueueEvent(Event(RLights, RStateX, lightNode->id(), item));
-                    changed = true;
-                }
-                item = lightNode->item(RStateY);
-                if (item && ls->y() != item->toNumber())
-                {
-                    item->setValue(ls->y());
-                    enqueueEvent(Event(RLights, RStateY, lightNode->id(), item));
-                    changed = true;
-                }
+                changed |= recallSceneSetItem(lightNode, lightNode->item(RStateX), ls.x(), &first);
+                changed |= recallSceneSetItem(lightNode, lightNode->item(RStateY), ls.y(), &first);
             }
-            else if(ls->colorMode() == QLatin1String("ct"))
+            else if(ls.colorMode() == QLatin1String("ct"))
             {
                 if (lightNode->manufacturer() == QLatin1String("GLEDOPTO") &&
                     lightNode->type() == QLatin1String("Extended color light"))
                 {
                     gledoptoSetColorTemperatureInSceneHack(d, lightNode);
                 }
-                item = lightNode->item(RStateCt);
-                if (item && ls->colorTemperature() != item->toNumber())
+
+                if (recallSceneSetItem(lightNode, lightNode->item(RStateCt), ls.colorTemperature(), &first))
                 {
-                    item->setValue(ls->colorTemperature());
-                    enqueueEvent(Event(RLights, RStateCt, lightNode->id(), item));
                     changed = true;
-                    groupCtChanged = true;
+                    groupChanged = true;
                 }
             }
-            else if (ls->colorMode() == QLatin1String("hs"))
+            else if (ls.colorMode() == QLatin1String("hs"))
             {
-                item = lightNode->item(RStateHue);
-                if (item && ls->enhancedHue() != item->toNumber())
+                if (recallSceneSetItem(lightNode, lightNode->item(RStateHue), ls.enhancedHue(), &first))
                 {
-                    item->setValue(ls->enhancedHue());
-                    enqueueEvent(Event(RLights, RStateHue, lightNode->id(), item));
                     changed = true;
-                    groupHueSatChanged = true;
+                    groupChanged = true;
                 }
 
-                item = lightNode->item(RStateSat);
-                if (item && ls->saturation() != item->toNumber())
+                if (recallSceneSetItem(lightNode, lightNode->item(RStateSat), ls.saturation(), &first))
                 {
-                    item->setValue(ls->saturation());
-                    enqueueEvent(Event(RLights, RStateSat, lightNode->id(), item));
                     changed = true;
-                    groupHueSatChanged = true;
+                    groupChanged = true;
                 }
             }
         }
 
+        if (first)
+        {
+            // the websocket message of this event carries all changed state items
+            enqueueEvent(Event(RLights, first->descriptor().suffix, lightNode->id(), first));
+        }
+
         if (changed)
         {
             d->updateLightEtag(lightNode);
         }
     }
 
-    if (groupOnChanged || groupBriChanged || groupHueSatChanged || groupCtChanged || groupColorModeChanged)
+    if (groupChanged)
     {
         if (groupOn && !group->isOn())
         {
@@ -3431,8 +3458,8 @@ void DeRestPluginPrivate::handleGroupEvent(const Event &e)
         int on = 0;
         int count = 0;
 
-        std::vector<LightNode>::const_iterator i = nodes.begin();
-        std::vector<LightNode>::const_iterator end = nodes.end();
+        SlabVector<LightNode>::const_iterator i = nodes.begin();
+        SlabVector<LightNode>::const_iterator end = nodes.end();
 
         for (; i != end; ++i)
         {
@@ -122,8 +122,8 @@ int DeRestPluginPrivate::getAllLights(const ApiRequest &req, ApiResponse &rsp)
         }
     }
 
-    std::vector<LightNode>::iterator i = nodes.begin();
-    std::vector<LightNode>::iterator end = nodes.end();
+    SlabVector<LightNode>::iterator i = nodes.begin();
+    SlabVector<LightNode>::iterator end = nodes.end();
 
     for (; i != end; ++i)
     {
@@ -1174,6 +1174,7 @@ int DeRestPluginPrivate::setLightState(const ApiRequest &req, ApiResponse &rsp)
 
     // Check whether light is on.
     isOn = taskRef.lightNode->toBool(RStateOn);
+    bool briWithOnOff = false; // state.bri was sent together with state.on
 
     // Special part for Profalux device
     // This device is a shutter but is used as a dimmable light, so need some hack
@@ -1215,6 +1216,14 @@ int DeRestPluginPrivate::setLightState(const ApiRequest &req, ApiResponse &rsp)
 
             ok = addTaskSetBrightness(task, 2, true);
         }
+        else if (hasBri && targetBri > 0 && taskRef.onTime == 0 && taskRef.lightNode->item(RStateBri) &&
+                 DDF_GetItem(taskRef.lightNode->item(RStateBri)).writeParameters.isNull())
+        {
+            // a single Move to Level (with On/Off) turns the light on and sets the brightness,
+            // also when the light is already on since state.on might be outdated
+            ok = addTaskSetBrightness(task, targetBri, true);
+            briWithOnOff = ok;
+        }
         else
         {
             const quint8 cmd = taskRef.onTime > 0
@@ -1253,7 +1262,7 @@ int DeRestPluginPrivate::setLightState(const ApiRequest &req, ApiResponse &rsp)
         {
             // Handled by state.on: false
         }
-        else if (addTaskSetBrightness(task, targetBri, false))
+        else if (briWithOnOff || addTaskSetBrightness(task, targetBri, false))
         {
             QVariantMap rspItem;
             QVariantMap rspItemState;
@@ -4075,20 +4084,18 @@ void DeRestPluginPrivate::handleLightEvent(const Event &e)
 
     if (pushed)
     {
-        // cleanup push flags
+        // cleanup push flags, the message carried all changed items of the same parent
+        // so further events of a batch, like a scene recall, don't send them again
         item->clearNeedPush();
-        if (gwWebSocketNotifyAll)
+        for (int i = 0; i < lightNode->itemCount(); i++)
         {
-            for (int i = 0; i < lightNode->itemCount(); i++)
+            item = lightNode->itemForIndex(static_cast<size_t>(i));
+            if (item && (item->needPushChange() || (gwWebSocketNotifyAll && item->needPushSet())))
             {
-                item = lightNode->itemForIndex(static_cast<size_t>(i));
-                if (item && (item->needPushChange() || item->needPushSet()))
+                const ResourceItemDescriptor &rid = item->descriptor();
+                if (rid.suffix[0] == e.what()[0] && rid.suffix[1] == e.what()[1])
                 {
-                    const ResourceItemDescriptor &rid = item->descriptor();
-                    if (rid.suffix[0] == e.what()[0] && rid.suffix[1] == e.what()[1])
-                    {
-                        item->clearNeedPush();
-                    }
+                    item->clearNeedPush();
                 }
             }
         }
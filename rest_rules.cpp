@@ -18,6 +18,7 @@
 #include "de_web_plugin_private.h"
 #include "json.h"
 #include "rest_alarmsystems.h"
+#include "stall_detector.h"
 
 #define MAX_RULES_COUNT 500
 #define FAST_RULE_CHECK_INTERVAL_MS 10
@@ -1319,6 +1320,7 @@ void DeRestPluginPrivate::triggerRule(Rule &rule)
 
     DBG_Printf(DBG_INFO, "trigger rule %s - %s\n", qPrintable(rule.id()), qPrintable(rule.name()));
 
+    TaskPriorityScope taskPriorityScope(taskPriorityContext, TaskPriorityRule);
     bool triggered = false;
     auto ai = rule.actions().cbegin();
     const auto aend = rule.actions().cend();
@@ -1526,6 +1528,7 @@ void DeRestPluginPrivate::indexRulesTriggers()
 /*! Checks one rule from the fast check queue per event loop cycle. */
 void DeRestPluginPrivate::fastRuleCheckTimerFired()
 {
+    SD_Scope stallScope(SD_Rules);
     for (int &handle : fastRuleCheck)
     {
         if (handle == 0)
@@ -1554,6 +1557,7 @@ void DeRestPluginPrivate::fastRuleCheckTimerFired()
 /*! Triggers rules based on events. */
 void DeRestPluginPrivate::handleRuleEvent(const Event &e)
 {
+    SD_Scope stallScope(SD_Rules);
     if (e.resource() == RDevices)
     {
         return; // todo
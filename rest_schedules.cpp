@@ -21,12 +21,21 @@
 void DeRestPluginPrivate::initSchedules()
 {
     scheduleTimer = new QTimer(this);
-    scheduleTimer->setSingleShot(false);
+    scheduleTimer->setSingleShot(true);
     connect(scheduleTimer, SIGNAL(timeout()),
             this, SLOT(scheduleTimerFired()));
     scheduleTimer->start(SCHEDULE_CHECK_PERIOD);
 }
 
+/*! Recalculates the next check time of all schedules in the next timer pass.
+    Must be called after schedules were added, changed or removed.
+ */
+void DeRestPluginPrivate::scheduleQueueChanged()
+{
+    scheduleQueueDirty = true;
+    scheduleTimer->start(0);
+}
+
 /*! Schedules REST API broker.
     \param req - request data
     \param rsp - response data
@@ -48,7 +57,9 @@ int DeRestPluginPrivate::handleSchedulesApi(const ApiRequest &req, ApiResponse &
     // POST /api/<apikey>/schedules
     else if ((req.path.size() == 3) && (req.hdr.method() == "POST"))
     {
-        return createSchedule(req, rsp);
+        const int ret = createSchedule(req, rsp);
+        scheduleQueueChanged();
+        return ret;
     }
     // GET /api/<apikey>/schedules/<id>
     else if ((req.path.size() == 4) && (req.hdr.method() == "GET"))
@@ -58,12 +69,16 @@ int DeRestPluginPrivate::handleSchedulesApi(const ApiRequest &req, ApiResponse &
     // PUT, PATCH /api/<apikey>/schedules/<id>
     else if ((req.path.size() == 4) && (req.hdr.method() == "PUT" || req.hdr.method() == "PATCH"))
     {
-        return setScheduleAttributes(req, rsp);
+        const int ret = setScheduleAttributes(req, rsp);
+        scheduleQueueChanged();
+        return ret;
     }
     // DELETE /api/<apikey>/schedules/<id>
     else if ((req.path.size() == 4) && (req.hdr.method() == "DELETE"))
     {
-        return deleteSchedule(req, rsp);
+        const int ret = deleteSchedule(req, rsp);
+        scheduleQueueChanged();
+        return ret;
     }
 
     return REQ_NOT_HANDLED;
@@ -1111,22 +1126,100 @@ bool DeRestPluginPrivate::jsonToSchedule(const QString &jsonString, Schedule &sc
     return true;
 }
 
-/*! Processes any schedules.
+/*! Returns the ms until \p schedule needs to be checked by scheduleTimerFired(),
+    or -1 if it's disabled or deleted.
  */
-void DeRestPluginPrivate::scheduleTimerFired()
+static qint64 scheduleMsecsToNextCheck(const Schedule &schedule, const QDateTime &now)
 {
-    if (schedules.empty())
+    if (schedule.state != Schedule::StateNormal ||
+        schedule.status != QLatin1String("enabled"))
     {
-        return;
+        return -1;
     }
 
-    std::vector<Schedule>::iterator i = schedules.begin();
-    std::vector<Schedule>::iterator end = schedules.end();
+    if (schedule.type == Schedule::TypeAbsoluteTime)
+    {
+        if (schedule.endtime.isValid())
+        {
+            return qMax(qint64(0), now.msecsTo(schedule.datetime));
+        }
+    }
+    else if (schedule.type == Schedule::TypeTimer)
+    {
+        if (schedule.endtime.isValid() && schedule.endtime > now)
+        {
+            return now.msecsTo(schedule.endtime);
+        }
+    }
+    else if (schedule.type == Schedule::TypeRecurringTime)
+    {
+        const qint64 diff = now.time().msecsTo(schedule.datetime.time());
+        const bool triggeredToday = schedule.lastTriggerDatetime.date().isValid() &&
+                                    schedule.lastTriggerDatetime.date() == now.date() &&
+                                    schedule.datetime.time() <= now.time();
 
+        const int days = SCHED_RecurringDaysAhead(schedule.weekBitmap, now.date().dayOfWeek(), triggeredToday || diff <= -5000);
+
+        if (days < 0)
+        {
+            return -1;
+        }
+
+        if (days == 0)
+        {
+            return qMax(qint64(0), diff);
+        }
+
+        // DST aware, the queue is recalculated if the UTC offset changes meanwhile
+        return qMax(qint64(0), now.msecsTo(QDateTime(now.date().addDays(days), schedule.datetime.time())));
+    }
+
+    return 0;
+}
+
+/*! Processes due schedules.
+
+    The next check time of each schedule is kept in scheduleQueue, the timer is armed
+    for the earliest one.
+ */
+void DeRestPluginPrivate::scheduleTimerFired()
+{
     QDateTime now = QDateTime::currentDateTime();
 
-    for (; i != end; ++i)
+    ScheduleClock clock;
+    clock.wallMs = now.toMSecsSinceEpoch();
+    clock.steadyMs = deCONZ::steadyTimeRef().ref;
+    clock.utcOffset = now.offsetFromUtc();
+
+    if (scheduleQueue.clockChanged(clock) || scheduleQueueDirty)
+    {
+        scheduleQueueDirty = false;
+        scheduleQueue.clear();
+
+        for (size_t index = 0; index < schedules.size(); index++)
+        {
+            const qint64 msecs = scheduleMsecsToNextCheck(schedules[index], now);
+            if (msecs >= 0)
+            {
+                scheduleQueue.update(index, clock.steadyMs + msecs);
+            }
+        }
+    }
+
+    std::vector<size_t> processed;
+    size_t index = 0;
+    bool triggered = false;
+
+    while (scheduleQueue.popDue(clock.steadyMs, &index))
     {
+        if (index >= schedules.size())
+        {
+            continue;
+        }
+
+        processed.push_back(index);
+        std::vector<Schedule>::iterator i = schedules.begin() + index;
+
         if (i->state != Schedule::StateNormal ||
             i->status != QLatin1String("enabled"))
         {
@@ -1351,7 +1444,8 @@ void DeRestPluginPrivate::scheduleTimerFired()
             if (cmd.isEmpty() || !cmd.contains("address") || !cmd.contains("method") || !cmd.contains("body"))
             {
                 DBG_Printf(DBG_INFO, "schedule %s ignored, invalid command %s\n",  qPrintable(i->id), qPrintable(i->command));
-                return;
+                triggered = true;
+                break;
             }
             QString method = cmd["method"].toString();
             QString address = cmd["address"].toString();
@@ -1363,7 +1457,8 @@ void DeRestPluginPrivate::scheduleTimerFired()
                 i->state = Schedule::StateDeleted;
                 queSaveDb(DB_SCHEDULES, DB_SHORT_SAVE_DELAY);
                 DBG_Printf(DBG_INFO, "schedule %s ignored and removed, invalid command %s\n", qPrintable(i->id), qPrintable(i->command));
-                return;
+                triggered = true;
+                break;
             }
 
             QHttpRequestHeader hdr(method, address);
@@ -1372,6 +1467,7 @@ void DeRestPluginPrivate::scheduleTimerFired()
             ApiRequest req(hdr, path, nullptr, content);
             ApiResponse rsp; // dummy
             rsp.httpStatus = HttpStatusOk;
+            TaskPriorityScope taskPriorityScope(taskPriorityContext, TaskPriorityRule);
 
             DBG_Printf(DBG_INFO, "schedule %s body: %s\n",  qPrintable(i->id), qPrintable(content));
 
@@ -1392,11 +1488,40 @@ void DeRestPluginPrivate::scheduleTimerFired()
                 DBG_Printf(DBG_INFO, "schedule failed: %s %s\n", rsp.httpStatus, qPrintable(err));
             }
 
-            return;
+            triggered = true;
+            break; // one schedule per pass
         }
         else
         {
             DBG_Printf(DBG_INFO, "schedule %s diff %lld, %s\n", qPrintable(i->id), diff, qPrintable(i->datetime.toString()));
         }
     }
+
+    for (size_t n : processed)
+    {
+        const qint64 msecs = scheduleMsecsToNextCheck(schedules[n], now);
+        if (msecs >= 0)
+        {
+            scheduleQueue.update(n, clock.steadyMs + msecs);
+        }
+    }
+
+    qint64 interval = SCHEDULE_MAX_CHECK_PERIOD; // catch clock jumps which aren't visible in the monotonic time
+    int64_t due = 0;
+    if (scheduleQueue.nextDue(&due))
+    {
+        interval = qBound(qint64(SCHEDULE_MIN_CHECK_PERIOD), qint64(due - clock.steadyMs), interval);
+    }
+
+    if (triggered)
+    {
+        interval = qMax(interval, qint64(SCHEDULE_CHECK_PERIOD)); // remaining due schedules in the next pass
+    }
+
+    if (scheduleQueueDirty)
+    {
+        interval = 0; // a schedule command changed schedules, recalculate the queue right away
+    }
+
+    scheduleTimer->start(int(interval));
 }
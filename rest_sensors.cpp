@@ -8,6 +8,7 @@
  *
  */
 
+#include <climits>
 #include <QString>
 #include <QTextCodec>
 #include <QTcpSocket>
@@ -23,6 +24,7 @@
 #include "fan_control.h"
 #include "ias_ace.h"
 #include "simple_metering.h"
+#include "stall_detector.h"
 #include "thermostat.h"
 #include "thermostat_ui_configuration.h"
 #include "tuya.h"
@@ -167,8 +169,8 @@ int DeRestPluginPrivate::getAllSensors(const ApiRequest &req, ApiResponse &rsp)
         }
     }
 
-    std::vector<Sensor>::iterator i = sensors.begin();
-    std::vector<Sensor>::iterator end = sensors.end();
+    SlabVector<Sensor>::iterator i = sensors.begin();
+    SlabVector<Sensor>::iterator end = sensors.end();
 
     for (; i != end; ++i)
     {
@@ -2467,7 +2469,7 @@ int DeRestPluginPrivate::changeSensorState(const ApiRequest &req, ApiResponse &r
                         ResourceItem *item2 = sensor->item(RConfigDuration);
                         if (item2 && item2->toNumber() > 0)
                         {
-                            sensor->durationDue = QDateTime::currentDateTime().addSecs(item2->toNumber()).addMSecs(-500);
+                            setSensorDurationDue(sensor, QDateTime::currentDateTime().addSecs(item2->toNumber()).addMSecs(-500));
                         }
                     }
                 }
@@ -2899,19 +2901,12 @@ void DeRestPluginPrivate::handleSensorEvent(const Event &e)
                 if (item2 && item2->toNumber() > 0)
                 {
                     DBG_Printf(DBG_DDF, "%s/%s auto reset in %us\n", sensor->item(RAttrUniqueId)->toCString(), qPrintable(e.what()), (quint16) item2->toNumber());
-                    sensor->durationDue = item->lastSet().addSecs(item2->toNumber());
+                    setSensorDurationDue(sensor, item->lastSet().addSecs(item2->toNumber()));
                 }
             }
         }
     }
 
-    // speedup sensor state check
-    if ((e.what() == RStatePresence || e.what() == RStateButtonEvent || e.what() == RStateVibration) &&
-        sensor && sensor->durationDue.isValid())
-    {
-        sensorCheckFast = CHECK_SENSOR_FAST_ROUNDS;
-    }
-
     if (e.what() == REventAdded)
     {
         checkSensorGroup(sensor);
@@ -3103,7 +3098,7 @@ void DeRestPluginPrivate::startSearchSensors()
     {
         pollNodes.clear();
         bindingQueue.clear();
-        sensors.reserve(sensors.size() + 10);
+        bindingScheduler.clear();
         searchSensorsCandidates.clear();
         searchSensorsResult.clear();
         lastSensorsScan = QDateTime::currentDateTimeUtc().toString(QLatin1String("yyyy-MM-ddTHH:mm:ss"));
@@ -3144,134 +3139,181 @@ void DeRestPluginPrivate::searchSensorsTimerFired()
     }
 }
 
-/*! Validate sensor states. */
-void DeRestPluginPrivate::checkSensorStateTimerFired()
+/*! Sets the time when the duration based state of \p sensor is reset (presence, button hold, vibration).
+    An invalid \p due cancels the reset.
+ */
+void DeRestPluginPrivate::setSensorDurationDue(Sensor *sensor, const QDateTime &due)
 {
-    if (sensors.empty())
+    sensor->durationDue = due;
+    timerWheel.cancel(sensor->durationTimer);
+    sensor->durationTimer = 0;
+
+    if (!due.isValid())
     {
         return;
     }
 
-    if (sensorCheckIter >= sensors.size())
+    size_t index = sensor->handle().index;
+    if (sensor->handle().type != 's' || index >= sensors.size() || &sensors[index] != sensor)
     {
-        sensorCheckIter = 0;
-        sensorCheckFast = (sensorCheckFast > 0) ? sensorCheckFast - 1 : 0;
-    }
+        // CLIP sensors have no handle
+        for (index = 0; index < sensors.size() && &sensors[index] != sensor; index++)
+        { }
 
-    for (int i = 0; i < CHECK_SENSORS_MAX; i++)
-    {
-        if (sensorCheckIter >= sensors.size())
+        if (index == sensors.size())
         {
-            break;
+            return;
         }
+    }
+
+    const qint64 msecs = qMax(qint64(0), QDateTime::currentDateTime().msecsTo(due));
+    const uint64_t tag = TW_TAG(TimerSensorDuration, sensors.generation(index), index);
+    sensor->durationTimer = timerWheel.start(deCONZ::steadyTimeRef().ref + msecs, tag);
+    armTimerWheel();
+}
+
+/*! Arms the timer wheel timer for the next expiry.
+ */
+void DeRestPluginPrivate::armTimerWheel()
+{
+    if (!timerWheelTimer)
+    {
+        return; // not yet initialised
+    }
+
+    int64_t due = 0;
+    if (!timerWheel.nextExpiry(&due))
+    {
+        timerWheelTimer->stop();
+        return;
+    }
+
+    const int interval = int(qBound(qint64(0), qint64(due - deCONZ::steadyTimeRef().ref), qint64(INT_MAX)));
+    if (!timerWheelTimer->isActive() || timerWheelTimer->remainingTime() > interval)
+    {
+        timerWheelTimer->start(interval);
+    }
+}
+
+/*! Dispatches expired timers of the timer wheel.
+ */
+void DeRestPluginPrivate::timerWheelFired()
+{
+    SD_Scope stallScope(SD_Timer);
+    timerWheelTags.clear();
+    timerWheel.expire(deCONZ::steadyTimeRef().ref, timerWheelTags);
 
-        Sensor *sensor = &sensors[sensorCheckIter];
-        sensorCheckIter++;
+    for (const uint64_t tag : timerWheelTags)
+    {
+        const size_t index = TW_TAG_INDEX(tag);
 
-        if (sensor->deletedState() != Sensor::StateNormal)
+        if (TW_TAG_KIND(tag) == TimerSensorDuration && sensors.isValid(index, TW_TAG_GENERATION(tag)))
         {
-            continue;
+            sensors[index].durationTimer = 0;
+            checkSensorDuration(&sensors[index]);
         }
+    }
+
+    armTimerWheel();
+}
+
+/*! Resets duration based sensor states when config.duration has elapsed. */
+void DeRestPluginPrivate::checkSensorDuration(Sensor *sensor)
+{
+    if (sensor->deletedState() != Sensor::StateNormal)
+    {
+        return;
+    }
 
-        if (sensor->durationDue.isValid())
+    if (sensor->durationDue.isValid())
+    {
+        if (sensor->durationDue <= QDateTime::currentDateTime().addMSecs(TW_TICK_MS)) // timer wheel resolution
         {
-            if (sensor->durationDue <= QDateTime::currentDateTime())
+            // automatically set presence to false, if not triggered in config.duration
+            ResourceItem *item = sensor->item(RStatePresence);
+            if (item && item->toBool())
             {
-                // automatically set presence to false, if not triggered in config.duration
-                ResourceItem *item = sensor->item(RStatePresence);
-                if (item && item->toBool())
+                DBG_Printf(DBG_INFO, "sensor %s (%s): disable presence\n", qPrintable(sensor->id()), qPrintable(sensor->modelId()));
+                item->setValue(false);
+                sensor->updateStateTimestamp();
+                sensor->setNeedSaveDatabase(true);
+                enqueueEvent(Event(RSensors, RStatePresence, sensor->id(), item));
+                enqueueEvent(Event(RSensors, RStateLastUpdated, sensor->id()));
+                updateSensorEtag(sensor);
+                for (quint16 clusterId : sensor->fingerPrint().inClusters)
                 {
-                    DBG_Printf(DBG_INFO, "sensor %s (%s): disable presence\n", qPrintable(sensor->id()), qPrintable(sensor->modelId()));
-                    item->setValue(false);
-                    sensor->updateStateTimestamp();
-                    sensor->setNeedSaveDatabase(true);
-                    enqueueEvent(Event(RSensors, RStatePresence, sensor->id(), item));
-                    enqueueEvent(Event(RSensors, RStateLastUpdated, sensor->id()));
-                    updateSensorEtag(sensor);
-                    for (quint16 clusterId : sensor->fingerPrint().inClusters)
+                    if (sensor->modelId().startsWith(QLatin1String("TRADFRI")))
                     {
-                        if (sensor->modelId().startsWith(QLatin1String("TRADFRI")))
-                        {
-                            clusterId = OCCUPANCY_SENSING_CLUSTER_ID; // workaround
-                        }
-
-                        if (clusterId == IAS_ZONE_CLUSTER_ID || clusterId == OCCUPANCY_SENSING_CLUSTER_ID)
-                        {
-                            pushZclValueDb(sensor->address().ext(), sensor->fingerPrint().endpoint, clusterId, 0x0000, 0);
-                            break;
-                        }
+                        clusterId = OCCUPANCY_SENSING_CLUSTER_ID; // workaround
                     }
-                }
-                else if (!item && sensor->modelId() == QLatin1String("lumi.sensor_switch"))
-                {
-                    // Xiaomi round button (WXKG01LM)
-                    // generate artificial hold event
-                    item = sensor->item(RStateButtonEvent);
-                    if (item && item->toNumber() == (S_BUTTON_1 + S_BUTTON_ACTION_INITIAL_PRESS))
+
+                    if (clusterId == IAS_ZONE_CLUSTER_ID || clusterId == OCCUPANCY_SENSING_CLUSTER_ID)
                     {
-                        item->setValue(S_BUTTON_1 + S_BUTTON_ACTION_HOLD);
-                        DBG_Printf(DBG_INFO, "[INFO] - Button %d Hold %s\n", (int)item->toNumber(), qPrintable(sensor->modelId()));
-                        sensor->updateStateTimestamp();
-                        sensor->setNeedSaveDatabase(true);
-                        enqueueEvent(Event(RSensors, RStateButtonEvent, sensor->id(), item));
-                        enqueueEvent(Event(RSensors, RStateLastUpdated, sensor->id()));
-                        updateSensorEtag(sensor);
+                        pushZclValueDb(sensor->address().ext(), sensor->fingerPrint().endpoint, clusterId, 0x0000, 0);
+                        break;
                     }
                 }
-                else if (sensor->modelId() == QLatin1String("FOHSWITCH"))
+            }
+            else if (!item && sensor->modelId() == QLatin1String("lumi.sensor_switch"))
+            {
+                // Xiaomi round button (WXKG01LM)
+                // generate artificial hold event
+                item = sensor->item(RStateButtonEvent);
+                if (item && item->toNumber() == (S_BUTTON_1 + S_BUTTON_ACTION_INITIAL_PRESS))
                 {
-                    // Friends of Hue switch
-                    // generate artificial hold event
-                    item = sensor->item(RStateButtonEvent);
-                    quint32 btn = item ? static_cast<quint32>(item->toNumber()) : 0;
-                    const quint32 action = btn & 0x03;
-                    if (btn >= S_BUTTON_1 && btn <= S_BUTTON_8 && action == S_BUTTON_ACTION_INITIAL_PRESS)
-                    {
-                        btn &= ~0x03;
-                        item->setValue(btn + S_BUTTON_ACTION_HOLD);
-                        DBG_Printf(DBG_INFO, "FoH switch button %d Hold %s\n", (int)item->toNumber(), qPrintable(sensor->modelId()));
-                        sensor->updateStateTimestamp();
-                        sensor->setNeedSaveDatabase(true);
-                        enqueueEvent(Event(RSensors, RStateButtonEvent, sensor->id(), item));
-                        enqueueEvent(Event(RSensors, RStateLastUpdated, sensor->id()));
-                        updateSensorEtag(sensor);
-                    }
+                    item->setValue(S_BUTTON_1 + S_BUTTON_ACTION_HOLD);
+                    DBG_Printf(DBG_INFO, "[INFO] - Button %d Hold %s\n", (int)item->toNumber(), qPrintable(sensor->modelId()));
+                    sensor->updateStateTimestamp();
+                    sensor->setNeedSaveDatabase(true);
+                    enqueueEvent(Event(RSensors, RStateButtonEvent, sensor->id(), item));
+                    enqueueEvent(Event(RSensors, RStateLastUpdated, sensor->id()));
+                    updateSensorEtag(sensor);
                 }
-                else if (!item && sensor->modelId().startsWith(QLatin1String("lumi.vibration")) && sensor->type() == QLatin1String("ZHAVibration"))
-                {
-                    item = sensor->item(RStateVibration);
-                    if (item && item->toBool())
-                    {
-                        DBG_Printf(DBG_INFO, "sensor %s (%s): disable vibration\n", qPrintable(sensor->id()), qPrintable(sensor->modelId()));
-                        item->setValue(false);
-                        sensor->setNeedSaveDatabase(true);
-                        sensor->updateStateTimestamp();
-                        enqueueEvent(Event(RSensors, RStateVibration, sensor->id(), item));
-                        enqueueEvent(Event(RSensors, RStateLastUpdated, sensor->id()));
-                        updateSensorEtag(sensor);
-                    }
+            }
+            else if (sensor->modelId() == QLatin1String("FOHSWITCH"))
+            {
+                // Friends of Hue switch
+                // generate artificial hold event
+                item = sensor->item(RStateButtonEvent);
+                quint32 btn = item ? static_cast<quint32>(item->toNumber()) : 0;
+                const quint32 action = btn & 0x03;
+                if (btn >= S_BUTTON_1 && btn <= S_BUTTON_8 && action == S_BUTTON_ACTION_INITIAL_PRESS)
+                {
+                    btn &= ~0x03;
+                    item->setValue(btn + S_BUTTON_ACTION_HOLD);
+                    DBG_Printf(DBG_INFO, "FoH switch button %d Hold %s\n", (int)item->toNumber(), qPrintable(sensor->modelId()));
+                    sensor->updateStateTimestamp();
+                    sensor->setNeedSaveDatabase(true);
+                    enqueueEvent(Event(RSensors, RStateButtonEvent, sensor->id(), item));
+                    enqueueEvent(Event(RSensors, RStateLastUpdated, sensor->id()));
+                    updateSensorEtag(sensor);
                 }
-                else if (sensor->type().endsWith(QLatin1String("AncillaryControl")))
+            }
+            else if (!item && sensor->modelId().startsWith(QLatin1String("lumi.vibration")) && sensor->type() == QLatin1String("ZHAVibration"))
+            {
+                item = sensor->item(RStateVibration);
+                if (item && item->toBool())
                 {
-                    DBG_Printf(DBG_IAS, "[IAS ACE] - Reseting counter\n");
+                    DBG_Printf(DBG_INFO, "sensor %s (%s): disable vibration\n", qPrintable(sensor->id()), qPrintable(sensor->modelId()));
+                    item->setValue(false);
+                    sensor->setNeedSaveDatabase(true);
+                    sensor->updateStateTimestamp();
+                    enqueueEvent(Event(RSensors, RStateVibration, sensor->id(), item));
+                    enqueueEvent(Event(RSensors, RStateLastUpdated, sensor->id()));
+                    updateSensorEtag(sensor);
                 }
-
-                sensor->durationDue = QDateTime();
             }
-            else
+            else if (sensor->type().endsWith(QLatin1String("AncillaryControl")))
             {
-                sensorCheckFast = CHECK_SENSOR_FAST_ROUNDS;
+                DBG_Printf(DBG_IAS, "[IAS ACE] - Reseting counter\n");
             }
-        }
-    }
 
-    // adjust check speed if needed
-    int interval = (sensorCheckFast > 0) ? CHECK_SENSOR_FAST_INTERVAL
-                                         : CHECK_SENSOR_INTERVAL;
-    if (interval != checkSensorsTimer->interval())
-    {
-        DBG_Printf(DBG_INFO, "Set sensor check interval to %d milliseconds\n", interval);
-        checkSensorsTimer->setInterval(interval);
+            sensor->durationDue = QDateTime();
+        }
+        else
+        {
+            setSensorDurationDue(sensor, sensor->durationDue); // wall clock was adjusted
+        }
     }
 }
 
@@ -661,8 +661,8 @@ void DeRestPluginPrivate::sendTouchlinkConfirm(deCONZ::TouchlinkStatus status)
             // mark the reset node as not available
             if (touchlinkState == TL_SendingResetRequest)
             {
-                std::vector<LightNode>::iterator i = nodes.begin();
-                std::vector<LightNode>::iterator end = nodes.end();
+                SlabVector<LightNode>::iterator i = nodes.begin();
+                SlabVector<LightNode>::iterator end = nodes.end();
 
                 for (; i != end; ++i)
                 {
@@ -54,6 +54,7 @@ public:
         state(StateCheck),
         timeout(BindingTask::Timeout),
         retries(BindingTask::Retries),
+        apsReqId(0),
         restNode(0)
     {
     }
@@ -67,7 +68,9 @@ public:
     quint8 zdpSeqNum;
     int timeout; // seconds
     int retries;
-    RestNodeBase *restNode; // TODO refactor, this can become dangling pointer after each nodes, sensors .push_back()
+    quint8 apsReqId; // bind/unbind request, to match the APS confirm
+    std::vector<uint8_t> zclSeqNums; // configure reporting requests without response
+    RestNodeBase *restNode; // nodes and sensors are kept in SlabVector containers, the pointer stays valid
 
     Binding binding;
 };
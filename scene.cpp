@@ -266,6 +266,10 @@ const QString &LightState::lid() const
  */
 void LightState::setLightId(const QString &lid)
 {
+    if (m_lid != lid)
+    {
+        m_lightHandle = {};
+    }
     m_lid = lid;
 }
 
@@ -16,6 +16,7 @@
 #include <vector>
 #include <QElapsedTimer>
 #include "json.h"
+#include "resource.h"
 
 class LightState;
 
@@ -97,6 +98,8 @@ public:
     void setTransitionTime(uint16_t transitionTime);
     bool needRead() const { return m_needRead; }
     void setNeedRead(bool needRead);
+    Resource::Handle lightHandle() const { return m_lightHandle; }
+    void setLightHandle(Resource::Handle hnd) { m_lightHandle = hnd; }
 
     QElapsedTimer tVerified;
 
@@ -115,6 +118,7 @@ private:
     uint8_t m_colorloopTime;
     QString m_colorMode;
     uint16_t m_transitiontime;
+    Resource::Handle m_lightHandle{}; //! resolved LightNode, verified on use
 };
 
 #endif // SCENE_H
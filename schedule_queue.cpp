@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include <algorithm>
+#include "schedule_queue.h"
+
+namespace {
+
+struct EntryLater
+{
+    template <typename T>
+    bool operator()(const T &a, const T &b) const
+    {
+        return a.due > b.due;
+    }
+};
+
+} // namespace
+
+void ScheduleQueue::clear()
+{
+    m_heap.clear();
+    m_generation.clear();
+    m_queued.clear();
+    m_count = 0;
+}
+
+/*! Sets the next check time of schedule \p index, replaces a previous one.
+ */
+void ScheduleQueue::update(size_t index, int64_t due)
+{
+    remove(index);
+
+    if (index >= m_generation.size())
+    {
+        m_generation.resize(index + 1, 0);
+        m_queued.resize(index + 1, 0);
+    }
+
+    m_queued[index] = 1;
+    m_count++;
+    m_heap.push_back({due, index, m_generation[index]});
+    std::push_heap(m_heap.begin(), m_heap.end(), EntryLater());
+
+    compact();
+}
+
+/*! Removes schedule \p index, its heap entry becomes stale.
+ */
+void ScheduleQueue::remove(size_t index)
+{
+    if (contains(index))
+    {
+        m_generation[index]++;
+        m_queued[index] = 0;
+        m_count--;
+    }
+}
+
+bool ScheduleQueue::contains(size_t index) const
+{
+    return index < m_queued.size() && m_queued[index];
+}
+
+/*! Takes the earliest schedule which is due at \p now.
+    \returns false if no schedule is due.
+ */
+bool ScheduleQueue::popDue(int64_t now, size_t *index)
+{
+    popStale();
+
+    if (m_heap.empty() || m_heap.front().due > now)
+    {
+        return false;
+    }
+
+    *index = m_heap.front().index;
+    std::pop_heap(m_heap.begin(), m_heap.end(), EntryLater());
+    m_heap.pop_back();
+    remove(*index);
+    return true;
+}
+
+/*! Sets \p due to the earliest check time.
+    \returns false if the queue is empty.
+ */
+bool ScheduleQueue::nextDue(int64_t *due)
+{
+    popStale();
+
+    if (m_heap.empty())
+    {
+        return false;
+    }
+
+    *due = m_heap.front().due;
+    return true;
+}
+
+/*! Detects wall clock jumps (NTP, manual setting) and UTC offset changes (DST, time zone).
+    The first call only takes the reference.
+    \returns true if the next check times need to be recalculated.
+ */
+bool ScheduleQueue::clockChanged(const ScheduleClock &clock)
+{
+    const int64_t wallOffset = clock.wallMs - clock.steadyMs;
+    bool changed = false;
+
+    if (m_clockValid)
+    {
+        const int64_t drift = wallOffset - m_wallOffset;
+        changed = drift > MaxClockDrift || drift < -MaxClockDrift || clock.utcOffset != m_utcOffset;
+    }
+
+    if (changed || !m_clockValid)
+    {
+        m_wallOffset = wallOffset;
+        m_utcOffset = clock.utcOffset;
+        m_clockValid = true;
+    }
+
+    return changed;
+}
+
+void ScheduleQueue::popStale()
+{
+    while (!m_heap.empty())
+    {
+        const Entry &top = m_heap.front();
+        if (contains(top.index) && m_generation[top.index] == top.generation)
+        {
+            break;
+        }
+
+        std::pop_heap(m_heap.begin(), m_heap.end(), EntryLater());
+        m_heap.pop_back();
+    }
+}
+
+/*! Drops stale entries when they make up most of the heap.
+ */
+void ScheduleQueue::compact()
+{
+    if (m_heap.size() < 2 * m_count + 16)
+    {
+        return;
+    }
+
+    m_heap.erase(std::remove_if(m_heap.begin(), m_heap.end(), [this](const Entry &e)
+    {
+        return !contains(e.index) || m_generation[e.index] != e.generation;
+    }), m_heap.end());
+
+    std::make_heap(m_heap.begin(), m_heap.end(), EntryLater());
+}
+
+/*! Returns the number of days until the next weekday of a recurring schedule.
+
+    \param weekBitmap - bbb = 0MTWTFSS, e.g. only Tuesdays is 00100000 = 32
+    \param dayOfWeek - Mon-Sun: 1-7
+    \param skipToday - true if today's time has passed or was already triggered
+    \returns 0..7 or -1 if no weekday is set.
+ */
+int SCHED_RecurringDaysAhead(uint8_t weekBitmap, int dayOfWeek, bool skipToday)
+{
+    if (dayOfWeek < 1 || dayOfWeek > 7)
+    {
+        return -1;
+    }
+
+    for (int days = skipToday ? 1 : 0; days <= 7; days++)
+    {
+        const int day = (dayOfWeek - 1 + days) % 7 + 1;
+        if (weekBitmap & (1 << (7 - day)))
+        {
+            return days;
+        }
+    }
+
+    return -1;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef SCHEDULE_QUEUE_H
+#define SCHEDULE_QUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*! Wall clock and monotonic time of a scheduler pass.
+ */
+struct ScheduleClock
+{
+    int64_t wallMs = 0;   //! ms since epoch
+    int64_t steadyMs = 0; //! monotonic ms
+    int utcOffset = 0;    //! seconds of local time ahead of UTC
+};
+
+/*! \class ScheduleQueue
+
+    Min-heap of the next check time of each schedule, so that a scheduler pass
+    only needs to look at due schedules. Schedules are referred to by their index
+    in the schedules vector, times are monotonic ms.
+ */
+class ScheduleQueue
+{
+public:
+    enum Constants
+    {
+        MaxClockDrift = 2000 //! ms the wall clock may deviate before all schedules are recalculated
+    };
+
+    void clear();
+    void update(size_t index, int64_t due);
+    void remove(size_t index);
+    bool contains(size_t index) const;
+    bool popDue(int64_t now, size_t *index);
+    bool nextDue(int64_t *due);
+    size_t size() const { return m_count; }
+    bool clockChanged(const ScheduleClock &clock);
+
+private:
+    struct Entry
+    {
+        int64_t due;
+        size_t index;
+        uint32_t generation;
+    };
+
+    void popStale();
+    void compact();
+
+    std::vector<Entry> m_heap;
+    std::vector<uint32_t> m_generation; //! per index, entries with an older generation are stale
+    std::vector<uint8_t> m_queued;
+    size_t m_count = 0;
+    int64_t m_wallOffset = 0; //! wallMs - steadyMs of the last pass
+    int m_utcOffset = 0;
+    bool m_clockValid = false;
+};
+
+int SCHED_RecurringDaysAhead(uint8_t weekBitmap, int dayOfWeek, bool skipToday);
+
+#endif // SCHEDULE_QUEUE_H
@@ -149,6 +149,7 @@ public:
     uint8_t previousDirection;
     quint16 previousCt;
     QDateTime durationDue;
+    uint32_t durationTimer = 0; //! TimerWheel::Id of durationDue
     uint16_t previousSequenceNumber = 0xffff;
     uint8_t previousCommandId;
 
@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include "stall_detector.h"
+
+#ifdef __linux__
+  #include <time.h>
+#endif
+
+struct SD_Frame
+{
+    int64_t startNs;
+    SD_Handler handler;
+    bool attributed; // an inner scope already recorded the stall
+};
+
+struct SD_Private
+{
+    std::thread::id thread;
+    int64_t thresholdNs = 0;
+    int64_t lastHeartbeatNs = 0;
+    bool attributedSinceHeartbeat = false;
+    int depth = 0;
+    SD_Frame frames[SD_MAX_DEPTH];
+    SD_Stats stats{};
+    int stallCount = 0;
+    SD_Stall stalls[SD_MAX_STALLS];
+};
+
+static SD_Private sd;
+
+/*! Stalls are in the range of tens of milliseconds, the coarse clock has enough resolution
+    (1-10 ms) and costs a fraction of a precise clock read, which matters on every handler call.
+ */
+static int64_t steadyNs()
+{
+#if defined(__linux__) && defined(CLOCK_MONOTONIC_COARSE)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/*! Keeps the stall if it is among the SD_MAX_STALLS worst ones.
+ */
+static void recordStall(int64_t durationNs, const SD_Frame *frames, int count)
+{
+    SD_Stall stall{};
+    stall.timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    stall.durationUs = durationNs / 1000;
+
+    const int first = std::max(0, count - SD_MAX_PATH); // keep the innermost handlers
+    for (int i = first; i < count; i++)
+    {
+        stall.path[i - first] = frames[i].handler;
+    }
+
+    sd.stats.stalls++;
+
+    if (sd.stallCount < SD_MAX_STALLS)
+    {
+        sd.stalls[sd.stallCount++] = stall;
+        return;
+    }
+
+    SD_Stall *least = std::min_element(sd.stalls, sd.stalls + SD_MAX_STALLS, [](const SD_Stall &a, const SD_Stall &b) {
+        return a.durationUs < b.durationUs;
+    });
+
+    if (least->durationUs < stall.durationUs)
+    {
+        *least = stall;
+    }
+}
+
+SD_Scope::SD_Scope(SD_Handler handler)
+{
+    m_active = sd.thresholdNs > 0 && sd.depth < SD_MAX_DEPTH && std::this_thread::get_id() == sd.thread;
+
+    if (m_active)
+    {
+        SD_Frame &frame = sd.frames[sd.depth++];
+        frame.handler = handler;
+        frame.attributed = false;
+        frame.startNs = steadyNs();
+    }
+}
+
+SD_Scope::~SD_Scope()
+{
+    if (!m_active)
+    {
+        return;
+    }
+
+    const int64_t durationNs = steadyNs() - sd.frames[sd.depth - 1].startNs;
+
+    if (durationNs >= sd.thresholdNs && !sd.frames[sd.depth - 1].attributed)
+    {
+        recordStall(durationNs, sd.frames, sd.depth);
+
+        for (int i = 0; i < sd.depth - 1; i++)
+        {
+            sd.frames[i].attributed = true; // don't report the same stall again for the outer handlers
+        }
+        sd.attributedSinceHeartbeat = true;
+    }
+
+    sd.depth--;
+}
+
+/*! Enables the detector for the calling thread, a threshold of 0 disables it.
+ */
+void SD_Init(int64_t thresholdMs)
+{
+    sd = SD_Private();
+    sd.thread = std::this_thread::get_id();
+    sd.thresholdNs = thresholdMs * 1000000;
+    sd.stats.thresholdUs = thresholdMs * 1000;
+}
+
+/*! Called every SD_HEARTBEAT_INTERVAL_MS by a timer in the event loop.
+    \return the event loop latency in microseconds, that is how late the heartbeat was.
+ */
+int64_t SD_Heartbeat()
+{
+    const int64_t now = steadyNs();
+
+    if (sd.lastHeartbeatNs == 0)
+    {
+        sd.lastHeartbeatNs = now;
+        return 0;
+    }
+
+    const int64_t latencyNs = std::max(int64_t(0), now - sd.lastHeartbeatNs - int64_t(SD_HEARTBEAT_INTERVAL_MS) * 1000000);
+    sd.lastHeartbeatNs = now;
+
+    sd.stats.maxLatencyUs = std::max(sd.stats.maxLatencyUs, latencyNs / 1000);
+
+    if (sd.thresholdNs > 0 && latencyNs >= sd.thresholdNs && !sd.attributedSinceHeartbeat)
+    {
+        recordStall(latencyNs, nullptr, 0); // blocked in code without marker
+    }
+
+    sd.attributedSinceHeartbeat = false;
+    return latencyNs / 1000;
+}
+
+/*! Returns the recorded stalls, worst first.
+ */
+void SD_GetStalls(std::vector<SD_Stall> &stalls)
+{
+    stalls.assign(sd.stalls, sd.stalls + sd.stallCount);
+    std::sort(stalls.begin(), stalls.end(), [](const SD_Stall &a, const SD_Stall &b) {
+        return a.durationUs > b.durationUs;
+    });
+}
+
+SD_Stats SD_GetStats()
+{
+    return sd.stats;
+}
+
+const char *SD_HandlerName(SD_Handler handler)
+{
+    switch (handler)
+    {
+    case SD_ApsIndication: return "apsdeDataIndication";
+    case SD_ApsConfirm:    return "apsdeDataConfirm";
+    case SD_HttpRequest:   return "handleHttpRequest";
+    case SD_SaveDb:        return "saveDb";
+    case SD_JsEvaluate:    return "DeviceJs::evaluate";
+    case SD_Rules:         return "rules";
+    case SD_Timer:         return "timer";
+    case SD_EventQueue:    return "eventQueue";
+    case SD_DeviceTick:    return "deviceTick";
+    default:
+        break;
+    }
+
+    return "unknown";
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef STALL_DETECTOR_H
+#define STALL_DETECTOR_H
+
+#include <cstdint>
+#include <vector>
+
+/*! Event loop stall detector.
+
+    Everything in the plugin runs in the Qt main thread, a slow handler blocks Zigbee,
+    REST API and websocket processing at the same time.
+
+    - SD_Scope markers around the hot handlers measure how long each handler runs,
+      a handler exceeding the threshold is recorded with the chain of enclosing handlers.
+    - SD_Heartbeat() is called by a periodic timer and measures the event loop latency,
+      this catches stalls in code without marker which are recorded as unattributed.
+
+    The worst SD_MAX_STALLS stalls are kept and exposed via GET /api/<apikey>/config/stalls.
+    Markers are only evaluated in the thread which called SD_Init().
+ */
+
+#define SD_MAX_DEPTH 8
+#define SD_MAX_PATH 4
+#define SD_MAX_STALLS 16
+#define SD_DEFAULT_THRESHOLD_MS 100
+#define SD_HEARTBEAT_INTERVAL_MS 100
+
+enum SD_Handler
+{
+    SD_HandlerNone,
+    SD_ApsIndication,
+    SD_ApsConfirm,
+    SD_HttpRequest,
+    SD_SaveDb,
+    SD_JsEvaluate,
+    SD_Rules,
+    SD_Timer,
+    SD_EventQueue,
+    SD_DeviceTick,
+    SD_HandlerMax
+};
+
+struct SD_Stall
+{
+    int64_t timestamp; // ms since epoch when the stall ended
+    int64_t durationUs;
+    SD_Handler path[SD_MAX_PATH]; // outermost first, SD_HandlerNone terminated, empty if unattributed
+};
+
+struct SD_Stats
+{
+    uint64_t stalls; // total recorded stalls, including the ones dropped from the worst list
+    int64_t maxLatencyUs; // worst event loop latency seen by SD_Heartbeat()
+    int64_t thresholdUs;
+};
+
+class SD_Scope
+{
+public:
+    explicit SD_Scope(SD_Handler handler);
+    ~SD_Scope();
+
+    SD_Scope(const SD_Scope&) = delete;
+    SD_Scope &operator=(const SD_Scope&) = delete;
+
+private:
+    bool m_active;
+};
+
+void SD_Init(int64_t thresholdMs = SD_DEFAULT_THRESHOLD_MS);
+int64_t SD_Heartbeat();
+void SD_GetStalls(std::vector<SD_Stall> &stalls);
+SD_Stats SD_GetStats();
+const char *SD_HandlerName(SD_Handler handler);
+
+#endif // STALL_DETECTOR_H
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include "startup_profile.h"
+
+struct SP_AtomicTiming
+{
+    std::atomic<int64_t> startUs{-1};
+    std::atomic<int64_t> durationUs{0};
+    std::atomic<uint32_t> count{0};
+};
+
+// phases may run on worker threads, hence the atomics
+static SP_AtomicTiming spTimings[SP_PhaseMax];
+static std::atomic<int64_t> spStartUs{0};
+static std::atomic<bool> spComplete{false};
+
+static int64_t steadyUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*! Keeps the earliest start if the phase is entered more than once.
+ */
+static void recordStart(SP_AtomicTiming &t, int64_t startUs)
+{
+    int64_t cur = t.startUs.load(std::memory_order_relaxed);
+    while ((cur == -1 || startUs < cur) &&
+           !t.startUs.compare_exchange_weak(cur, startUs, std::memory_order_relaxed))
+    {
+    }
+}
+
+/*! Resets all timings, times are relative to this call.
+ */
+void SP_Start()
+{
+    for (auto &t : spTimings)
+    {
+        t.startUs.store(-1, std::memory_order_relaxed);
+        t.durationUs.store(0, std::memory_order_relaxed);
+        t.count.store(0, std::memory_order_relaxed);
+    }
+
+    spComplete.store(false, std::memory_order_relaxed);
+    spStartUs.store(steadyUs(), std::memory_order_relaxed);
+}
+
+int64_t SP_ElapsedUs()
+{
+    return steadyUs() - spStartUs.load(std::memory_order_relaxed);
+}
+
+SP_Scope::SP_Scope(SP_Phase phase) :
+    m_phase(phase),
+    m_startUs(SP_ElapsedUs())
+{
+}
+
+SP_Scope::~SP_Scope()
+{
+    if (spComplete.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    SP_AtomicTiming &t = spTimings[m_phase];
+    recordStart(t, m_startUs);
+    t.durationUs.fetch_add(SP_ElapsedUs() - m_startUs, std::memory_order_relaxed);
+    t.count.fetch_add(1, std::memory_order_relaxed);
+}
+
+/*! Records the time since SP_Start() when \p phase is reached the first time,
+    later calls only cost an atomic load.
+ */
+void SP_Milestone(SP_Phase phase)
+{
+    SP_AtomicTiming &t = spTimings[phase];
+    if (t.startUs.load(std::memory_order_relaxed) != -1)
+    {
+        return;
+    }
+
+    int64_t expected = -1;
+    if (t.startUs.compare_exchange_strong(expected, SP_ElapsedUs(), std::memory_order_relaxed))
+    {
+        t.count.store(1, std::memory_order_relaxed);
+        if (phase == SP_FirstPollCycle)
+        {
+            spComplete.store(true, std::memory_order_relaxed);
+        }
+    }
+}
+
+SP_Timing SP_GetTiming(SP_Phase phase)
+{
+    SP_Timing result;
+    if (phase >= SP_DbOpen && phase < SP_PhaseMax)
+    {
+        const SP_AtomicTiming &t = spTimings[phase];
+        result.startUs = t.startUs.load(std::memory_order_relaxed);
+        result.durationUs = t.durationUs.load(std::memory_order_relaxed);
+        result.count = t.count.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+bool SP_IsMilestone(SP_Phase phase)
+{
+    return phase == SP_FirstPollCycle || phase == SP_FirstRestResponse;
+}
+
+const char *SP_PhaseName(SP_Phase phase)
+{
+    switch (phase)
+    {
+    case SP_DbOpen: return "db_open";
+    case SP_DbInit: return "db_init";
+    case SP_DbPreload: return "db_preload";
+    case SP_LoadAuth: return "load_auth";
+    case SP_LoadConfig: return "load_config";
+    case SP_LoadUserparameter: return "load_userparameter";
+    case SP_LoadGroups: return "load_groups";
+    case SP_LoadResourcelinks: return "load_resourcelinks";
+    case SP_LoadScenes: return "load_scenes";
+    case SP_LoadRules: return "load_rules";
+    case SP_LoadSchedules: return "load_schedules";
+    case SP_LoadSensors: return "load_sensors";
+    case SP_LoadAlarmSystems: return "load_alarmsystems";
+    case SP_DdfScan: return "ddf_scan";
+    case SP_DdfParse: return "ddf_parse";
+    case SP_DdfBundles: return "ddf_bundles";
+    case SP_DdfSignatures: return "ddf_signatures";
+    case SP_JsInit: return "js_init";
+    case SP_FirstPollCycle: return "first_poll_cycle";
+    case SP_FirstRestResponse: return "first_rest_response";
+    default:
+        break;
+    }
+
+    return "unknown";
+}
+
+/*! Human readable table of all phases, used by the headless benchmark and debug output.
+ */
+std::string SP_Report()
+{
+    std::string result;
+    char buf[128];
+
+    snprintf(buf, sizeof(buf), "%-22s %12s %12s %6s\n", "phase", "start ms", "duration ms", "count");
+    result += buf;
+
+    for (int i = 0; i < SP_PhaseMax; i++)
+    {
+        const SP_Phase phase = SP_Phase(i);
+        const SP_Timing t = SP_GetTiming(phase);
+
+        if (t.startUs < 0)
+        {
+            snprintf(buf, sizeof(buf), "%-22s %12s %12s %6u\n", SP_PhaseName(phase), "-", "-", 0u);
+        }
+        else if (SP_IsMilestone(phase))
+        {
+            snprintf(buf, sizeof(buf), "%-22s %12.3f %12s %6u\n", SP_PhaseName(phase), t.startUs / 1000.0, "-", t.count);
+        }
+        else
+        {
+            snprintf(buf, sizeof(buf), "%-22s %12.3f %12.3f %6u\n", SP_PhaseName(phase), t.startUs / 1000.0, t.durationUs / 1000.0, t.count);
+        }
+        result += buf;
+    }
+
+    return result;
+}
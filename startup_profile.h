@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef STARTUP_PROFILE_H
+#define STARTUP_PROFILE_H
+
+#include <cstdint>
+#include <string>
+
+/*! Cold-start phase timings.
+
+    SP_Start() is called first thing in the plugin constructor, all times are relative to it.
+    SP_Scope markers around the startup phases accumulate the time spent in each phase,
+    milestones like the first completed poll cycle record the time since start once.
+    Startup is considered complete with the first poll cycle, later DDF reloads or
+    bundle uploads don't count towards the phases.
+
+    The timings are exposed via GET /api/<apikey>/config/startup.
+ */
+
+enum SP_Phase
+{
+    SP_DbOpen,
+    SP_DbInit,
+    SP_DbPreload, // worker thread, overlaps with the DDF phases
+    SP_LoadAuth,
+    SP_LoadConfig,
+    SP_LoadUserparameter,
+    SP_LoadGroups,
+    SP_LoadResourcelinks,
+    SP_LoadScenes,
+    SP_LoadRules,
+    SP_LoadSchedules,
+    SP_LoadSensors,
+    SP_LoadAlarmSystems,
+    SP_DdfScan,
+    SP_DdfParse,
+    SP_DdfBundles,
+    SP_DdfSignatures,
+    SP_JsInit,
+    SP_FirstPollCycle,   // milestone
+    SP_FirstRestResponse, // milestone
+    SP_PhaseMax
+};
+
+struct SP_Timing
+{
+    int64_t startUs = -1; // first entry since SP_Start(), -1 if not reached
+    int64_t durationUs = 0; // accumulated, 0 for milestones
+    uint32_t count = 0;
+};
+
+class SP_Scope
+{
+public:
+    explicit SP_Scope(SP_Phase phase);
+    ~SP_Scope();
+
+    SP_Scope(const SP_Scope&) = delete;
+    SP_Scope &operator=(const SP_Scope&) = delete;
+
+private:
+    SP_Phase m_phase;
+    int64_t m_startUs;
+};
+
+void SP_Start();
+void SP_Milestone(SP_Phase phase);
+int64_t SP_ElapsedUs();
+SP_Timing SP_GetTiming(SP_Phase phase);
+bool SP_IsMilestone(SP_Phase phase);
+const char *SP_PhaseName(SP_Phase phase);
+std::string SP_Report();
+
+#endif // STARTUP_PROFILE_H
@@ -0,0 +1,332 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include <algorithm>
+#include "task_scheduler.h"
+
+/*! Exponential weighted moving average with alpha = 1/4. */
+static int64_t updateEwma(int64_t avg, int64_t sample)
+{
+    if (sample < 1)
+    {
+        sample = 1;
+    }
+
+    if (avg == 0)
+    {
+        return sample;
+    }
+
+    return avg + (sample - avg) / 4;
+}
+
+bool TaskScheduler::enqueue(int taskId, uint64_t dst, bool groupcast, TaskPriority prio, uint64_t coalesceKey, int *supersededTaskId, bool coalesceTailOnly)
+{
+    if (supersededTaskId)
+    {
+        *supersededTaskId = -1;
+    }
+
+    if (prio < 0 || prio >= TaskPriorityMax)
+    {
+        prio = TaskPriorityPoll;
+    }
+
+    int replaceTaskId = -1;
+
+    if (coalesceKey != 0)
+    {
+        const auto c = m_coalesce.find(CoalesceKey{dst, coalesceKey});
+        if (c != m_coalesce.end())
+        {
+            const int oldTaskId = c->second;
+            const auto p = m_pending.find(oldTaskId);
+
+            if (p != m_pending.end())
+            {
+                // replace in place, the newer command keeps the queue position of the old one
+                // but is promoted if it has a higher priority
+                PrioClass &pc = m_prio[p->second.prio];
+                auto q = pc.queues.find(dst);
+                // other commands are queued after the old one, both are sent in order
+                const bool keepOrder = coalesceTailOnly && (q == pc.queues.end() || q->second.empty() || q->second.back() != oldTaskId);
+
+                if (!keepOrder && q != pc.queues.end() && p->second.prio <= prio)
+                {
+                    auto i = std::find(q->second.begin(), q->second.end(), oldTaskId);
+                    if (i != q->second.end())
+                    {
+                        *i = taskId;
+                        Pending entry = p->second;
+                        m_pending.erase(p);
+                        m_pending[taskId] = entry;
+                        c->second = taskId;
+
+                        if (supersededTaskId)
+                        {
+                            *supersededTaskId = oldTaskId;
+                        }
+                        return true;
+                    }
+                }
+
+                // different priority, the old one is removed and the new one queued regularly,
+                // only after the capacity checks so that a full queue leaves the old task intact
+                if (!keepOrder)
+                {
+                    replaceTaskId = oldTaskId;
+                }
+            }
+            else
+            {
+                m_coalesce.erase(c);
+            }
+        }
+    }
+
+    // the old task is in another priority class, it only counts against the total
+    if (m_pending.size() - (replaceTaskId != -1 ? 1 : 0) >= MaxQueued)
+    {
+        return false;
+    }
+
+    PrioClass &pc = m_prio[prio];
+    auto q = pc.queues.find(dst);
+
+    if (q != pc.queues.end() && q->second.size() >= MaxQueuedPerDestination)
+    {
+        return false;
+    }
+
+    if (replaceTaskId != -1)
+    {
+        remove(replaceTaskId);
+        if (supersededTaskId)
+        {
+            *supersededTaskId = replaceTaskId;
+        }
+    }
+
+    if (q == pc.queues.end())
+    {
+        // a destination is in the ring as long as it has a queue
+        q = pc.queues.emplace(dst, std::deque<int>()).first;
+        pc.ring.push_back(dst);
+    }
+
+    q->second.push_back(taskId);
+
+    Pending &entry = m_pending[taskId];
+    entry.dst = dst;
+    entry.coalesceKey = coalesceKey;
+    entry.prio = prio;
+    entry.groupcast = groupcast;
+
+    if (coalesceKey != 0)
+    {
+        m_coalesce[CoalesceKey{dst, coalesceKey}] = taskId;
+    }
+
+    return true;
+}
+
+void TaskScheduler::unlinkPending(int taskId, const Pending &p)
+{
+    PrioClass &pc = m_prio[p.prio];
+    auto q = pc.queues.find(p.dst);
+    if (q != pc.queues.end())
+    {
+        auto i = std::find(q->second.begin(), q->second.end(), taskId);
+        if (i != q->second.end())
+        {
+            q->second.erase(i);
+        }
+        // empty queues are dropped lazily from the ring in selectNext()
+    }
+
+    if (p.coalesceKey != 0)
+    {
+        const auto c = m_coalesce.find(CoalesceKey{p.dst, p.coalesceKey});
+        if (c != m_coalesce.end() && c->second == taskId)
+        {
+            m_coalesce.erase(c);
+        }
+    }
+}
+
+bool TaskScheduler::remove(int taskId)
+{
+    const auto p = m_pending.find(taskId);
+    if (p == m_pending.end())
+    {
+        return false;
+    }
+
+    unlinkPending(taskId, p->second);
+    m_pending.erase(p);
+    return true;
+}
+
+void TaskScheduler::markSent(int taskId, int64_t nowMs, bool awaitConfirm)
+{
+    const auto p = m_pending.find(taskId);
+    if (p == m_pending.end())
+    {
+        return;
+    }
+
+    const Pending entry = p->second;
+    unlinkPending(taskId, entry);
+    m_pending.erase(p);
+
+    if (!awaitConfirm)
+    {
+        return;
+    }
+
+    m_onAir[taskId] = OnAir{entry.dst, nowMs, entry.groupcast};
+
+    if (entry.groupcast)
+    {
+        m_groupOnAir++;
+    }
+    else
+    {
+        m_dstStats[entry.dst].onAir++;
+    }
+}
+
+void TaskScheduler::markConfirmed(int taskId, int64_t nowMs)
+{
+    const auto i = m_onAir.find(taskId);
+    if (i == m_onAir.end())
+    {
+        return;
+    }
+
+    const int64_t latency = nowMs - i->second.sendTime;
+
+    if (i->second.groupcast)
+    {
+        m_groupOnAir = std::max(0, m_groupOnAir - 1);
+        m_groupLatencyEwma = updateEwma(m_groupLatencyEwma, latency);
+    }
+    else
+    {
+        DestStats &stats = m_dstStats[i->second.dst];
+        stats.onAir = std::max(0, stats.onAir - 1);
+        stats.latencyEwma = updateEwma(stats.latencyEwma, latency);
+    }
+
+    m_onAir.erase(i);
+}
+
+void TaskScheduler::markDropped(int taskId)
+{
+    const auto i = m_onAir.find(taskId);
+    if (i == m_onAir.end())
+    {
+        return;
+    }
+
+    if (i->second.groupcast)
+    {
+        m_groupOnAir = std::max(0, m_groupOnAir - 1);
+    }
+    else
+    {
+        DestStats &stats = m_dstStats[i->second.dst];
+        stats.onAir = std::max(0, stats.onAir - 1);
+        // a timeout is the worst latency we can get
+        stats.latencyEwma = updateEwma(stats.latencyEwma, TargetLatencyMs * 4);
+    }
+
+    m_onAir.erase(i);
+}
+
+void TaskScheduler::clear()
+{
+    for (PrioClass &pc : m_prio)
+    {
+        pc.queues.clear();
+        pc.ring.clear();
+    }
+    m_pending.clear();
+    m_coalesce.clear();
+    m_onAir.clear();
+    m_groupOnAir = 0;
+
+    for (auto &stats : m_dstStats)
+    {
+        stats.second.onAir = 0;
+    }
+}
+
+size_t TaskScheduler::pendingCount(TaskPriority prio) const
+{
+    size_t result = 0;
+    for (const auto &p : m_pending)
+    {
+        if (p.second.prio == prio)
+        {
+            result++;
+        }
+    }
+    return result;
+}
+
+int TaskScheduler::onAirCount(uint64_t dst) const
+{
+    const auto i = m_dstStats.find(dst);
+    return i != m_dstStats.end() ? i->second.onAir : 0;
+}
+
+int64_t TaskScheduler::confirmLatency(uint64_t dst) const
+{
+    const auto i = m_dstStats.find(dst);
+    return i != m_dstStats.end() ? i->second.latencyEwma : 0;
+}
+
+/*! Returns the number of requests which may be on-air for a destination.
+
+    Fast destinations get up to MaxUnicastOnAir concurrent requests, slow or unreachable
+    ones are throttled down to a single request to not waste network capacity.
+ */
+int TaskScheduler::onAirBudget(uint64_t dst, bool groupcast) const
+{
+    if (groupcast)
+    {
+        if (m_groupLatencyEwma == 0)
+        {
+            return DefaultGroupcastOnAir;
+        }
+        const int64_t budget = (int64_t(MaxGroupcastOnAir) * TargetLatencyMs / 4) / m_groupLatencyEwma;
+        return int(std::min<int64_t>(MaxGroupcastOnAir, std::max<int64_t>(MinGroupcastOnAir, budget)));
+    }
+
+    const int64_t latency = confirmLatency(dst);
+    if (latency == 0)
+    {
+        return DefaultUnicastOnAir;
+    }
+
+    const int64_t budget = TargetLatencyMs / latency;
+    return int(std::min<int64_t>(MaxUnicastOnAir, std::max<int64_t>(MinUnicastOnAir, budget)));
+}
+
+bool TaskScheduler::hasBudget(uint64_t dst, bool groupcast) const
+{
+    if (groupcast)
+    {
+        return m_groupOnAir < onAirBudget(dst, true);
+    }
+
+    return onAirCount(dst) < onAirBudget(dst, false);
+}
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <unordered_map>
+
+/*! Priority classes of APS tasks, lower value means higher priority. */
+enum TaskPriority
+{
+    TaskPriorityUser = 0,   //! interactive REST-API command
+    TaskPriorityRule = 1,   //! rule or schedule action
+    TaskPriorityPoll = 2,   //! polling and maintenance
+    TaskPriorityMax
+};
+
+/*! RAII helper to assign a priority class to all tasks created within a scope.
+ */
+class TaskPriorityScope
+{
+public:
+    TaskPriorityScope(TaskPriority &context, TaskPriority prio) :
+        m_context(context),
+        m_prev(context)
+    {
+        m_context = prio;
+    }
+
+    ~TaskPriorityScope()
+    {
+        m_context = m_prev;
+    }
+
+private:
+    TaskPriority &m_context;
+    TaskPriority m_prev;
+};
+
+/*! \class TaskScheduler
+
+    Decides which queued APS task is sent next. The scheduler only deals with task ids,
+    the TaskItem storage stays with the caller.
+
+    - Each priority class has per destination FIFO queues which are served round-robin,
+      so one busy or unreachable destination doesn't block its neighbours.
+    - Superseded commands with the same coalesce key replace the pending task in O(1)
+      while keeping its queue position.
+    - The number of requests on-air per destination is adapted to the measured
+      APS confirm latency of that destination.
+ */
+class TaskScheduler
+{
+public:
+    enum Limits
+    {
+        MaxQueuedPerDestination = 20,
+        MaxQueued = 256,
+        MinUnicastOnAir = 1,
+        DefaultUnicastOnAir = 2,
+        MaxUnicastOnAir = 4,
+        MinGroupcastOnAir = 2,
+        DefaultGroupcastOnAir = 6,
+        MaxGroupcastOnAir = 8,
+        TargetLatencyMs = 1000   //! confirm latency at which the unicast budget is 1
+    };
+
+    /*! Adds a task to the queue of its destination.
+
+        \param coalesceKey - non zero key of commands to the same destination which supersede each other, 0 to never coalesce.
+        \param supersededTaskId - set to the replaced task id if a pending task was superseded, otherwise -1.
+        \param coalesceTailOnly - only supersede the pending task if it is the last one queued for the destination,
+                                  for commands which must not overtake other commands.
+        \returns true if the task was queued or replaced a pending task, false if the queue is full.
+                 On false nothing is changed and no task was superseded.
+     */
+    bool enqueue(int taskId, uint64_t dst, bool groupcast, TaskPriority prio, uint64_t coalesceKey, int *supersededTaskId, bool coalesceTailOnly = false);
+
+    /*! Removes a pending task without sending it. */
+    bool remove(int taskId);
+
+    /*! Returns the next task id which may be sent or -1.
+
+        The task remains queued until markSent() or remove() is called.
+        \p canSend(taskId) allows the caller to veto tasks, e.g. for ordering constraints.
+     */
+    template <typename F>
+    int selectNext(F canSend);
+
+    /*! Moves a pending task on-air, if \p awaitConfirm is false it only leaves the queue. */
+    void markSent(int taskId, int64_t nowMs, bool awaitConfirm);
+    /*! Takes a task off-air and feeds its confirm latency into the budget of the destination. */
+    void markConfirmed(int taskId, int64_t nowMs);
+    /*! Takes a task off-air without latency sample, e.g. after a timeout. */
+    void markDropped(int taskId);
+    void clear();
+
+    size_t pendingCount() const { return m_pending.size(); }
+    size_t pendingCount(TaskPriority prio) const;
+    int onAirCount(uint64_t dst) const;
+    int onAirBudget(uint64_t dst, bool groupcast) const;
+    int64_t confirmLatency(uint64_t dst) const;
+
+private:
+    struct Pending
+    {
+        uint64_t dst;
+        uint64_t coalesceKey;
+        TaskPriority prio;
+        bool groupcast;
+    };
+
+    struct OnAir
+    {
+        uint64_t dst;
+        int64_t sendTime;
+        bool groupcast;
+    };
+
+    struct DestStats
+    {
+        int onAir = 0;
+        int64_t latencyEwma = 0; // ms, 0 = unknown
+    };
+
+    struct CoalesceKey
+    {
+        uint64_t dst;
+        uint64_t key;
+        bool operator==(const CoalesceKey &other) const { return dst == other.dst && key == other.key; }
+    };
+
+    struct CoalesceKeyHash
+    {
+        size_t operator()(const CoalesceKey &k) const { return std::hash<uint64_t>()(k.dst * 0x9E3779B97F4A7C15ULL ^ k.key); }
+    };
+
+    struct PrioClass
+    {
+        std::unordered_map<uint64_t, std::deque<int>> queues; // per destination FIFO
+        std::deque<uint64_t> ring; // destinations with queued tasks, served round-robin
+    };
+
+    bool hasBudget(uint64_t dst, bool groupcast) const;
+    void unlinkPending(int taskId, const Pending &p);
+
+    PrioClass m_prio[TaskPriorityMax];
+    std::unordered_map<int, Pending> m_pending;
+    std::unordered_map<CoalesceKey, int, CoalesceKeyHash> m_coalesce; // (destination, coalesce key) -> pending task id
+    std::unordered_map<int, OnAir> m_onAir;
+    std::unordered_map<uint64_t, DestStats> m_dstStats;
+    int m_groupOnAir = 0;
+    int64_t m_groupLatencyEwma = 0;
+};
+
+template <typename F>
+int TaskScheduler::selectNext(F canSend)
+{
+    for (int prio = 0; prio < TaskPriorityMax; prio++)
+    {
+        PrioClass &pc = m_prio[prio];
+
+        for (size_t n = pc.ring.size(); n > 0; n--)
+        {
+            const uint64_t dst = pc.ring.front();
+            pc.ring.pop_front();
+
+            auto q = pc.queues.find(dst);
+            if (q == pc.queues.end() || q->second.empty())
+            {
+                if (q != pc.queues.end())
+                {
+                    pc.queues.erase(q);
+                }
+                continue; // drop destination from ring
+            }
+
+            pc.ring.push_back(dst); // rotate for fairness
+
+            const int taskId = q->second.front();
+            const auto p = m_pending.find(taskId);
+            if (p == m_pending.end())
+            {
+                continue;
+            }
+
+            if (!hasBudget(dst, p->second.groupcast))
+            {
+                continue;
+            }
+
+            if (canSend(taskId))
+            {
+                return taskId;
+            }
+        }
+    }
+
+    return -1;
+}
+
+#endif // TASK_SCHEDULER_H
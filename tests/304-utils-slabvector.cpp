@@ -0,0 +1,91 @@
+#include <string>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "utils/slabvector.h"
+
+struct SlabItem
+{
+    explicit SlabItem(int n) : id(std::to_string(n)), value(n) {}
+    std::string id;
+    int value = 0;
+};
+
+struct SlabHandle
+{
+    size_t index;
+    uint16_t generation;
+    const SlabItem *ptr;
+};
+
+TEST_CASE("SlabVector keeps addresses stable while growing")
+{
+    SlabVector<SlabItem, 64> items;
+    std::vector<SlabHandle> handles;
+
+    const int count = 5000;
+
+    for (int i = 0; i < count; i++)
+    {
+        items.emplace_back(i);
+        const size_t idx = items.size() - 1;
+        handles.push_back({idx, items.generation(idx), &items.back()});
+
+        // verify a handle taken early survives every chunk allocation
+        REQUIRE(&items[handles[0].index] == handles[0].ptr);
+    }
+
+    REQUIRE(items.size() == size_t(count));
+
+    for (const auto &hnd : handles)
+    {
+        REQUIRE(items.isValid(hnd.index, hnd.generation));
+        const SlabItem &item = items[hnd.index];
+        REQUIRE(&item == hnd.ptr);
+        REQUIRE(item.value == int(hnd.index));
+        REQUIRE(item.id == std::to_string(hnd.index));
+    }
+
+    SECTION("iteration covers all elements in order")
+    {
+        int n = 0;
+        for (const SlabItem &item : items)
+        {
+            REQUIRE(item.value == n);
+            n++;
+        }
+        REQUIRE(n == count);
+        REQUIRE(items.end() - items.begin() == count);
+    }
+
+    SECTION("reused slots invalidate old handles")
+    {
+        const SlabHandle last = handles.back();
+        items.pop_back();
+        REQUIRE(!items.isValid(last.index, last.generation));
+
+        items.emplace_back(int(last.index));
+        REQUIRE(!items.isValid(last.index, last.generation));
+        REQUIRE(items.isValid(last.index, items.generation(last.index)));
+        // still the same memory slot
+        REQUIRE(&items.back() == last.ptr);
+
+        items.clear();
+        REQUIRE(items.empty());
+        REQUIRE(!items.isValid(handles[0].index, handles[0].generation));
+    }
+}
+
+TEST_CASE("SlabVector benchmark")
+{
+    BENCHMARK("push_back 10000 elements")
+    {
+        SlabVector<SlabItem> items;
+        for (int i = 0; i < 10000; i++)
+        {
+            items.emplace_back(i);
+        }
+        return items.size();
+    };
+}
@@ -0,0 +1,148 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "catch2/catch.hpp"
+
+#include "crypto/verify_worker.h"
+
+using Clock = std::chrono::steady_clock;
+
+static int64_t elapsedMs(Clock::time_point t)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - t).count();
+}
+
+/*
+ * Stand-in for CRYPTO_ScryptVerify(), burns CPU for about the time of a
+ * scrypt calculation on a Raspberry Pi (N=1024, r=8, p=16).
+ */
+static bool expensiveVerify(int code)
+{
+    const auto start = Clock::now();
+    volatile uint32_t h = 2166136261U;
+    while (elapsedMs(start) < 30)
+    {
+        for (int i = 0; i < 1000; i++)
+        {
+            h = (h ^ uint32_t(i)) * 16777619U;
+        }
+    }
+    return code == 1234;
+}
+
+TEST_CASE("VerifyWorker keeps the event loop responsive")
+{
+    VerifyWorker worker;
+    std::atomic<int> notified{0};
+    worker.setNotify([&notified]() { notified++; });
+
+    const int attempts = 20;
+    int results = 0;
+    int valid = 0;
+
+    for (int i = 0; i < attempts; i++)
+    {
+        const int code = (i == attempts - 1) ? 1234 : i;
+        worker.submit([code]() { return expensiveVerify(code); }, [&results, &valid](bool ok)
+        {
+            results++;
+            if (ok) { valid++; }
+        });
+    }
+
+    REQUIRE(worker.pendingCount() == attempts);
+
+    // simulated event loop, each iteration should run within a few milliseconds
+    int64_t maxLatency = 0;
+    const auto start = Clock::now();
+    auto last = Clock::now();
+
+    while (results < attempts && elapsedMs(start) < 10000)
+    {
+        worker.processResults();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        maxLatency = std::max(maxLatency, elapsedMs(last));
+        last = Clock::now();
+    }
+
+    INFO("max event loop latency " << maxLatency << " ms for " << attempts << " verifications in " << elapsedMs(start) << " ms");
+    REQUIRE(results == attempts);
+    REQUIRE(valid == 1);
+    REQUIRE(notified == attempts);
+    REQUIRE(worker.pendingCount() == 0);
+    REQUIRE(maxLatency < 20);
+
+    // for comparison: the same work on the event loop stalls it for each attempt
+    const auto t = Clock::now();
+    expensiveVerify(0);
+    REQUIRE(elapsedMs(t) >= 30);
+}
+
+TEST_CASE("VerifyRateLimiter locks out brute force attempts per source")
+{
+    VerifyRateLimiter limiter;
+    const uint64_t keypad = 0x00158d0001020304ULL;
+    const uint64_t other = 0x00158d0005060708ULL;
+    int64_t now = 1000;
+
+    // one verification in flight per source
+    REQUIRE(limiter.begin(keypad, now));
+    REQUIRE(!limiter.begin(keypad, now));
+    REQUIRE(limiter.begin(other, now));
+    limiter.end(other, true, now);
+
+    limiter.end(keypad, false, now);
+
+    // free attempts
+    for (int i = 1; i < VerifyRateLimiter::FreeFailures; i++)
+    {
+        REQUIRE(limiter.begin(keypad, now));
+        limiter.end(keypad, false, now);
+    }
+
+    // lockout doubles with each further failure
+    int64_t lockout = VerifyRateLimiter::LockoutMs;
+    for (int i = 0; i < 4; i++)
+    {
+        REQUIRE(limiter.begin(keypad, now));
+        limiter.end(keypad, false, now);
+        REQUIRE(limiter.lockedUntil(keypad) == now + lockout);
+        REQUIRE(!limiter.begin(keypad, now + lockout - 1));
+        REQUIRE(limiter.begin(other, now)); // other sources aren't affected
+        limiter.end(other, true, now);
+        now += lockout;
+        lockout *= 2;
+    }
+
+    // success resets the source
+    REQUIRE(limiter.begin(keypad, now));
+    limiter.end(keypad, true, now);
+    REQUIRE(limiter.lockedUntil(keypad) == 0);
+
+    // lockout is capped
+    for (int i = 0; i < 40; i++)
+    {
+        REQUIRE(limiter.begin(keypad, now));
+        limiter.end(keypad, false, now);
+        now = limiter.lockedUntil(keypad);
+    }
+    REQUIRE(limiter.begin(keypad, now));
+    limiter.end(keypad, false, now);
+    REQUIRE(limiter.lockedUntil(keypad) - now == VerifyRateLimiter::MaxLockoutMs);
+}
+
+TEST_CASE("VerifyRateLimiter bounded number of sources")
+{
+    VerifyRateLimiter limiter;
+
+    for (uint64_t src = 1; src <= 1000; src++)
+    {
+        REQUIRE(limiter.begin(src, int64_t(src)));
+        limiter.end(src, false, int64_t(src));
+    }
+
+    // spoofed sources don't exhaust memory, old entries are evicted
+    REQUIRE(limiter.lockedUntil(1) == 0);
+    REQUIRE(limiter.begin(1000, 1000) == true);
+}
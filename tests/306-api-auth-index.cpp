@@ -0,0 +1,198 @@
+#include "catch2/catch.hpp"
+
+#include "api_auth.h"
+
+static std::vector<ApiAuth> makeAuths(int count, const QDateTime &lastUse)
+{
+    std::vector<ApiAuth> auths;
+    auths.reserve(size_t(count));
+
+    for (int i = 0; i < count; i++)
+    {
+        ApiAuth auth;
+        auth.apikey = QString("%1").arg(0x1000000000ULL + quint64(i) * 7919, 10, 16, QLatin1Char('0')).toUpper();
+        auth.devicetype = QLatin1String("test#client");
+        auth.createDate = lastUse;
+        auth.lastUseDate = lastUse;
+        auths.push_back(auth);
+    }
+
+    return auths;
+}
+
+/*
+ * Linear lookup as done by authorise() before the index was added.
+ */
+static int linearFind(const std::vector<ApiAuth> &auths, const QString &apikey)
+{
+    for (size_t i = 0; i < auths.size(); i++)
+    {
+        if (auths[i].apikey == apikey && auths[i].state == ApiAuth::StateNormal)
+        {
+            return int(i);
+        }
+    }
+    return -1;
+}
+
+TEST_CASE("ApiAuthIndex lookup follows vector changes")
+{
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    std::vector<ApiAuth> auths = makeAuths(100, now);
+    ApiAuthIndex index;
+
+    for (size_t i = 0; i < auths.size(); i++)
+    {
+        REQUIRE(index.find(auths, auths[i].apikey) == int(i));
+    }
+
+    REQUIRE(index.find(auths, QLatin1String("unknownkey")) == -1);
+
+    // deleted entries aren't found
+    const QString deleted = auths[10].apikey;
+    auths[10].state = ApiAuth::StateDeleted;
+    REQUIRE(index.find(auths, deleted) == -1);
+
+    // appended entries are found
+    ApiAuth auth;
+    auth.apikey = QLatin1String("ABCDEF0123");
+    auths.push_back(auth);
+    REQUIRE(index.find(auths, auth.apikey) == int(auths.size() - 1));
+
+    // same size but different positions
+    std::swap(auths[0], auths[1]);
+    index.invalidate();
+    REQUIRE(index.find(auths, auths[0].apikey) == 0);
+    REQUIRE(index.find(auths, auths[1].apikey) == 1);
+
+    // re-created key after delete
+    auth.apikey = deleted;
+    auths.push_back(auth);
+    REQUIRE(index.find(auths, deleted) == int(auths.size() - 1));
+}
+
+TEST_CASE("ApiAuthIndex finds a new key after compaction restored the vector size")
+{
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    std::vector<ApiAuth> auths = makeAuths(10, now);
+    ApiAuthIndex index;
+
+    REQUIRE(index.find(auths, auths[9].apikey) == 9);
+
+    // saveDb() removed a deleted key, createUser() appended a new one
+    auths[4].state = ApiAuth::StateDeleted;
+    REQUIRE(API_CompactDeleted(auths) == 1);
+
+    ApiAuth auth;
+    auth.apikey = QLatin1String("ABCDEF0123");
+    auths.push_back(auth);
+    REQUIRE(auths.size() == 10);
+
+    // as in saveDb() and createUser()
+    index.invalidate();
+    REQUIRE(index.find(auths, auth.apikey) == 9);
+    REQUIRE(index.find(auths, auths[4].apikey) == 4);
+
+    // deleted key re-created in place of a compacted one
+    const QString deleted = auths[0].apikey;
+    auths[0].state = ApiAuth::StateDeleted;
+    index.invalidate();
+    REQUIRE(index.find(auths, deleted) == -1);
+    auths[1].apikey = deleted;
+    index.invalidate();
+    REQUIRE(index.find(auths, deleted) == 1);
+
+    index.invalidate();
+    REQUIRE(index.find(auths, QLatin1String("unknownkey")) == -1);
+}
+
+TEST_CASE("API keys are pruned incrementally")
+{
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    std::vector<ApiAuth> auths = makeAuths(1000, now.addDays(-100));
+
+    // every second key was used recently, one only batched in lastUseMs
+    for (size_t i = 0; i < auths.size(); i += 2)
+    {
+        auths[i].lastUseDate = now.addDays(-1);
+    }
+    auths[1].lastUseMs = 5000;
+
+    ApiAuthPruneState state;
+    state.active = true;
+    state.threshold = now.addDays(-30);
+    state.keepApikey = auths[3].apikey;
+
+    int steps = 0;
+    while (API_PruneStep(auths, state, 50))
+    {
+        steps++;
+        REQUIRE(state.cursor == size_t(steps * 50));
+    }
+
+    REQUIRE(steps == 19);
+    REQUIRE(!state.active);
+    REQUIRE(state.pruned == 498);
+    REQUIRE(auths[0].state == ApiAuth::StateNormal);
+    REQUIRE(auths[1].state == ApiAuth::StateNormal);
+    REQUIRE(auths[3].state == ApiAuth::StateNormal);
+    REQUIRE(auths[5].state == ApiAuth::StateDeleted);
+    REQUIRE(auths[5].needSaveDatabase);
+
+    // batched last use is converted to a date
+    REQUIRE(API_FlushLastUse(auths, 10000, now) == 1);
+    REQUIRE(auths[1].lastUseMs == 0);
+    REQUIRE(auths[1].lastUseDate == now.addMSecs(-5000));
+    REQUIRE(auths[1].needSaveDatabase);
+
+    // deleted entries are only removed after they are saved
+    REQUIRE(API_CompactDeleted(auths) == 0);
+
+    for (ApiAuth &auth : auths)
+    {
+        auth.needSaveDatabase = false;
+    }
+
+    REQUIRE(API_CompactDeleted(auths) == 498);
+    REQUIRE(auths.size() == 502);
+
+    ApiAuthIndex index;
+    for (size_t i = 0; i < auths.size(); i++)
+    {
+        REQUIRE(index.find(auths, auths[i].apikey) == int(i));
+    }
+}
+
+TEST_CASE("Authorisation throughput with 1000 keys", "[!benchmark]")
+{
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    std::vector<ApiAuth> auths = makeAuths(1000, now);
+    ApiAuthIndex index;
+
+    std::vector<QString> keys;
+    for (size_t i = 0; i < auths.size(); i += 7)
+    {
+        keys.push_back(auths[i].apikey);
+    }
+    keys.push_back(QLatin1String("unknownkey"));
+
+    BENCHMARK("linear search")
+    {
+        int found = 0;
+        for (const QString &key : keys)
+        {
+            found += linearFind(auths, key) >= 0 ? 1 : 0;
+        }
+        return found;
+    };
+
+    BENCHMARK("hash index")
+    {
+        int found = 0;
+        for (const QString &key : keys)
+        {
+            found += index.find(auths, key) >= 0 ? 1 : 0;
+        }
+        return found;
+    };
+}
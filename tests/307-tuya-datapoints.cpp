@@ -0,0 +1,223 @@
+#include <string>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "tuya_dp.h"
+
+/*
+ * TY_DATA_REPORT payloads (without ZCL header) as recorded from TS0601 TRVs.
+ */
+static const std::vector<std::vector<uint8_t>> trvFrames = {
+    // single datapoint: local temperature 21.5 °C
+    { 0x00, 0x4c, 0x03, 0x02, 0x00, 0x04, 0x00, 0x00, 0x00, 0xd7 },
+    // multi datapoint status after query
+    { 0x01, 0x02,
+      0x02, 0x02, 0x00, 0x04, 0x00, 0x00, 0x00, 0xc8, // heat setpoint 20.0
+      0x03, 0x02, 0x00, 0x04, 0x00, 0x00, 0x00, 0xd2, // local temperature 21.0
+      0x04, 0x04, 0x00, 0x01, 0x01,                   // preset
+      0x07, 0x01, 0x00, 0x01, 0x00,                   // child lock
+      0x0d, 0x02, 0x00, 0x04, 0x00, 0x00, 0x00, 0x64, // battery
+      0x0e, 0x04, 0x00, 0x01, 0x00,                   // fault
+      0x12, 0x01, 0x00, 0x01, 0x01,                   // window open
+      0x14, 0x02, 0x00, 0x04, 0x00, 0x00, 0x00, 0x32, // valve
+      0x15, 0x02, 0x00, 0x04, 0xff, 0xff, 0xff, 0xf6, // calibration -1.0
+      0x1a, 0x05, 0x00, 0x01, 0x03,                   // error bitmap
+      0x65, 0x00, 0x00, 0x08, 0x06, 0x00, 0x14, 0x08, 0x00, 0x0f, 0x11, 0x1e, // schedule (raw)
+      0x66, 0x02, 0x00, 0x04, 0x00, 0x00, 0x00, 0x05,
+      0x67, 0x02, 0x00, 0x04, 0x00, 0x00, 0x00, 0x23,
+      0x68, 0x04, 0x00, 0x01, 0x02,
+      0x69, 0x02, 0x00, 0x04, 0x00, 0x00, 0x01, 0x2c,
+      0x6a, 0x01, 0x00, 0x01, 0x00,
+      0x6b, 0x01, 0x00, 0x01, 0x01,
+      0x6c, 0x01, 0x00, 0x01, 0x00,
+      0x6d, 0x03, 0x00, 0x05, 'v', '1', '.', '0', '2', // firmware string
+      0x6e, 0x05, 0x00, 0x02, 0x01, 0x80
+    },
+    // valve and setpoint change
+    { 0x01, 0x03,
+      0x14, 0x02, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00,
+      0x02, 0x02, 0x00, 0x04, 0x00, 0x00, 0x00, 0xbe
+    }
+};
+
+// DPIDs of the items on a TRV sensor, one parse call per item and frame
+static const std::vector<uint8_t> trvItems = {
+    0x02, 0x03, 0x04, 0x07, 0x0d, 0x0e, 0x12, 0x14, 0x15, 0x1a, 0x65,
+    0x66, 0x67, 0x68, 0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e, 0x70, 0x71
+};
+
+/*
+ * Previous behaviour: each item walks the whole payload to find its datapoint.
+ */
+static bool scanForDataPoint(const std::vector<uint8_t> &payload, uint8_t dpid, int64_t *value)
+{
+    size_t pos = 2;
+    bool found = false;
+
+    while (pos + 4 <= payload.size())
+    {
+        const uint8_t id = payload[pos];
+        const uint8_t type = payload[pos + 1];
+        const uint16_t length = uint16_t(payload[pos + 2] << 8 | payload[pos + 3]);
+        pos += 4;
+
+        if (pos + length > payload.size())
+        {
+            break;
+        }
+
+        int64_t v = 0;
+        if (type != TuyaDataTypeRaw && type != TuyaDataTypeString)
+        {
+            uint32_t u = 0;
+            for (unsigned i = 0; i < length && i < 4; i++)
+            {
+                u = (u << 8) | payload[pos + i];
+            }
+            v = type == TuyaDataTypeValue ? int64_t(int32_t(u)) : int64_t(u);
+        }
+
+        if (id == dpid)
+        {
+            *value = v;
+            found = true;
+        }
+
+        pos += length;
+    }
+
+    return found;
+}
+
+TEST_CASE("Tuya datapoints are decoded once per frame")
+{
+    TY_DataPoints dps;
+    const auto &frame = trvFrames[1];
+
+    REQUIRE(TY_DecodeDataPoints(frame.data(), frame.size(), &dps));
+    REQUIRE(dps.complete);
+    REQUIRE(dps.seq == 0x0102);
+    REQUIRE(dps.count == 20);
+
+    const TY_DataPoint *dp = TY_FindDataPoint(dps, 0x02);
+    REQUIRE(dp);
+    REQUIRE(dp->type == TuyaDataTypeValue);
+    REQUIRE(dp->value == 200);
+
+    dp = TY_FindDataPoint(dps, 0x15);
+    REQUIRE(dp);
+    REQUIRE(dp->value == -10);
+
+    dp = TY_FindDataPoint(dps, 0x12);
+    REQUIRE(dp);
+    REQUIRE(dp->type == TuyaDataTypeBool);
+    REQUIRE(dp->value == 1);
+
+    dp = TY_FindDataPoint(dps, 0x6e);
+    REQUIRE(dp);
+    REQUIRE(dp->type == TuyaDataTypeBitmap);
+    REQUIRE(dp->value == 0x0180);
+
+    // raw and string datapoints reference the payload
+    dp = TY_FindDataPoint(dps, 0x65);
+    REQUIRE(dp);
+    REQUIRE(dp->type == TuyaDataTypeRaw);
+    REQUIRE(dp->length == 8);
+    REQUIRE(frame[dp->offset] == 0x06);
+    REQUIRE(frame[dp->offset + 7] == 0x1e);
+
+    dp = TY_FindDataPoint(dps, 0x6d);
+    REQUIRE(dp);
+    REQUIRE(dp->type == TuyaDataTypeString);
+    REQUIRE(std::string(reinterpret_cast<const char*>(&frame[dp->offset]), dp->length) == "v1.02");
+
+    REQUIRE(TY_FindDataPoint(dps, 0x70) == nullptr);
+}
+
+TEST_CASE("Malformed Tuya frames keep the valid datapoints")
+{
+    TY_DataPoints dps;
+
+    // truncated second datapoint
+    const uint8_t truncated[] = { 0x00, 0x01, 0x01, 0x01, 0x00, 0x01, 0x01, 0x02, 0x02, 0x00, 0x04, 0x00, 0x00 };
+    REQUIRE(TY_DecodeDataPoints(truncated, sizeof(truncated), &dps));
+    REQUIRE(!dps.complete);
+    REQUIRE(dps.count == 1);
+    REQUIRE(TY_FindDataPoint(dps, 0x01));
+    REQUIRE(!TY_FindDataPoint(dps, 0x02));
+
+    // unknown type
+    const uint8_t unknown[] = { 0x00, 0x01, 0x01, 0x09, 0x00, 0x01, 0x01 };
+    REQUIRE(!TY_DecodeDataPoints(unknown, sizeof(unknown), &dps));
+    REQUIRE(dps.count == 0);
+
+    // wrong length for value
+    const uint8_t badLength[] = { 0x00, 0x01, 0x02, 0x02, 0x00, 0x02, 0x00, 0x01 };
+    REQUIRE(!TY_DecodeDataPoints(badLength, sizeof(badLength), &dps));
+
+    REQUIRE(!TY_DecodeDataPoints(truncated, 1, &dps));
+
+    // duplicate DPIDs, the last one wins
+    const uint8_t dup[] = { 0x00, 0x01, 0x04, 0x04, 0x00, 0x01, 0x01, 0x04, 0x04, 0x00, 0x01, 0x02 };
+    REQUIRE(TY_DecodeDataPoints(dup, sizeof(dup), &dps));
+    REQUIRE(dps.count == 2);
+    REQUIRE(TY_FindDataPoint(dps, 0x04)->value == 2);
+}
+
+TEST_CASE("Tuya TRV frame parse benchmark")
+{
+    // both variants must agree
+    for (const auto &frame : trvFrames)
+    {
+        TY_DataPoints dps;
+        TY_DecodeDataPoints(frame.data(), frame.size(), &dps);
+
+        for (uint8_t dpid : trvItems)
+        {
+            int64_t value = 0;
+            const TY_DataPoint *dp = TY_FindDataPoint(dps, dpid);
+            REQUIRE(scanForDataPoint(frame, dpid, &value) == (dp != nullptr));
+            if (dp)
+            {
+                REQUIRE(dp->value == value);
+            }
+        }
+    }
+
+    BENCHMARK("per item payload scan")
+    {
+        int64_t sum = 0;
+        for (const auto &frame : trvFrames)
+        {
+            for (uint8_t dpid : trvItems)
+            {
+                int64_t value = 0;
+                if (scanForDataPoint(frame, dpid, &value))
+                {
+                    sum += value;
+                }
+            }
+        }
+        return sum;
+    };
+
+    BENCHMARK("decode once and lookup")
+    {
+        int64_t sum = 0;
+        TY_DataPoints dps;
+        for (const auto &frame : trvFrames)
+        {
+            TY_DecodeDataPoints(frame.data(), frame.size(), &dps);
+            for (uint8_t dpid : trvItems)
+            {
+                const TY_DataPoint *dp = TY_FindDataPoint(dps, dpid);
+                if (dp)
+                {
+                    sum += dp->value;
+                }
+            }
+        }
+        return sum;
+    };
+}
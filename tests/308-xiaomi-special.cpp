@@ -0,0 +1,223 @@
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "xiaomi_special.h"
+
+/*
+ * Attribute report payloads (without ZCL header) as captured from Aqara devices.
+ */
+
+// lumi.weather, basic cluster 0xff01 after model identifier 0x0005
+static const std::vector<uint8_t> lumiWeather = {
+    0x05, 0x00, 0x42, 0x0c, 'l', 'u', 'm', 'i', '.', 'w', 'e', 'a', 't', 'h', 'e', 'r',
+    0x01, 0xff, 0x42, 0x25,
+    0x01, 0x21, 0xd1, 0x0b,                   // battery 3025 mV
+    0x04, 0x21, 0xa8, 0x13,
+    0x05, 0x21, 0x2b, 0x00,
+    0x06, 0x24, 0x01, 0x00, 0x00, 0x00, 0x00, // uint40
+    0x64, 0x29, 0xc2, 0x07,                   // temperature 19.86 °C
+    0x65, 0x21, 0x1e, 0x14,                   // humidity 51.50 %
+    0x66, 0x2b, 0x5b, 0x88, 0x01, 0x00,       // pressure 100443 Pa
+    0x0a, 0x21, 0x00, 0x00
+};
+
+// lumi.sensor_magnet.aq2, basic cluster 0xff01
+static const std::vector<uint8_t> lumiMagnetAq2 = {
+    0x01, 0xff, 0x42, 0x1d,
+    0x01, 0x21, 0xb3, 0x0b,
+    0x03, 0x28, 0xe7,                         // device temperature -25 °C
+    0x04, 0x21, 0xa8, 0x01,
+    0x05, 0x21, 0x09, 0x00,
+    0x06, 0x24, 0x02, 0x00, 0x00, 0x00, 0x00,
+    0x0a, 0x21, 0x00, 0x00,
+    0x64, 0x10, 0x01                          // open
+};
+
+// lumi.sensor_magnet, basic cluster 0xff02 struct
+static const std::vector<uint8_t> lumiMagnet = {
+    0x02, 0xff, 0x4c, 0x06, 0x00,
+    0x10, 0x01,                               // on/off
+    0x21, 0xb3, 0x0b,                         // battery 2995 mV
+    0x21, 0xa8, 0x01,
+    0x24, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x21, 0x17, 0x00,
+    0x20, 0x5c
+};
+
+// lumi.plug.mmeu01, lumi cluster 0xfcc0 attribute 0x00f7
+static const std::vector<uint8_t> lumiPlug = {
+    0xf7, 0x00, 0x41, 0x3d,
+    0x03, 0x28, 0x1e,                         // device temperature 30 °C
+    0x05, 0x21, 0x01, 0x00,
+    0x9a, 0x20, 0x00,
+    0x08, 0x21, 0x1c, 0x01,
+    0x07, 0x27, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x09, 0x21, 0x00, 0x04,
+    0x0b, 0x20, 0x00,
+    0x9b, 0x10, 0x01,
+    0x64, 0x10, 0x01,                         // on
+    0x95, 0x39, 0x00, 0x00, 0x00, 0x3e,       // consumption 0.125 kWh
+    0x96, 0x39, 0x00, 0x10, 0x10, 0x45,       // voltage 2305 (230.5 V)
+    0x97, 0x39, 0x00, 0x00, 0x58, 0x42,       // current 54 mA
+    0x98, 0x39, 0x00, 0x00, 0x48, 0x41        // power 12.5 W
+};
+
+// tags read by xiaomi:special items of each device
+static const std::vector<uint8_t> weatherItems = { 0x01, 0x64, 0x65, 0x66 };
+static const std::vector<uint8_t> plugItems = { 0x03, 0x64, 0x95, 0x96, 0x97, 0x98 };
+
+/*
+ * Previous behaviour: each item walks the payload up to its tag.
+ */
+static const XM_Tag *scanForTag(const std::vector<uint8_t> &payload, uint8_t tag, XM_SpecialReport *tmp)
+{
+    XM_DecodeSpecialReport(payload.data(), payload.size(), tmp);
+    return XM_FindTag(*tmp, tag);
+}
+
+TEST_CASE("Xiaomi 0xff01 report of lumi.weather")
+{
+    XM_SpecialReport report;
+
+    REQUIRE(XM_DecodeSpecialReport(lumiWeather.data(), lumiWeather.size(), &report));
+    REQUIRE(report.complete);
+    REQUIRE(report.attrId == 0xff01);
+    REQUIRE(report.count == 8);
+
+    const XM_Tag *t = XM_FindTag(report, 0x01);
+    REQUIRE(t);
+    REQUIRE(t->dataType == 0x21);
+    REQUIRE(t->value.u64 == 3025);
+
+    t = XM_FindTag(report, 0x64);
+    REQUIRE(t);
+    REQUIRE(t->value.s64 == 1986);
+
+    t = XM_FindTag(report, 0x65);
+    REQUIRE(t);
+    REQUIRE(t->value.u64 == 5150);
+
+    t = XM_FindTag(report, 0x66);
+    REQUIRE(t);
+    REQUIRE(t->dataType == 0x2b);
+    REQUIRE(t->value.s64 == 100443);
+    REQUIRE(t->length == 4);
+    REQUIRE(lumiWeather[t->offset] == 0x5b);
+
+    REQUIRE(XM_FindTag(report, 0x95) == nullptr);
+}
+
+TEST_CASE("Xiaomi 0xff01 report of lumi.sensor_magnet.aq2")
+{
+    XM_SpecialReport report;
+
+    REQUIRE(XM_DecodeSpecialReport(lumiMagnetAq2.data(), lumiMagnetAq2.size(), &report));
+    REQUIRE(report.complete);
+    REQUIRE(report.count == 7);
+    REQUIRE(XM_FindTag(report, 0x03)->value.s64 == -25);
+    REQUIRE(XM_FindTag(report, 0x06)->value.u64 == 2);
+    REQUIRE(XM_FindTag(report, 0x64)->dataType == 0x10);
+    REQUIRE(XM_FindTag(report, 0x64)->value.u64 == 1);
+}
+
+TEST_CASE("Xiaomi 0xff02 struct report of lumi.sensor_magnet")
+{
+    XM_SpecialReport report;
+
+    REQUIRE(XM_DecodeSpecialReport(lumiMagnet.data(), lumiMagnet.size(), &report));
+    REQUIRE(report.complete);
+    REQUIRE(report.attrId == 0xff02);
+    REQUIRE(report.count == 6);
+
+    // struct elements are addressed by 0-based index
+    REQUIRE(XM_FindTag(report, 0)->value.u64 == 1);
+    REQUIRE(XM_FindTag(report, 1)->value.u64 == 2995);
+    REQUIRE(XM_FindTag(report, 5)->value.u64 == 0x5c);
+    REQUIRE(XM_FindTag(report, 6) == nullptr);
+}
+
+TEST_CASE("Xiaomi 0x00f7 report of lumi.plug.mmeu01")
+{
+    XM_SpecialReport report;
+
+    REQUIRE(XM_DecodeSpecialReport(lumiPlug.data(), lumiPlug.size(), &report));
+    REQUIRE(report.complete);
+    REQUIRE(report.attrId == 0x00f7);
+    REQUIRE(report.count == 13);
+
+    REQUIRE(XM_FindTag(report, 0x03)->value.s64 == 30);
+    REQUIRE(XM_FindTag(report, 0x95)->value.real == Approx(0.125));
+    REQUIRE(XM_FindTag(report, 0x96)->value.real == Approx(2305));
+    REQUIRE(XM_FindTag(report, 0x97)->value.real == Approx(54));
+    REQUIRE(XM_FindTag(report, 0x98)->value.real == Approx(12.5));
+}
+
+TEST_CASE("Xiaomi special report edge cases")
+{
+    XM_SpecialReport report;
+
+    // no special attribute
+    REQUIRE(!XM_DecodeSpecialReport(lumiWeather.data(), 16, &report));
+    REQUIRE(report.attrId == 0);
+
+    // truncated in the middle of the pressure value
+    REQUIRE(XM_DecodeSpecialReport(lumiWeather.data(), lumiWeather.size() - 7, &report));
+    REQUIRE(!report.complete);
+    REQUIRE(report.count == 6);
+    REQUIRE(XM_FindTag(report, 0x65));
+    REQUIRE(!XM_FindTag(report, 0x66));
+
+    // unsupported data type stops decoding
+    std::vector<uint8_t> bad = lumiMagnetAq2;
+    bad[9] = 0x48; // array
+    REQUIRE(XM_DecodeSpecialReport(bad.data(), bad.size(), &report));
+    REQUIRE(!report.complete);
+    REQUIRE(report.count == 1);
+
+    // a string element doesn't misalign the following ones
+    const uint8_t withString[] = { 0x01, 0xff, 0x42, 0x0a, 0x08, 0x42, 0x02, 'a', 'b', 0x64, 0x10, 0x01 };
+    REQUIRE(XM_DecodeSpecialReport(withString, sizeof(withString), &report));
+    REQUIRE(report.complete);
+    REQUIRE(XM_FindTag(report, 0x08)->length == 3);
+    REQUIRE(XM_FindTag(report, 0x64)->value.u64 == 1);
+}
+
+TEST_CASE("Xiaomi special report benchmark")
+{
+    BENCHMARK("per item decode")
+    {
+        XM_SpecialReport tmp;
+        uint64_t sum = 0;
+        for (uint8_t tag : weatherItems)
+        {
+            const XM_Tag *t = scanForTag(lumiWeather, tag, &tmp);
+            sum += t ? t->value.u64 : 0;
+        }
+        for (uint8_t tag : plugItems)
+        {
+            const XM_Tag *t = scanForTag(lumiPlug, tag, &tmp);
+            sum += t ? t->value.u64 : 0;
+        }
+        return sum;
+    };
+
+    BENCHMARK("decode once and lookup")
+    {
+        XM_SpecialReport report;
+        uint64_t sum = 0;
+        XM_DecodeSpecialReport(lumiWeather.data(), lumiWeather.size(), &report);
+        for (uint8_t tag : weatherItems)
+        {
+            const XM_Tag *t = XM_FindTag(report, tag);
+            sum += t ? t->value.u64 : 0;
+        }
+        XM_DecodeSpecialReport(lumiPlug.data(), lumiPlug.size(), &report);
+        for (uint8_t tag : plugItems)
+        {
+            const XM_Tag *t = XM_FindTag(report, tag);
+            sum += t ? t->value.u64 : 0;
+        }
+        return sum;
+    };
+}
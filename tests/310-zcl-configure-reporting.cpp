@@ -0,0 +1,142 @@
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "zcl/configure_reporting.h"
+
+static ZCL_ConfigureReportingParam::Record makeRecord(uint16_t attrId, uint8_t dataType)
+{
+    ZCL_ConfigureReportingParam::Record rec{};
+    rec.attributeId = attrId;
+    rec.dataType = dataType;
+    rec.minInterval = 1;
+    rec.maxInterval = 300;
+    rec.reportableChange = 1;
+    return rec;
+}
+
+TEST_CASE("Configure reporting record encoding")
+{
+    ZCL_ConfigureReportingParam::Record rec = makeRecord(0x0508, 0x21); // uint16
+    rec.reportableChange = 0x0102;
+    rec.maxInterval = 0x0e10;
+
+    uint8_t buf[16];
+    REQUIRE(ZCL_ConfigureReportingRecordSize(rec) == 10);
+    REQUIRE(ZCL_WriteReportingRecord(rec, buf, sizeof(buf)) == 10);
+
+    const uint8_t expected[] = { 0x00, 0x08, 0x05, 0x21, 0x01, 0x00, 0x10, 0x0e, 0x02, 0x01 };
+    REQUIRE(std::vector<uint8_t>(buf, buf + 10) == std::vector<uint8_t>(expected, expected + 10));
+
+    REQUIRE(ZCL_WriteReportingRecord(rec, buf, 9) == 0);
+
+    const ZCL_ConfigureReportingParam::Record onOff = makeRecord(0x0000, 0x10); // bool, no reportable change
+    REQUIRE(ZCL_WriteReportingRecord(onOff, buf, sizeof(buf)) == 8);
+}
+
+TEST_CASE("Configure reporting records of a manufacturer code share a frame")
+{
+    // Danfoss thermostat: four standard attributes, the manufacturer specific one has its own request
+    ZCL_ConfigureReportingParam param;
+    param.records = {
+        makeRecord(0x0000, 0x29), // int16
+        makeRecord(0x0008, 0x20), // uint8
+        makeRecord(0x0012, 0x29),
+        makeRecord(0x0014, 0x29)
+    };
+
+    const auto frames = ZCL_PackReportingRecords(param, ZCL_CONFIGURE_REPORTING_MAX_PAYLOAD);
+    REQUIRE(frames.size() == 1);
+    REQUIRE(frames[0].records == std::vector<size_t>({0, 1, 2, 3}));
+    REQUIRE(frames[0].payloadSize == 10 + 9 + 10 + 10);
+
+    ZCL_ConfigureReportingParam mfParam;
+    mfParam.manufacturerCode = 0x1246;
+    mfParam.records = { makeRecord(0x4110, 0x18) }; // bitmap8, no reportable change
+
+    const auto mfFrames = ZCL_PackReportingRecords(mfParam, ZCL_CONFIGURE_REPORTING_MAX_PAYLOAD);
+    REQUIRE(mfFrames.size() == 1);
+    REQUIRE(mfFrames[0].payloadSize == 8);
+}
+
+TEST_CASE("Configure reporting frames respect the payload limit")
+{
+    ZCL_ConfigureReportingParam param;
+    std::vector<ZCL_ConfigureReportingParam::Record> &records = param.records;
+    for (uint16_t attrId = 0; attrId < 12; attrId++)
+    {
+        records.push_back(makeRecord(0x0500 + attrId, 0x21)); // 10 bytes each
+    }
+    records.push_back(makeRecord(0x0500, 0x21)); // duplicate
+
+    const auto frames = ZCL_PackReportingRecords(param, 70);
+    REQUIRE(frames.size() == 2);
+    REQUIRE(frames[0].records.size() == 7);
+    REQUIRE(frames[1].records.size() == 5);
+
+    size_t total = 0;
+    for (const auto &f : frames)
+    {
+        REQUIRE(f.payloadSize <= 70);
+        total += f.records.size();
+    }
+    REQUIRE(total == 12);
+
+    // a single record larger than the limit still gets its own frame
+    ZCL_ConfigureReportingParam bigParam;
+    bigParam.records = { makeRecord(0x0001, 0x27) }; // uint64, 16 bytes
+    const auto big = ZCL_PackReportingRecords(bigParam, 10);
+    REQUIRE(big.size() == 1);
+    REQUIRE(big[0].records.size() == 1);
+}
+
+TEST_CASE("Configure reporting response is mapped to attributes")
+{
+    ZCL_ReportingStatus attrs[] = {
+        { 0x0000, 0x00, 0xff },
+        { 0x0008, 0x00, 0xff },
+        { 0x0012, 0x00, 0xff }
+    };
+
+    SECTION("single status for all attributes")
+    {
+        const uint8_t rsp[] = { 0x00 };
+        REQUIRE(ZCL_ConfigureReportingRspStatus(rsp, sizeof(rsp), attrs, 3));
+        REQUIRE(attrs[0].status == 0x00);
+        REQUIRE(attrs[2].status == 0x00);
+    }
+
+    SECTION("only failed attributes are listed")
+    {
+        const uint8_t rsp[] = { 0x86, 0x00, 0x08, 0x00 }; // unsupported attribute 0x0008
+        REQUIRE(ZCL_ConfigureReportingRspStatus(rsp, sizeof(rsp), attrs, 3));
+        REQUIRE(attrs[0].status == 0x00);
+        REQUIRE(attrs[1].status == 0x86);
+        REQUIRE(attrs[2].status == 0x00);
+    }
+
+    SECTION("status of each attribute")
+    {
+        const uint8_t rsp[] = { 0x00, 0x00, 0x00, 0x00,
+                                0x8d, 0x00, 0x08, 0x00,   // invalid data type
+                                0x00, 0x00, 0x12, 0x00 };
+        REQUIRE(ZCL_ConfigureReportingRspStatus(rsp, sizeof(rsp), attrs, 3));
+        REQUIRE(attrs[0].status == 0x00);
+        REQUIRE(attrs[1].status == 0x8d);
+        REQUIRE(attrs[2].status == 0x00);
+    }
+
+    SECTION("direction must match")
+    {
+        const uint8_t rsp[] = { 0x86, 0x01, 0x00, 0x00 };
+        REQUIRE(ZCL_ConfigureReportingRspStatus(rsp, sizeof(rsp), attrs, 3));
+        REQUIRE(attrs[0].status == 0x00);
+    }
+
+    SECTION("malformed")
+    {
+        const uint8_t rsp[] = { 0x86, 0x00, 0x08 };
+        REQUIRE(!ZCL_ConfigureReportingRspStatus(rsp, sizeof(rsp), attrs, 3));
+        REQUIRE(!ZCL_ConfigureReportingRspStatus(rsp, 0, attrs, 3));
+    }
+}
@@ -0,0 +1,295 @@
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "task_scheduler.h"
+
+/*
+ * Simulated controller which sends tasks chosen by the TaskScheduler and confirms them
+ * after a per destination latency. Used to measure the command latency under load.
+ */
+struct SimTask
+{
+    int id;
+    uint64_t dst;
+    bool groupcast;
+    TaskPriority prio;
+    uint64_t coalesceKey;
+    int64_t queueTime;
+    int64_t sendTime;
+    int64_t confirmTime;
+};
+
+struct SimController
+{
+    enum { TickMs = 10, MaxOnAir = 5 }; // MaxOnAir mirrors MAX_BACKGROUND_TASKS
+
+    TaskScheduler sched;
+    std::vector<SimTask> tasks;
+    std::vector<int> onAir;
+    int64_t now = 0;
+    int nextId = 1;
+
+    int64_t latencyFor(uint64_t dst) const
+    {
+        if (dst == 0xdead) { return 6000; }  // unreachable router, APS confirm after timeout
+        if (dst >= 0x10000) { return 40; }   // groupcast
+        return 80;
+    }
+
+    int add(uint64_t dst, TaskPriority prio, bool groupcast = false, uint64_t coalesceKey = 0)
+    {
+        SimTask t{nextId++, dst, groupcast, prio, coalesceKey, now, -1, -1};
+        int superseded = -1;
+        if (!sched.enqueue(t.id, dst, groupcast, prio, coalesceKey, &superseded))
+        {
+            return -1;
+        }
+        tasks.push_back(t);
+        return t.id;
+    }
+
+    SimTask &task(int id)
+    {
+        return *std::find_if(tasks.begin(), tasks.end(), [id](const SimTask &t) { return t.id == id; });
+    }
+
+    void tick()
+    {
+        now += TickMs;
+
+        // confirms
+        for (auto i = onAir.begin(); i != onAir.end(); )
+        {
+            SimTask &t = task(*i);
+            if (t.sendTime + latencyFor(t.dst) <= now)
+            {
+                t.confirmTime = now;
+                sched.markConfirmed(t.id, now);
+                i = onAir.erase(i);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+
+        // the plugin sends at most one request per processTasks() call,
+        // processTasks() runs on timer and on each confirm
+        while (onAir.size() < MaxOnAir)
+        {
+            const int id = sched.selectNext([](int) { return true; });
+            if (id < 0)
+            {
+                break;
+            }
+            SimTask &t = task(id);
+            t.sendTime = now;
+            sched.markSent(id, now, true);
+            onAir.push_back(id);
+            break;
+        }
+    }
+
+    void runUntilIdle(int64_t maxMs)
+    {
+        const int64_t end = now + maxMs;
+        while (now < end && (sched.pendingCount() > 0 || !onAir.empty()))
+        {
+            tick();
+        }
+    }
+};
+
+TEST_CASE("TaskScheduler user commands overtake queued rule and poll tasks")
+{
+    SimController sim;
+
+    // burst of group commands from rules and polling of many routers
+    for (int i = 0; i < 20; i++)
+    {
+        sim.add(0x10000 + (i % 4), TaskPriorityRule, true);
+    }
+
+    for (uint64_t dst = 1; dst <= 30; dst++)
+    {
+        sim.add(dst, TaskPriorityPoll);
+        sim.add(dst, TaskPriorityPoll);
+    }
+
+    const int userTask = sim.add(7, TaskPriorityUser);
+    REQUIRE(userTask > 0);
+
+    sim.runUntilIdle(60000);
+
+    const SimTask &t = sim.task(userTask);
+    REQUIRE(t.sendTime >= 0);
+    // the first free on-air slot is used for the user command
+    const int64_t latency = t.confirmTime - t.queueTime;
+    INFO("user command latency " << latency << " ms");
+    REQUIRE(latency <= 200);
+    REQUIRE(sim.sched.pendingCount() == 0);
+}
+
+TEST_CASE("TaskScheduler unreachable router doesn't block neighbours")
+{
+    SimController sim;
+
+    std::vector<int> deadTasks;
+    for (int i = 0; i < 10; i++)
+    {
+        deadTasks.push_back(sim.add(0xdead, TaskPriorityUser));
+    }
+
+    std::vector<int> ids;
+    for (uint64_t dst = 1; dst <= 10; dst++)
+    {
+        ids.push_back(sim.add(dst, TaskPriorityUser));
+    }
+
+    sim.runUntilIdle(2000);
+
+    for (int id : ids)
+    {
+        const SimTask &t = sim.task(id);
+        REQUIRE(t.confirmTime >= 0);
+        REQUIRE(t.confirmTime - t.queueTime < 1000);
+    }
+
+    // the slow router is throttled to a single request on-air
+    sim.runUntilIdle(120000);
+    REQUIRE(sim.sched.onAirBudget(0xdead, false) == TaskScheduler::MinUnicastOnAir);
+    REQUIRE(sim.sched.onAirBudget(1, false) > TaskScheduler::DefaultUnicastOnAir);
+}
+
+TEST_CASE("TaskScheduler coalesces superseded commands")
+{
+    TaskScheduler sched;
+    int superseded = -1;
+
+    REQUIRE(sched.enqueue(1, 5, false, TaskPriorityUser, 0x1234, &superseded));
+    REQUIRE(superseded == -1);
+    REQUIRE(sched.enqueue(2, 5, false, TaskPriorityUser, 0, &superseded));
+    REQUIRE(sched.enqueue(3, 5, false, TaskPriorityUser, 0x1234, &superseded));
+    REQUIRE(superseded == 1);
+    REQUIRE(sched.pendingCount() == 2);
+
+    // replaced task keeps the queue position
+    REQUIRE(sched.selectNext([](int) { return true; }) == 3);
+    sched.markSent(3, 0, true);
+    REQUIRE(sched.selectNext([](int) { return true; }) == 2);
+    sched.markSent(2, 0, true);
+    REQUIRE(sched.onAirCount(5) == 2);
+
+    // on-air tasks are not superseded
+    REQUIRE(sched.enqueue(4, 5, false, TaskPriorityUser, 0x1234, &superseded));
+    REQUIRE(superseded == -1);
+    REQUIRE(sched.pendingCount() == 1);
+
+    sched.markConfirmed(3, 100);
+    sched.markConfirmed(2, 100);
+    REQUIRE(sched.onAirCount(5) == 0);
+    REQUIRE(sched.confirmLatency(5) == 100);
+}
+
+TEST_CASE("TaskScheduler per destination queue limit")
+{
+    TaskScheduler sched;
+    int id = 1;
+    for (int i = 0; i < TaskScheduler::MaxQueuedPerDestination; i++)
+    {
+        REQUIRE(sched.enqueue(id++, 1, false, TaskPriorityPoll, 0, nullptr));
+    }
+    REQUIRE(!sched.enqueue(id++, 1, false, TaskPriorityPoll, 0, nullptr));
+    // other destinations aren't affected
+    REQUIRE(sched.enqueue(id++, 2, false, TaskPriorityPoll, 0, nullptr));
+}
+
+TEST_CASE("TaskScheduler full queue leaves a superseded task of other priority intact")
+{
+    TaskScheduler sched;
+    int superseded = -1;
+
+    // poll task with coalesce key, then the user queue of the destination runs full
+    REQUIRE(sched.enqueue(1, 7, false, TaskPriorityPoll, 0x1234, &superseded));
+    int id = 2;
+    for (int i = 0; i < TaskScheduler::MaxQueuedPerDestination; i++)
+    {
+        REQUIRE(sched.enqueue(id++, 7, false, TaskPriorityUser, 0, &superseded));
+    }
+    const size_t pending = sched.pendingCount();
+
+    // the newer user command can't be queued, the poll task must stay schedulable
+    REQUIRE(!sched.enqueue(id++, 7, false, TaskPriorityUser, 0x1234, &superseded));
+    REQUIRE(superseded == -1);
+    REQUIRE(sched.pendingCount() == pending);
+    REQUIRE(sched.pendingCount(TaskPriorityPoll) == 1);
+
+    // with room in the user queue it supersedes the poll task
+    REQUIRE(sched.remove(2));
+    REQUIRE(sched.enqueue(id, 7, false, TaskPriorityUser, 0x1234, &superseded));
+    REQUIRE(superseded == 1);
+    REQUIRE(sched.pendingCount(TaskPriorityPoll) == 0);
+    REQUIRE(!sched.remove(1));
+}
+
+TEST_CASE("TaskScheduler total queue limit with superseded task")
+{
+    TaskScheduler sched;
+    int superseded = -1;
+    int id = 1;
+
+    REQUIRE(sched.enqueue(id++, 0, false, TaskPriorityPoll, 0x99, &superseded));
+    for (uint64_t dst = 1; sched.pendingCount() < TaskScheduler::MaxQueued; dst++)
+    {
+        REQUIRE(sched.enqueue(id++, dst, false, TaskPriorityPoll, 0, &superseded));
+    }
+    REQUIRE(!sched.enqueue(id++, 1000, false, TaskPriorityPoll, 0, &superseded));
+
+    // replacing takes no additional slot
+    REQUIRE(sched.enqueue(id, 0, false, TaskPriorityUser, 0x99, &superseded));
+    REQUIRE(superseded == 1);
+    REQUIRE(sched.pendingCount() == TaskScheduler::MaxQueued);
+}
+
+TEST_CASE("TaskScheduler benchmark")
+{
+    BENCHMARK("enqueue and select 200 tasks across 50 destinations")
+    {
+        TaskScheduler sched;
+        for (int i = 0; i < 200; i++)
+        {
+            sched.enqueue(i, uint64_t(i % 50), false, TaskPriority(i % TaskPriorityMax), uint64_t(i % 70) + 1, nullptr);
+        }
+
+        int n = 0;
+        for (;;)
+        {
+            const int id = sched.selectNext([](int) { return true; });
+            if (id < 0)
+            {
+                break;
+            }
+            sched.markSent(id, 0, false);
+            n++;
+        }
+        return n;
+    };
+
+    BENCHMARK("load test 1000 mixed tasks with simulated controller")
+    {
+        SimController sim;
+        for (int i = 0; i < 1000; i++)
+        {
+            sim.add(uint64_t(1 + i % 40), TaskPriority(i % TaskPriorityMax));
+            if ((i % 5) == 0)
+            {
+                sim.tick();
+            }
+        }
+        sim.runUntilIdle(600000);
+        return sim.now;
+    };
+}
@@ -0,0 +1,394 @@
+#include <algorithm>
+#include <cstdint>
+#include <list>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "binding_scheduler.h"
+
+/*
+ * Simulated binding queue of devices joining the network. Each binding needs a bind
+ * request and a configure reporting request, the device answers after a latency.
+ * Compares the previous timer driven queue processing with the event driven one.
+ */
+enum { Timeout = 20, TimeoutEndDevice = 90, Retries = 2 }; // BindingTask::Constants
+
+struct SimBinding
+{
+    enum State { StateIdle, StateInProgress, StateFinished };
+
+    BindingTaskKey key;
+    bool endDevice;
+    State state;
+    int timeout;
+    int retries;
+    int64_t rspTime;      //! time of the pending bind or configure reporting response
+    bool configuring;     //! waiting for the configure reporting response
+    int64_t configuredTime;
+};
+
+struct SimBindingQueue
+{
+    enum { TickMs = 10, OldMaxActive = 3 }; // MAX_ACTIVE_BINDING_TASKS
+
+    bool eventDriven;
+    BindingScheduler sched;
+    std::list<SimBinding> queue;
+    std::vector<int64_t> configured;
+    int64_t now = 1000;
+    int64_t nextTimer = 0;
+    int bindRequests = 0;
+
+    explicit SimBindingQueue(bool ev) : eventDriven(ev) { }
+
+    void add(uint64_t device, uint16_t clusterId, bool endDevice)
+    {
+        SimBinding bt{};
+        bt.key.srcAddress = device;
+        bt.key.dstAddress = 0x00212effff000001ULL;
+        bt.key.clusterId = clusterId;
+        bt.key.srcEndpoint = 0x01;
+        bt.key.dstEndpoint = 0x01;
+        bt.key.dstAddrMode = 0x03;
+        bt.endDevice = endDevice;
+        bt.state = SimBinding::StateIdle;
+        bt.timeout = endDevice ? TimeoutEndDevice : Timeout;
+        bt.retries = Retries;
+        bt.rspTime = -1;
+        bt.configuring = false;
+        bt.configuredTime = -1;
+
+        if (eventDriven && !sched.insert(bt.key))
+        {
+            return;
+        }
+        queue.push_back(bt);
+    }
+
+    int64_t latency(const SimBinding &bt) const
+    {
+        return bt.endDevice ? 1500 : 120; // end devices answer when they poll their parent
+    }
+
+    void sendBind(SimBinding &bt)
+    {
+        bt.state = SimBinding::StateInProgress;
+        bt.rspTime = now + latency(bt);
+        bt.configuring = false;
+        bindRequests++;
+    }
+
+    /* previous bindingTimerFired(): one request per call, timeouts count calls */
+    void oldPass()
+    {
+        int active = 0;
+        for (auto i = queue.begin(); i != queue.end(); ++i)
+        {
+            if (i->state == SimBinding::StateIdle)
+            {
+                if (active < OldMaxActive)
+                {
+                    sendBind(*i);
+                    break;
+                }
+            }
+            else if (i->state == SimBinding::StateInProgress)
+            {
+                i->timeout--;
+                if (i->timeout < 0)
+                {
+                    i->retries--;
+                    i->rspTime = -1;
+                    if (i->retries > 0)
+                    {
+                        i->state = SimBinding::StateIdle;
+                        i->timeout = i->endDevice ? TimeoutEndDevice : Timeout;
+                    }
+                    else
+                    {
+                        i->state = SimBinding::StateFinished;
+                    }
+                }
+                else
+                {
+                    active++;
+                }
+            }
+            else if (i->state == SimBinding::StateFinished)
+            {
+                queue.erase(i);
+                break;
+            }
+        }
+    }
+
+    /* current bindingTimerFired() */
+    void newPass()
+    {
+        const int elapsed = sched.elapsedSeconds(now);
+
+        sched.beginPass();
+        for (const auto &bt : queue)
+        {
+            if (bt.state == SimBinding::StateInProgress)
+            {
+                sched.addActive(bt.key.srcAddress);
+            }
+        }
+
+        for (auto i = queue.begin(); i != queue.end(); )
+        {
+            if (i->state == SimBinding::StateIdle)
+            {
+                if (sched.canStart(i->key.srcAddress))
+                {
+                    sendBind(*i);
+                    sched.addActive(i->key.srcAddress);
+                }
+            }
+            else if (i->state == SimBinding::StateInProgress)
+            {
+                i->timeout -= elapsed;
+                if (i->timeout < 0)
+                {
+                    sched.removeActive(i->key.srcAddress);
+                    i->retries--;
+                    i->rspTime = -1;
+                    i->state = i->retries > 0 ? SimBinding::StateIdle : SimBinding::StateFinished;
+                    i->timeout = i->endDevice ? TimeoutEndDevice : Timeout;
+                }
+            }
+
+            if (i->state == SimBinding::StateFinished)
+            {
+                sched.remove(i->key);
+                i = queue.erase(i);
+                continue;
+            }
+            ++i;
+        }
+    }
+
+    void tick()
+    {
+        now += TickMs;
+        bool pass = now >= nextTimer;
+
+        for (auto &bt : queue)
+        {
+            if (bt.state != SimBinding::StateInProgress || bt.rspTime < 0 || bt.rspTime > now)
+            {
+                continue;
+            }
+
+            if (!bt.configuring) // bind response, configure reporting
+            {
+                bt.configuring = true;
+                bt.rspTime = now + latency(bt);
+            }
+            else // configure reporting response
+            {
+                bt.rspTime = -1;
+                if (bt.configuredTime < 0)
+                {
+                    bt.configuredTime = now;
+                    configured.push_back(now);
+                }
+                if (eventDriven)
+                {
+                    bt.state = SimBinding::StateFinished;
+                }
+            }
+            pass = true; // bindingTimer->start(0)
+        }
+
+        if (pass)
+        {
+            if (eventDriven) { newPass(); } else { oldPass(); }
+            nextTimer = now + 1000;
+        }
+    }
+
+    int64_t runUntilConfigured(size_t count, int64_t maxMs)
+    {
+        const int64_t start = now;
+        while (configured.size() < count && !queue.empty() && now - start < maxMs)
+        {
+            tick();
+        }
+        return now - start;
+    }
+};
+
+static const uint16_t bindClusters[] = { 0x0006, 0x0008, 0x0300, 0x0702 };
+
+static void addDevices(SimBindingQueue &sim, int n)
+{
+    for (int dev = 1; dev <= n; dev++)
+    {
+        for (uint16_t clusterId : bindClusters)
+        {
+            sim.add(uint64_t(dev), clusterId, (dev % 5) == 0);
+        }
+    }
+}
+
+TEST_CASE("BindingScheduler duplicate index")
+{
+    BindingScheduler sched;
+    BindingTaskKey key;
+    key.srcAddress = 0x00158d0001020304ULL;
+    key.dstAddress = 0x0001; // group
+    key.clusterId = 0x0006;
+    key.srcEndpoint = 0x01;
+    key.dstAddrMode = 0x01;
+
+    REQUIRE(sched.insert(key));
+    REQUIRE(!sched.insert(key));
+
+    BindingTaskKey unbind = key;
+    unbind.action = 1;
+    REQUIRE(sched.insert(unbind));
+
+    BindingTaskKey otherGroup = key;
+    otherGroup.dstAddress = 0x0002;
+    REQUIRE(!sched.contains(otherGroup));
+
+    sched.remove(key);
+    REQUIRE(!sched.contains(key));
+    REQUIRE(sched.contains(unbind));
+    REQUIRE(sched.size() == 1);
+
+    sched.clear();
+    REQUIRE(sched.size() == 0);
+}
+
+TEST_CASE("BindingScheduler on-air limits")
+{
+    BindingScheduler sched;
+    sched.beginPass();
+
+    for (int i = 0; i < BindingScheduler::MaxActivePerDevice; i++)
+    {
+        REQUIRE(sched.canStart(1));
+        sched.addActive(1);
+    }
+    REQUIRE(!sched.canStart(1));
+    REQUIRE(sched.canStart(2));
+
+    for (uint64_t dev = 2; sched.active() < BindingScheduler::MaxActive; dev++)
+    {
+        sched.addActive(dev);
+    }
+    REQUIRE(!sched.canStart(100));
+
+    sched.removeActive(1);
+    REQUIRE(sched.active(1) == BindingScheduler::MaxActivePerDevice - 1);
+    REQUIRE(sched.canStart(1));
+    sched.removeActive(100); // not active, ignored
+    REQUIRE(sched.active() == BindingScheduler::MaxActive - 1);
+}
+
+TEST_CASE("BindingScheduler timeouts count real seconds")
+{
+    BindingScheduler sched;
+    REQUIRE(sched.elapsedSeconds(5000) == 0);
+    REQUIRE(sched.elapsedSeconds(5000) == 0); // triggered by events
+    REQUIRE(sched.elapsedSeconds(5600) == 0);
+    REQUIRE(sched.elapsedSeconds(6100) == 1);
+    REQUIRE(sched.elapsedSeconds(9000) == 3); // remainder carried over
+    REQUIRE(sched.elapsedSeconds(9100) == 0);
+
+    // idle time without queued tasks isn't counted
+    BindingTaskKey key;
+    REQUIRE(sched.insert(key));
+    REQUIRE(sched.elapsedSeconds(60000) == 0);
+}
+
+TEST_CASE("Time to fully configured of 50 devices")
+{
+    const size_t count = 50 * 4;
+
+    // a successful bind task was kept in progress until it timed out and was sent again
+    SimBindingQueue before(false);
+    addDevices(before, 50);
+    const int64_t beforeMs = before.runUntilConfigured(count, 4 * 3600 * 1000);
+
+    SimBindingQueue after(true);
+    addDevices(after, 50);
+    addDevices(after, 50); // duplicates are discarded
+    REQUIRE(after.queue.size() == count);
+    const int64_t afterMs = after.runUntilConfigured(count, 3600 * 1000);
+
+    INFO("before: " << before.configured.size() << " configured after " << beforeMs << " ms, " << before.bindRequests << " bind requests");
+    INFO("after: " << after.configured.size() << " configured after " << afterMs << " ms, " << after.bindRequests << " bind requests");
+    REQUIRE(before.configured.size() == count);
+    REQUIRE(after.configured.size() == count);
+    REQUIRE(after.bindRequests == int(count));
+    REQUIRE(afterMs * 5 < beforeMs);
+
+    after.runUntilConfigured(count + 1, 2000);
+    REQUIRE(after.queue.empty());
+    REQUIRE(after.sched.size() == 0);
+}
+
+TEST_CASE("BindingScheduler benchmark")
+{
+    std::vector<BindingTaskKey> keys;
+    for (int dev = 1; dev <= 125; dev++)
+    {
+        for (uint16_t clusterId : bindClusters)
+        {
+            BindingTaskKey key;
+            key.srcAddress = 0x00158d0000000000ULL + uint64_t(dev);
+            key.dstAddress = 0x00212effff000001ULL;
+            key.clusterId = clusterId;
+            key.srcEndpoint = 0x01;
+            key.dstEndpoint = 0x01;
+            key.dstAddrMode = 0x03;
+            keys.push_back(key);
+        }
+    }
+
+    BENCHMARK("queue 500 tasks, linear duplicate check")
+    {
+        std::list<BindingTaskKey> queue;
+        for (const auto &key : keys)
+        {
+            if (std::find(queue.begin(), queue.end(), key) == queue.end())
+            {
+                queue.push_back(key);
+            }
+        }
+        return queue.size();
+    };
+
+    BENCHMARK("queue 500 tasks, hashed duplicate check")
+    {
+        BindingScheduler sched;
+        std::list<BindingTaskKey> queue;
+        for (const auto &key : keys)
+        {
+            if (sched.insert(key))
+            {
+                queue.push_back(key);
+            }
+        }
+        return queue.size();
+    };
+}
+
+TEST_CASE("Bind task finishes when all configure reporting requests are answered")
+{
+    std::vector<uint8_t> zclSeqNums = { 10, 11, 12 }; // attributes split over three frames
+
+    REQUIRE(!BS_ConfigureReportingAnswered(zclSeqNums, 11));
+    REQUIRE(!BS_ConfigureReportingAnswered(zclSeqNums, 11)); // duplicate response
+    REQUIRE(!BS_ConfigureReportingAnswered(zclSeqNums, 42)); // response to another request
+    REQUIRE(!BS_ConfigureReportingAnswered(zclSeqNums, 10));
+    REQUIRE(BS_ConfigureReportingAnswered(zclSeqNums, 12));
+    REQUIRE(zclSeqNums.empty());
+
+    REQUIRE(!BS_ConfigureReportingAnswered(zclSeqNums, 12)); // nothing outstanding
+}
@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "binding_table_cache.h"
+
+enum { RecordSize = 21 }; // binding table record with 64-bit destination address
+
+static std::vector<uint8_t> makeRecords(uint8_t first, uint8_t count)
+{
+    std::vector<uint8_t> records;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        records.insert(records.end(), RecordSize, uint8_t(first + i));
+    }
+    return records;
+}
+
+TEST_CASE("Binding table pages are assembled in order")
+{
+    BindingTableCache cache;
+    const uint64_t ext = 0x00158d0001020304ULL;
+    const auto page0 = makeRecords(0, 3);
+    const auto page1 = makeRecords(3, 2);
+
+    REQUIRE(!cache.addPage(ext, 5, 0, 3, page0.data(), page0.size(), 100));
+    REQUIRE(cache.get(ext) == nullptr);
+    REQUIRE(cache.addPage(ext, 5, 3, 2, page1.data(), page1.size(), 101));
+
+    const BindingTableCacheEntry *entry = cache.get(ext);
+    REQUIRE(entry != nullptr);
+    REQUIRE(entry->count == 5);
+    REQUIRE(entry->timestamp == 101);
+    REQUIRE(entry->records.size() == 5 * RecordSize);
+    REQUIRE(entry->records.back() == 4);
+
+    SECTION("empty table")
+    {
+        REQUIRE(cache.addPage(ext, 0, 0, 0, nullptr, 0, 200));
+        REQUIRE(cache.get(ext)->count == 0);
+        REQUIRE(cache.get(ext)->records.empty());
+    }
+
+    SECTION("a gap drops the partial table")
+    {
+        const uint64_t ext2 = 0x00158d0001020305ULL;
+        REQUIRE(!cache.addPage(ext2, 5, 0, 3, page0.data(), page0.size(), 100));
+        REQUIRE(!cache.addPage(ext2, 5, 4, 1, page1.data(), RecordSize, 100));
+        REQUIRE(!cache.addPage(ext2, 5, 3, 2, page1.data(), page1.size(), 100));
+        REQUIRE(cache.get(ext2) == nullptr);
+    }
+
+    SECTION("pages without records are ignored")
+    {
+        const uint64_t ext2 = 0x00158d0001020305ULL;
+        REQUIRE(!cache.addPage(ext2, 5, 3, 2, page1.data(), page1.size(), 100));
+        REQUIRE(!cache.addPage(ext2, 5, 0, 0, nullptr, 0, 100));
+        REQUIRE(cache.get(ext2) == nullptr);
+    }
+}
+
+TEST_CASE("Binding table cache staleness and invalidation")
+{
+    BindingTableCache cache;
+    const uint64_t ext = 0x00158d0001020304ULL;
+    const auto page = makeRecords(0, 2);
+
+    REQUIRE(cache.addPage(ext, 2, 0, 2, page.data(), page.size(), 1000));
+    REQUIRE(cache.fresh(ext, 1000) != nullptr);
+    REQUIRE(cache.fresh(ext, 1000 + BindingTableCache::MaxAge - 1) != nullptr);
+    REQUIRE(cache.fresh(ext, 1000 + BindingTableCache::MaxAge) == nullptr);
+    REQUIRE(cache.fresh(ext, 999) == nullptr); // clock jumped back
+    REQUIRE(cache.get(ext) != nullptr);
+
+    REQUIRE(cache.invalidate(ext));
+    REQUIRE(!cache.invalidate(ext));
+    REQUIRE(cache.get(ext) == nullptr);
+
+    BindingTableCacheEntry restored;
+    restored.records = page;
+    restored.count = 2;
+    restored.timestamp = 5000;
+    cache.restore(ext, restored);
+    REQUIRE(cache.size() == 1);
+    REQUIRE(cache.fresh(ext, 5001)->records == page);
+}
+
+/*
+ * Simulated controller answering Mgmt_Bind_req of routers with multi page binding tables.
+ * Compares the previous reader timer (one request per 1 s tick, next page on the next tick)
+ * with parallel readers which request the next page as soon as a response arrives.
+ */
+struct SimReader
+{
+    enum State { StateIdle, StateWait, StateFinished };
+
+    uint64_t ext;
+    uint8_t index;
+    State state;
+    int64_t rspTime;
+};
+
+struct SimController
+{
+    enum { TimerMs = 1000, PageSize = 3, Entries = 7 };
+
+    int maxReaders; // 0: previous behaviour
+    BindingTableCache cache;
+    std::vector<SimReader> readers;
+    int64_t now = 0;
+    int64_t timer = 0;
+    int requests = 0;
+
+    explicit SimController(int max) : maxReaders(max) { }
+
+    static int64_t latency(uint64_t ext)
+    {
+        return 200 + int64_t(ext % 5) * 100;
+    }
+
+    void read(uint64_t ext)
+    {
+        if (cache.fresh(ext, now / 1000 + 1000000))
+        {
+            return;
+        }
+        readers.push_back({ext, 0, SimReader::StateIdle, -1});
+    }
+
+    void timerFired()
+    {
+        int active = 0;
+        for (const SimReader &r : readers)
+        {
+            active += r.state == SimReader::StateWait ? 1 : 0;
+        }
+
+        for (SimReader &r : readers)
+        {
+            if (r.state != SimReader::StateIdle)
+            {
+                continue;
+            }
+
+            if (maxReaders > 0 && active >= maxReaders)
+            {
+                break;
+            }
+
+            r.state = SimReader::StateWait;
+            r.rspTime = now + latency(r.ext);
+            requests++;
+            active++;
+
+            if (maxReaders == 0)
+            {
+                break;
+            }
+        }
+
+        timer = now + TimerMs;
+    }
+
+    void response(SimReader &r)
+    {
+        const uint8_t count = uint8_t(std::min<int>(PageSize, Entries - r.index));
+        const auto records = makeRecords(r.index, count);
+        cache.addPage(r.ext, Entries, r.index, count, records.data(), records.size(), now / 1000 + 1000000);
+
+        r.index = uint8_t(r.index + count);
+        r.state = r.index < Entries ? SimReader::StateIdle : SimReader::StateFinished;
+        r.rspTime = -1;
+
+        if (maxReaders > 0)
+        {
+            timer = now; // bindingTableReaderTimer->start(0)
+        }
+    }
+
+    int64_t run()
+    {
+        timer = now;
+        while (!readers.empty() && now < 3600 * 1000)
+        {
+            for (SimReader &r : readers)
+            {
+                if (r.rspTime == now)
+                {
+                    response(r);
+                }
+            }
+
+            if (timer == now)
+            {
+                timerFired();
+            }
+
+            for (size_t i = 0; i < readers.size(); )
+            {
+                if (readers[i].state == SimReader::StateFinished)
+                {
+                    readers[i] = readers.back();
+                    readers.pop_back();
+                }
+                else
+                {
+                    i++;
+                }
+            }
+
+            now++;
+        }
+        return now;
+    }
+};
+
+TEST_CASE("Binding table verification time across routers")
+{
+    const int routers = 30;
+    const uint64_t base = 0x00158d0000000000ULL;
+
+    SimController before(0);
+    SimController after(4);
+
+    for (int i = 0; i < routers; i++)
+    {
+        before.read(base + i);
+        after.read(base + i);
+    }
+
+    const int64_t beforeMs = before.run();
+    const int64_t afterMs = after.run();
+
+    // restart with the tables of the previous run
+    SimController restart(4);
+    restart.cache = after.cache;
+    restart.now = afterMs;
+    for (int i = 0; i < routers; i++)
+    {
+        restart.read(base + i);
+    }
+    const int64_t restartMs = restart.run() - afterMs;
+
+    INFO("before: " << beforeMs << " ms, " << before.requests << " requests");
+    INFO("after: " << afterMs << " ms, " << after.requests << " requests");
+    INFO("restart: " << restartMs << " ms, " << restart.requests << " requests");
+
+    const int pages = (SimController::Entries + SimController::PageSize - 1) / SimController::PageSize;
+    REQUIRE(before.requests == routers * pages);
+    REQUIRE(after.requests == routers * pages);
+    REQUIRE(restart.requests == 0);
+    REQUIRE(after.cache.size() == size_t(routers));
+    REQUIRE(after.cache.get(base)->count == SimController::Entries);
+    REQUIRE(after.cache.get(base)->records.size() == SimController::Entries * RecordSize);
+    REQUIRE(afterMs * 4 < beforeMs);
+    REQUIRE(restartMs == 0);
+}
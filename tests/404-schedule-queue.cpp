@@ -0,0 +1,189 @@
+#include <cstdint>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "schedule_queue.h"
+
+enum { Monday = 1, Tuesday = 2, Sunday = 7 };
+enum { BitMonday = 0x40, BitTuesday = 0x20, BitFriday = 0x04, BitSunday = 0x01 };
+
+TEST_CASE("Schedule queue returns due schedules in order")
+{
+    ScheduleQueue queue;
+    size_t index = 0;
+    int64_t due = 0;
+
+    REQUIRE(!queue.nextDue(&due));
+    REQUIRE(!queue.popDue(1000, &index));
+
+    queue.update(2, 3000);
+    queue.update(0, 1000);
+    queue.update(1, 2000);
+    REQUIRE(queue.size() == 3);
+
+    queue.update(0, 5000); // schedule edited
+    REQUIRE(queue.size() == 3);
+    REQUIRE(queue.nextDue(&due));
+    REQUIRE(due == 2000);
+
+    REQUIRE(!queue.popDue(1999, &index));
+    REQUIRE(queue.popDue(2500, &index));
+    REQUIRE(index == 1);
+    REQUIRE(!queue.popDue(2500, &index));
+
+    queue.remove(2); // schedule deleted
+    REQUIRE(!queue.contains(2));
+    REQUIRE(queue.nextDue(&due));
+    REQUIRE(due == 5000);
+
+    REQUIRE(queue.popDue(10000, &index));
+    REQUIRE(index == 0);
+    REQUIRE(queue.size() == 0);
+    REQUIRE(!queue.nextDue(&due));
+}
+
+TEST_CASE("Schedule queue stays compact with frequent updates")
+{
+    ScheduleQueue queue;
+    for (int round = 0; round < 1000; round++)
+    {
+        for (size_t i = 0; i < 10; i++)
+        {
+            queue.update(i, round * 100 + int64_t(i));
+        }
+    }
+
+    REQUIRE(queue.size() == 10);
+
+    size_t index = 0;
+    size_t count = 0;
+    int64_t last = -1;
+    int64_t due = 0;
+    while (queue.nextDue(&due) && queue.popDue(due, &index))
+    {
+        REQUIRE(due >= last);
+        REQUIRE(due == 999 * 100 + int64_t(index));
+        last = due;
+        count++;
+    }
+    REQUIRE(count == 10);
+}
+
+TEST_CASE("Schedule queue detects clock jumps and DST")
+{
+    ScheduleQueue queue;
+    ScheduleClock clock;
+    clock.wallMs = 1711846800000; // 2024-03-31 01:00 UTC, DST starts in central Europe
+    clock.steadyMs = 5000;
+    clock.utcOffset = 3600;
+
+    REQUIRE(!queue.clockChanged(clock)); // reference
+
+    clock.wallMs += 60000;
+    clock.steadyMs += 60000;
+    REQUIRE(!queue.clockChanged(clock));
+
+    clock.wallMs += 1500; // small jitter
+    REQUIRE(!queue.clockChanged(clock));
+
+    clock.utcOffset = 7200; // 02:00 -> 03:00 local, UTC continues
+    REQUIRE(queue.clockChanged(clock));
+    REQUIRE(!queue.clockChanged(clock));
+
+    clock.wallMs += 3600 * 1000; // NTP correction
+    REQUIRE(queue.clockChanged(clock));
+
+    clock.wallMs -= 10 * 1000;
+    REQUIRE(queue.clockChanged(clock));
+}
+
+TEST_CASE("Recurring schedule weekdays")
+{
+    // bbb = 0MTWTFSS
+    REQUIRE(SCHED_RecurringDaysAhead(BitMonday, Monday, false) == 0);
+    REQUIRE(SCHED_RecurringDaysAhead(BitMonday, Monday, true) == 7);
+    REQUIRE(SCHED_RecurringDaysAhead(BitTuesday, Monday, false) == 1);
+    REQUIRE(SCHED_RecurringDaysAhead(BitMonday | BitFriday, Tuesday, false) == 3);
+    REQUIRE(SCHED_RecurringDaysAhead(BitMonday, Sunday, false) == 1);
+    REQUIRE(SCHED_RecurringDaysAhead(BitSunday, Sunday, true) == 7);
+    REQUIRE(SCHED_RecurringDaysAhead(0x7f, Sunday, true) == 1);
+    REQUIRE(SCHED_RecurringDaysAhead(0, Monday, false) == -1);
+    REQUIRE(SCHED_RecurringDaysAhead(BitMonday, 0, false) == -1);
+}
+
+/*
+ * Fake clock driving the queue like scheduleTimerFired(): a recurring timer
+ * R3/PT00:05:00 which is removed after the last trigger (autodelete).
+ */
+TEST_CASE("Recurring timer with autodelete on a fake clock")
+{
+    ScheduleQueue queue;
+    const int64_t timeout = 300 * 1000;
+    int64_t now = 0;
+    unsigned recurring = 3;
+    std::vector<int64_t> triggers;
+    int passes = 0;
+
+    queue.update(0, now + timeout);
+
+    int64_t due = 0;
+    while (queue.nextDue(&due))
+    {
+        now = due; // timer armed for the earliest schedule
+        passes++;
+
+        size_t index = 0;
+        while (queue.popDue(now, &index))
+        {
+            triggers.push_back(now);
+            if (recurring == 1)
+            {
+                break; // autodelete, not queued again
+            }
+            recurring--;
+            queue.update(index, now + timeout);
+        }
+    }
+
+    REQUIRE(triggers == std::vector<int64_t>({ timeout, 2 * timeout, 3 * timeout }));
+    REQUIRE(passes == 3);
+    REQUIRE(queue.size() == 0);
+}
+
+/*
+ * Hundreds of weekly schedules: the previous timer inspected each schedule every second.
+ */
+TEST_CASE("Schedule checks per day benchmark")
+{
+    const int64_t day = 24 * 3600 * 1000LL;
+    const size_t count = 500;
+    ScheduleQueue queue;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        queue.update(i, int64_t(i) * (day / count)); // spread over the day
+    }
+
+    int64_t now = 0;
+    int64_t due = 0;
+    size_t checks = 0;
+    int passes = 0;
+
+    while (queue.nextDue(&due) && due < day)
+    {
+        now = due;
+        passes++;
+        size_t index = 0;
+        while (queue.popDue(now, &index))
+        {
+            checks++;
+            queue.update(index, now + 7 * day);
+        }
+    }
+
+    const size_t before = size_t(day / 1000) * count;
+    INFO("before: " << before << " checks, after: " << checks << " checks in " << passes << " passes");
+    REQUIRE(checks == count);
+    REQUIRE(checks * 1000 < before);
+}
@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "timer_wheel.h"
+
+TEST_CASE("Timer wheel expires timers in time")
+{
+    TimerWheel wheel(1000, 100);
+    std::vector<uint64_t> tags;
+
+    const TimerWheel::Id a = wheel.start(1500, 1);
+    const TimerWheel::Id b = wheel.start(1250, 2); // rounded up to 1300
+    const TimerWheel::Id c = wheel.start(900, 3);  // already due
+    REQUIRE(a != 0);
+    REQUIRE(b != a);
+    REQUIRE(wheel.size() == 3);
+
+    int64_t due = 0;
+    REQUIRE(wheel.nextExpiry(&due));
+    REQUIRE(due == 1000);
+
+    REQUIRE(wheel.expire(1000, tags) == 1);
+    REQUIRE(tags == std::vector<uint64_t>({ 3 }));
+    REQUIRE(!wheel.isActive(c));
+
+    REQUIRE(wheel.expire(1299, tags) == 0);
+    REQUIRE(wheel.nextExpiry(&due));
+    REQUIRE(due == 1300);
+    REQUIRE(wheel.expire(1300, tags) == 1);
+    REQUIRE(tags.back() == 2);
+
+    REQUIRE(wheel.isActive(a));
+    REQUIRE(wheel.cancel(a));
+    REQUIRE(!wheel.cancel(a));
+    REQUIRE(!wheel.isActive(a));
+    REQUIRE(wheel.size() == 0);
+    REQUIRE(!wheel.nextExpiry(&due));
+    REQUIRE(wheel.expire(100000, tags) == 0);
+
+    // ids of reused nodes differ
+    const TimerWheel::Id d = wheel.start(200000, 4);
+    REQUIRE(d != a);
+    REQUIRE(!wheel.isActive(a));
+    REQUIRE(wheel.isActive(d));
+    REQUIRE(!wheel.cancel(0));
+}
+
+TEST_CASE("Timer wheel matches a reference across all levels")
+{
+    const int64_t tickMs = 100;
+    TimerWheel wheel(0, tickMs);
+    std::multimap<int64_t, uint64_t> reference; // due tick -> tag
+    std::map<uint64_t, TimerWheel::Id> ids;
+
+    uint32_t rnd = 12345;
+    auto next = [&rnd]() { rnd = rnd * 1103515245 + 12345; return (rnd >> 8); };
+
+    const int64_t ranges[] = { 1000, 60 * 1000, 3600 * 1000, 48 * 3600 * 1000LL, 40 * 24 * 3600 * 1000LL };
+
+    for (uint64_t tag = 1; tag <= 2000; tag++)
+    {
+        const int64_t due = int64_t(next()) % ranges[tag % 5];
+        ids[tag] = wheel.start(due, tag);
+        reference.emplace((due + tickMs - 1) / tickMs, tag);
+    }
+
+    // cancel some
+    for (uint64_t tag = 7; tag <= 2000; tag += 7)
+    {
+        REQUIRE(wheel.cancel(ids[tag]));
+        for (auto i = reference.begin(); i != reference.end(); ++i)
+        {
+            if (i->second == tag)
+            {
+                reference.erase(i);
+                break;
+            }
+        }
+    }
+
+    REQUIRE(wheel.size() == reference.size());
+
+    int64_t now = 0;
+    std::vector<uint64_t> tags;
+    const int64_t end = 41 * 24 * 3600 * 1000LL;
+    int wakeups = 0;
+
+    while (now < end)
+    {
+        int64_t due = 0;
+        if (!wheel.nextExpiry(&due))
+        {
+            break;
+        }
+
+        // never sleep past the earliest timer
+        REQUIRE(!reference.empty());
+        REQUIRE(due <= reference.begin()->first * tickMs);
+
+        now = std::max(now, due);
+        tags.clear();
+        wheel.expire(now, tags);
+        wakeups++;
+
+        std::vector<uint64_t> expected;
+        while (!reference.empty() && reference.begin()->first * tickMs <= now)
+        {
+            expected.push_back(reference.begin()->second);
+            reference.erase(reference.begin());
+        }
+
+        std::sort(tags.begin(), tags.end());
+        std::sort(expected.begin(), expected.end());
+        REQUIRE(tags == expected);
+    }
+
+    REQUIRE(reference.empty());
+    REQUIRE(wheel.size() == 0);
+    INFO("wakeups: " << wakeups);
+    REQUIRE(wakeups < 6000);
+}
+
+/*
+ * 500 synthetic devices, each with a presence or button hold duration which is
+ * re-armed every 5 minutes. The previous checkSensorStateTimerFired() looked at
+ * 10 sensors per second (10 per 100 ms while a duration was pending).
+ */
+TEST_CASE("Timer wheel idle load benchmark")
+{
+    const int devices = 500;
+    const int64_t hour = 3600 * 1000;
+    const int64_t period = 5 * 60 * 1000;
+    const int64_t duration = 90 * 1000;
+
+    TimerWheel wheel(0, 100);
+    std::vector<TimerWheel::Id> ids(devices, 0);
+    std::vector<uint64_t> tags;
+    int wakeups = 0;
+    size_t expired = 0;
+
+    // devices report spread over the period, each report (re)arms the duration
+    for (int64_t now = 0; now < hour; now += 100)
+    {
+        tags.clear();
+        const size_t n = wheel.expire(now, tags);
+        if (n > 0)
+        {
+            wakeups++; // the timer is armed for the next expiry
+            expired += n;
+        }
+
+        for (int dev = 0; dev < devices; dev++)
+        {
+            if ((now + dev * (period / devices)) % period == 0)
+            {
+                wheel.cancel(ids[dev]);
+                ids[dev] = wheel.start(now + duration, uint64_t(dev));
+            }
+        }
+    }
+
+    // previous: a 1 s tick checking 10 sensors, 100 ms ticks while durations are pending
+    const int beforeWakeups = int(hour / 100);
+    const int beforeChecks = beforeWakeups * 10;
+    INFO("before: " << beforeWakeups << " wakeups, " << beforeChecks << " sensor checks per hour");
+    INFO("after: " << wakeups << " wakeups, " << expired << " expired timers per hour");
+    REQUIRE(expired >= size_t(devices * (hour / period) - devices));
+    REQUIRE(wakeups * 5 < beforeWakeups);
+    REQUIRE(expired * 50 < size_t(beforeChecks)); // only due sensors are looked at
+
+    BENCHMARK("start and cancel")
+    {
+        const TimerWheel::Id id = wheel.start(hour + 12345, 1);
+        return wheel.cancel(id);
+    };
+}
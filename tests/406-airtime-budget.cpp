@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "airtime_budget.h"
+
+TEST_CASE("Airtime budget defers traffic on busy routes only")
+{
+    AirtimeBudget budget(4, 8, 6000);
+    const uint64_t busyRoute = 0x00212EFFFF000001;
+    const uint64_t otherRoute = 0x00212EFFFF000002;
+
+    REQUIRE(budget.acquire(busyRoute, 0, 2));
+    REQUIRE(budget.size() == 0); // idle routes don't need a bucket
+
+    budget.consume(busyRoute, 0, 2); // OTA block request and response
+    REQUIRE(budget.size() == 1);
+    REQUIRE(!budget.isThrottled(busyRoute, 0));
+
+    for (int64_t t = 0; t < 2000; t += 100)
+    {
+        budget.consume(busyRoute, t, 2); // 20 frames per second
+    }
+
+    REQUIRE(budget.isThrottled(busyRoute, 2000));
+    REQUIRE(!budget.isThrottled(otherRoute, 2000));
+    REQUIRE(budget.acquire(otherRoute, 2000, 2));
+
+    REQUIRE(!budget.acquire(busyRoute, 2000, 2));
+    REQUIRE(!budget.acquire(busyRoute, 2500, 2));
+
+    // OTA pauses, the budget recovers at 4 frames per second
+    REQUIRE(!budget.acquire(busyRoute, 4000, 2));
+    REQUIRE(budget.acquire(busyRoute, 4500, 2));
+
+    // after the transfer the bucket is dropped
+    REQUIRE(!budget.isThrottled(busyRoute, 10000));
+    REQUIRE(budget.size() == 0);
+}
+
+TEST_CASE("Airtime budget grants a fair share on saturated routes")
+{
+    AirtimeBudget budget(4, 8, 6000);
+    const uint64_t route = 1;
+    int grants = 0;
+
+    for (int64_t t = 0; t < 60000; t += 100)
+    {
+        budget.consume(route, t, 2);
+        if (t % 1000 == 0 && budget.acquire(route, t, 2))
+        {
+            grants++;
+        }
+    }
+
+    // one grant per 6 seconds at most, but never zero
+    REQUIRE(grants >= 8);
+    REQUIRE(grants <= 11);
+}
+
+namespace {
+
+struct SimDevice
+{
+    uint64_t route;
+    bool reachable;
+    int64_t lastPoll = -1;
+    int64_t sumInterval = 0;
+    int64_t maxInterval = 0;
+    int intervals = 0;
+};
+
+struct PollLatency
+{
+    double unrelated = 0; // mean poll interval in seconds
+    double sameRoute = 0;
+    double sameRouteMax = 0; // worst poll interval on the OTA route
+};
+
+/*
+ * Mirrors the DeviceTick idle state: one device is polled per tick, a poll takes
+ * pollMs until REventPollDone, unreachable devices cost a tick. The OTA device
+ * requests a block every 250 ms for the whole simulated time.
+ */
+PollLatency simulate(bool perRoute)
+{
+    const int64_t simTime = 2 * 3600 * 1000LL;
+    const int64_t tickIdle = 1000;
+    const int64_t tickIdleOtau = 6000; // previous global slowdown
+    const int64_t pollMs = 300;
+    const int64_t blockInterval = 250;
+    const uint64_t otaRoute = 1000;
+
+    std::vector<SimDevice> devices;
+    for (int i = 0; i < 100; i++)
+    {
+        SimDevice dev;
+        dev.route = (i % 10 == 0) ? otaRoute : uint64_t(i); // every 10th device behind the same router
+        dev.reachable = (i % 5) != 3; // sleeping or offline devices
+        devices.push_back(dev);
+    }
+
+    AirtimeBudget budget;
+    std::vector<size_t> deferred; // skipped devices on throttled routes, oldest first
+    size_t devIter = 0;
+    int64_t now = 0;
+    int64_t nextBlock = 0;
+
+    const auto poll = [&now](SimDevice &dev)
+    {
+        if (dev.lastPoll >= 0)
+        {
+            dev.sumInterval += now - dev.lastPoll;
+            dev.intervals++;
+            dev.maxInterval = std::max(dev.maxInterval, now - dev.lastPoll);
+        }
+        dev.lastPoll = now;
+    };
+
+    while (now < simTime)
+    {
+        for (; nextBlock <= now; nextBlock += blockInterval)
+        {
+            budget.consume(otaRoute, nextBlock, 2);
+        }
+
+        bool polled = false;
+        for (auto i = deferred.begin(); perRoute && i != deferred.end(); ++i)
+        {
+            if (budget.acquire(devices[*i].route, now, 2))
+            {
+                poll(devices[*i]);
+                deferred.erase(i);
+                polled = true;
+                break;
+            }
+        }
+
+        for (size_t n = 0; !polled && n < devices.size(); n++)
+        {
+            const size_t idx = devIter % devices.size();
+            SimDevice &dev = devices[idx];
+            devIter++;
+
+            if (!dev.reachable)
+            {
+                break;
+            }
+
+            if (std::find(deferred.begin(), deferred.end(), idx) != deferred.end())
+            {
+                continue;
+            }
+
+            if (perRoute && !budget.acquire(dev.route, now, 2))
+            {
+                deferred.push_back(idx);
+                continue;
+            }
+
+            poll(dev);
+            polled = true;
+        }
+
+        if (polled)
+        {
+            now += pollMs + tickIdle; // poll done, idle state entered again
+        }
+        else
+        {
+            now += perRoute ? tickIdle : tickIdleOtau;
+        }
+    }
+
+    PollLatency result;
+    int64_t sum[2] = { };
+    int count[2] = { };
+    for (const SimDevice &dev : devices)
+    {
+        const int i = dev.route == otaRoute ? 1 : 0;
+        sum[i] += dev.sumInterval;
+        count[i] += dev.intervals;
+        if (i == 1)
+        {
+            result.sameRouteMax = std::max(result.sameRouteMax, double(dev.maxInterval) / 1000);
+        }
+    }
+
+    result.unrelated = count[0] ? double(sum[0]) / count[0] / 1000 : 0;
+    result.sameRoute = count[1] ? double(sum[1]) / count[1] / 1000 : 0;
+    return result;
+}
+
+} // namespace
+
+TEST_CASE("Poll latency during a long OTA transfer")
+{
+    const PollLatency before = simulate(false);
+    const PollLatency after = simulate(true);
+
+    INFO("before: unrelated " << before.unrelated << " s, same route " << before.sameRoute << " s");
+    INFO("after: unrelated " << after.unrelated << " s, same route " << after.sameRoute << " s, max " << after.sameRouteMax << " s");
+
+    REQUIRE(after.unrelated > 0);
+    REQUIRE(after.unrelated * 1.5 < before.unrelated);
+    REQUIRE(after.sameRoute > after.unrelated); // only the busy route is throttled
+    REQUIRE(after.sameRouteMax < 2 * before.sameRouteMax); // but not starved
+}
@@ -0,0 +1,545 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <vector>
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonDocument>
+#include <deconz.h>
+
+#include "catch2/catch.hpp"
+
+#include "aps_capture.h"
+#include "database.h"
+#include "device.h"
+#include "device_access_fn.h"
+#include "device_descriptions.h"
+#include "device_js/device_js.h"
+#include "event.h"
+#include "resource.h"
+
+static APS_CaptureRecord makeReport(int64_t timeMs, uint64_t ext, uint16_t clusterId, uint16_t attrId, uint8_t dataType, uint64_t value, int valueSize)
+{
+    APS_CaptureRecord rec;
+    rec.timeMs = timeMs;
+    rec.srcExt = ext;
+    rec.srcNwk = uint16_t(ext & 0xFFFF);
+    rec.profileId = 0x0104;
+    rec.clusterId = clusterId;
+    rec.srcEndpoint = 0x01;
+    rec.dstEndpoint = 0x01;
+    rec.lqi = 200;
+    rec.rssi = -60;
+
+    // ZCL header: profile wide, server to client, disable default response
+    rec.asdu = { 0x18, uint8_t(timeMs), 0x0A, uint8_t(attrId), uint8_t(attrId >> 8), dataType };
+    for (int i = 0; i < valueSize; i++)
+    {
+        rec.asdu.push_back(uint8_t(value >> (i * 8)));
+    }
+    return rec;
+}
+
+/*
+ * Synthetic stand-in for a real capture: 200 devices reporting temperature,
+ * humidity, on/off and power measurements for one hour, and bursts of 20 lights
+ * reporting on/off at once every 10 seconds.
+ */
+static std::vector<APS_CaptureRecord> syntheticCapture()
+{
+    std::vector<APS_CaptureRecord> records;
+    const int64_t hour = 3600 * 1000;
+
+    for (int64_t t = 0; t < hour; t += 250)
+    {
+        const int dev = int((t / 250) % 200);
+        const uint64_t ext = 0x00158D0000000000ULL + uint64_t(dev);
+
+        switch (dev % 4)
+        {
+        case 0: records.push_back(makeReport(t, ext, 0x0402, 0x0000, 0x29, 2150 + dev, 2)); break;
+        case 1: records.push_back(makeReport(t, ext, 0x0405, 0x0000, 0x21, 4800 + dev, 2)); break;
+        case 2: records.push_back(makeReport(t, ext, 0x0006, 0x0000, 0x10, uint64_t(t / 1000) & 1, 1)); break;
+        default: records.push_back(makeReport(t, ext, 0x0B04, 0x050B, 0x29, 60 + dev, 2)); break;
+        }
+
+        for (int light = 0; t % 10000 == 0 && light < 20; light++)
+        {
+            records.push_back(makeReport(t, 0x0017880100000000ULL + uint64_t(light), 0x0006, 0x0000, 0x10, uint64_t(t / 10000) & 1, 1));
+        }
+    }
+
+    APS_CaptureRecord group; // switch sending a groupcast command
+    group.timeMs = hour;
+    group.srcExt = 0x000B57FFFE000001ULL;
+    group.groupcast = true;
+    group.dstGroup = 0x1234;
+    group.profileId = 0x0104;
+    group.clusterId = 0x0006;
+    group.asdu = { 0x01, 0x42, 0x02 }; // toggle
+    records.push_back(group);
+
+    return records;
+}
+
+int argc = 0;
+QCoreApplication app(argc, nullptr);
+
+// device.cpp dependencies which live in the plugin, as in 001-device-1.cpp
+
+bool DB_StoreSubDevice(const QString &parentUniqueId, const QString &uniqueId)
+{
+    return !parentUniqueId.isEmpty() && !uniqueId.isEmpty();
+}
+
+bool DB_StoreSubDeviceItem(const Resource *sub, const ResourceItem *item)
+{
+    return sub && item;
+}
+
+bool DB_LoadSubDeviceItem(const Resource *sub, ResourceItem *item)
+{
+    return sub && item;
+}
+
+std::vector<DB_ResourceItem> DB_LoadSubDeviceItemsOfDevice(const QString &/*deviceUniqueId*/)
+{
+    return {};
+}
+
+std::vector<DB_ResourceItem> DB_LoadSubDeviceItems(const QString &/*uniqueId*/)
+{
+    return {};
+}
+
+Resource *DEV_InitCompatNodeFromDescription(Device */*device*/, const DeviceDescription::SubDevice &/*sub*/, const QString &/*uniqueId*/)
+{
+    return nullptr;
+}
+
+const deCONZ::Node *DEV_GetCoreNode(uint64_t /*extAddr*/)
+{
+    return nullptr;
+}
+
+Resource *DEV_GetResource(const char */*resource*/, const QString &/*identifier*/)
+{
+    return nullptr;
+}
+
+quint8 zclNextSequenceNumber()
+{
+    return 0;
+}
+
+static std::vector<Event> *eventQueue = nullptr;
+
+void enqueueEvent(const Event &e)
+{
+    if (eventQueue)
+    {
+        eventQueue->push_back(e);
+    }
+}
+
+/*
+ * DDF items of the clusters in the synthetic capture. The "parse" objects come from the
+ * generic item files, which the device description loader uses for DDF items without
+ * their own "parse".
+ */
+static const char *ddfItemFiles[] = {
+    "state_temperature_item.json",
+    "state_humidity_item.json",
+    "state_on_item.json",
+    "state_power_item.json"
+};
+
+struct ReplayItem
+{
+    QString suffix;
+    QVariant parseParameters;
+};
+
+struct ReplayResource
+{
+    DeviceKey deviceKey = 0;
+    std::unique_ptr<Resource> r;
+    std::vector<QVariant> parseParameters; //! per item index, like DDF_GetItem()
+};
+
+static std::vector<ReplayItem> loadDdfItems()
+{
+    std::vector<ReplayItem> result;
+
+    for (const char *file : ddfItemFiles)
+    {
+        QFile f(QLatin1String(DDF_DIR "/generic/items/") + QLatin1String(file));
+        REQUIRE(f.open(QIODevice::ReadOnly));
+
+        const QVariantMap ddfItem = QJsonDocument::fromJson(f.readAll()).toVariant().toMap();
+        REQUIRE(ddfItem.contains(QLatin1String("parse")));
+        result.push_back({ddfItem.value(QLatin1String("id")).toString(), ddfItem.value(QLatin1String("parse"))});
+    }
+
+    return result;
+}
+
+/*
+ * Replays \p records through the stages of apsdeDataIndication() which don't need the plugin:
+ * the indication and ZCL frame are rebuilt as deCONZ types, the DA_* parse functions of the
+ * DDF items evaluate their expressions with DeviceJs and every item set by them is queued as
+ * Event, like the plugin does for managed devices. The queue is processed when the recorded
+ * time advances. Database writes and rules aren't part of the replay.
+ */
+class CaptureReplay
+{
+public:
+    CaptureReplay() : m_ddfItems(loadDdfItems()) { }
+
+    APS_ReplayStats replay(const std::vector<APS_CaptureRecord> &records)
+    {
+        APS_ReplayStats stats;
+        std::vector<Event> queue;
+        int64_t lastTime = records.empty() ? 0 : records.front().timeMs;
+        stats.latencyNs.reserve(records.size());
+        eventQueue = &queue;
+
+        for (const APS_CaptureRecord &rec : records)
+        {
+            if (rec.timeMs != lastTime)
+            {
+                m_events += queue.size();
+                queue.clear();
+                lastTime = rec.timeMs;
+            }
+
+            const auto start = std::chrono::steady_clock::now();
+            indication(rec);
+            const auto end = std::chrono::steady_clock::now();
+
+            stats.latencyNs.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+            stats.maxQueueDepth = std::max(stats.maxQueueDepth, queue.size());
+            stats.sumQueueDepth += queue.size();
+        }
+
+        m_events += queue.size();
+        eventQueue = nullptr;
+        return stats;
+    }
+
+    Resource *resource(uint64_t ext, uint8_t endpoint)
+    {
+        const auto i = m_index.find({ext, endpoint});
+        return i != m_index.end() ? m_resources[i->second].r.get() : nullptr;
+    }
+
+    size_t events() const { return m_events; }
+
+private:
+    void indication(const APS_CaptureRecord &rec)
+    {
+        deCONZ::ApsDataIndication ind;
+        ind.setProfileId(rec.profileId);
+        ind.setClusterId(rec.clusterId);
+        ind.setSrcAddressMode(deCONZ::ApsExtAddress);
+        ind.srcAddress().setExt(rec.srcExt);
+        ind.srcAddress().setNwk(rec.srcNwk);
+        ind.setSrcEndpoint(rec.srcEndpoint);
+        ind.setDstEndpoint(rec.dstEndpoint);
+        ind.setLinkQuality(rec.lqi);
+        ind.setRssi(rec.rssi);
+        ind.setAsdu(QByteArray(reinterpret_cast<const char*>(rec.asdu.data()), int(rec.asdu.size())));
+
+        if (rec.groupcast)
+        {
+            ind.setDstAddressMode(deCONZ::ApsGroupAddress);
+            ind.dstAddress().setGroup(rec.dstGroup);
+        }
+        else
+        {
+            ind.setDstAddressMode(deCONZ::ApsNwkAddress);
+        }
+
+        deCONZ::ZclFrame zclFrame;
+        {
+            QDataStream stream(ind.asdu());
+            stream.setByteOrder(QDataStream::LittleEndian);
+            zclFrame.readFromStream(stream);
+        }
+
+        if (rec.groupcast || !rec.srcExt)
+        {
+            return; // group commands go to the rules
+        }
+
+        ReplayResource &res = replayResource(rec.srcExt, rec.srcEndpoint);
+        Resource *r = res.r.get();
+
+        DeviceJs::instance()->clearItemsSet();
+
+        for (int i = 0; i < r->itemCount(); i++)
+        {
+            ResourceItem *item = r->itemForIndex(size_t(i));
+            const QVariant &parseParameters = res.parseParameters[size_t(i)];
+            ParseFunction_t parseFunction = item->parseFunction();
+
+            if (!parseFunction && !parseParameters.isNull())
+            {
+                parseFunction = DA_GetParseFunction(parseParameters);
+            }
+
+            if (parseFunction)
+            {
+                parseFunction(r, item, ind, zclFrame, parseParameters);
+            }
+        }
+
+        const QString &id = r->item(RAttrId)->toString();
+        for (ResourceItem *item : DeviceJs::instance()->itemsSet())
+        {
+            enqueueEvent(Event(r->prefix(), item->descriptor().suffix, id, item, res.deviceKey));
+        }
+    }
+
+    /*! Sub-device of the node and endpoint, created on the first frame like a device joining. */
+    ReplayResource &replayResource(uint64_t ext, uint8_t endpoint)
+    {
+        const auto i = m_index.find({ext, endpoint});
+        if (i != m_index.end())
+        {
+            return m_resources[i->second];
+        }
+
+        m_index[{ext, endpoint}] = m_resources.size();
+        m_resources.emplace_back();
+        ReplayResource &res = m_resources.back();
+        res.deviceKey = ext;
+        res.r = std::make_unique<Resource>(RSensors);
+
+        // endpoint in the unique id, resolveAutoEndpoint() uses it for "ep": 0
+        const QString uniqueId = QString("%1-%2").arg(quint64(ext), 16, 16, QLatin1Char('0')).arg(uint(endpoint), 2, 16, QLatin1Char('0'));
+        res.r->addItem(DataTypeString, RAttrId)->setValue(QString::number(m_resources.size()));
+        res.r->addItem(DataTypeString, RAttrUniqueId)->setValue(uniqueId);
+        res.r->addItem(DataTypeInt16, RConfigOffset)->setValue(qint64(0));
+        res.parseParameters.resize(size_t(res.r->itemCount()));
+
+        for (const ReplayItem &ddfItem : m_ddfItems)
+        {
+            ResourceItemDescriptor rid;
+            REQUIRE(getResourceItemDescriptor(ddfItem.suffix, rid));
+            res.r->addItem(rid.type, rid.suffix);
+            res.parseParameters.push_back(ddfItem.parseParameters);
+        }
+
+        return res;
+    }
+
+    std::vector<ReplayItem> m_ddfItems;
+    std::vector<ReplayResource> m_resources;
+    std::map<std::pair<uint64_t, uint8_t>, size_t> m_index;
+    size_t m_events = 0;
+};
+
+TEST_CASE("APS capture records round trip")
+{
+    std::vector<APS_CaptureRecord> records = syntheticCapture();
+    records.resize(8);
+    records.push_back(syntheticCapture().back());
+
+    std::vector<uint8_t> data;
+    APS_EncodeCaptureHeader(data);
+    int64_t prev = 0;
+    for (const APS_CaptureRecord &rec : records)
+    {
+        APS_EncodeCaptureRecord(rec, prev, data);
+        prev = rec.timeMs;
+    }
+
+    std::vector<APS_CaptureRecord> decoded;
+    REQUIRE(APS_DecodeCapture(data.data(), data.size(), &decoded));
+    REQUIRE(decoded.size() == records.size());
+
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        REQUIRE(decoded[i].timeMs == records[i].timeMs);
+        REQUIRE(decoded[i].srcExt == records[i].srcExt);
+        REQUIRE(decoded[i].srcNwk == records[i].srcNwk);
+        REQUIRE(decoded[i].groupcast == records[i].groupcast);
+        REQUIRE(decoded[i].dstGroup == records[i].dstGroup);
+        REQUIRE(decoded[i].profileId == records[i].profileId);
+        REQUIRE(decoded[i].clusterId == records[i].clusterId);
+        REQUIRE(decoded[i].srcEndpoint == records[i].srcEndpoint);
+        REQUIRE(decoded[i].dstEndpoint == records[i].dstEndpoint);
+        REQUIRE(decoded[i].lqi == records[i].lqi);
+        REQUIRE(decoded[i].rssi == records[i].rssi);
+        REQUIRE(decoded[i].asdu == records[i].asdu);
+    }
+
+    // a capture which is still written might end in the middle of a record
+    decoded.clear();
+    REQUIRE(!APS_DecodeCapture(data.data(), data.size() - 2, &decoded));
+    REQUIRE(decoded.size() == records.size() - 1);
+
+    data[0] = 'X';
+    REQUIRE(!APS_DecodeCapture(data.data(), data.size(), &decoded));
+}
+
+TEST_CASE("APS capture writer and reader")
+{
+    const char *path = "407-aps-replay.bin";
+    const std::vector<APS_CaptureRecord> records = syntheticCapture();
+    std::remove(path);
+
+    {
+        APS_CaptureWriter writer;
+        REQUIRE(writer.open(path));
+        for (const APS_CaptureRecord &rec : records)
+        {
+            writer.write(rec);
+        }
+        REQUIRE(writer.count() == records.size());
+    }
+
+    std::vector<APS_CaptureRecord> decoded;
+    REQUIRE(APS_ReadCapture(path, &decoded));
+    REQUIRE(decoded.size() == records.size());
+    REQUIRE(decoded.back().asdu == records.back().asdu);
+    REQUIRE(decoded.back().timeMs == records.back().timeMs);
+
+    FILE *fp = fopen(path, "rb");
+    REQUIRE(fp);
+    fseek(fp, 0, SEEK_END);
+    const long size = ftell(fp);
+    fclose(fp);
+    std::remove(path);
+
+    INFO("capture size: " << size << " bytes for " << records.size() << " indications");
+    REQUIRE(size < long(records.size() * 32)); // compact, ~30 bytes per report
+}
+
+TEST_CASE("APS capture is continued after restart and rotated at its size limit")
+{
+    const char *path = "407-aps-rotate.bin";
+    const char *prevPath = "407-aps-rotate.bin.1";
+    const std::vector<APS_CaptureRecord> records = syntheticCapture();
+    const size_t half = records.size() / 2;
+    std::remove(path);
+    std::remove(prevPath);
+
+    for (int restart = 0; restart < 2; restart++)
+    {
+        APS_CaptureWriter writer;
+        REQUIRE(writer.open(path));
+        for (size_t i = restart * half; i < (restart + 1) * half; i++)
+        {
+            writer.write(records[i]);
+        }
+    }
+
+    std::vector<APS_CaptureRecord> decoded;
+    REQUIRE(APS_ReadCapture(path, &decoded));
+    REQUIRE(decoded.size() == 2 * half);
+    REQUIRE(decoded[half - 1].asdu == records[half - 1].asdu);
+    REQUIRE(decoded[half].asdu == records[half].asdu);
+
+    const size_t maxSize = 64 * 1024;
+    {
+        APS_CaptureWriter writer;
+        REQUIRE(writer.open(path, maxSize));
+        for (const APS_CaptureRecord &rec : records)
+        {
+            writer.write(rec);
+        }
+    }
+
+    std::vector<APS_CaptureRecord> prev;
+    decoded.clear();
+    REQUIRE(APS_ReadCapture(prevPath, &prev));
+    REQUIRE(APS_ReadCapture(path, &decoded));
+    REQUIRE(!prev.empty());
+    REQUIRE(!decoded.empty());
+    REQUIRE(decoded.back().asdu == records.back().asdu);
+    REQUIRE(decoded.back().srcExt == records.back().srcExt);
+
+    for (const char *p : { path, prevPath })
+    {
+        FILE *fp = fopen(p, "rb");
+        REQUIRE(fp);
+        fseek(fp, 0, SEEK_END);
+        const long size = ftell(fp);
+        fclose(fp);
+        REQUIRE(size_t(size) < maxSize + 8192); // limit is checked per written chunk
+    }
+
+    // a file which isn't a capture is moved aside instead of appended to
+    FILE *fp = fopen(path, "wb");
+    REQUIRE(fp);
+    fputs("not a capture", fp);
+    fclose(fp);
+
+    {
+        APS_CaptureWriter writer;
+        REQUIRE(writer.open(path));
+        writer.write(records.front());
+    }
+
+    decoded.clear();
+    REQUIRE(APS_ReadCapture(path, &decoded));
+    REQUIRE(decoded.size() == 1);
+
+    std::remove(path);
+    std::remove(prevPath);
+}
+
+/*
+ * Set APS_CAPTURE to a log recorded with the plugin (--aps-capture=1) to replay the frames of a real network.
+ */
+TEST_CASE("Replay an APS capture through the DDF parse functions")
+{
+    initResourceDescriptors();
+    DeviceJs deviceJs;
+
+    std::vector<APS_CaptureRecord> records;
+    const char *path = std::getenv("APS_CAPTURE");
+
+    if (path)
+    {
+        REQUIRE(APS_ReadCapture(path, &records));
+    }
+    else
+    {
+        records = syntheticCapture();
+    }
+
+    REQUIRE(!records.empty());
+
+    CaptureReplay replay;
+    const APS_ReplayStats stats = replay.replay(records);
+    REQUIRE(stats.latencyNs.size() == records.size());
+    REQUIRE(stats.percentile(50) <= stats.percentile(99));
+
+    INFO("frames: " << records.size() << ", events: " << replay.events());
+    INFO("latency p50: " << stats.percentile(50) << " ns, p90: " << stats.percentile(90) << " ns, p99: " << stats.percentile(99) << " ns");
+    INFO("event queue depth mean: " << stats.meanQueueDepth() << ", max: " << stats.maxQueueDepth);
+
+    if (!path)
+    {
+        // every report sets one item, the groupcast has no sub-device
+        REQUIRE(replay.events() == records.size() - 1);
+        REQUIRE(stats.maxQueueDepth >= 21); // light burst and a sensor report at the same time
+
+        Resource *sensor = replay.resource(0x00158D0000000000ULL, 0x01); // device 0 reports temperature
+        REQUIRE(sensor);
+        REQUIRE(sensor->item(RStateTemperature)->toNumber() == 2150);
+
+        Resource *plug = replay.resource(0x00158D0000000000ULL + 3, 0x01); // device 3 reports power
+        REQUIRE(plug);
+        REQUIRE(plug->item(RStatePower)->toNumber() == 63);
+    }
+
+    CHECK(stats.percentile(99) < 5000000); // 5 ms per frame
+}
@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "task_scheduler.h"
+
+/*
+ * A dashboard slider recorded at ~25 requests per second for 3 seconds, each
+ * PUT /lights/1/state carries bri and xy. The mock controller sends the tasks chosen
+ * by the TaskScheduler and applies them to the light after the APS confirm latency.
+ */
+namespace {
+
+enum Attribute { AttrBri, AttrXy };
+
+struct SliderRequest
+{
+    int64_t time;
+    int bri;
+    int x;
+};
+
+struct Frame
+{
+    int taskId;
+    Attribute attr;
+    int value;
+    int64_t sendTime;
+};
+
+struct SliderResult
+{
+    int frames = 0;
+    int rejected = 0;     // requests answered with bridge busy
+    int finalBri = -1;
+    int finalX = -1;
+    int64_t lag = 0;      // ms from the last request until the light shows its values
+};
+
+std::vector<SliderRequest> recordedSlider()
+{
+    std::vector<SliderRequest> burst;
+    int64_t t = 0;
+    for (int i = 0; i < 75; i++)
+    {
+        burst.push_back({t, 1 + (i * 253) / 74, 10000 + i * 400});
+        t += 40 + ((i * 7) % 5) - 2; // jitter of the browser
+    }
+    return burst;
+}
+
+SliderResult replaySlider(bool coalesceLevel)
+{
+    const uint64_t light = 0x00178801000000AAULL;
+    const uint64_t levelKey = 0x0101000801; // endpoints, level cluster, task type
+    const uint64_t colorKey = 0x0101030002; // endpoints, color cluster, task type
+    const int64_t confirmLatency = 250; // routed light
+    const int tickMs = 10;
+
+    TaskScheduler sched;
+    std::map<int, Frame> queued;
+    std::vector<Frame> onAir;
+    SliderResult result;
+    const std::vector<SliderRequest> burst = recordedSlider();
+    size_t next = 0;
+    int nextId = 1;
+    int64_t now = 0;
+    int64_t lastApplied = 0;
+
+    const auto add = [&](Attribute attr, int value, uint64_t key)
+    {
+        const int id = nextId++;
+        int superseded = -1;
+        if (!sched.enqueue(id, light, false, TaskPriorityUser, key, &superseded, attr == AttrBri))
+        {
+            return false;
+        }
+        if (superseded != -1)
+        {
+            queued.erase(superseded);
+        }
+        queued[id] = Frame{id, attr, value, -1};
+        return true;
+    };
+
+    while (next < burst.size() || !queued.empty() || !onAir.empty())
+    {
+        for (; next < burst.size() && burst[next].time <= now; next++)
+        {
+            const bool ok1 = add(AttrBri, burst[next].bri, coalesceLevel ? levelKey : 0);
+            const bool ok2 = add(AttrXy, burst[next].x, colorKey);
+            if (!ok1 || !ok2)
+            {
+                result.rejected++;
+            }
+        }
+
+        for (auto i = onAir.begin(); i != onAir.end(); )
+        {
+            if (i->sendTime + confirmLatency <= now)
+            {
+                if (i->attr == AttrBri) { result.finalBri = i->value; }
+                else                    { result.finalX = i->value; }
+                lastApplied = now;
+                sched.markConfirmed(i->taskId, now);
+                i = onAir.erase(i);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+
+        const int id = sched.selectNext([](int) { return true; });
+        if (id != -1)
+        {
+            Frame frame = queued[id];
+            queued.erase(id);
+            frame.sendTime = now;
+            sched.markSent(id, now, true);
+            onAir.push_back(frame);
+            result.frames++;
+        }
+
+        now += tickMs;
+    }
+
+    result.lag = lastApplied - burst.back().time;
+    return result;
+}
+
+} // namespace
+
+TEST_CASE("Slider burst is coalesced per light and attribute")
+{
+    const std::vector<SliderRequest> burst = recordedSlider();
+    const SliderResult before = replaySlider(false);
+    const SliderResult after = replaySlider(true);
+
+    INFO("requests: " << burst.size());
+    INFO("before: " << before.frames << " frames, " << before.rejected << " rejected, lag " << before.lag << " ms");
+    INFO("after: " << after.frames << " frames, " << after.rejected << " rejected, lag " << after.lag << " ms");
+
+    // the light ends with the values of the last request
+    REQUIRE(after.finalBri == burst.back().bri);
+    REQUIRE(after.finalX == burst.back().x);
+    REQUIRE(after.rejected == 0);
+
+    // at most one pending frame per attribute, so the light follows closely
+    REQUIRE(after.frames < before.frames);
+    REQUIRE(after.lag <= 3 * 250 + 20);
+    REQUIRE(after.lag * 4 < before.lag);
+}
+
+TEST_CASE("Move to Level doesn't overtake a queued On/Off")
+{
+    const uint64_t light = 0x00178801000000AAULL;
+    const uint64_t levelKey = 0x0101000801;
+    const uint64_t onOffKey = 0x0101000601;
+    const uint64_t colorKey = 0x0101030002;
+    TaskScheduler sched;
+    int superseded = -1;
+
+    REQUIRE(sched.enqueue(1, light, false, TaskPriorityUser, levelKey, &superseded, true)); // bri 200
+    REQUIRE(sched.enqueue(2, light, false, TaskPriorityUser, onOffKey, &superseded));       // off
+    REQUIRE(sched.enqueue(3, light, false, TaskPriorityUser, levelKey, &superseded, true)); // bri 50
+    CHECK(superseded == -1); // queued after the off command
+
+    REQUIRE(sched.enqueue(4, light, false, TaskPriorityUser, levelKey, &superseded, true)); // bri 60
+    CHECK(superseded == 3);  // last queued, replaced in place
+
+    REQUIRE(sched.enqueue(5, light, false, TaskPriorityUser, colorKey, &superseded));
+    REQUIRE(sched.enqueue(6, light, false, TaskPriorityUser, levelKey, &superseded, true)); // bri 70
+    CHECK(superseded == -1);
+
+    std::vector<int> order;
+    for (int id; (id = sched.selectNext([](int) { return true; })) != -1; )
+    {
+        order.push_back(id);
+        sched.markSent(id, 0, false);
+    }
+
+    CHECK(order == std::vector<int>({1, 2, 4, 5, 6}));
+}
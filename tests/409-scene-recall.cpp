@@ -0,0 +1,265 @@
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "utils/slabvector.h"
+
+/*
+ * Models recallSceneCheckGroupChanges() and the websocket part of handleLightEvent():
+ * lights live in a SlabVector, scene members either carry the light id only or
+ * additionally the resolved (index, generation, hash) handle.
+ */
+namespace {
+
+enum StateItem { ItemOn, ItemBri, ItemColorMode, ItemX, ItemY, ItemCount };
+
+struct SimItem
+{
+    int64_t value = 0;
+    bool needPush = false;
+};
+
+struct SimLight
+{
+    explicit SimLight(int n) :
+        id(std::to_string(n)),
+        uniqueId("00:17:88:01:00:00:" + std::to_string(1000 + n) + "-0b"),
+        hash(std::hash<std::string>()(uniqueId))
+    { }
+
+    std::string id;
+    std::string uniqueId;
+    size_t hash;
+    SimItem state[ItemCount];
+};
+
+struct SimMember
+{
+    std::string lid;
+    size_t index = SIZE_MAX;
+    uint16_t generation = 0;
+    size_t hash = 0;
+    int64_t values[ItemCount];
+};
+
+struct SimEvent
+{
+    SimLight *light;
+    StateItem item;
+};
+
+struct SimGateway
+{
+    SimGateway(int lightCount)
+    {
+        for (int i = 1; i <= lightCount; i++)
+        {
+            lights.emplace_back(i);
+        }
+    }
+
+    // getLightNodeForId() with the id cache
+    SimLight *lightForId(const std::string &id, size_t *index)
+    {
+        const auto cached = idCache.find(id);
+        if (cached != idCache.end() && cached->second < lights.size() && lights[cached->second].id == id)
+        {
+            *index = cached->second;
+            return &lights[cached->second];
+        }
+
+        for (auto i = lights.begin(); i != lights.end(); ++i)
+        {
+            if (i->id == id)
+            {
+                idCache[id] = i.index();
+                *index = i.index();
+                return &*i;
+            }
+        }
+        return nullptr;
+    }
+
+    SimLight *lightForMember(SimMember &m, bool useHandle)
+    {
+        if (useHandle && lights.isValid(m.index, m.generation) && lights[m.index].hash == m.hash)
+        {
+            return &lights[m.index];
+        }
+
+        size_t idx = 0;
+        SimLight *light = lightForId(m.lid, &idx);
+        if (light && useHandle)
+        {
+            m.index = idx;
+            m.generation = lights.generation(idx);
+            m.hash = light->hash;
+        }
+        return light;
+    }
+
+    void recall(std::vector<SimMember> &scene, bool batched)
+    {
+        for (SimMember &m : scene)
+        {
+            SimLight *light = lightForMember(m, batched);
+            if (!light)
+            {
+                continue;
+            }
+
+            bool first = true;
+            for (int i = 0; i < ItemCount; i++)
+            {
+                SimItem &item = light->state[i];
+                if (item.value != m.values[i])
+                {
+                    item.value = m.values[i];
+                    item.needPush = true;
+                    if (!batched || first)
+                    {
+                        events.push_back({light, StateItem(i)});
+                        first = false;
+                    }
+                }
+            }
+        }
+    }
+
+    // handleLightEvent(): one message carries all state items which need a push
+    void processEvents(bool batched)
+    {
+        for (const SimEvent &e : events)
+        {
+            if (!e.light->state[e.item].needPush)
+            {
+                continue; // already pushed
+            }
+
+            messages++;
+            for (int i = 0; i < ItemCount; i++)
+            {
+                if (batched || i == e.item)
+                {
+                    e.light->state[i].needPush = false;
+                }
+            }
+        }
+        events.clear();
+    }
+
+    SlabVector<SimLight> lights;
+    std::unordered_map<std::string, size_t> idCache;
+    std::vector<SimEvent> events;
+    int messages = 0;
+};
+
+std::vector<SimMember> makeScene(int first, int count, int variant)
+{
+    std::vector<SimMember> scene;
+    for (int i = 0; i < count; i++)
+    {
+        SimMember m;
+        m.lid = std::to_string(first + i * 7); // members spread over the whole network
+        m.values[ItemOn] = 1;
+        m.values[ItemBri] = 50 + variant * 100;
+        m.values[ItemColorMode] = variant;
+        m.values[ItemX] = 20000 + variant * 1000 + i;
+        m.values[ItemY] = 18000 + variant * 1000 + i;
+        scene.push_back(m);
+    }
+    return scene;
+}
+
+struct RecallResult
+{
+    int messages = 0;
+    int64_t latencyNs = 0;
+};
+
+// four groups with a 40 light scene each, every scene is recalled alternating with a second one
+RecallResult recallScenes(bool batched)
+{
+    SimGateway gw(300);
+    std::vector<std::vector<SimMember>> scenes;
+    for (int g = 0; g < 4; g++)
+    {
+        scenes.push_back(makeScene(1 + g, 40, 0));
+        scenes.push_back(makeScene(1 + g, 40, 1));
+    }
+
+    RecallResult result;
+    const int rounds = 50;
+    for (int r = 0; r < rounds; r++)
+    {
+        for (std::vector<SimMember> &scene : scenes)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            gw.recall(scene, batched);
+            const auto end = std::chrono::steady_clock::now();
+            result.latencyNs += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+            gw.processEvents(batched);
+        }
+    }
+
+    result.messages = gw.messages / (rounds * int(scenes.size()));
+    result.latencyNs /= rounds * int(scenes.size());
+    return result;
+}
+
+} // namespace
+
+TEST_CASE("Scene members keep resolved light handles")
+{
+    SimGateway gw(100);
+    std::vector<SimMember> scene = makeScene(1, 10, 0);
+    scene.back().lid = "100";
+
+    gw.recall(scene, true);
+    REQUIRE(scene[1].index == 7);
+    REQUIRE(scene.back().index == 99);
+    REQUIRE(gw.lights.isValid(scene.back().index, scene.back().generation));
+
+    // light 100 is removed and another light takes its slot
+    SimMember &member = scene.back();
+    const uint16_t generation = member.generation;
+    gw.lights.pop_back();
+    gw.idCache.clear();
+    gw.lights.emplace_back(500);
+    REQUIRE(!gw.lights.isValid(99, generation));
+    REQUIRE(gw.lightForMember(member, true) == nullptr); // stale handle isn't used
+
+    // light 100 joins again
+    gw.lights.emplace_back(100);
+    REQUIRE(gw.lightForMember(member, true) == &gw.lights.back());
+    REQUIRE(member.index == 100);
+    REQUIRE(gw.lights.isValid(member.index, member.generation));
+}
+
+TEST_CASE("Scene recall sends one websocket message per light")
+{
+    const RecallResult before = recallScenes(false);
+    const RecallResult after = recallScenes(true);
+
+    INFO("before: " << before.messages << " messages, " << before.latencyNs << " ns per recall");
+    INFO("after: " << after.messages << " messages, " << after.latencyNs << " ns per recall");
+
+    REQUIRE(before.messages == 40 * 4); // on stays, bri, colormode, x, y change
+    REQUIRE(after.messages == 40);
+    CHECK(after.latencyNs <= before.latencyNs * 2);
+
+    BENCHMARK("recall 40 light scene, id lookup")
+    {
+        return recallScenes(false).messages;
+    };
+
+    BENCHMARK("recall 40 light scene, handles")
+    {
+        return recallScenes(true).messages;
+    };
+}
@@ -0,0 +1,317 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "http_keepalive.h"
+
+TEST_CASE("Connection header keep-alive token")
+{
+    const auto wants = [](const char *str) { return HTTP_WantsKeepAlive(1, 1, str, strlen(str)); };
+
+    REQUIRE(wants("keep-alive"));
+    REQUIRE(wants("Keep-Alive"));
+    REQUIRE(wants("Upgrade, keep-alive"));
+    REQUIRE(wants(""));
+    REQUIRE(HTTP_WantsKeepAlive(1, 1, nullptr, 0));
+    REQUIRE(!wants("close"));
+    REQUIRE(!wants("Close"));
+    REQUIRE(!wants("keep-alive, close"));
+}
+
+TEST_CASE("HTTP/1.0 connections close unless keep-alive is requested")
+{
+    const auto wants = [](const char *str) { return HTTP_WantsKeepAlive(1, 0, str, str ? strlen(str) : 0); };
+
+    REQUIRE(!wants(nullptr));
+    REQUIRE(!wants(""));
+    REQUIRE(!wants("Upgrade"));
+    REQUIRE(!wants("close"));
+    REQUIRE(!wants("keep-alive, close"));
+    REQUIRE(wants("keep-alive"));
+    REQUIRE(wants("Keep-Alive"));
+    REQUIRE(HTTP_WantsKeepAlive(2, 0, nullptr, 0));
+}
+
+TEST_CASE("Keep-alive connections are capped and expire")
+{
+    HttpKeepAlive ka(15000, 3);
+    int a = 1;
+    int b = 2;
+    int remaining = -1;
+
+    REQUIRE(!ka.request(&a, 0, false, &remaining));
+    REQUIRE(remaining == 0);
+    REQUIRE(ka.size() == 0);
+
+    REQUIRE(ka.request(&a, 0, true, &remaining));
+    REQUIRE(remaining == 2);
+    REQUIRE(ka.request(&a, 100, true, &remaining));
+    REQUIRE(remaining == 1);
+    REQUIRE(!ka.request(&a, 200, true, &remaining)); // third request closes
+    REQUIRE(!ka.contains(&a));
+
+    REQUIRE(ka.request(&a, 1000, true, &remaining));
+    REQUIRE(ka.request(&b, 10000, true, &remaining));
+
+    std::vector<void*> expired;
+    ka.expire(15999, &expired);
+    REQUIRE(expired.empty());
+    ka.expire(16000, &expired);
+    REQUIRE(expired.size() == 1);
+    REQUIRE(expired[0] == &a);
+    REQUIRE(ka.contains(&b));
+
+    // client asks to close on a persistent connection
+    REQUIRE(!ka.request(&b, 11000, false, &remaining));
+    REQUIRE(ka.size() == 0);
+
+    ka.request(&a, 0, true, &remaining);
+    ka.remove(&a);
+    REQUIRE(ka.size() == 0);
+}
+
+/*
+ * Local load test: a minimal HTTP server on the loopback interface answers like the
+ * REST API, its connection handling is driven by HttpKeepAlive. Clients either open a
+ * connection per request as before, or reuse connections and pipeline requests.
+ */
+namespace {
+
+const char response[] = "[{\"success\":{\"/lights/1/state/on\":true}}]";
+
+void serveClient(int fd, HttpKeepAlive *ka, int64_t *now)
+{
+    std::string buf;
+    char tmp[4096];
+
+    for (;;)
+    {
+        const size_t end = buf.find("\r\n\r\n");
+        if (end == std::string::npos)
+        {
+            const ssize_t n = recv(fd, tmp, sizeof(tmp), 0);
+            if (n <= 0)
+            {
+                break;
+            }
+            buf.append(tmp, size_t(n));
+            continue;
+        }
+
+        const std::string hdr = buf.substr(0, end);
+        buf.erase(0, end + 4); // no request body, pipelined requests remain
+
+        const size_t conn = hdr.find("Connection: ");
+        const int minor = hdr.find(" HTTP/1.0\r\n") != std::string::npos ? 0 : 1;
+        const bool clientKeepAlive = conn == std::string::npos ? HTTP_WantsKeepAlive(1, minor, nullptr, 0)
+                                                               : HTTP_WantsKeepAlive(1, minor, hdr.c_str() + conn + 12, hdr.size() - conn - 12);
+        int remaining = 0;
+        const bool keepAlive = ka->request(&fd, (*now)++, clientKeepAlive, &remaining);
+
+        std::string rsp = "HTTP/1.1 200 OK\r\nContent-Type: application/json; charset=utf-8\r\n";
+        rsp += "Content-Length: " + std::to_string(sizeof(response) - 1) + "\r\n";
+        rsp += keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+        rsp += "\r\n";
+        rsp += response;
+
+        if (send(fd, rsp.data(), rsp.size(), MSG_NOSIGNAL) != ssize_t(rsp.size()) || !keepAlive)
+        {
+            break;
+        }
+    }
+
+    ka->remove(&fd);
+    close(fd);
+}
+
+struct LoadServer
+{
+    LoadServer()
+    {
+        listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        const int one = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        ok = bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 && listen(listenFd, 64) == 0;
+
+        socklen_t len = sizeof(addr);
+        getsockname(listenFd, reinterpret_cast<sockaddr*>(&addr), &len);
+        port = ntohs(addr.sin_port);
+
+        // one client at a time like the single threaded plugin
+        thread = std::thread([this]()
+        {
+            HttpKeepAlive ka(15000, HTTP_KEEPALIVE_MAX_REQUESTS);
+            int64_t now = 0;
+            for (;;)
+            {
+                const int fd = accept(listenFd, nullptr, nullptr);
+                if (fd < 0 || stop)
+                {
+                    if (fd >= 0) { close(fd); }
+                    break;
+                }
+                const int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                connections++;
+                serveClient(fd, &ka, &now);
+            }
+        });
+    }
+
+    ~LoadServer()
+    {
+        stop = true;
+        const int fd = connectClient();
+        if (fd >= 0) { close(fd); }
+        thread.join();
+        close(listenFd);
+    }
+
+    int connectClient() const
+    {
+        const int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+        {
+            close(fd);
+            return -1;
+        }
+        const int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        return fd;
+    }
+
+    int listenFd = -1;
+    uint16_t port = 0;
+    bool ok = false;
+    std::atomic<bool> stop{false};
+    std::atomic<int> connections{0};
+    std::thread thread;
+};
+
+// reads responses until \p count are complete, \returns false if the server closed early
+bool readResponses(int fd, int count, bool *closed)
+{
+    std::string buf;
+    char tmp[4096];
+    int done = 0;
+    *closed = false;
+
+    while (done < count)
+    {
+        const size_t end = buf.find("\r\n\r\n");
+        if (end != std::string::npos && buf.size() >= end + 4 + sizeof(response) - 1)
+        {
+            *closed = buf.substr(0, end).find("Connection: close") != std::string::npos;
+            buf.erase(0, end + 4 + sizeof(response) - 1);
+            done++;
+            continue;
+        }
+
+        const ssize_t n = recv(fd, tmp, sizeof(tmp), 0);
+        if (n <= 0)
+        {
+            return false;
+        }
+        buf.append(tmp, size_t(n));
+    }
+    return true;
+}
+
+struct LoadResult
+{
+    int requests = 0;
+    int connections = 0;
+    double requestsPerSecond = 0;
+};
+
+LoadResult runLoad(int requests, bool keepAlive, int pipeline)
+{
+    LoadServer server;
+    LoadResult result;
+    REQUIRE(server.ok);
+
+    const std::string req = std::string("PUT /api/0123456789/lights/1/state HTTP/1.1\r\nHost: 127.0.0.1\r\n") +
+                            (keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n") + "\r\n";
+
+    const auto start = std::chrono::steady_clock::now();
+    int fd = -1;
+
+    while (result.requests < requests)
+    {
+        if (fd < 0)
+        {
+            fd = server.connectClient();
+            REQUIRE(fd >= 0);
+        }
+
+        const int batch = keepAlive ? std::min(pipeline, requests - result.requests) : 1;
+        std::string out;
+        for (int i = 0; i < batch; i++)
+        {
+            out += req;
+        }
+        REQUIRE(send(fd, out.data(), out.size(), MSG_NOSIGNAL) == ssize_t(out.size()));
+
+        bool closed = false;
+        REQUIRE(readResponses(fd, batch, &closed));
+        result.requests += batch;
+
+        if (closed || !keepAlive)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>(end - start).count();
+    result.requestsPerSecond = seconds > 0 ? result.requests / seconds : 0;
+    result.connections = server.connections;
+    return result;
+}
+
+} // namespace
+
+TEST_CASE("REST load test with and without keep-alive")
+{
+    const int requests = 2000;
+    const LoadResult closeEach = runLoad(requests, false, 1);
+    const LoadResult keepAlive = runLoad(requests, true, 1);
+    const LoadResult pipelined = runLoad(requests, true, 10);
+
+    INFO("Connection: close " << closeEach.requestsPerSecond << " req/s, " << closeEach.connections << " connections");
+    INFO("keep-alive " << keepAlive.requestsPerSecond << " req/s, " << keepAlive.connections << " connections");
+    INFO("keep-alive pipelined " << pipelined.requestsPerSecond << " req/s, " << pipelined.connections << " connections");
+
+    REQUIRE(closeEach.connections == requests);
+    REQUIRE(keepAlive.connections == requests / HTTP_KEEPALIVE_MAX_REQUESTS);
+    REQUIRE(pipelined.connections == requests / HTTP_KEEPALIVE_MAX_REQUESTS);
+    CHECK(keepAlive.requestsPerSecond > closeEach.requestsPerSecond);
+}
@@ -0,0 +1,292 @@
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+#include "catch2/catch.hpp"
+
+#include "websocket_deflate.h"
+
+static bool negotiate(const char *offer, WS_DeflateParams *params, std::string *response)
+{
+    return WS_NegotiateDeflate(offer, strlen(offer), params, response);
+}
+
+TEST_CASE("permessage-deflate negotiation")
+{
+    WS_DeflateParams params;
+    std::string rsp;
+
+    // Chrome and Firefox
+    REQUIRE(negotiate("permessage-deflate; client_max_window_bits", &params, &rsp));
+    REQUIRE(rsp == "permessage-deflate");
+    REQUIRE(!params.serverNoContextTakeover);
+    REQUIRE(params.serverMaxWindowBits == 15);
+
+    // Python websockets
+    REQUIRE(negotiate("permessage-deflate; server_max_window_bits=12; client_max_window_bits=12", &params, &rsp));
+    REQUIRE(rsp == "permessage-deflate; server_max_window_bits=12");
+    REQUIRE(params.serverMaxWindowBits == 12);
+
+    REQUIRE(negotiate("permessage-deflate; server_no_context_takeover; client_no_context_takeover", &params, &rsp));
+    REQUIRE(rsp == "permessage-deflate; server_no_context_takeover; client_no_context_takeover");
+    REQUIRE(params.serverNoContextTakeover);
+
+    // the first acceptable offer is taken
+    REQUIRE(negotiate("permessage-deflate; server_max_window_bits=8, permessage-deflate", &params, &rsp));
+    REQUIRE(rsp == "permessage-deflate");
+
+    // fall back to no extension
+    REQUIRE(!negotiate("x-webkit-deflate-frame", &params, &rsp));
+    REQUIRE(!negotiate("permessage-deflate; server_max_window_bits=8", &params, &rsp));
+    REQUIRE(!negotiate("permessage-deflate; unknown_param", &params, &rsp));
+    REQUIRE(!negotiate("permessage-deflate; server_no_context_takeover; server_no_context_takeover", &params, &rsp));
+    REQUIRE(!negotiate("", &params, &rsp));
+}
+
+static std::vector<uint8_t> clientFrame(uint8_t opcode, bool rsv1, const std::string &payload)
+{
+    const uint8_t mask[4] = { 0x37, 0xFA, 0x21, 0x3D };
+    std::vector<uint8_t> frame;
+    frame.push_back(uint8_t(0x80 | (rsv1 ? 0x40 : 0) | opcode));
+    frame.push_back(uint8_t(0x80 | payload.size()));
+    frame.insert(frame.end(), mask, mask + 4);
+    for (size_t i = 0; i < payload.size(); i++)
+    {
+        frame.push_back(uint8_t(payload[i]) ^ mask[i & 3]);
+    }
+    return frame;
+}
+
+TEST_CASE("Websocket client frames")
+{
+    WS_FrameReader reader;
+    WS_Frame frame;
+
+    std::vector<uint8_t> data = clientFrame(WS_OPCODE_PING, false, "ping");
+    const std::vector<uint8_t> close = clientFrame(WS_OPCODE_CLOSE, false, "\x03\xE8");
+    data.insert(data.end(), close.begin(), close.end());
+
+    // arrives in pieces
+    reader.feed(data.data(), 3);
+    REQUIRE(!reader.next(&frame));
+    reader.feed(data.data() + 3, data.size() - 3);
+
+    REQUIRE(reader.next(&frame));
+    REQUIRE(frame.opcode == WS_OPCODE_PING);
+    REQUIRE(std::string(frame.payload.begin(), frame.payload.end()) == "ping");
+    REQUIRE(reader.next(&frame));
+    REQUIRE(frame.opcode == WS_OPCODE_CLOSE);
+    REQUIRE(frame.payload.size() == 2);
+    REQUIRE(!reader.next(&frame));
+    REQUIRE(!reader.hasError());
+
+    // RSV1 only with negotiated compression
+    data = clientFrame(WS_OPCODE_TEXT, true, "x");
+    reader.feed(data.data(), data.size());
+    REQUIRE(!reader.next(&frame));
+    REQUIRE(reader.hasError());
+
+    WS_FrameReader reader2;
+    reader2.setCompressionEnabled(true);
+    reader2.feed(data.data(), data.size());
+    REQUIRE(reader2.next(&frame));
+    REQUIRE(frame.rsv1);
+
+    // clients must mask their frames
+    WS_FrameReader reader3;
+    std::vector<uint8_t> unmasked;
+    WS_EncodeFrame(WS_OPCODE_TEXT, false, reinterpret_cast<const uint8_t*>("abc"), 3, unmasked);
+    reader3.feed(unmasked.data(), unmasked.size());
+    REQUIRE(!reader3.next(&frame));
+    REQUIRE(reader3.hasError());
+}
+
+/*
+ * Websocket events as sent by the plugin during one hour: 120 sensors reporting
+ * every 1-5 minutes, lights changing state and attr/lastseen updates.
+ */
+static std::vector<std::string> recordedEventStream()
+{
+    std::vector<std::string> events;
+    char buf[512];
+
+    for (int t = 0; t < 3600; t += 2)
+    {
+        const int sensor = (t * 7) % 120;
+        const int sec = t % 60;
+        const int min = t / 60;
+
+        snprintf(buf, sizeof(buf),
+                 "{\"e\":\"changed\",\"id\":\"%d\",\"r\":\"sensors\",\"state\":{\"lastupdated\":\"2024-05-13T10:%02d:%02d.%03d\",\"temperature\":%d},\"t\":\"event\",\"uniqueid\":\"00:15:8d:00:02:%02x:%02x:%02x-01-0402\"}",
+                 sensor + 1, min, sec, (t * 37) % 1000, 2000 + (t % 300), sensor, sensor * 3 & 0xFF, sensor * 7 & 0xFF);
+        events.push_back(buf);
+
+        snprintf(buf, sizeof(buf),
+                 "{\"attr\":{\"id\":\"%d\",\"lastannounced\":null,\"lastseen\":\"2024-05-13T10:%02dZ\",\"manufacturername\":\"LUMI\",\"modelid\":\"lumi.weather\",\"name\":\"Temperature %d\",\"swversion\":\"20191205\",\"type\":\"ZHATemperature\",\"uniqueid\":\"00:15:8d:00:02:%02x:%02x:%02x-01-0402\"},\"e\":\"changed\",\"id\":\"%d\",\"r\":\"sensors\",\"t\":\"event\",\"uniqueid\":\"00:15:8d:00:02:%02x:%02x:%02x-01-0402\"}",
+                 sensor + 1, min, sensor + 1, sensor, sensor * 3 & 0xFF, sensor * 7 & 0xFF, sensor + 1, sensor, sensor * 3 & 0xFF, sensor * 7 & 0xFF);
+        events.push_back(buf);
+
+        if (t % 10 == 0)
+        {
+            const int light = (t / 10) % 40;
+            snprintf(buf, sizeof(buf),
+                     "{\"e\":\"changed\",\"id\":\"%d\",\"r\":\"lights\",\"state\":{\"alert\":null,\"bri\":%d,\"colormode\":\"ct\",\"ct\":%d,\"on\":%s,\"reachable\":true},\"t\":\"event\",\"uniqueid\":\"00:17:88:01:00:%02x:%02x:%02x-0b\"}",
+                     light + 1, (t * 13) % 254 + 1, 153 + (t % 347), (t / 10) % 3 ? "true" : "false", light, light * 5 & 0xFF, light * 11 & 0xFF);
+            events.push_back(buf);
+        }
+    }
+
+    return events;
+}
+
+/*
+ * Independent client side: parses server frames and inflates RSV1 messages like
+ * a browser does, with the inflate window kept between messages.
+ */
+struct TestClient
+{
+    TestClient(bool contextTakeover) : contextTakeover(contextTakeover)
+    {
+        inflateInit2(&zs, -15);
+    }
+
+    ~TestClient()
+    {
+        inflateEnd(&zs);
+    }
+
+    bool receive(const std::vector<uint8_t> &data, std::string *message)
+    {
+        if (data.size() < 2 || (data[0] & 0x0F) != WS_OPCODE_TEXT || !(data[0] & 0x80) || (data[1] & 0x80))
+        {
+            return false;
+        }
+
+        size_t pos = 2;
+        size_t length = data[1] & 0x7F;
+        if (length == 126)
+        {
+            length = size_t(data[2]) << 8 | data[3];
+            pos = 4;
+        }
+        else if (length == 127)
+        {
+            return false;
+        }
+
+        if (data.size() != pos + length)
+        {
+            return false;
+        }
+
+        std::vector<uint8_t> in(data.begin() + long(pos), data.end());
+
+        if (!(data[0] & 0x40))
+        {
+            message->assign(in.begin(), in.end());
+            return true;
+        }
+
+        const uint8_t tail[4] = { 0x00, 0x00, 0xFF, 0xFF };
+        in.insert(in.end(), tail, tail + 4);
+
+        char out[4096];
+        message->clear();
+        zs.next_in = in.data();
+        zs.avail_in = uInt(in.size());
+        do
+        {
+            zs.next_out = reinterpret_cast<Bytef*>(out);
+            zs.avail_out = sizeof(out);
+            const int ret = inflate(&zs, Z_SYNC_FLUSH);
+            if (ret != Z_OK && ret != Z_BUF_ERROR)
+            {
+                return false;
+            }
+            message->append(out, sizeof(out) - zs.avail_out);
+        } while (zs.avail_out == 0);
+
+        if (!contextTakeover)
+        {
+            inflateReset(&zs);
+        }
+        return true;
+    }
+
+    bool contextTakeover;
+    z_stream zs{};
+};
+
+struct StreamResult
+{
+    size_t raw = 0;        // uncompressed frames
+    size_t compressed = 0; // permessage-deflate frames
+};
+
+static StreamResult sendStream(const std::vector<std::string> &events, const char *offer)
+{
+    WS_DeflateParams params;
+    std::string rsp;
+    REQUIRE(negotiate(offer, &params, &rsp));
+
+    WS_DeflateEncoder encoder;
+    REQUIRE(encoder.init(params));
+    TestClient client(!params.serverNoContextTakeover);
+
+    StreamResult result;
+    std::vector<uint8_t> payload;
+    std::vector<uint8_t> frame;
+    std::string received;
+
+    for (const std::string &msg : events)
+    {
+        frame.clear();
+        WS_EncodeFrame(WS_OPCODE_TEXT, false, reinterpret_cast<const uint8_t*>(msg.data()), msg.size(), frame);
+        result.raw += frame.size();
+
+        REQUIRE(encoder.compress(msg.data(), msg.size(), payload));
+        frame.clear();
+        WS_EncodeFrame(WS_OPCODE_TEXT, true, payload.data(), payload.size(), frame);
+        result.compressed += frame.size();
+
+        REQUIRE(client.receive(frame, &received));
+        REQUIRE(received == msg);
+    }
+
+    return result;
+}
+
+TEST_CASE("Compressed vs uncompressed bytes of an event stream")
+{
+    const std::vector<std::string> events = recordedEventStream();
+    const StreamResult takeover = sendStream(events, "permessage-deflate; client_max_window_bits");
+    const StreamResult noTakeover = sendStream(events, "permessage-deflate; server_no_context_takeover");
+
+    INFO("events: " << events.size());
+    INFO("uncompressed: " << takeover.raw << " bytes");
+    INFO("context takeover: " << takeover.compressed << " bytes (" << (100 * takeover.compressed / takeover.raw) << " %)");
+    INFO("no context takeover: " << noTakeover.compressed << " bytes (" << (100 * noTakeover.compressed / noTakeover.raw) << " %)");
+
+    REQUIRE(takeover.raw == noTakeover.raw);
+    REQUIRE(noTakeover.compressed < noTakeover.raw);
+    // repeated keys are back references into previous messages
+    REQUIRE(takeover.compressed * 3 < takeover.raw);
+    REQUIRE(takeover.compressed < noTakeover.compressed);
+
+    BENCHMARK("compress event stream")
+    {
+        WS_DeflateParams params;
+        WS_DeflateEncoder encoder;
+        encoder.init(params);
+        std::vector<uint8_t> payload;
+        size_t n = 0;
+        for (const std::string &msg : events)
+        {
+            encoder.compress(msg.data(), msg.size(), payload);
+            n += payload.size();
+        }
+        return n;
+    };
+}
@@ -0,0 +1,504 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "aps_sim.h"
+#include "task_scheduler.h"
+#include "zcl/attribute_view.h"
+
+/*
+ * Large network scenarios on top of APS_SimController. The plugin side is a test-local
+ * PluginModel built from the TaskScheduler APS queue, ZCL attribute decoding and an event
+ * queue which is drained after each indication like Event processing in the main loop.
+ * The real apsdeDataIndication() needs the deCONZ runtime and isn't run, the model ns per
+ * event therefore measures the model, not the plugin's cost per event.
+ */
+namespace {
+
+struct SimTask
+{
+    APS_SimRequest req;
+    int64_t queueTime = 0;
+    int retries = 0;
+    bool awaitResponse = true;
+};
+
+struct SimDevice
+{
+    int interviewStep = 0;
+    bool configured = false;
+};
+
+struct SimEvent
+{
+    uint64_t ext;
+    uint16_t clusterId;
+    uint16_t attrId;
+    int64_t value;
+};
+
+struct ScenarioStats
+{
+    std::vector<int64_t> requestLatencyMs; // enqueue to response
+    int64_t modelNs = 0; // time spent in PluginModel::apsdeDataIndication()
+    uint64_t events = 0;
+    size_t maxPending = 0;
+    size_t maxEventQueue = 0;
+    int64_t lastResponseMs = 0;
+
+    int64_t percentile(double p)
+    {
+        if (requestLatencyMs.empty()) { return 0; }
+        std::sort(requestLatencyMs.begin(), requestLatencyMs.end());
+        return requestLatencyMs[std::min(requestLatencyMs.size() - 1, size_t(p / 100 * requestLatencyMs.size()))];
+    }
+
+    int64_t modelNsPerEvent() const { return events ? modelNs / int64_t(events) : 0; }
+};
+
+class PluginModel : public APS_SimHandler
+{
+public:
+    explicit PluginModel(APS_SimController &sim) : m_sim(sim)
+    {
+        m_sim.setHandler(this);
+    }
+
+    void addKnownDevice(uint64_t ext)
+    {
+        m_devices[ext].configured = true;
+    }
+
+    // startup poll, reads all reported attributes; DeviceTick only adds a few devices at a time
+    void readAttributes(uint64_t ext)
+    {
+        m_pollBacklog.push_back(ext);
+    }
+
+    void apsdeDataIndication(const APS_CaptureRecord &ind) override
+    {
+        const auto start = std::chrono::steady_clock::now();
+
+        if (ind.profileId == 0x0000)
+        {
+            handleZdp(ind);
+        }
+        else if (ind.asdu.size() >= 3)
+        {
+            handleZcl(ind);
+        }
+
+        // Event queue runs after the indication
+        stats.maxEventQueue = std::max(stats.maxEventQueue, m_eventQueue.size());
+        while (!m_eventQueue.empty())
+        {
+            const SimEvent &e = m_eventQueue.front();
+            m_items[e.ext ^ (uint64_t(e.clusterId) << 48) ^ e.attrId] = e.value;
+            stats.events++;
+            m_eventQueue.pop_front();
+        }
+
+        stats.modelNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        processTasks();
+    }
+
+    void apsdeDataConfirm(const APS_SimConfirm &conf) override
+    {
+        const auto i = m_onAir.find(conf.id);
+        if (i == m_onAir.end())
+        {
+            return;
+        }
+
+        const int taskId = i->second;
+        m_onAir.erase(i);
+        SimTask &task = m_tasks[taskId];
+
+        if (conf.status == APS_SIM_SUCCESS)
+        {
+            m_sched.markConfirmed(taskId, conf.timeMs);
+            if (!task.awaitResponse)
+            {
+                m_tasks.erase(taskId);
+            }
+        }
+        else
+        {
+            m_sched.markDropped(taskId);
+            if (task.retries++ < 2)
+            {
+                int superseded = -1;
+                m_sched.enqueue(taskId, task.req.dstExt, false, TaskPriorityPoll, 0, &superseded);
+            }
+            else
+            {
+                m_tasks.erase(taskId);
+            }
+        }
+
+        processTasks();
+    }
+
+    void processTasks()
+    {
+        while (!m_pollBacklog.empty() && m_sched.pendingCount() < 32)
+        {
+            const uint64_t ext = m_pollBacklog.front();
+            m_pollBacklog.pop_front();
+            for (const APS_SimReport &rep : m_sim.profile(ext)->reports)
+            {
+                enqueue(zclRead(ext, rep.endpoint, rep.clusterId, { rep.attrId }), TaskPriorityPoll);
+            }
+        }
+
+        for (;;)
+        {
+            const int taskId = m_sched.selectNext([this](int id) { return m_onAir.count(uint8_t(id)) == 0; });
+            if (taskId < 0)
+            {
+                break;
+            }
+
+            SimTask &task = m_tasks[taskId];
+            task.req.id = uint8_t(taskId);
+            if (m_sim.apsdeDataRequest(task.req) != APS_SIM_SUCCESS)
+            {
+                break; // retried on next confirm
+            }
+
+            m_sched.markSent(taskId, m_sim.now(), true);
+            m_onAir[task.req.id] = taskId;
+        }
+
+        stats.maxPending = std::max(stats.maxPending, m_sched.pendingCount());
+    }
+
+    size_t pendingTasks() const { return m_tasks.size(); }
+    size_t configuredDevices() const
+    {
+        return size_t(std::count_if(m_devices.begin(), m_devices.end(), [](const auto &d) { return d.second.configured; }));
+    }
+
+    ScenarioStats stats;
+
+private:
+    int enqueue(APS_SimRequest req, TaskPriority prio, bool awaitResponse = true)
+    {
+        const int taskId = m_nextTaskId++;
+        // ZCL and ZDP sequence number, used to match the response
+        req.asdu[req.profileId == 0x0000 ? 0 : 1] = uint8_t(taskId);
+
+        int superseded = -1;
+        if (!m_sched.enqueue(taskId, req.dstExt, false, prio, 0, &superseded))
+        {
+            return -1;
+        }
+
+        SimTask &task = m_tasks[taskId];
+        task.req = std::move(req);
+        task.queueTime = m_sim.now();
+        task.awaitResponse = awaitResponse;
+        m_responseKey[task.req.dstExt << 8 | uint8_t(taskId)] = taskId;
+        return taskId;
+    }
+
+    static APS_SimRequest zclRead(uint64_t ext, uint8_t endpoint, uint16_t clusterId, std::vector<uint16_t> attrs)
+    {
+        APS_SimRequest req;
+        req.dstExt = ext;
+        req.dstEndpoint = endpoint;
+        req.clusterId = clusterId;
+        req.asdu = { 0x00, 0x00, 0x00 }; // profile wide, read attributes
+        for (uint16_t attrId : attrs)
+        {
+            req.asdu.push_back(uint8_t(attrId));
+            req.asdu.push_back(uint8_t(attrId >> 8));
+        }
+        return req;
+    }
+
+    static APS_SimRequest zdpRequest(uint64_t ext, uint16_t clusterId)
+    {
+        APS_SimRequest req;
+        req.dstExt = ext;
+        req.profileId = 0x0000;
+        req.dstEndpoint = 0x00;
+        req.clusterId = clusterId;
+        req.asdu = { 0x00, 0x00, 0x00 };
+        return req;
+    }
+
+    void completeRequest(uint64_t ext, uint8_t seq)
+    {
+        const auto i = m_responseKey.find(ext << 8 | seq);
+        if (i == m_responseKey.end())
+        {
+            return;
+        }
+
+        const auto t = m_tasks.find(i->second);
+        if (t != m_tasks.end())
+        {
+            stats.requestLatencyMs.push_back(m_sim.now() - t->second.queueTime);
+            stats.lastResponseMs = m_sim.now();
+            if (m_onAir.count(uint8_t(i->second)) == 0)
+            {
+                m_tasks.erase(t); // confirm arrived before
+            }
+            else
+            {
+                t->second.awaitResponse = false;
+            }
+        }
+        m_responseKey.erase(i);
+    }
+
+    // device interview: node and simple descriptors, basic cluster, then bindings and reporting
+    void advanceInterview(uint64_t ext)
+    {
+        SimDevice &dev = m_devices[ext];
+        const APS_SimProfile *profile = m_sim.profile(ext);
+
+        switch (dev.interviewStep++)
+        {
+        case 0: enqueue(zdpRequest(ext, 0x0002), TaskPriorityPoll); break;
+        case 1: enqueue(zdpRequest(ext, 0x0005), TaskPriorityPoll); break;
+        case 2: enqueue(zdpRequest(ext, 0x0004), TaskPriorityPoll); break;
+        case 3: enqueue(zclRead(ext, 0x01, 0x0000, { 0x0004, 0x0005, 0x0007 }), TaskPriorityPoll); break;
+        case 4:
+            for (const APS_SimReport &rep : profile->reports)
+            {
+                APS_SimRequest bind = zdpRequest(ext, 0x0021);
+                enqueue(std::move(bind), TaskPriorityPoll);
+
+                APS_SimRequest cfg = zclRead(ext, rep.endpoint, rep.clusterId, { });
+                cfg.asdu[2] = 0x06; // configure reporting
+                cfg.asdu.insert(cfg.asdu.end(), { 0x00, uint8_t(rep.attrId), uint8_t(rep.attrId >> 8), rep.dataType,
+                                                  uint8_t(rep.minInterval), uint8_t(rep.minInterval >> 8),
+                                                  uint8_t(rep.maxInterval), uint8_t(rep.maxInterval >> 8) });
+                m_configureTasks[ext]++;
+                enqueue(std::move(cfg), TaskPriorityPoll);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    void handleZdp(const APS_CaptureRecord &ind)
+    {
+        if (ind.clusterId == APS_SIM_ZDP_DEVICE_ANNCE)
+        {
+            if (m_devices.count(ind.srcExt) == 0)
+            {
+                m_devices[ind.srcExt];
+                advanceInterview(ind.srcExt);
+            }
+            return;
+        }
+
+        if (ind.asdu.size() >= 2)
+        {
+            completeRequest(ind.srcExt, ind.asdu[0]);
+            if (ind.clusterId != 0x8021)
+            {
+                advanceInterview(ind.srcExt);
+            }
+        }
+    }
+
+    void handleZcl(const APS_CaptureRecord &ind)
+    {
+        const uint8_t fc = ind.asdu[0];
+        const size_t hdrSize = (fc & 0x04) ? 5 : 3;
+        if (ind.asdu.size() < hdrSize)
+        {
+            return;
+        }
+
+        const uint8_t seq = ind.asdu[hdrSize - 2];
+        const uint8_t commandId = ind.asdu[hdrSize - 1];
+
+        if ((commandId == 0x01 || commandId == 0x0A) &&
+            ZCL_DecodeAttributeRecords(ind.asdu.data() + hdrSize, ind.asdu.size() - hdrSize, commandId == 0x01, &m_view))
+        {
+            for (int i = 0; i < m_view.count; i++)
+            {
+                const ZCL_AttributeRecord &rec = m_view.records[size_t(i)];
+                m_eventQueue.push_back({ind.srcExt, ind.clusterId, rec.id, int64_t(rec.dataType)});
+            }
+        }
+
+        if (commandId == 0x01)
+        {
+            completeRequest(ind.srcExt, seq);
+            if (ind.clusterId == 0x0000)
+            {
+                advanceInterview(ind.srcExt); // basic cluster done
+            }
+        }
+        else if (commandId == 0x07)
+        {
+            completeRequest(ind.srcExt, seq);
+            if (--m_configureTasks[ind.srcExt] == 0)
+            {
+                m_devices[ind.srcExt].configured = true;
+            }
+        }
+    }
+
+    APS_SimController &m_sim;
+    TaskScheduler m_sched;
+    std::unordered_map<int, SimTask> m_tasks;
+    std::unordered_map<uint8_t, int> m_onAir; // APS request id -> task id
+    std::unordered_map<uint64_t, int> m_responseKey; // (ext, seq) -> task id
+    std::unordered_map<uint64_t, SimDevice> m_devices;
+    std::unordered_map<uint64_t, int> m_configureTasks;
+    std::unordered_map<uint64_t, int64_t> m_items;
+    std::deque<SimEvent> m_eventQueue;
+    std::deque<uint64_t> m_pollBacklog;
+    ZCL_AttributeView m_view;
+    int m_nextTaskId = 1;
+};
+
+// main loop: the plugin's task timer fires every 100 ms
+void run(APS_SimController &sim, PluginModel &model, int64_t untilMs)
+{
+    for (int64_t t = sim.now(); t < untilMs; t += 100)
+    {
+        sim.runUntil(t + 100);
+        model.processTasks();
+    }
+}
+
+const APS_SimProfile &pickProfile(size_t i)
+{
+    const std::vector<APS_SimProfile> &profiles = APS_SimDdfProfiles();
+    return profiles[(i * 37) % profiles.size()];
+}
+
+} // namespace
+
+TEST_CASE("Network simulator answers like devices of the DDFs")
+{
+    const std::vector<APS_SimProfile> &profiles = APS_SimDdfProfiles();
+    REQUIRE(profiles.size() > 100);
+    REQUIRE(std::any_of(profiles.begin(), profiles.end(), [](const APS_SimProfile &p) { return p.sleepy; }));
+    REQUIRE(std::any_of(profiles.begin(), profiles.end(), [](const APS_SimProfile &p) { return !p.sleepy; }));
+
+    APS_SimConfig config;
+    config.lossRate = 0;
+    APS_SimController sim(config);
+    PluginModel model(sim);
+
+    const APS_SimProfile *sleepy = &*std::find_if(profiles.begin(), profiles.end(), [](const APS_SimProfile &p) { return p.sleepy; });
+    const APS_SimProfile *mains = &*std::find_if(profiles.begin(), profiles.end(), [](const APS_SimProfile &p) { return !p.sleepy; });
+
+    sim.addNode(*mains, 0, true);
+    sim.addNode(*sleepy, 0, true);
+    run(sim, model, 120 * 1000);
+
+    REQUIRE(model.configuredDevices() == 2);
+    REQUIRE(model.pendingTasks() == 0);
+    REQUIRE(sim.stats().confirmsFailed == 0);
+    REQUIRE(sim.stats().reports > 0);
+    // requests to the sleepy device wait for its poll
+    REQUIRE(model.stats.percentile(100) > config.pollIntervalMs / 2);
+    REQUIRE(model.stats.percentile(0) < 200);
+}
+
+TEST_CASE("Cold start with 300 devices")
+{
+    APS_SimConfig config;
+    APS_SimController sim(config);
+    PluginModel model(sim);
+
+    for (size_t i = 0; i < 300; i++)
+    {
+        const uint64_t ext = sim.addNode(pickProfile(i), 0, false);
+        model.addKnownDevice(ext);
+    }
+
+    sim.runUntil(0);
+    for (size_t i = 0; i < 300; i++)
+    {
+        model.readAttributes(0x00212E0000000000ULL | uint64_t(i + 1));
+    }
+
+    run(sim, model, 10 * 60 * 1000);
+
+    ScenarioStats &stats = model.stats;
+    INFO("startup reads answered after " << stats.lastResponseMs / 1000 << " s");
+    INFO("request latency p50: " << stats.percentile(50) << " ms, p99: " << stats.percentile(99) << " ms");
+    INFO("max APS queue: " << stats.maxPending << " tasks, controller " << sim.stats().maxQueued << ", busy " << sim.stats().busy);
+    INFO("events: " << stats.events << ", model ns per event " << stats.modelNsPerEvent() << ", max event queue " << stats.maxEventQueue);
+
+    REQUIRE(stats.requestLatencyMs.size() > 300);
+    REQUIRE(sim.stats().maxQueued <= size_t(config.maxQueued));
+    CHECK(stats.percentile(50) < 60 * 1000);
+    CHECK(stats.modelNsPerEvent() < 100000);
+}
+
+TEST_CASE("Join storm of 50 devices in a 300 device network")
+{
+    APS_SimConfig config;
+    APS_SimController sim(config);
+    PluginModel model(sim);
+
+    for (size_t i = 0; i < 300; i++)
+    {
+        model.addKnownDevice(sim.addNode(pickProfile(i), 0, false));
+    }
+
+    // all devices are put in pairing mode at once
+    for (size_t i = 0; i < 50; i++)
+    {
+        sim.addNode(pickProfile(300 + i), 60 * 1000 + int64_t(i) * 600, true);
+    }
+
+    run(sim, model, 20 * 60 * 1000);
+
+    ScenarioStats &stats = model.stats;
+    INFO("configured " << model.configuredDevices() - 300 << " of 50 new devices, last response after " << stats.lastResponseMs / 1000 << " s");
+    INFO("request latency p50: " << stats.percentile(50) << " ms, p99: " << stats.percentile(99) << " ms");
+    INFO("max APS queue: " << stats.maxPending << " tasks, controller " << sim.stats().maxQueued << ", busy " << sim.stats().busy);
+    INFO("events: " << stats.events << ", model ns per event " << stats.modelNsPerEvent() << ", max event queue " << stats.maxEventQueue);
+
+    CHECK(model.configuredDevices() >= 300 + 45); // 1% loss may exhaust retries
+    REQUIRE(sim.stats().maxQueued <= size_t(config.maxQueued));
+}
+
+TEST_CASE("Steady state reporting of 300 devices")
+{
+    APS_SimConfig config;
+    APS_SimController sim(config);
+    PluginModel model(sim);
+
+    for (size_t i = 0; i < 300; i++)
+    {
+        model.addKnownDevice(sim.addNode(pickProfile(i), 0, false));
+    }
+
+    const int64_t hour = 3600 * 1000;
+    run(sim, model, hour);
+
+    ScenarioStats &stats = model.stats;
+    const double reportsPerSecond = double(sim.stats().reports) / (hour / 1000);
+    INFO("reports: " << sim.stats().reports << " (" << reportsPerSecond << "/s), lost " << sim.stats().lost);
+    INFO("events: " << stats.events << ", model ns per event " << stats.modelNsPerEvent() << ", max event queue " << stats.maxEventQueue);
+
+    REQUIRE(sim.stats().reports > 300 * 6); // max intervals are 5-60 min
+    REQUIRE(stats.events == sim.stats().reports);
+    CHECK(stats.modelNsPerEvent() < 100000);
+
+    BENCHMARK("one minute of reporting")
+    {
+        run(sim, model, sim.now() + 60 * 1000);
+        return stats.events;
+    };
+}
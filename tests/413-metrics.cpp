@@ -0,0 +1,182 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "metrics.h"
+
+// series name including labels -> value, doesn't use Catch macros as it runs in the scraper thread
+static std::map<std::string, double> parseMetrics(const std::string &text, size_t *helpLines, size_t *malformed)
+{
+    std::map<std::string, double> result;
+    std::istringstream in(text);
+    std::string line;
+    *helpLines = 0;
+    *malformed = 0;
+
+    while (std::getline(in, line))
+    {
+        if (line.compare(0, 7, "# HELP ") == 0)
+        {
+            (*helpLines)++;
+            continue;
+        }
+
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        const size_t sep = line.rfind(' ');
+        if (sep == std::string::npos || result.count(line.substr(0, sep)) != 0) // no duplicate series
+        {
+            (*malformed)++;
+            continue;
+        }
+        result[line.substr(0, sep)] = std::strtod(line.c_str() + sep + 1, nullptr);
+    }
+
+    return result;
+}
+
+TEST_CASE("Metrics text format")
+{
+    MET_Reset();
+
+    MET_Add(MET_EventsProcessed, 5);
+    MET_Set(MET_EventQueueDepth, 12);
+    MET_ObserveUs(MET_EventProcessing, 50);      // <= 0.0001
+    MET_ObserveUs(MET_EventProcessing, 700);     // <= 0.001
+    MET_ObserveUs(MET_EventProcessing, 3000000); // +Inf
+    MET_ObserveUs(MET_RestModuleHistogram("lights", 6), 2000);
+    MET_ObserveUs(MET_RestModuleHistogram("unknown", 7), 2000);
+    MET_ObserveUs(MET_DeviceTickCycle, 90 * 1000000LL);
+
+    std::string text;
+    MET_WritePrometheus(text);
+    size_t helpLines = 0;
+    size_t malformed = 0;
+    const std::map<std::string, double> m = parseMetrics(text, &helpLines, &malformed);
+
+    REQUIRE(malformed == 0);
+    REQUIRE(m.at("deconz_events_processed_total") == 5);
+    REQUIRE(m.at("deconz_event_queue_depth") == 12);
+    REQUIRE(m.at("deconz_event_processing_seconds_bucket{le=\"0.0001\"}") == 1);
+    REQUIRE(m.at("deconz_event_processing_seconds_bucket{le=\"0.001\"}") == 2);
+    REQUIRE(m.at("deconz_event_processing_seconds_bucket{le=\"1\"}") == 2);
+    REQUIRE(m.at("deconz_event_processing_seconds_bucket{le=\"+Inf\"}") == 3);
+    REQUIRE(m.at("deconz_event_processing_seconds_count") == 3);
+    REQUIRE(m.at("deconz_event_processing_seconds_sum") == Approx(3.00075));
+    REQUIRE(m.at("deconz_rest_request_seconds_count{module=\"lights\"}") == 1);
+    REQUIRE(m.at("deconz_rest_request_seconds_count{module=\"other\"}") == 1);
+    REQUIRE(m.at("deconz_rest_request_seconds_bucket{module=\"lights\",le=\"0.005\"}") == 1);
+    REQUIRE(m.at("deconz_device_tick_cycle_seconds_bucket{le=\"60\"}") == 0);
+    REQUIRE(m.at("deconz_device_tick_cycle_seconds_bucket{le=\"120\"}") == 1);
+
+    // one HELP per metric family, label values don't create families
+    REQUIRE(helpLines == MET_CounterMax + MET_GaugeMax + 7);
+    REQUIRE(text.find("# TYPE deconz_rest_request_seconds histogram") != std::string::npos);
+
+    // fixed, low cardinality
+    INFO("series: " << m.size());
+    REQUIRE(m.size() < 250);
+}
+
+/*
+ * Synthetic load: worker threads update the metrics like the main loop and the
+ * crypto worker do, while /metrics is scraped continuously.
+ */
+TEST_CASE("Scrape metrics under load")
+{
+    MET_Reset();
+
+    const int threads = 4;
+    const int iterations = 200000;
+    std::atomic<bool> done{false};
+    std::atomic<int> scrapes{0};
+    bool monotonic = true;
+    bool consistent = true;
+
+    std::thread scraper([&]()
+    {
+        double prevEvents = 0;
+        double prevCount = 0;
+        std::string text;
+
+        while (!done)
+        {
+            text.clear();
+            MET_WritePrometheus(text);
+            size_t helpLines = 0;
+            size_t malformed = 0;
+            const std::map<std::string, double> m = parseMetrics(text, &helpLines, &malformed);
+
+            const double events = m.at("deconz_events_processed_total");
+            const double count = m.at("deconz_rest_request_seconds_count{module=\"sensors\"}");
+            monotonic = monotonic && events >= prevEvents && count >= prevCount;
+            consistent = consistent && malformed == 0 && m.at("deconz_rest_request_seconds_bucket{module=\"sensors\",le=\"+Inf\"}") == count &&
+                         m.at("deconz_rest_request_seconds_bucket{module=\"sensors\",le=\"0.0001\"}") <= m.at("deconz_rest_request_seconds_bucket{module=\"sensors\",le=\"0.001\"}");
+            prevEvents = events;
+            prevCount = count;
+            scrapes++;
+        }
+    });
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++)
+    {
+        workers.emplace_back([t]()
+        {
+            for (int i = 0; i < iterations; i++)
+            {
+                MET_Add(MET_EventsProcessed);
+                MET_Add(MET_WebsocketBytesSent, 120);
+                MET_Set(MET_EventQueueDepth, i & 63);
+                MET_ObserveUs(MET_RestSensors, (i * 37 + t) % 2000);
+            }
+        });
+    }
+
+    for (std::thread &w : workers)
+    {
+        w.join();
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    done = true;
+    scraper.join();
+
+    const double nsPerUpdate = double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()) / (threads * iterations * 4.0);
+    INFO("scrapes during load: " << scrapes);
+    INFO("ns per metric update with " << threads << " threads: " << nsPerUpdate);
+
+    REQUIRE(scrapes > 0);
+    REQUIRE(monotonic);
+    REQUIRE(consistent);
+    REQUIRE(MET_CounterValue(MET_EventsProcessed) == uint64_t(threads) * iterations);
+    REQUIRE(MET_CounterValue(MET_WebsocketBytesSent) == uint64_t(threads) * iterations * 120);
+    REQUIRE(MET_HistogramCount(MET_RestSensors) == uint64_t(threads) * iterations);
+    CHECK(nsPerUpdate < 1000);
+
+    BENCHMARK("observe histogram")
+    {
+        MET_ObserveUs(MET_EventProcessing, 420);
+        return MET_HistogramCount(MET_EventProcessing);
+    };
+
+    BENCHMARK("scrape")
+    {
+        std::string text;
+        MET_WritePrometheus(text);
+        return text.size();
+    };
+}
@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "stall_detector.h"
+
+static void blockMs(int ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+TEST_CASE("Stall attributed to innermost handler")
+{
+    SD_Init(20);
+
+    {
+        SD_Scope http(SD_HttpRequest);
+        {
+            SD_Scope fast(SD_JsEvaluate); // below threshold
+        }
+        {
+            SD_Scope db(SD_SaveDb);
+            blockMs(30);
+        }
+    }
+
+    std::vector<SD_Stall> stalls;
+    SD_GetStalls(stalls);
+
+    REQUIRE(stalls.size() == 1); // the outer handler isn't reported again
+    REQUIRE(SD_GetStats().stalls == 1);
+    REQUIRE(stalls[0].durationUs >= 25000); // coarse clock
+    REQUIRE(stalls[0].path[0] == SD_HttpRequest);
+    REQUIRE(stalls[0].path[1] == SD_SaveDb);
+    REQUIRE(stalls[0].path[2] == SD_HandlerNone);
+
+    SECTION("Outer handler stalls by itself")
+    {
+        {
+            SD_Scope timer(SD_Timer);
+            {
+                SD_Scope rules(SD_Rules);
+            }
+            blockMs(25);
+        }
+
+        SD_GetStalls(stalls);
+        REQUIRE(stalls.size() == 2);
+        REQUIRE(stalls[1].path[0] == SD_Timer);
+        REQUIRE(stalls[1].path[1] == SD_HandlerNone);
+    }
+}
+
+TEST_CASE("Heartbeat catches stalls without marker")
+{
+    SD_Init(20);
+    std::vector<SD_Stall> stalls;
+
+    REQUIRE(SD_Heartbeat() == 0); // first call only starts measuring
+    blockMs(SD_HEARTBEAT_INTERVAL_MS + 40);
+    REQUIRE(SD_Heartbeat() >= 30000);
+
+    SD_GetStalls(stalls);
+    REQUIRE(stalls.size() == 1);
+    REQUIRE(stalls[0].path[0] == SD_HandlerNone); // unattributed
+    REQUIRE(SD_GetStats().maxLatencyUs >= 30000);
+
+    // a stall which was attributed by a marker isn't counted twice
+    {
+        SD_Scope ind(SD_ApsIndication);
+        blockMs(SD_HEARTBEAT_INTERVAL_MS + 40);
+    }
+    REQUIRE(SD_Heartbeat() >= 30000);
+
+    SD_GetStalls(stalls);
+    REQUIRE(stalls.size() == 2);
+    REQUIRE(SD_GetStats().stalls == 2);
+}
+
+TEST_CASE("Keep the worst stalls")
+{
+    SD_Init(10);
+
+    const int total = SD_MAX_STALLS + 6;
+    for (int i = 0; i < total; i++)
+    {
+        SD_Scope timer(SD_Timer);
+        blockMs(20 + (i % 4) * 2);
+    }
+
+    std::vector<SD_Stall> stalls;
+    SD_GetStalls(stalls);
+
+    REQUIRE(SD_GetStats().stalls == total);
+    REQUIRE(stalls.size() == SD_MAX_STALLS);
+    REQUIRE(std::is_sorted(stalls.begin(), stalls.end(), [](const SD_Stall &a, const SD_Stall &b) { return a.durationUs > b.durationUs; }));
+}
+
+TEST_CASE("Markers from other threads are ignored")
+{
+    SD_Init(1);
+
+    std::thread worker([]()
+    {
+        SD_Scope js(SD_JsEvaluate);
+        blockMs(5);
+    });
+    worker.join();
+
+    REQUIRE(SD_GetStats().stalls == 0);
+}
+
+/*
+ * Synthetic handler comparable to a small apsdeDataIndication() which evaluates
+ * a DDF expression, so two nested markers per call.
+ */
+static uint32_t syntheticHandler(const std::vector<uint8_t> &frame)
+{
+    uint32_t hash = 2166136261u;
+    for (int round = 0; round < 4; round++)
+    {
+        for (const uint8_t byte : frame)
+        {
+            hash = (hash ^ byte) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+TEST_CASE("Marker overhead below 1%")
+{
+    SD_Init(SD_DEFAULT_THRESHOLD_MS);
+
+    std::vector<uint8_t> frame(1024);
+    for (size_t i = 0; i < frame.size(); i++)
+    {
+        frame[i] = uint8_t(i * 7);
+    }
+
+    const int calls = 20000;
+    volatile uint32_t sink = 0;
+    int64_t bestPlain = INT64_MAX;
+    int64_t bestMarked = INT64_MAX;
+
+    for (int round = 0; round < 7; round++)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < calls; i++)
+        {
+            sink = sink + syntheticHandler(frame);
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        for (int i = 0; i < calls; i++)
+        {
+            SD_Scope ind(SD_ApsIndication);
+            SD_Scope js(SD_JsEvaluate);
+            sink = sink + syntheticHandler(frame);
+        }
+        auto t2 = std::chrono::steady_clock::now();
+
+        bestPlain = std::min<int64_t>(bestPlain, std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+        bestMarked = std::min<int64_t>(bestMarked, std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count());
+    }
+
+    // cost of a marker alone, the A/B difference above is within timing noise
+    int64_t bestScopes = INT64_MAX;
+    for (int round = 0; round < 7; round++)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < calls; i++)
+        {
+            SD_Scope ind(SD_ApsIndication);
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        bestScopes = std::min<int64_t>(bestScopes, std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+    }
+
+    const double handlerNs = double(bestPlain) / calls;
+    const double scopeNs = double(bestScopes) / calls;
+    const double overhead = 2 * scopeNs / handlerNs;
+
+    INFO("handler: " << handlerNs << " ns, marker: " << scopeNs << " ns");
+    INFO("A/B overhead: " << (double(bestMarked - bestPlain) / bestPlain * 100) << " %, marker cost: " << (overhead * 100) << " %");
+    REQUIRE(SD_GetStats().stalls == 0);
+    REQUIRE(overhead < 0.01);
+}
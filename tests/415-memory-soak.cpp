@@ -0,0 +1,444 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <QString>
+
+#include "catch2/catch.hpp"
+
+#include "aps_sim.h"
+#include "event.h"
+#include "memory_stats.h"
+#include "resource.h"
+#include "task_scheduler.h"
+#include "utils/stringcache.h"
+#include "zcl/attribute_view.h"
+
+/*
+ * Soak test: a synthetic network runs for days of simulated time while the plugin
+ * model feeds the reports through the types which grow with traffic in the plugin,
+ * Resource and ResourceItem with the atom table behind string items, Event in a queue
+ * drained like EventEmitter, websocket messages and the QString database query queue.
+ * Memory is accounted like DeRestPluginPrivate::collectMemoryUsage() and sampled every
+ * simulated hour with MEM_History.
+ */
+namespace {
+
+const qint64 SoakEpochMs = 1700000000000LL; // wall clock of simulated time 0
+
+struct SoakAttribute
+{
+    uint16_t clusterId;
+    uint16_t attrId;
+    const char *suffix;
+};
+
+// most frequent reports of the DDFs, the others only update attr/lastseen
+const SoakAttribute soakAttributes[] = {
+    { 0x0001, 0x0021, RConfigBattery },
+    { 0x0006, 0x0000, RStateOn },
+    { 0x0008, 0x0000, RStateBri },
+    { 0x0102, 0x0008, RStateLift },
+    { 0x0201, 0x0000, RStateTemperature },
+    { 0x0300, 0x0003, RStateX },
+    { 0x0300, 0x0004, RStateY },
+    { 0x0300, 0x0007, RStateCt },
+    { 0x0400, 0x0000, RStateLightLevel },
+    { 0x0402, 0x0000, RStateTemperature },
+    { 0x0405, 0x0000, RStateHumidity },
+    { 0x0406, 0x0000, RStatePresence },
+    { 0x0702, 0x0000, RStateConsumption },
+    { 0x0B04, 0x0505, RStateVoltage },
+    { 0x0B04, 0x0508, RStateCurrent },
+    { 0x0B04, 0x050B, RStatePower }
+};
+
+const char *soakSuffix(uint16_t clusterId, uint16_t attrId)
+{
+    for (const SoakAttribute &a : soakAttributes)
+    {
+        if (a.clusterId == clusterId && a.attrId == attrId)
+        {
+            return a.suffix;
+        }
+    }
+    return nullptr;
+}
+
+class SoakPlugin : public APS_SimHandler
+{
+public:
+    explicit SoakPlugin(APS_SimController &sim) : m_sim(sim)
+    {
+        m_sim.setHandler(this);
+    }
+
+    void apsdeDataIndication(const APS_CaptureRecord &ind) override
+    {
+        if (ind.profileId == 0x0000 || ind.asdu.size() < 3)
+        {
+            return;
+        }
+
+        const size_t hdrSize = (ind.asdu[0] & 0x04) ? 5 : 3;
+        const uint8_t commandId = ind.asdu[hdrSize - 1];
+
+        if (commandId == 0x01)
+        {
+            completeRequest(ind.srcExt);
+        }
+
+        if ((commandId == 0x01 || commandId == 0x0A) && ind.asdu.size() > hdrSize &&
+            ZCL_DecodeAttributeRecords(ind.asdu.data() + hdrSize, ind.asdu.size() - hdrSize, commandId == 0x01, &m_view))
+        {
+            Resource *r = sensor(ind.srcExt);
+            r->item(RAttrLastSeen)->setValue(SoakEpochMs + m_sim.now());
+
+            for (int i = 0; i < m_view.count; i++)
+            {
+                const ZCL_AttributeRecord &rec = m_view.records[size_t(i)];
+                const char *suffix = soakSuffix(ind.clusterId, rec.id);
+                if (suffix)
+                {
+                    setItem(r, ind.srcExt, ind.clusterId, rec.id, suffix, qint64(rec.value));
+                }
+            }
+        }
+    }
+
+    void apsdeDataConfirm(const APS_SimConfirm &conf) override
+    {
+        const auto i = m_onAir.find(conf.id);
+        if (i == m_onAir.end())
+        {
+            return;
+        }
+
+        const int taskId = i->second;
+        m_onAir.erase(i);
+
+        if (conf.status == APS_SIM_SUCCESS)
+        {
+            m_sched.markConfirmed(taskId, conf.timeMs);
+        }
+        else
+        {
+            m_sched.markDropped(taskId);
+            m_tasks.erase(taskId);
+            m_taskByDevice.erase(conf.dstExt);
+        }
+    }
+
+    // 100 ms main loop tick: event queue, websocket flush, APS tasks
+    void tick()
+    {
+        for (; m_eventPos < m_eventQueue.size(); m_eventPos++)
+        {
+            const Event &e = m_eventQueue[m_eventPos];
+            m_wsPending.push_back(QString("{\"e\":\"changed\",\"id\":\"%1\",\"r\":\"%2\",\"state\":{\"%3\":%4}}")
+                                  .arg(e.id(), QLatin1String(e.resource()), QLatin1String(e.what())).arg(e.num()));
+        }
+        m_eventQueue.clear(); // keeps the capacity like EventEmitter::process()
+        m_eventPos = 0;
+
+        m_wsMessagesSent += m_wsPending.size();
+        m_wsPending.clear();
+
+        if (m_sim.now() - m_lastDbSave >= 60 * 1000)
+        {
+            m_dbQueryQueue.clear(); // saveDb()
+            m_lastDbSave = m_sim.now();
+        }
+
+        processTasks();
+    }
+
+    // DeviceTick style poll, one read per device
+    void poll(uint64_t ext)
+    {
+        if (m_taskByDevice.count(ext) != 0)
+        {
+            return; // previous poll still pending
+        }
+
+        const APS_SimProfile *profile = m_sim.profile(ext);
+        if (!profile || profile->reports.empty())
+        {
+            return;
+        }
+
+        const APS_SimReport &rep = profile->reports.front();
+        const int taskId = m_nextTaskId++;
+        int superseded = -1;
+        if (!m_sched.enqueue(taskId, ext, false, TaskPriorityPoll, 0, &superseded))
+        {
+            return;
+        }
+
+        APS_SimRequest &req = m_tasks[taskId];
+        req.dstExt = ext;
+        req.dstEndpoint = rep.endpoint;
+        req.clusterId = rep.clusterId;
+        req.asdu = { 0x00, uint8_t(taskId), 0x00, uint8_t(rep.attrId), uint8_t(rep.attrId >> 8) };
+        m_taskByDevice[ext] = taskId;
+    }
+
+    // same accounting as DeRestPluginPrivate::collectMemoryUsage() and EventEmitter::memoryUsage()
+    void memoryUsage(MEM_Report &report) const
+    {
+        for (const auto &i : m_sensors)
+        {
+            report.add(MEM_ResourceItems, i.second->memoryUsage(), size_t(i.second->itemCount()));
+        }
+
+        unsigned atoms = 0;
+        const unsigned long atomBytes = StringCacheMemoryUsage(&atoms);
+        report.add(MEM_AtomTable, atomBytes, atoms);
+
+        size_t eventBytes = MEM_VectorBytes(m_eventQueue);
+        for (size_t i = m_eventPos; i < m_eventQueue.size(); i++)
+        {
+            eventBytes += MEM_SharedArrayBytes(size_t(m_eventQueue[i].id().capacity()), sizeof(QChar));
+        }
+        report.add(MEM_EventQueue, eventBytes, m_eventQueue.size() - m_eventPos);
+
+        size_t wsBytes = MEM_VectorBytes(m_wsPending);
+        for (const QString &msg : m_wsPending)
+        {
+            wsBytes += MEM_SharedArrayBytes(size_t(msg.capacity()), sizeof(QChar));
+        }
+        report.add(MEM_WebsocketBuffers, wsBytes, m_wsPending.size());
+
+        size_t dbQueueBytes = MEM_VectorBytes(m_dbQueryQueue);
+        for (const QString &sql : m_dbQueryQueue)
+        {
+            dbQueueBytes += MEM_SharedArrayBytes(size_t(sql.capacity()), sizeof(QChar));
+        }
+        report.add(MEM_DbQueryQueue, dbQueueBytes, m_dbQueryQueue.size());
+    }
+
+    size_t pendingTasks() const { return m_tasks.size(); }
+    uint64_t messagesSent() const { return m_wsMessagesSent; }
+
+private:
+    /*! Sensor of the node, created on the first report like a device joining. */
+    Resource *sensor(uint64_t ext)
+    {
+        std::unique_ptr<Resource> &r = m_sensors[ext];
+        if (r)
+        {
+            return r.get();
+        }
+
+        r.reset(new Resource(RSensors));
+        r->addItem(DataTypeString, RAttrId)->setValue(QString::number(m_sensors.size()));
+        r->addItem(DataTypeString, RAttrUniqueId)->setValue(QString("%1-01").arg(quint64(ext), 16, 16, QLatin1Char('0')));
+        r->addItem(DataTypeString, RAttrModelId)->setValue(QString::fromStdString(m_sim.profile(ext)->modelId));
+        r->addItem(DataTypeTime, RAttrLastSeen);
+        return r.get();
+    }
+
+    void setItem(Resource *r, uint64_t ext, uint16_t clusterId, uint16_t attrId, const char *suffix, qint64 value)
+    {
+        ResourceItem *item = r->item(suffix);
+        if (!item)
+        {
+            ResourceItemDescriptor rid;
+            if (!getResourceItemDescriptor(QLatin1String(suffix), rid))
+            {
+                return;
+            }
+            item = r->addItem(rid.type, rid.suffix);
+        }
+
+        if (!item->setValue(value))
+        {
+            return; // out of range
+        }
+
+        m_eventQueue.push_back(Event(r->prefix(), item->descriptor().suffix, r->item(RAttrId)->toString(), item, ext));
+
+        m_dbQueryQueue.push_back(QString("INSERT INTO zcl_values (device_id,endpoint,cluster,attribute,data,timestamp) "
+                                         "SELECT id, 1, %1, %2, %3, %4 FROM devices WHERE mac = '%5'")
+                                 .arg(clusterId).arg(attrId).arg(value).arg((SoakEpochMs + m_sim.now()) / 1000)
+                                 .arg(quint64(ext), 16, 16, QLatin1Char('0')));
+    }
+
+    void completeRequest(uint64_t ext)
+    {
+        const auto i = m_taskByDevice.find(ext);
+        if (i != m_taskByDevice.end())
+        {
+            if (m_onAir.count(uint8_t(i->second)) == 0)
+            {
+                m_tasks.erase(i->second);
+            }
+            m_taskByDevice.erase(i);
+        }
+    }
+
+    void processTasks()
+    {
+        for (;;)
+        {
+            const int taskId = m_sched.selectNext([this](int id) { return m_onAir.count(uint8_t(id)) == 0; });
+            if (taskId < 0)
+            {
+                break;
+            }
+
+            APS_SimRequest &req = m_tasks[taskId];
+            req.id = uint8_t(taskId);
+            if (m_sim.apsdeDataRequest(req) != APS_SIM_SUCCESS)
+            {
+                break;
+            }
+
+            m_sched.markSent(taskId, m_sim.now(), true);
+            m_onAir[req.id] = taskId;
+        }
+
+        // tasks whose response arrived are done once the confirm is in
+        for (auto i = m_tasks.begin(); i != m_tasks.end(); )
+        {
+            const bool waiting = m_onAir.count(uint8_t(i->first)) != 0 || m_taskByDevice.count(i->second.dstExt) != 0;
+            i = waiting ? std::next(i) : m_tasks.erase(i);
+        }
+    }
+
+    APS_SimController &m_sim;
+    TaskScheduler m_sched;
+    std::unordered_map<int, APS_SimRequest> m_tasks;
+    std::unordered_map<uint8_t, int> m_onAir;
+    std::unordered_map<uint64_t, int> m_taskByDevice;
+    std::unordered_map<uint64_t, std::unique_ptr<Resource>> m_sensors;
+    std::vector<Event> m_eventQueue;
+    size_t m_eventPos = 0;
+    std::vector<QString> m_wsPending;
+    std::vector<QString> m_dbQueryQueue;
+    ZCL_AttributeView m_view;
+    int64_t m_lastDbSave = 0;
+    uint64_t m_wsMessagesSent = 0;
+    int m_nextTaskId = 1;
+};
+
+} // namespace
+
+TEST_CASE("Memory history growth")
+{
+    MEM_History history;
+    MEM_Report report;
+
+    REQUIRE(history.growthPerDay(MEM_EventQueue) == 0);
+
+    for (int hour = 0; hour < MEM_HISTORY_SIZE + 10; hour++)
+    {
+        report.usage[MEM_EventQueue].bytes = 1000;
+        report.usage[MEM_DbQueryQueue].bytes = size_t(1000 + hour * 100); // leaks 2400 bytes/day
+        history.add(int64_t(hour) * MEM_SAMPLE_INTERVAL_MS, report);
+    }
+
+    REQUIRE(history.size() == MEM_HISTORY_SIZE);
+    REQUIRE(history.at(0).timeMs == 10 * int64_t(MEM_SAMPLE_INTERVAL_MS)); // oldest samples dropped
+    REQUIRE(history.growthPerDay(MEM_EventQueue) == 0);
+    REQUIRE(history.growthPerDay(MEM_DbQueryQueue) == 2400);
+    REQUIRE(history.totalGrowthPerDay() == 2400);
+}
+
+TEST_CASE("Heap block estimate")
+{
+    REQUIRE(MEM_HeapBytes(0) == 0);
+    REQUIRE(MEM_HeapBytes(1) == 32);
+    REQUIRE(MEM_HeapBytes(24) == 32);
+    REQUIRE(MEM_HeapBytes(25) == 48);
+    REQUIRE(MEM_SharedArrayBytes(0, 2) == 0);
+    REQUIRE(MEM_SharedArrayBytes(10, 2) == MEM_HeapBytes(24 + 22));
+
+    std::vector<uint32_t> vec;
+    REQUIRE(MEM_VectorBytes(vec) == 0);
+    vec.reserve(100);
+    REQUIRE(MEM_VectorBytes(vec) == MEM_HeapBytes(400));
+}
+
+TEST_CASE("Memory stays bounded on a long running network")
+{
+    initResourceDescriptors();
+
+    const std::vector<APS_SimProfile> &profiles = APS_SimDdfProfiles();
+    REQUIRE(profiles.size() > 100);
+
+    APS_SimConfig config;
+    APS_SimController sim(config);
+    SoakPlugin plugin(sim);
+
+    std::vector<uint64_t> devices;
+    for (size_t i = 0; i < 200; i++)
+    {
+        devices.push_back(sim.addNode(profiles[(i * 37) % profiles.size()], 0, false));
+    }
+
+    const int days = 3;
+    const int64_t end = int64_t(days) * 24 * 3600 * 1000;
+    const int64_t pollInterval = 15 * 60 * 1000 / int64_t(devices.size()); // each device every 15 minutes
+    int64_t nextPoll = 0;
+    int64_t nextSample = MEM_SAMPLE_INTERVAL_MS;
+    size_t pollIndex = 0;
+    size_t maxPending = 0;
+    MEM_History history;
+    MEM_Report firstDay;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int64_t t = 0; t < end; t += 100)
+    {
+        sim.runUntil(t + 100);
+        plugin.tick();
+
+        if (t >= nextPoll)
+        {
+            plugin.poll(devices[pollIndex++ % devices.size()]);
+            nextPoll += pollInterval;
+        }
+
+        maxPending = std::max(maxPending, plugin.pendingTasks());
+
+        if (t >= nextSample)
+        {
+            MEM_Report report;
+            plugin.memoryUsage(report);
+            history.add(t, report);
+            nextSample += MEM_SAMPLE_INTERVAL_MS;
+
+            if (t < 24 * 3600 * 1000)
+            {
+                firstDay = report; // warm up, all items known and queues at their working size
+            }
+        }
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    MEM_Report last;
+    plugin.memoryUsage(last);
+
+    INFO("simulated " << days << " days in " << seconds << " s, " << sim.stats().reports << " reports, "
+         << plugin.messagesSent() << " websocket messages");
+    INFO("accounted after day 1: " << firstDay.totalBytes() << " bytes, at the end: " << last.totalBytes() << " bytes");
+
+    REQUIRE(sim.stats().reports > 500000);
+    REQUIRE(history.size() == MEM_HISTORY_SIZE); // covers day 2 and 3
+
+    for (int i = 0; i < MEM_CategoryMax; i++)
+    {
+        const MEM_Category category = MEM_Category(i);
+        INFO(MEM_CategoryName(category) << ": " << last.usage[i].bytes << " bytes, growth " << history.growthPerDay(category) << " bytes/day");
+
+        // drains leave the capacity of the high water mark, which may rise a little
+        CHECK(last.usage[i].bytes <= firstDay.usage[i].bytes + firstDay.usage[i].bytes / 4 + 4096);
+        CHECK(history.growthPerDay(category) <= 8192);
+    }
+
+    REQUIRE(last.usage[MEM_ResourceItems].count == firstDay.usage[MEM_ResourceItems].count);
+    REQUIRE(maxPending < devices.size());
+}
@@ -0,0 +1,156 @@
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "aps_sim.h"
+#include "startup_profile.h"
+#include "startup_sim.h"
+
+/*
+ * Headless startup benchmark: the startup sequence of the plugin runs against a fixture
+ * database of a gateway with 250 devices and the DDFs of the source tree. The phase
+ * report is printed so startup regressions can be tracked between builds.
+ */
+namespace {
+
+const char *fixturePath = "416-startup-fixture.db";
+
+} // namespace
+
+TEST_CASE("Startup phases accumulate and milestones are recorded once")
+{
+    SP_Start();
+
+    REQUIRE(SP_GetTiming(SP_DbOpen).startUs == -1);
+    REQUIRE(SP_GetTiming(SP_DbOpen).count == 0);
+
+    for (int i = 0; i < 3; i++)
+    {
+        SP_Scope scope(SP_DdfSignatures);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+
+    const SP_Timing signatures = SP_GetTiming(SP_DdfSignatures);
+    CHECK(signatures.count == 3);
+    CHECK(signatures.startUs >= 0);
+    CHECK(signatures.durationUs >= 6000);
+    CHECK(signatures.durationUs <= SP_ElapsedUs());
+
+    SP_Milestone(SP_FirstRestResponse);
+    const SP_Timing rest = SP_GetTiming(SP_FirstRestResponse);
+    REQUIRE(rest.startUs >= signatures.durationUs);
+    REQUIRE(rest.count == 1);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    SP_Milestone(SP_FirstRestResponse);
+    CHECK(SP_GetTiming(SP_FirstRestResponse).startUs == rest.startUs);
+
+    SECTION("phases after the first poll cycle don't count towards startup")
+    {
+        SP_Milestone(SP_FirstPollCycle);
+        {
+            SP_Scope scope(SP_DdfSignatures); // bundle upload later on
+        }
+        CHECK(SP_GetTiming(SP_DdfSignatures).count == 3);
+    }
+
+    SECTION("SP_Start() resets all timings")
+    {
+        SP_Start();
+        CHECK(SP_GetTiming(SP_DdfSignatures).startUs == -1);
+        CHECK(SP_GetTiming(SP_FirstRestResponse).startUs == -1);
+    }
+}
+
+TEST_CASE("Startup phases from worker threads")
+{
+    SP_Start();
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++)
+    {
+        threads.emplace_back([]()
+        {
+            for (int i = 0; i < 1000; i++)
+            {
+                SP_Scope scope(SP_DdfParse);
+            }
+        });
+    }
+
+    for (std::thread &t : threads)
+    {
+        t.join();
+    }
+
+    CHECK(SP_GetTiming(SP_DdfParse).count == 4000);
+}
+
+TEST_CASE("Startup sequence against a fixture database")
+{
+    REQUIRE(APS_SimDdfProfiles().size() > 100);
+
+    SS_FixtureConfig config;
+    REQUIRE(SS_CreateFixtureDb(fixturePath, APS_SimDdfProfiles(), config));
+
+    SS_Result result;
+    REQUIRE(SS_RunStartup(fixturePath, DDF_DIR, &result));
+
+    CHECK(result.jsInit);
+    CHECK(result.auth == 5);
+    CHECK(result.groups == config.groups);
+    CHECK(result.scenes == config.groups * config.scenesPerGroup);
+    CHECK(result.rules == config.rules);
+    CHECK(result.schedules == config.schedules);
+    CHECK(result.resourcelinks == config.resourcelinks);
+    CHECK(result.sensors > 0);
+    CHECK(result.alarmDevices > 0);
+    CHECK(result.identifiers > 0);
+    CHECK(result.ddfFiles > 500);
+    CHECK(result.ddfParsed > result.ddfFiles * 9 / 10);
+    CHECK(result.ddfModels >= result.ddfParsed);
+    CHECK(result.jsonErrors == 0);
+
+    for (int i = 0; i < SP_PhaseMax; i++)
+    {
+        const SP_Phase phase = SP_Phase(i);
+        const SP_Timing timing = SP_GetTiming(phase);
+        INFO(SP_PhaseName(phase));
+
+        if (SP_IsMilestone(phase) || phase == SP_DdfSignatures || phase == SP_DbPreload)
+        {
+            CHECK(timing.startUs == -1); // no poll cycle, no REST, no bundles, sequential
+        }
+        else
+        {
+            CHECK(timing.count == 1);
+            CHECK(timing.startUs >= 0);
+        }
+    }
+
+    // phases run one after another in the order of the plugin constructor
+    CHECK(SP_GetTiming(SP_JsInit).startUs <= SP_GetTiming(SP_DbOpen).startUs);
+    CHECK(SP_GetTiming(SP_DbOpen).startUs <= SP_GetTiming(SP_DdfParse).startUs);
+    CHECK(SP_GetTiming(SP_DdfParse).startUs <= SP_GetTiming(SP_LoadAuth).startUs);
+    CHECK(SP_GetTiming(SP_LoadSensors).startUs <= SP_GetTiming(SP_LoadAlarmSystems).startUs);
+
+    int64_t total = 0;
+    for (int i = 0; i < SP_PhaseMax; i++)
+    {
+        total += SP_GetTiming(SP_Phase(i)).durationUs;
+    }
+    CHECK(total <= SP_ElapsedUs());
+
+    printf("startup with %zu devices, %zu sensors, %zu DDF files\n%s", config.devices, result.sensors, result.ddfFiles, SP_Report().c_str());
+
+    BENCHMARK("startup 250 devices")
+    {
+        SS_Result r;
+        return SS_RunStartup(fixturePath, DDF_DIR, &r);
+    };
+
+    remove(fixturePath);
+}
@@ -0,0 +1,245 @@
+#include <sqlite3.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "catch2/catch.hpp"
+
+#include "aps_sim.h"
+#include "db_preload.h"
+#include "startup_profile.h"
+#include "startup_sim.h"
+#include "utils/parallel_for.h"
+
+/*
+ * Parallel startup: the database tables are preloaded on a worker while the DDFs are read
+ * and parsed in batches by ParallelFor(). Both must yield exactly the rows and documents
+ * of the sequential startup, in the same order.
+ */
+namespace {
+
+const char *fixturePath = "417-parallel-fixture.db";
+const char *tablePath = "417-preload.db";
+
+typedef std::vector<std::string> Row;
+
+int collectRow(void *user, int ncols, char **colval, char **colname)
+{
+    std::vector<Row> *rows = static_cast<std::vector<Row>*>(user);
+    Row row;
+    for (int i = 0; i < ncols; i++)
+    {
+        row.push_back(std::string(colname[i]) + "=" + (colval[i] ? colval[i] : "<null>"));
+    }
+    rows->push_back(row);
+    return 0;
+}
+
+int abortRow(void *, int, char **, char **)
+{
+    return 1;
+}
+
+void createTable(const char *path)
+{
+    remove(path);
+    sqlite3 *db = nullptr;
+    REQUIRE(sqlite3_open(path, &db) == SQLITE_OK);
+    REQUIRE(sqlite3_exec(db, "CREATE TABLE t (a TEXT, b TEXT, c INTEGER);"
+                             "INSERT INTO t VALUES('one', NULL, 1);"
+                             "INSERT INTO t VALUES('', 'two', 2);"
+                             "INSERT INTO t VALUES('three', 'x', NULL);"
+                             "CREATE TABLE empty (a TEXT)", nullptr, nullptr, nullptr) == SQLITE_OK);
+    sqlite3_close(db);
+}
+
+std::vector<Row> execRows(const char *path, const char *sql)
+{
+    std::vector<Row> rows;
+    sqlite3 *db = nullptr;
+    REQUIRE(sqlite3_open(path, &db) == SQLITE_OK);
+    REQUIRE(sqlite3_exec(db, sql, collectRow, &rows, nullptr) == SQLITE_OK);
+    sqlite3_close(db);
+    return rows;
+}
+
+double bestOf(int runs, SS_Mode mode)
+{
+    double best = 1e9;
+    for (int i = 0; i < runs; i++)
+    {
+        SS_Result result;
+        const auto start = std::chrono::steady_clock::now();
+        REQUIRE(SS_RunStartup(fixturePath, DDF_DIR, &result, mode));
+        const std::chrono::duration<double, std::milli> ms = std::chrono::steady_clock::now() - start;
+        best = std::min(best, ms.count());
+    }
+    return best;
+}
+
+} // namespace
+
+TEST_CASE("DB_Preload rows replay like sqlite3_exec()")
+{
+    createTable(tablePath);
+
+    DB_Preload preload;
+    preload.start(tablePath, { "SELECT * FROM t", "SELECT * FROM empty", "SELECT * FROM missing" });
+    REQUIRE(preload.isActive());
+
+    DB_PreloadResult result;
+
+    SECTION("rows including NULL values")
+    {
+        REQUIRE(preload.take("SELECT * FROM t", &result));
+        CHECK(result.rc == SQLITE_OK);
+        CHECK(result.rowCount() == 3);
+
+        std::vector<Row> rows;
+        CHECK(DB_ReplayRows(result, collectRow, &rows) == SQLITE_OK);
+        CHECK(rows == execRows(tablePath, "SELECT * FROM t"));
+
+        // each statement is handed out once
+        CHECK_FALSE(preload.take("SELECT * FROM t", &result));
+    }
+
+    SECTION("empty table")
+    {
+        REQUIRE(preload.take("SELECT * FROM empty", &result));
+        CHECK(result.rc == SQLITE_OK);
+        CHECK(result.rowCount() == 0);
+    }
+
+    SECTION("failed statement")
+    {
+        REQUIRE(preload.take("SELECT * FROM missing", &result));
+        CHECK(result.rc != SQLITE_OK);
+
+        std::vector<Row> rows;
+        CHECK(DB_ReplayRows(result, collectRow, &rows) == result.rc);
+        CHECK(rows.empty());
+    }
+
+    SECTION("callback aborts")
+    {
+        REQUIRE(preload.take("SELECT * FROM t", &result));
+        CHECK(DB_ReplayRows(result, abortRow, nullptr) == SQLITE_ABORT);
+    }
+
+    SECTION("statement which isn't preloaded")
+    {
+        CHECK_FALSE(preload.take("SELECT a FROM t", &result));
+    }
+
+    SECTION("finish without taking results")
+    {
+        preload.finish();
+        CHECK_FALSE(preload.isActive());
+        CHECK_FALSE(preload.take("SELECT * FROM t", &result));
+    }
+
+    preload.finish();
+    remove(tablePath);
+}
+
+TEST_CASE("DB_Preload of a database which can't be opened")
+{
+    DB_Preload preload;
+    preload.start("417-does-not-exist/no.db", { "SELECT * FROM t" });
+
+    DB_PreloadResult result;
+    REQUIRE(preload.take("SELECT * FROM t", &result));
+    CHECK(result.rc != SQLITE_OK);
+}
+
+TEST_CASE("ParallelFor visits each index once")
+{
+    const size_t count = 1000;
+    std::vector<std::atomic<int>> visits(count);
+    for (auto &v : visits)
+    {
+        v = 0;
+    }
+
+    ParallelFor(count, PARALLEL_MAX_THREADS, [&visits](size_t i) { visits[i]++; });
+
+    CHECK(std::all_of(visits.begin(), visits.end(), [](const std::atomic<int> &v) { return v == 1; }));
+
+    size_t calls = 0;
+    ParallelFor(0, PARALLEL_MAX_THREADS, [&calls](size_t) { calls++; });
+    CHECK(calls == 0);
+
+    ParallelFor(3, 0, [&calls](size_t) { calls++; }); // runs on the calling thread
+    CHECK(calls == 3);
+
+    CHECK(ParallelThreadCount() >= 1);
+    CHECK(ParallelThreadCount() <= PARALLEL_MAX_THREADS);
+}
+
+TEST_CASE("Parallel startup matches the sequential startup")
+{
+    REQUIRE(APS_SimDdfProfiles().size() > 100);
+
+    SS_FixtureConfig config;
+    config.devices = 300;
+    REQUIRE(SS_CreateFixtureDb(fixturePath, APS_SimDdfProfiles(), config));
+
+    SS_Result sequential;
+    REQUIRE(SS_RunStartup(fixturePath, DDF_DIR, &sequential, SS_Sequential));
+    CHECK(SP_GetTiming(SP_DbPreload).count == 0);
+
+    SS_Result parallel;
+    REQUIRE(SS_RunStartup(fixturePath, DDF_DIR, &parallel, SS_Parallel));
+    CHECK(SP_GetTiming(SP_DbPreload).count == 1);
+    CHECK(SP_GetTiming(SP_DbPreload).startUs <= SP_GetTiming(SP_DdfParse).startUs);
+
+    CHECK(parallel.jsInit);
+    CHECK(parallel.auth == sequential.auth);
+    CHECK(parallel.config == sequential.config);
+    CHECK(parallel.userparameter == sequential.userparameter);
+    CHECK(parallel.groups == sequential.groups);
+    CHECK(parallel.resourcelinks == sequential.resourcelinks);
+    CHECK(parallel.scenes == sequential.scenes);
+    CHECK(parallel.rules == sequential.rules);
+    CHECK(parallel.schedules == sequential.schedules);
+    CHECK(parallel.sensors == sequential.sensors);
+    CHECK(parallel.alarmDevices == sequential.alarmDevices);
+    CHECK(parallel.identifiers == sequential.identifiers);
+    CHECK(parallel.ddfFiles == sequential.ddfFiles);
+    CHECK(parallel.ddfParsed == sequential.ddfParsed);
+    CHECK(parallel.ddfModels == sequential.ddfModels);
+    CHECK(parallel.jsonErrors == 0);
+    CHECK(sequential.groups == config.groups);
+
+    const double sequentialMs = bestOf(5, SS_Sequential);
+    const double parallelMs = bestOf(5, SS_Parallel);
+
+    printf("startup with %zu devices on %zu threads: sequential %.1f ms, parallel %.1f ms\n",
+           config.devices, ParallelThreadCount(), sequentialMs, parallelMs);
+
+    if (ParallelThreadCount() > 1)
+    {
+        CHECK(parallelMs < sequentialMs);
+    }
+    else
+    {
+        CHECK(parallelMs < sequentialMs * 1.25); // single core, only the worker overhead
+    }
+
+    BENCHMARK("sequential startup 300 devices")
+    {
+        SS_Result r;
+        return SS_RunStartup(fixturePath, DDF_DIR, &r, SS_Sequential);
+    };
+
+    BENCHMARK("parallel startup 300 devices")
+    {
+        SS_Result r;
+        return SS_RunStartup(fixturePath, DDF_DIR, &r, SS_Parallel);
+    };
+
+    remove(fixturePath);
+}
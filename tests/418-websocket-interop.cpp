@@ -0,0 +1,254 @@
+#include <functional>
+#include <string>
+#include <vector>
+#include <zlib.h>
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QWebSocket>
+#include <deconz/qhttprequest_compat.h>
+
+#include "catch2/catch.hpp"
+
+#include "websocket_server.h"
+
+/*
+ * End-to-end handshake and framing of WebSocketServer on a REST API port. The HTTP
+ * server hands the socket over with the request still buffered, like the plugin does.
+ * A raw client speaks RFC 6455/7692 the way browsers do, QWebSocket covers the clients
+ * which are handled by QWebSocketServer.
+ */
+namespace {
+
+const char *wsKey = "dGhlIHNhbXBsZSBub25jZQ==";
+
+QCoreApplication *app()
+{
+    static int argc = 2;
+    static char arg0[] = "418-websocket-interop";
+    static char arg1[] = "--ws-deflate=1";
+    static char *argv[] = { arg0, arg1, nullptr };
+    static QCoreApplication *instance = new QCoreApplication(argc, argv);
+    return instance;
+}
+
+bool waitFor(const std::function<bool()> &cond)
+{
+    QElapsedTimer t;
+    t.start();
+    while (!cond() && t.elapsed() < 5000)
+    {
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+    }
+    return cond();
+}
+
+class RestPort
+{
+public:
+    explicit RestPort(WebSocketServer *ws)
+    {
+        REQUIRE(srv.listen(QHostAddress::LocalHost));
+
+        QObject::connect(&srv, &QTcpServer::newConnection, &srv, [this, ws]() {
+            QTcpSocket *sock = srv.nextPendingConnection();
+            QObject::connect(sock, &QTcpSocket::readyRead, &srv, [this, ws, sock]() {
+                const QByteArray pending = sock->peek(sock->bytesAvailable());
+                if (!pending.contains("\r\n\r\n"))
+                {
+                    return;
+                }
+                QObject::disconnect(sock, nullptr, &srv, nullptr);
+                const QHttpRequestHeader hdr(pending.constData(), size_t(pending.size()));
+                ws->handleExternalTcpSocket(hdr, sock);
+            });
+        });
+    }
+
+    quint16 port() const { return srv.serverPort(); }
+
+private:
+    QTcpServer srv;
+};
+
+QByteArray handshake(const char *extraHeaders)
+{
+    QByteArray req;
+    req += "GET / HTTP/1.1\r\n";
+    req += "Host: 127.0.0.1\r\n";
+    req += "Upgrade: websocket\r\n";
+    req += "Connection: keep-alive, Upgrade\r\n";
+    req += "Sec-WebSocket-Version: 13\r\n";
+    req += QByteArray("Sec-WebSocket-Key: ") + wsKey + "\r\n";
+    req += extraHeaders;
+    req += "\r\n";
+    return req;
+}
+
+QByteArray clientFrame(uint8_t opcode, const QByteArray &payload)
+{
+    const char mask[4] = { 0x12, 0x34, 0x56, 0x78 };
+    QByteArray frame;
+    frame += char(0x80 | opcode);
+    frame += char(0x80 | payload.size());
+    frame.append(mask, 4);
+    for (int i = 0; i < payload.size(); i++)
+    {
+        frame += char(payload[i] ^ mask[i & 3]);
+    }
+    return frame;
+}
+
+struct ServerFrame
+{
+    uint8_t head = 0;
+    QByteArray payload;
+};
+
+// takes the next unmasked server frame from the front of buf
+bool nextFrame(QByteArray &buf, ServerFrame *frame)
+{
+    if (buf.size() < 2)
+    {
+        return false;
+    }
+
+    const uint8_t *p = reinterpret_cast<const uint8_t*>(buf.constData());
+    int pos = 2;
+    uint64_t len = p[1] & 0x7F;
+    if (len == 126)
+    {
+        if (buf.size() < 4) { return false; }
+        len = (uint64_t(p[2]) << 8) | p[3];
+        pos = 4;
+    }
+    else if (len == 127)
+    {
+        if (buf.size() < 10) { return false; }
+        len = 0;
+        for (int i = 0; i < 8; i++) { len = (len << 8) | p[2 + i]; }
+        pos = 10;
+    }
+
+    if (uint64_t(buf.size()) < pos + len)
+    {
+        return false;
+    }
+
+    frame->head = p[0];
+    frame->payload = buf.mid(pos, int(len));
+    buf.remove(0, pos + int(len));
+    return true;
+}
+
+} // namespace
+
+TEST_CASE("Browser-equivalent permessage-deflate client")
+{
+    app();
+    WebSocketServer ws(nullptr, 0);
+    RestPort rest(&ws);
+
+    QTcpSocket client;
+    client.connectToHost(QHostAddress::LocalHost, rest.port());
+    REQUIRE(waitFor([&]() { return client.state() == QAbstractSocket::ConnectedState; }));
+
+    // the ping arrives in the same segment as the handshake
+    client.write(handshake("Sec-WebSocket-Extensions: permessage-deflate; client_max_window_bits\r\n") +
+                 clientFrame(0x9, "ping"));
+
+    QByteArray rsp;
+    REQUIRE(waitFor([&]() { rsp += client.readAll(); return rsp.contains("\r\n\r\n") && rsp.size() > rsp.indexOf("\r\n\r\n") + 4; }));
+
+    const int end = rsp.indexOf("\r\n\r\n");
+    const QByteArray header = rsp.left(end + 4);
+    QByteArray frames = rsp.mid(end + 4);
+    const QByteArray accept = QCryptographicHash::hash(QByteArray(wsKey) + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11", QCryptographicHash::Sha1).toBase64();
+
+    CHECK(header.startsWith("HTTP/1.1 101"));
+    CHECK(header.contains("Sec-WebSocket-Accept: " + accept + "\r\n"));
+    CHECK(header.contains("Sec-WebSocket-Extensions: permessage-deflate\r\n"));
+
+    ServerFrame frame;
+    REQUIRE(waitFor([&]() { frames += client.readAll(); return frames.size() >= 6; }));
+    REQUIRE(nextFrame(frames, &frame));
+    CHECK(frame.head == 0x8A); // FIN + pong
+    CHECK(frame.payload == "ping");
+
+    z_stream inflater{};
+    REQUIRE(inflateInit2(&inflater, -15) == Z_OK);
+
+    // the second message relies on the context of the first one
+    const QString messages[] = {
+        QLatin1String(R"({"e":"changed","id":"1","r":"lights","state":{"on":true,"bri":254}})"),
+        QLatin1String(R"({"e":"changed","id":"1","r":"lights","state":{"on":true,"bri":200}})")
+    };
+
+    for (const QString &msg : messages)
+    {
+        ws.broadcastTextMessage(msg);
+
+        REQUIRE(waitFor([&]() { frames += client.readAll(); ServerFrame f; QByteArray copy = frames; return nextFrame(copy, &f); }));
+        REQUIRE(nextFrame(frames, &frame));
+        CHECK(frame.head == 0xC1); // FIN + RSV1 + text
+
+        QByteArray in = frame.payload + QByteArray("\x00\x00\xff\xff", 4);
+        char out[512];
+        inflater.next_in = reinterpret_cast<Bytef*>(in.data());
+        inflater.avail_in = uInt(in.size());
+        inflater.next_out = reinterpret_cast<Bytef*>(out);
+        inflater.avail_out = sizeof(out);
+        REQUIRE(inflate(&inflater, Z_SYNC_FLUSH) == Z_OK);
+
+        CHECK(QString::fromUtf8(out, int(sizeof(out) - inflater.avail_out)) == msg);
+    }
+
+    inflateEnd(&inflater);
+
+    client.write(clientFrame(0x8, QByteArray("\x03\xE8", 2)));
+    REQUIRE(waitFor([&]() { frames += client.readAll(); return nextFrame(frames, &frame); }));
+    CHECK(frame.head == 0x88);
+    CHECK(frame.payload == QByteArray("\x03\xE8", 2));
+    CHECK(waitFor([&]() { return client.state() == QAbstractSocket::UnconnectedState; }));
+}
+
+TEST_CASE("Client requesting a subprotocol is left to QWebSocketServer")
+{
+    app();
+    WebSocketServer ws(nullptr, 0);
+    RestPort rest(&ws);
+
+    QTcpSocket client;
+    client.connectToHost(QHostAddress::LocalHost, rest.port());
+    REQUIRE(waitFor([&]() { return client.state() == QAbstractSocket::ConnectedState; }));
+
+    client.write(handshake("Sec-WebSocket-Protocol: chat\r\n"
+                           "Sec-WebSocket-Extensions: permessage-deflate\r\n"));
+
+    QByteArray rsp;
+    REQUIRE(waitFor([&]() { rsp += client.readAll(); return rsp.contains("\r\n\r\n"); }));
+    CHECK(rsp.startsWith("HTTP/1.1"));
+    CHECK(!rsp.contains("permessage-deflate"));
+}
+
+TEST_CASE("QWebSocket client receives broadcasts")
+{
+    app();
+    WebSocketServer ws(nullptr, 0);
+    RestPort rest(&ws);
+
+    QWebSocket client;
+    QStringList received;
+    QObject::connect(&client, &QWebSocket::textMessageReceived, [&received](const QString &msg) { received.push_back(msg); });
+
+    client.open(QUrl(QString("ws://127.0.0.1:%1").arg(rest.port())));
+    REQUIRE(waitFor([&]() { return client.state() == QAbstractSocket::ConnectedState; }));
+
+    const QString msg = QLatin1String(R"({"e":"changed","id":"2","r":"sensors","state":{"presence":true}})");
+    REQUIRE(waitFor([&]() { ws.broadcastTextMessage(msg); return !received.isEmpty(); }));
+    CHECK(received.front() == msg);
+
+    client.close();
+}
@@ -0,0 +1,204 @@
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+#include <cstdio>
+#include <sqlite3.h>
+
+#include "catch2/catch.hpp"
+
+#include "backup.h"
+#include "utils/targz.h"
+
+static void createLargeDatabase(const QString &path, int rows)
+{
+    sqlite3 *db = nullptr;
+    REQUIRE(sqlite3_open(qPrintable(path), &db) == SQLITE_OK);
+    REQUIRE(sqlite3_exec(db, "CREATE TABLE IF NOT EXISTS sensors (id INTEGER PRIMARY KEY, json TEXT)", nullptr, nullptr, nullptr) == SQLITE_OK);
+    REQUIRE(sqlite3_exec(db, "BEGIN", nullptr, nullptr, nullptr) == SQLITE_OK);
+
+    sqlite3_stmt *stmt = nullptr;
+    REQUIRE(sqlite3_prepare_v2(db, "INSERT INTO sensors (json) VALUES (?1)", -1, &stmt, nullptr) == SQLITE_OK);
+
+    const QByteArray payload(512, 'x');
+    for (int i = 0; i < rows; i++)
+    {
+        sqlite3_bind_text(stmt, 1, payload.constData(), payload.size(), SQLITE_STATIC);
+        REQUIRE(sqlite3_step(stmt) == SQLITE_DONE);
+        sqlite3_reset(stmt);
+    }
+
+    sqlite3_finalize(stmt);
+    REQUIRE(sqlite3_exec(db, "COMMIT", nullptr, nullptr, nullptr) == SQLITE_OK);
+    sqlite3_close(db);
+}
+
+static int countRows(const QString &path, const char *where = "")
+{
+    sqlite3 *db = nullptr;
+    int count = -1;
+    if (sqlite3_open_v2(qPrintable(path), &db, SQLITE_OPEN_READONLY, nullptr) == SQLITE_OK)
+    {
+        sqlite3_stmt *stmt = nullptr;
+        const QByteArray sql = QByteArray("SELECT COUNT(*) FROM sensors ") + where;
+        if (sqlite3_prepare_v2(db, sql.constData(), -1, &stmt, nullptr) == SQLITE_OK)
+        {
+            if (sqlite3_step(stmt) == SQLITE_ROW)
+            {
+                count = sqlite3_column_int(stmt, 0);
+            }
+            sqlite3_finalize(stmt);
+        }
+    }
+    sqlite3_close(db);
+    return count;
+}
+
+TEST_CASE("Backup tar.gz round trip")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+
+    const QString archive = dir.path() + "/test.tar.gz";
+    QByteArray big;
+    for (int i = 0; i < 100000; i++)
+    {
+        big.append(char(i * 7));
+    }
+
+    {
+        TarGzWriter tgz;
+        REQUIRE(tgz.open(archive));
+        REQUIRE(tgz.beginFile("a.txt", 5, 0));
+        REQUIRE(tgz.write("hello", 5));
+        REQUIRE(tgz.endFile());
+        // long name needs a GNU 'L' entry
+        const QString longName = QString("logs/") + QString(120, QChar('n')) + ".log";
+        REQUIRE(tgz.beginFile(longName, big.size(), 0));
+        REQUIRE(tgz.write(big.constData(), 1000));
+        REQUIRE(tgz.write(big.constData() + 1000, big.size() - 1000));
+        REQUIRE(tgz.endFile());
+        REQUIRE(tgz.close());
+    }
+
+    const QString out = dir.path() + "/out";
+    QStringList files;
+    REQUIRE(TGZ_Extract(archive, out, &files));
+    REQUIRE(files.size() == 2);
+
+    QFile a(out + "/a.txt");
+    REQUIRE(a.open(QIODevice::ReadOnly));
+    REQUIRE(a.readAll() == QByteArray("hello"));
+
+    QFile b(out + "/" + files.at(1));
+    REQUIRE(b.open(QIODevice::ReadOnly));
+    REQUIRE(b.readAll() == big);
+}
+
+TEST_CASE("Backup export and restore of a large database")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+
+    const int rows = 40000; // ~25 MB
+    createLargeDatabase(dir.path() + "/zll.db", rows);
+
+    // connection of the plugin which keeps writing during export
+    sqlite3 *db = nullptr;
+    REQUIRE(sqlite3_open(qPrintable(dir.path() + "/zll.db"), &db) == SQLITE_OK);
+
+    const QByteArray conf = "{\"panId\": \"0x1234\"}\n";
+    REQUIRE(!BAK_StartExport(dir.path(), conf, nullptr));
+    REQUIRE(BAK_StartExport(dir.path(), conf, db));
+    REQUIRE(!BAK_StartExport(dir.path(), conf, db)); // already running
+
+    qint64 maxStall = 0;
+    int steps = 0;
+    int writes = 0;
+    QElapsedTimer t;
+
+    for (;;)
+    {
+        t.start();
+        const bool more = BAK_ExportStep();
+        maxStall = qMax(maxStall, t.elapsed());
+        steps++;
+
+        if (!more)
+        {
+            break;
+        }
+
+        // writes through the source connection are applied to the snapshot without restarting it
+        if (BAK_GetExportStatus().state == BAK_ExportSnapshot)
+        {
+            char sql[96];
+            snprintf(sql, sizeof(sql), "UPDATE sensors SET json = 'changed' WHERE id = %d", steps);
+            REQUIRE(sqlite3_exec(db, sql, nullptr, nullptr, nullptr) == SQLITE_OK);
+            writes++;
+        }
+    }
+
+    REQUIRE(sqlite3_close(db) == SQLITE_OK);
+
+    const BAK_ExportStatus status = BAK_GetExportStatus();
+    INFO("export took " << status.duration << " ms in " << steps << " steps, max main loop stall " << maxStall << " ms");
+    REQUIRE(writes > 10);
+    REQUIRE(status.state == BAK_ExportDone);
+    REQUIRE(status.progress == 100);
+    REQUIRE(status.bytesWritten > 0);
+    REQUIRE(maxStall < 100);
+
+    REQUIRE(!QFile::exists(dir.path() + "/zll-backup.db"));
+    REQUIRE(QFile::exists(dir.path() + "/deCONZ.tar.gz"));
+
+    const QString restore = dir.path() + "/restore";
+    QStringList files;
+    REQUIRE(TGZ_Extract(dir.path() + "/deCONZ.tar.gz", restore, &files));
+    REQUIRE(files.contains("deCONZ.conf"));
+    REQUIRE(files.contains("zll.db"));
+
+    QFile confFile(restore + "/deCONZ.conf");
+    REQUIRE(confFile.open(QIODevice::ReadOnly));
+    REQUIRE(confFile.readAll() == conf);
+
+    REQUIRE(countRows(restore + "/zll.db") == rows);
+    REQUIRE(countRows(restore + "/zll.db", "WHERE json = 'changed'") == writes);
+}
+
+TEST_CASE("Backup export keeps the previous archive until it is replaced")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+
+    createLargeDatabase(dir.path() + "/zll.db", 2000);
+
+    sqlite3 *db = nullptr;
+    REQUIRE(sqlite3_open(qPrintable(dir.path() + "/zll.db"), &db) == SQLITE_OK);
+
+    const QString archive = dir.path() + "/deCONZ.tar.gz";
+    {
+        QFile old(archive);
+        REQUIRE(old.open(QIODevice::WriteOnly));
+        old.write("previous");
+    }
+
+    REQUIRE(BAK_StartExport(dir.path(), "{}\n", db));
+    REQUIRE(BAK_ExportStep());
+
+    // clients which download during the export get the complete previous archive
+    {
+        QFile old(archive);
+        REQUIRE(old.open(QIODevice::ReadOnly));
+        REQUIRE(old.readAll() == QByteArray("previous"));
+    }
+
+    REQUIRE(BAK_FinishExport());
+    REQUIRE(!QFile::exists(dir.path() + "/deCONZ.tar.gz.part"));
+
+    QStringList files;
+    REQUIRE(TGZ_Extract(archive, dir.path() + "/restore", &files));
+    REQUIRE(countRows(dir.path() + "/restore/zll.db") == 2000);
+
+    REQUIRE(sqlite3_close(db) == SQLITE_OK);
+}
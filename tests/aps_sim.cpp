@@ -0,0 +1,644 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include <dirent.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "cj/cj.h"
+#include "aps_sim.h"
+
+extern "C" {
+int cj_copy_ref_utf8(cj_ctx *ctx, char *buf, unsigned size, cj_token_ref ref);
+int cj_ref_to_long(cj_ctx *ctx, long *result, cj_token_ref ref);
+}
+
+#define ZCL_FC_PROFILE_WIDE          0x00
+#define ZCL_FC_MANUFACTURER_SPECIFIC 0x04
+#define ZCL_FC_SERVER_TO_CLIENT      0x08
+#define ZCL_FC_DISABLE_DEFAULT_RSP   0x10
+
+#define ZCL_STATUS_SUCCESS           0x00
+#define ZCL_STATUS_UNSUPPORTED_ATTR  0x86
+
+/*! \returns the size of a ZCL value of \p dataType or 0 if not simulated.
+ */
+static size_t dataTypeSize(uint8_t dataType)
+{
+    switch (dataType)
+    {
+    case 0x10: // bool
+    case 0x18: // bitmap8
+    case 0x20: // uint8
+    case 0x28: // int8
+    case 0x30: // enum8
+        return 1;
+    case 0x19: // bitmap16
+    case 0x21: // uint16
+    case 0x29: // int16
+    case 0x31: // enum16
+        return 2;
+    case 0x22: // uint24
+    case 0x2A: // int24
+        return 3;
+    case 0x1B: // bitmap32
+    case 0x23: // uint32
+    case 0x2B: // int32
+    case 0x39: // float
+        return 4;
+    case 0x25: // uint48
+        return 6;
+    default:
+        break;
+    }
+    return 0;
+}
+
+static void putU16(std::vector<uint8_t> &out, uint16_t val)
+{
+    out.push_back(uint8_t(val));
+    out.push_back(uint8_t(val >> 8));
+}
+
+static void putValue(std::vector<uint8_t> &out, uint64_t val, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        out.push_back(uint8_t(val >> (i * 8)));
+    }
+}
+
+static void putString(std::vector<uint8_t> &out, const std::string &str)
+{
+    out.push_back(0x42); // character string
+    out.push_back(uint8_t(std::min<size_t>(str.size(), 0xFE)));
+    out.insert(out.end(), str.begin(), str.begin() + long(std::min<size_t>(str.size(), 0xFE)));
+}
+
+APS_SimController::APS_SimController(const APS_SimConfig &config) :
+    m_config(config),
+    m_rng(config.seed)
+{
+}
+
+uint64_t APS_SimController::addNode(const APS_SimProfile &profile, int64_t joinTimeMs, bool announce)
+{
+    Node node;
+    node.ext = 0x00212E0000000000ULL | uint64_t(m_nodes.size() + 1);
+    node.nwk = uint16_t(0x1000 + m_nodes.size() * 7);
+    node.profile = &profile;
+    node.pollPhase = std::uniform_int_distribution<int64_t>(0, m_config.pollIntervalMs - 1)(m_rng);
+    m_nodes.push_back(node);
+
+    Event ev{};
+    ev.time = joinTimeMs;
+    ev.type = EventJoin;
+    ev.node = m_nodes.size() - 1;
+    ev.report = announce ? 1 : 0;
+    schedule(std::move(ev));
+
+    return node.ext;
+}
+
+const APS_SimProfile *APS_SimController::profile(uint64_t ext) const
+{
+    for (const Node &node : m_nodes)
+    {
+        if (node.ext == ext)
+        {
+            return node.profile;
+        }
+    }
+    return nullptr;
+}
+
+void APS_SimController::schedule(Event ev)
+{
+    ev.seq = m_seq++;
+    m_events.push(std::move(ev));
+}
+
+bool APS_SimController::lose()
+{
+    return std::uniform_real_distribution<double>(0, 1)(m_rng) < m_config.lossRate;
+}
+
+int64_t APS_SimController::latency()
+{
+    return m_config.confirmLatencyMs + std::uniform_int_distribution<int64_t>(0, m_config.confirmJitterMs)(m_rng);
+}
+
+int64_t APS_SimController::nextPoll(const Node &node, int64_t timeMs) const
+{
+    const int64_t interval = m_config.pollIntervalMs;
+    const int64_t n = (timeMs - node.pollPhase + interval - 1) / interval;
+    return node.pollPhase + std::max<int64_t>(n, 0) * interval;
+}
+
+/*! Queues a request, the confirm and the response are delivered by runUntil().
+ */
+int APS_SimController::apsdeDataRequest(const APS_SimRequest &req)
+{
+    if (int(m_queued) >= m_config.maxQueued)
+    {
+        m_stats.busy++;
+        return APS_SIM_BUSY;
+    }
+
+    m_stats.requests++;
+    m_queued++;
+    m_stats.maxQueued = std::max(m_stats.maxQueued, m_queued);
+
+    const auto n = std::find_if(m_nodes.begin(), m_nodes.end(), [&req](const Node &node) { return node.ext == req.dstExt; });
+
+    Event conf{};
+    conf.type = EventConfirm;
+    conf.confirm.id = req.id;
+    conf.confirm.dstExt = req.dstExt;
+
+    if (n == m_nodes.end() || !n->joined)
+    {
+        conf.time = m_now + m_config.ackTimeoutMs;
+        conf.confirm.status = APS_SIM_MAC_NO_ACK;
+        schedule(std::move(conf));
+        return APS_SIM_SUCCESS;
+    }
+
+    if (lose())
+    {
+        m_stats.lost++;
+        conf.time = m_now + m_config.ackTimeoutMs;
+        conf.confirm.status = APS_SIM_NO_ACK;
+        schedule(std::move(conf));
+        return APS_SIM_SUCCESS;
+    }
+
+    int64_t deliverTime = m_now + latency() / 2;
+    if (n->profile->sleepy)
+    {
+        deliverTime = nextPoll(*n, deliverTime); // held by the parent
+    }
+
+    conf.time = deliverTime + m_config.confirmLatencyMs / 2;
+    conf.confirm.status = APS_SIM_SUCCESS;
+    schedule(std::move(conf));
+
+    Event del{};
+    del.time = deliverTime;
+    del.type = EventDeliver;
+    del.node = size_t(n - m_nodes.begin());
+    del.request = req;
+    schedule(std::move(del));
+
+    return APS_SIM_SUCCESS;
+}
+
+APS_CaptureRecord APS_SimController::indication(const Node &node, uint16_t profileId, uint16_t clusterId, uint8_t srcEndpoint, int64_t timeMs)
+{
+    APS_CaptureRecord ind;
+    ind.timeMs = timeMs;
+    ind.srcExt = node.ext;
+    ind.srcNwk = node.nwk;
+    ind.profileId = profileId;
+    ind.clusterId = clusterId;
+    ind.srcEndpoint = srcEndpoint;
+    ind.dstEndpoint = profileId == 0x0000 ? 0x00 : 0x01;
+    ind.lqi = uint8_t(std::uniform_int_distribution<int>(120, 255)(m_rng));
+    ind.rssi = int8_t(std::uniform_int_distribution<int>(-85, -40)(m_rng));
+    return ind;
+}
+
+uint64_t APS_SimController::attributeValue(const Node &node, uint16_t clusterId, uint16_t attrId)
+{
+    if (clusterId == 0x0006 || clusterId == 0x0500 || clusterId == 0x0406)
+    {
+        return std::uniform_int_distribution<int>(0, 1)(m_rng); // on/off, occupancy, zone status
+    }
+    return (node.nwk * 31u + attrId + uint64_t(std::uniform_int_distribution<int>(0, 400)(m_rng))) & 0x7FFF;
+}
+
+/*! Creates the response of \p node to \p req, answering like a typical Zigbee 3.0 device.
+ */
+void APS_SimController::respond(const Node &node, const APS_SimRequest &req, int64_t timeMs)
+{
+    Event ev{};
+    ev.time = timeMs;
+    ev.type = EventIndication;
+    ev.node = size_t(&node - m_nodes.data());
+
+    if (req.asdu.empty())
+    {
+        return;
+    }
+
+    if (req.profileId == 0x0000) // ZDP
+    {
+        if (req.clusterId & 0x8000)
+        {
+            return;
+        }
+
+        ev.ind = indication(node, 0x0000, req.clusterId | 0x8000, 0x00, timeMs);
+        ev.ind.asdu = { req.asdu[0], ZCL_STATUS_SUCCESS };
+        if (req.clusterId != 0x0021 && req.clusterId != 0x0022) // bind/unbind have no payload
+        {
+            putU16(ev.ind.asdu, node.nwk);
+        }
+        if (req.clusterId == 0x0005) // active endpoints
+        {
+            ev.ind.asdu.push_back(1);
+            ev.ind.asdu.push_back(0x01);
+        }
+        schedule(std::move(ev));
+        return;
+    }
+
+    const uint8_t fc = req.asdu[0];
+    const size_t hdrSize = (fc & ZCL_FC_MANUFACTURER_SPECIFIC) ? 5 : 3;
+    if (req.asdu.size() < hdrSize || (fc & ZCL_FC_SERVER_TO_CLIENT))
+    {
+        return;
+    }
+
+    const uint8_t seq = req.asdu[hdrSize - 2];
+    const uint8_t commandId = req.asdu[hdrSize - 1];
+    const bool profileWide = (fc & 0x03) == ZCL_FC_PROFILE_WIDE;
+    std::vector<uint8_t> &rsp = ev.ind.asdu;
+
+    ev.ind = indication(node, req.profileId, req.clusterId, req.dstEndpoint, timeMs);
+    rsp.push_back(ZCL_FC_PROFILE_WIDE | ZCL_FC_SERVER_TO_CLIENT | ZCL_FC_DISABLE_DEFAULT_RSP);
+    rsp.push_back(seq);
+
+    if (profileWide && commandId == 0x00) // read attributes
+    {
+        rsp.push_back(0x01);
+        for (size_t i = hdrSize; i + 1 < req.asdu.size(); i += 2)
+        {
+            const uint16_t attrId = uint16_t(req.asdu[i] | req.asdu[i + 1] << 8);
+            putU16(rsp, attrId);
+
+            if (req.clusterId == 0x0000 && (attrId == 0x0004 || attrId == 0x0005))
+            {
+                rsp.push_back(ZCL_STATUS_SUCCESS);
+                putString(rsp, attrId == 0x0004 ? node.profile->manufacturer : node.profile->modelId);
+                continue;
+            }
+
+            if (req.clusterId == 0x0000 && attrId == 0x0007) // power source
+            {
+                rsp.push_back(ZCL_STATUS_SUCCESS);
+                rsp.push_back(0x30);
+                rsp.push_back(node.profile->sleepy ? 0x03 : 0x01);
+                continue;
+            }
+
+            const auto r = std::find_if(node.profile->reports.begin(), node.profile->reports.end(), [&req, attrId](const APS_SimReport &rep)
+            {
+                return rep.clusterId == req.clusterId && rep.attrId == attrId;
+            });
+
+            const size_t size = r != node.profile->reports.end() ? dataTypeSize(r->dataType) : 0;
+            if (size == 0)
+            {
+                rsp.push_back(ZCL_STATUS_UNSUPPORTED_ATTR);
+                continue;
+            }
+
+            rsp.push_back(ZCL_STATUS_SUCCESS);
+            rsp.push_back(r->dataType);
+            putValue(rsp, attributeValue(node, req.clusterId, attrId), size);
+        }
+    }
+    else if (profileWide && commandId == 0x06) // configure reporting
+    {
+        rsp.push_back(0x07);
+        rsp.push_back(ZCL_STATUS_SUCCESS);
+    }
+    else if (!profileWide && (fc & ZCL_FC_DISABLE_DEFAULT_RSP))
+    {
+        return;
+    }
+    else
+    {
+        rsp.push_back(0x0B); // default response
+        rsp.push_back(commandId);
+        rsp.push_back(ZCL_STATUS_SUCCESS);
+    }
+
+    schedule(std::move(ev));
+}
+
+void APS_SimController::scheduleReport(size_t node, size_t report, int64_t after)
+{
+    Event ev{};
+    ev.time = m_now + after;
+    ev.type = EventReport;
+    ev.node = node;
+    ev.report = report;
+    schedule(std::move(ev));
+}
+
+void APS_SimController::deliver(const Event &ev)
+{
+    if (m_handler)
+    {
+        m_stats.indications++;
+        m_handler->apsdeDataIndication(ev.ind);
+    }
+}
+
+/*! Processes all events up to \p timeMs.
+ */
+void APS_SimController::runUntil(int64_t timeMs)
+{
+    while (!m_events.empty() && m_events.top().time <= timeMs)
+    {
+        const Event ev = m_events.top();
+        m_events.pop();
+        m_now = std::max(m_now, ev.time);
+
+        if (ev.type == EventJoin)
+        {
+            Node &node = m_nodes[ev.node];
+            node.joined = true;
+
+            if (ev.report) // announce
+            {
+                Event annce{};
+                annce.type = EventIndication;
+                annce.time = m_now + latency() / 2;
+                annce.ind = indication(node, 0x0000, APS_SIM_ZDP_DEVICE_ANNCE, 0x00, annce.time);
+                annce.ind.asdu = { node.zclSeq++ };
+                putU16(annce.ind.asdu, node.nwk);
+                putValue(annce.ind.asdu, node.ext, 8);
+                annce.ind.asdu.push_back(node.profile->sleepy ? 0x80 : 0x8E); // capabilities
+                schedule(std::move(annce));
+            }
+
+            for (size_t i = 0; i < node.profile->reports.size(); i++)
+            {
+                const int64_t maxMs = std::max<int64_t>(node.profile->reports[i].maxInterval, 1) * 1000;
+                scheduleReport(ev.node, i, std::uniform_int_distribution<int64_t>(0, maxMs)(m_rng));
+            }
+        }
+        else if (ev.type == EventReport)
+        {
+            Node &node = m_nodes[ev.node];
+            const APS_SimReport &rep = node.profile->reports[ev.report];
+            const size_t size = dataTypeSize(rep.dataType);
+
+            if (size > 0 && !lose())
+            {
+                Event ind{};
+                ind.ind = indication(node, 0x0104, rep.clusterId, rep.endpoint, m_now);
+                ind.ind.asdu = { ZCL_FC_PROFILE_WIDE | ZCL_FC_SERVER_TO_CLIENT | ZCL_FC_DISABLE_DEFAULT_RSP, node.zclSeq++, 0x0A };
+                putU16(ind.ind.asdu, rep.attrId);
+                ind.ind.asdu.push_back(rep.dataType);
+                putValue(ind.ind.asdu, attributeValue(node, rep.clusterId, rep.attrId), size);
+                m_stats.reports++;
+                deliver(ind);
+            }
+            else if (size > 0)
+            {
+                m_stats.lost++;
+            }
+
+            // value changes are reported after the min interval, otherwise the max interval elapses
+            const int64_t minMs = std::max<int64_t>(rep.minInterval, 1) * 1000;
+            const int64_t maxMs = std::max<int64_t>(rep.maxInterval * 1000, minMs);
+            scheduleReport(ev.node, ev.report, std::uniform_int_distribution<int64_t>(minMs, maxMs)(m_rng));
+        }
+        else if (ev.type == EventDeliver)
+        {
+            const Node &node = m_nodes[ev.node];
+            if (!lose())
+            {
+                respond(node, ev.request, m_now + m_config.responseLatencyMs);
+            }
+            else
+            {
+                m_stats.lost++;
+            }
+        }
+        else if (ev.type == EventConfirm)
+        {
+            m_queued--;
+            if (ev.confirm.status != APS_SIM_SUCCESS)
+            {
+                m_stats.confirmsFailed++;
+            }
+
+            if (m_handler)
+            {
+                APS_SimConfirm conf = ev.confirm;
+                conf.timeMs = m_now;
+                m_handler->apsdeDataConfirm(conf);
+            }
+        }
+        else if (ev.type == EventIndication)
+        {
+            deliver(ev);
+        }
+    }
+
+    m_now = std::max(m_now, timeMs);
+}
+
+static bool copyString(cj_ctx *cj, cj_token_ref ref, std::string *out)
+{
+    char buf[128];
+
+    if (ref < cj->tokens_pos && cj->tokens[ref].type == CJ_TOKEN_ARRAY_BEG)
+    {
+        ref++; // first of several names
+    }
+
+    if (ref >= cj->tokens_pos || cj->tokens[ref].type != CJ_TOKEN_STRING || cj_copy_ref_utf8(cj, buf, sizeof(buf), ref) == 0)
+    {
+        return false;
+    }
+
+    *out = buf;
+    return true;
+}
+
+static long toNumber(cj_ctx *cj, cj_token_ref ref, long def)
+{
+    char buf[32];
+    long result = def;
+
+    if (ref >= cj->tokens_pos)
+    {
+        return def;
+    }
+
+    if (cj->tokens[ref].type == CJ_TOKEN_STRING && cj_copy_ref_utf8(cj, buf, sizeof(buf), ref))
+    {
+        return strtol(buf, nullptr, 0); // "0x0402"
+    }
+
+    if (cj_ref_to_long(cj, &result, ref))
+    {
+        return result;
+    }
+    return def;
+}
+
+/*! Loads the reporting configuration of a DDF, \returns false if the DDF has none.
+ */
+bool APS_SimLoadProfile(const char *path, APS_SimProfile *profile)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+    {
+        return false;
+    }
+
+    std::vector<char> data;
+    char tmp[4096];
+    size_t n;
+    while ((n = fread(tmp, 1, sizeof(tmp), fp)) > 0)
+    {
+        data.insert(data.end(), tmp, tmp + n);
+    }
+    fclose(fp);
+
+    std::vector<cj_token> tokens(data.size() / 2 + 16);
+    cj_ctx cj[1];
+    cj_parse_init(cj, data.data(), cj_size(data.size()), tokens.data(), cj_size(tokens.size()));
+    cj_parse(cj);
+
+    if (cj->status != CJ_OK || cj->tokens_pos == 0 || tokens[0].type != CJ_TOKEN_OBJECT_BEG)
+    {
+        return false;
+    }
+
+    APS_SimProfile result;
+    if (!copyString(cj, cj_value_ref(cj, 0, "manufacturername"), &result.manufacturer) ||
+        !copyString(cj, cj_value_ref(cj, 0, "modelid"), &result.modelId))
+    {
+        return false;
+    }
+
+    const cj_token_ref bindings = cj_value_ref(cj, 0, "bindings");
+    if (bindings >= cj->tokens_pos || tokens[bindings].type != CJ_TOKEN_ARRAY_BEG)
+    {
+        return false;
+    }
+
+    for (cj_token_ref b = bindings + 1; b < cj->tokens_pos && !(tokens[b].type == CJ_TOKEN_ARRAY_END && tokens[b].parent == 0); b++)
+    {
+        if (tokens[b].parent != bindings || tokens[b].type != CJ_TOKEN_OBJECT_BEG)
+        {
+            continue;
+        }
+
+        const uint16_t clusterId = uint16_t(toNumber(cj, cj_value_ref(cj, b, "cl"), 0));
+        const uint8_t endpoint = uint8_t(toNumber(cj, cj_value_ref(cj, b, "src.ep"), 1));
+
+        if (clusterId == 0x0001)
+        {
+            result.sleepy = true; // battery reporting
+        }
+
+        const cj_token_ref reports = cj_value_ref(cj, b, "report");
+        if (reports >= cj->tokens_pos || tokens[reports].type != CJ_TOKEN_ARRAY_BEG)
+        {
+            continue;
+        }
+
+        for (cj_token_ref r = reports + 1; r < cj->tokens_pos && !(tokens[r].type == CJ_TOKEN_ARRAY_END && tokens[r].parent == b); r++)
+        {
+            if (tokens[r].parent != reports || tokens[r].type != CJ_TOKEN_OBJECT_BEG)
+            {
+                continue;
+            }
+
+            APS_SimReport rep;
+            rep.endpoint = endpoint;
+            rep.clusterId = clusterId;
+            rep.attrId = uint16_t(toNumber(cj, cj_value_ref(cj, r, "at"), 0));
+            rep.dataType = uint8_t(toNumber(cj, cj_value_ref(cj, r, "dt"), 0));
+            rep.minInterval = uint16_t(toNumber(cj, cj_value_ref(cj, r, "min"), 1));
+            rep.maxInterval = uint16_t(toNumber(cj, cj_value_ref(cj, r, "max"), 300));
+
+            if (rep.maxInterval != 0 && rep.maxInterval != 0xFFFF && dataTypeSize(rep.dataType) > 0)
+            {
+                result.reports.push_back(rep);
+            }
+        }
+    }
+
+    if (result.reports.empty())
+    {
+        return false;
+    }
+
+    *profile = std::move(result);
+    return true;
+}
+
+/*! Recursively loads all DDFs with reporting configuration below \p dir.
+    \returns the number of loaded profiles.
+ */
+size_t APS_SimLoadProfiles(const char *dir, std::vector<APS_SimProfile> *profiles)
+{
+    DIR *d = opendir(dir);
+    if (!d)
+    {
+        return 0;
+    }
+
+    std::vector<std::string> entries;
+    while (dirent *entry = readdir(d))
+    {
+        if (entry->d_name[0] != '.')
+        {
+            entries.push_back(entry->d_name);
+        }
+    }
+    closedir(d);
+    std::sort(entries.begin(), entries.end()); // same population on every run
+
+    size_t count = 0;
+    for (const std::string &name : entries)
+    {
+        const std::string path = std::string(dir) + "/" + name;
+
+        if (name.size() > 5 && name.compare(name.size() - 5, 5, ".json") == 0)
+        {
+            APS_SimProfile profile;
+            if (APS_SimLoadProfile(path.c_str(), &profile))
+            {
+                profiles->push_back(std::move(profile));
+                count++;
+            }
+        }
+        else if (name.find('.') == std::string::npos)
+        {
+            count += APS_SimLoadProfiles(path.c_str(), profiles);
+        }
+    }
+
+    return count;
+}
+
+/*! Returns the profiles of all DDFs in the repository, loaded once per process.
+ */
+const std::vector<APS_SimProfile> &APS_SimDdfProfiles()
+{
+    static std::vector<APS_SimProfile> profiles;
+    if (profiles.empty())
+    {
+        APS_SimLoadProfiles(DDF_DIR, &profiles);
+    }
+    return profiles;
+}
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef APS_SIM_H
+#define APS_SIM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "aps_capture.h"
+
+#define APS_SIM_SUCCESS        0x00
+#define APS_SIM_NO_ACK         0xA7 //! APS ack not received
+#define APS_SIM_MAC_NO_ACK     0xE9 //! MAC ack not received, route broken
+#define APS_SIM_BUSY           0x01 //! apsdeDataRequest() queue full
+
+#define APS_SIM_ZDP_DEVICE_ANNCE 0x0013
+
+/*! Attribute reporting of a simulated device, taken from the "report" entries of a DDF binding.
+ */
+struct APS_SimReport
+{
+    uint8_t endpoint = 1;
+    uint16_t clusterId = 0;
+    uint16_t attrId = 0;
+    uint8_t dataType = 0;
+    uint16_t minInterval = 0; //! seconds
+    uint16_t maxInterval = 0; //! seconds
+};
+
+/*! Device model loaded from a DDF.
+ */
+struct APS_SimProfile
+{
+    std::string manufacturer;
+    std::string modelId;
+    bool sleepy = false; //! battery powered end device, has a power configuration binding
+    std::vector<APS_SimReport> reports;
+};
+
+/*! Radio and node behaviour of the simulated network.
+ */
+struct APS_SimConfig
+{
+    uint32_t seed = 1;
+    int confirmLatencyMs = 40;   //! mean APS confirm latency to routers
+    int confirmJitterMs = 40;    //! uniform 0..jitter on top
+    int responseLatencyMs = 25;  //! ZCL/ZDP response after the request was received
+    int ackTimeoutMs = 6000;     //! APS confirm of a lost request
+    int pollIntervalMs = 7500;   //! sleepy end devices fetch requests from their parent
+    int maxQueued = 8;           //! requests in the controller before apsdeDataRequest() returns busy
+    double lossRate = 0.01;      //! frames lost in both directions
+};
+
+/*! An APS data request as passed to deCONZ::ApsController::apsdeDataRequest().
+ */
+struct APS_SimRequest
+{
+    uint8_t id = 0;
+    uint64_t dstExt = 0;
+    uint16_t profileId = 0x0104;
+    uint16_t clusterId = 0;
+    uint8_t dstEndpoint = 1;
+    std::vector<uint8_t> asdu; //! ZCL or ZDP frame
+};
+
+/*! An APS data confirm as passed to apsdeDataConfirm().
+ */
+struct APS_SimConfirm
+{
+    uint8_t id = 0;
+    uint64_t dstExt = 0;
+    uint8_t status = APS_SIM_SUCCESS;
+    int64_t timeMs = 0;
+};
+
+/*! Receives indications and confirms with the signature of the plugin entry points
+    apsdeDataIndication() and apsdeDataConfirm(), implemented by a test-local model. Indications use the capture record so simulated traffic can be
+    written with APS_CaptureWriter and replayed later.
+ */
+class APS_SimHandler
+{
+public:
+    virtual ~APS_SimHandler() = default;
+    virtual void apsdeDataIndication(const APS_CaptureRecord &ind) = 0;
+    virtual void apsdeDataConfirm(const APS_SimConfirm &conf) = 0;
+};
+
+/*! Counters of the simulated radio.
+ */
+struct APS_SimStats
+{
+    uint64_t requests = 0;
+    uint64_t busy = 0;           //! rejected by a full queue
+    uint64_t confirmsFailed = 0;
+    uint64_t indications = 0;
+    uint64_t reports = 0;
+    uint64_t lost = 0;           //! dropped frames in both directions
+    size_t maxQueued = 0;
+};
+
+/*! \class APS_SimController
+
+    Mock of deCONZ::ApsController for a synthetic network with hundreds of nodes.
+
+    Runs on virtual time: runUntil() delivers indications and confirms in time order to
+    the handler. Nodes answer ZDP requests, ZCL read attributes and configure reporting,
+    and emit attribute reports between the min and max interval of their DDF bindings.
+    Requests to sleepy end devices are held by the parent until the next poll.
+ */
+class APS_SimController
+{
+public:
+    explicit APS_SimController(const APS_SimConfig &config);
+
+    void setHandler(APS_SimHandler *handler) { m_handler = handler; }
+
+    /*! Adds a node which joins at \p joinTimeMs, \returns its IEEE address.
+        \p announce sends a ZDP device announce on join, otherwise the node is known already
+        and only starts reporting.
+     */
+    uint64_t addNode(const APS_SimProfile &profile, int64_t joinTimeMs, bool announce);
+
+    /*! \returns APS_SIM_SUCCESS or APS_SIM_BUSY. */
+    int apsdeDataRequest(const APS_SimRequest &req);
+
+    void runUntil(int64_t timeMs);
+
+    int64_t now() const { return m_now; }
+    size_t queued() const { return m_queued; }
+    size_t nodeCount() const { return m_nodes.size(); }
+    const APS_SimProfile *profile(uint64_t ext) const;
+    const APS_SimStats &stats() const { return m_stats; }
+
+private:
+    enum EventType { EventJoin, EventReport, EventDeliver, EventConfirm, EventIndication };
+
+    struct Node
+    {
+        uint64_t ext;
+        uint16_t nwk;
+        const APS_SimProfile *profile;
+        int64_t pollPhase;
+        uint8_t zclSeq = 0;
+        bool joined = false;
+    };
+
+    struct Event
+    {
+        int64_t time;
+        uint64_t seq;           // keeps events of the same time in order
+        EventType type;
+        size_t node;
+        size_t report;          // EventReport
+        APS_SimConfirm confirm; // EventConfirm
+        APS_SimRequest request; // EventDeliver
+        APS_CaptureRecord ind;  // EventIndication
+
+        bool operator>(const Event &other) const { return time != other.time ? time > other.time : seq > other.seq; }
+    };
+
+    void schedule(Event ev);
+    void scheduleReport(size_t node, size_t report, int64_t after);
+    void deliver(const Event &ev);
+    void respond(const Node &node, const APS_SimRequest &req, int64_t timeMs);
+    APS_CaptureRecord indication(const Node &node, uint16_t profileId, uint16_t clusterId, uint8_t srcEndpoint, int64_t timeMs);
+    uint64_t attributeValue(const Node &node, uint16_t clusterId, uint16_t attrId);
+    bool lose();
+    int64_t latency();
+    int64_t nextPoll(const Node &node, int64_t timeMs) const;
+
+    APS_SimConfig m_config;
+    APS_SimHandler *m_handler = nullptr;
+    std::vector<Node> m_nodes;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> m_events;
+    std::mt19937 m_rng;
+    APS_SimStats m_stats;
+    int64_t m_now = 0;
+    uint64_t m_seq = 0;
+    size_t m_queued = 0;
+};
+
+bool APS_SimLoadProfile(const char *path, APS_SimProfile *profile);
+size_t APS_SimLoadProfiles(const char *dir, std::vector<APS_SimProfile> *profiles);
+const std::vector<APS_SimProfile> &APS_SimDdfProfiles();
+
+#endif // APS_SIM_H
@@ -0,0 +1,532 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include <dirent.h>
+#include <sqlite3.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "cj/cj.h"
+#include "db_preload.h"
+#include "device_js/duktape.h"
+#include "startup_profile.h"
+#include "startup_sim.h"
+#include "utils/parallel_for.h"
+
+/*! Tables read during startup, as created by initDb() and DB_StoreAlarmSystem...() in database.cpp. */
+static const char *ssSchema[] = {
+    "CREATE TABLE IF NOT EXISTS auth (apikey TEXT PRIMARY KEY, devicetype TEXT, createdate TEXT, lastusedate TEXT, useragent TEXT)",
+    "CREATE TABLE IF NOT EXISTS userparameter (key TEXT PRIMARY KEY, value TEXT)",
+    "CREATE TABLE IF NOT EXISTS nodes (mac TEXT PRIMARY KEY, id TEXT, state TEXT, name TEXT, groups TEXT, endpoint TEXT, modelid TEXT, manufacturername TEXT, swbuildid TEXT, ritems TEXT)",
+    "CREATE TABLE IF NOT EXISTS config2 (key text PRIMARY KEY, value text)",
+    "CREATE TABLE IF NOT EXISTS groups (gid TEXT PRIMARY KEY, name TEXT, state TEXT, mids TEXT, devicemembership TEXT, lightsequence TEXT, hidden TEXT, type TEXT, class TEXT, uniqueid TEXT)",
+    "CREATE TABLE IF NOT EXISTS resourcelinks (id TEXT PRIMARY KEY, json TEXT)",
+    "CREATE TABLE IF NOT EXISTS rules (rid TEXT PRIMARY KEY, name TEXT, created TEXT, etag TEXT, lasttriggered TEXT, owner TEXT, status TEXT, timestriggered TEXT, actions TEXT, conditions TEXT, periodic TEXT)",
+    "CREATE TABLE IF NOT EXISTS sensors (sid TEXT PRIMARY KEY, name TEXT, type TEXT, modelid TEXT, manufacturername TEXT, uniqueid TEXT, swversion TEXT, state TEXT, config TEXT, fingerprint TEXT, deletedState TEXT, mode TEXT, lastseen TEXT, lastannounced TEXT)",
+    "CREATE TABLE IF NOT EXISTS scenes (gsid TEXT PRIMARY KEY, gid TEXT, sid TEXT, name TEXT, transitiontime TEXT, lights TEXT)",
+    "CREATE TABLE IF NOT EXISTS schedules (id TEXT PRIMARY KEY, json TEXT)",
+    "CREATE TABLE IF NOT EXISTS devices (id INTEGER PRIMARY KEY, mac TEXT UNIQUE, timestamp INTEGER NOT NULL, nwk INTEGER)",
+    "CREATE TABLE IF NOT EXISTS sub_devices (id INTEGER PRIMARY KEY, uniqueid TEXT NOT NULL, device_id INTEGER REFERENCES devices(id) ON DELETE CASCADE, timestamp INTEGER NOT NULL, UNIQUE(uniqueid) ON CONFLICT IGNORE)",
+    "CREATE TABLE IF NOT EXISTS resource_items (sub_device_id TEXT REFERENCES sub_devices(id) ON DELETE CASCADE, item STRING NOT NULL, value NOT NULL, source STRING NOT NULL, timestamp INTEGER NOT NULL, PRIMARY KEY (sub_device_id, item) ON CONFLICT REPLACE)",
+    "CREATE TABLE IF NOT EXISTS alarm_systems (id INTEGER PRIMARY KEY ON CONFLICT IGNORE, timestamp INTEGER NOT NULL)",
+    "CREATE TABLE IF NOT EXISTS alarm_systems_devices (uniqueid TEXT PRIMARY KEY ON CONFLICT REPLACE, as_id INTEGER, flags INTEGER NOT NULL, timestamp INTEGER NOT NULL, FOREIGN KEY(as_id) REFERENCES alarm_systems(id) ON DELETE CASCADE)",
+    nullptr
+};
+
+static int rowCallback(void *user, int ncols, char **colval, char **colname)
+{
+    std::vector<SS_Row> *rows = static_cast<std::vector<SS_Row>*>(user);
+    SS_Row row;
+
+    for (int i = 0; i < ncols; i++)
+    {
+        if (colval[i] && colval[i][0] != '\0')
+        {
+            row[colname[i]] = colval[i];
+        }
+    }
+
+    rows->push_back(std::move(row));
+    return 0;
+}
+
+static bool exec(sqlite3 *db, const char *sql, std::vector<SS_Row> *rows = nullptr)
+{
+    char *errmsg = nullptr;
+    const int rc = sqlite3_exec(db, sql, rows ? rowCallback : nullptr, rows, &errmsg);
+
+    if (errmsg)
+    {
+        sqlite3_free(errmsg);
+    }
+
+    return rc == SQLITE_OK;
+}
+
+/*! Quotes a string literal for the fixture INSERTs. */
+static std::string q(const std::string &str)
+{
+    std::string result = "'";
+    for (char c : str)
+    {
+        if (c == '\'') { result += '\''; }
+        result += c;
+    }
+    result += '\'';
+    return result;
+}
+
+bool SS_ParseJson(const std::string &json)
+{
+    std::vector<cj_token> tokens(json.size() / 2 + 16);
+    cj_ctx cj[1];
+    cj_parse_init(cj, json.data(), cj_size(json.size()), tokens.data(), cj_size(tokens.size()));
+    cj_parse(cj);
+    return cj->status == CJ_OK;
+}
+
+static void parseColumn(const SS_Row &row, const char *column, SS_Result *result)
+{
+    const auto i = row.find(column);
+    if (i != row.end() && !SS_ParseJson(i->second))
+    {
+        result->jsonErrors++;
+    }
+}
+
+/*! Creates a fixture database like a gateway with \p config devices would have,
+    the devices are taken round robin from the DDF \p profiles.
+ */
+bool SS_CreateFixtureDb(const char *path, const std::vector<APS_SimProfile> &profiles, const SS_FixtureConfig &config)
+{
+    remove(path);
+
+    sqlite3 *db = nullptr;
+    if (sqlite3_open(path, &db) != SQLITE_OK)
+    {
+        sqlite3_close(db);
+        return false;
+    }
+
+    bool ok = exec(db, "BEGIN");
+    for (size_t i = 0; ssSchema[i]; i++)
+    {
+        ok = ok && exec(db, ssSchema[i]);
+    }
+
+    char buf[512];
+    std::string sql;
+
+    for (size_t i = 0; i < 5; i++)
+    {
+        snprintf(buf, sizeof(buf), "INSERT INTO auth VALUES('%08X%08X', 'app#%zu', '2024-01-01T00:00:00', '2024-06-01T00:00:00', 'client/1.0')", unsigned(i * 7919), unsigned(i), i);
+        ok = ok && exec(db, buf);
+    }
+
+    for (size_t i = 0; i < 48; i++)
+    {
+        snprintf(buf, sizeof(buf), "INSERT INTO config2 VALUES('key%zu', 'value of configuration key %zu')", i, i);
+        ok = ok && exec(db, buf);
+    }
+
+    for (size_t i = 0; i < 10; i++)
+    {
+        snprintf(buf, sizeof(buf), "INSERT INTO userparameter VALUES('param%zu', '{\"value\":%zu}')", i, i);
+        ok = ok && exec(db, buf);
+    }
+
+    size_t sid = 1;
+    size_t subDeviceId = 1;
+    for (size_t i = 0; i < config.devices && !profiles.empty(); i++)
+    {
+        const APS_SimProfile &profile = profiles[i % profiles.size()];
+        char mac[32];
+        snprintf(mac, sizeof(mac), "00:15:8d:00:%02x:%02x:%02x:%02x", unsigned(i >> 24) & 0xFF, unsigned(i >> 16) & 0xFF, unsigned(i >> 8) & 0xFF, unsigned(i) & 0xFF);
+
+        snprintf(buf, sizeof(buf), "INSERT INTO devices VALUES(%zu, '%s', 1700000000, %zu)", i + 1, mac, 0x1000 + i);
+        ok = ok && exec(db, buf);
+
+        std::string uniqueId = std::string(mac) + (profile.sleepy ? "-01-0402" : "-01");
+
+        if (profile.sleepy)
+        {
+            sql = "INSERT INTO sensors VALUES(" + q(std::to_string(sid)) + ", " + q("Sensor " + std::to_string(sid)) + ", 'ZHATemperature', " +
+                  q(profile.modelId) + ", " + q(profile.manufacturer) + ", " + q(uniqueId) + ", '20240101', " +
+                  q("{\"temperature\":2150,\"lastupdated\":\"2024-06-01T12:00:00.000\"}") + ", " +
+                  q("{\"on\":true,\"reachable\":true,\"battery\":87,\"offset\":0}") + ", " +
+                  q("{\"ep\":1,\"p\":260,\"d\":770,\"v\":0,\"in\":[\"0000\",\"0001\",\"0402\"],\"out\":[\"0019\"]}") +
+                  ", 'normal', '1', '2024-06-01T12:00Z', '2024-05-01T12:00:00Z')";
+            sid++;
+        }
+        else
+        {
+            sql = "INSERT INTO nodes VALUES(" + q(mac) + ", " + q(std::to_string(i + 1)) + ", 'normal', " + q("Light " + std::to_string(i + 1)) +
+                  ", '1,2', '1', " + q(profile.modelId) + ", " + q(profile.manufacturer) + ", '1.0.0', '')";
+        }
+        ok = ok && exec(db, sql.c_str());
+
+        snprintf(buf, sizeof(buf), "INSERT INTO sub_devices VALUES(%zu, '%s', %zu, 1700000000)", subDeviceId, uniqueId.c_str(), i + 1);
+        ok = ok && exec(db, buf);
+
+        const std::pair<std::string, std::string> attrs[] = {
+            { "attr/modelid", profile.modelId },
+            { "attr/manufacturername", profile.manufacturer },
+            { "attr/swversion", "20240101" },
+            { "attr/name", "Device " + std::to_string(i) }
+        };
+
+        for (size_t j = 0; j < config.itemsPerSubDevice; j++)
+        {
+            const std::string item = j < 4 ? attrs[j].first : "state/item" + std::to_string(j);
+            const std::string value = j < 4 ? attrs[j].second : std::to_string(j * 100 + i);
+            sql = "INSERT INTO resource_items VALUES(" + std::to_string(subDeviceId) + ", " + q(item) + ", " + q(value) + ", 'device', 1700000000)";
+            ok = ok && exec(db, sql.c_str());
+        }
+        subDeviceId++;
+    }
+
+    for (size_t i = 1; i <= config.groups; i++)
+    {
+        snprintf(buf, sizeof(buf), "INSERT INTO groups VALUES('%zu', 'Group %zu', 'normal', '', '[]', '[]', 'false', 'Room', 'Living room', '')", i, i);
+        ok = ok && exec(db, buf);
+
+        for (size_t s = 1; s <= config.scenesPerGroup; s++)
+        {
+            snprintf(buf, sizeof(buf), "INSERT INTO scenes VALUES('0x%04zX%02zX', '%zu', '%zu', 'Scene %zu', '4', "
+                     "'[{\"lid\":\"1\",\"on\":true,\"bri\":254,\"x\":24939,\"y\":24701,\"tt\":4},{\"lid\":\"2\",\"on\":false,\"bri\":0,\"x\":0,\"y\":0,\"tt\":4}]')",
+                     i, s, i, s, s);
+            ok = ok && exec(db, buf);
+        }
+    }
+
+    for (size_t i = 1; i <= config.rules; i++)
+    {
+        snprintf(buf, sizeof(buf), "INSERT INTO rules VALUES('%zu', 'Rule %zu', '2024-01-01T00:00:00', 'etag', 'none', 'owner', 'enabled', '0', "
+                 "'[{\"address\":\"/groups/1/action\",\"method\":\"PUT\",\"body\":{\"on\":true}}]', "
+                 "'[{\"address\":\"/sensors/%zu/state/buttonevent\",\"operator\":\"eq\",\"value\":\"1002\"},{\"address\":\"/sensors/%zu/state/lastupdated\",\"operator\":\"dx\"}]', '0')",
+                 i, i, i, i);
+        ok = ok && exec(db, buf);
+    }
+
+    for (size_t i = 1; i <= config.schedules; i++)
+    {
+        snprintf(buf, sizeof(buf), "INSERT INTO schedules VALUES('%zu', '{\"name\":\"Schedule %zu\",\"command\":{\"address\":\"/api/key/groups/1/action\",\"method\":\"PUT\",\"body\":{\"on\":false}},\"localtime\":\"W127/T22:00:00\",\"status\":\"enabled\"}')", i, i);
+        ok = ok && exec(db, buf);
+    }
+
+    for (size_t i = 1; i <= config.resourcelinks; i++)
+    {
+        snprintf(buf, sizeof(buf), "INSERT INTO resourcelinks VALUES('%zu', '{\"name\":\"Link %zu\",\"classid\":1,\"links\":[\"/groups/1\",\"/rules/1\",\"/sensors/1\"]}')", i, i);
+        ok = ok && exec(db, buf);
+    }
+
+    ok = ok && exec(db, "INSERT INTO alarm_systems VALUES(1, 1700000000)");
+    for (size_t i = 1; i < sid && i <= 16; i++)
+    {
+        snprintf(buf, sizeof(buf), "INSERT INTO alarm_systems_devices SELECT uniqueid, 1, 1, 1700000000 FROM sensors WHERE sid = '%zu'", i);
+        ok = ok && exec(db, buf);
+    }
+
+    ok = ok && exec(db, "COMMIT");
+    sqlite3_close(db);
+    return ok;
+}
+
+/*! Lists the DDF JSON files below \p dir in a stable order. */
+void SS_ListDdfFiles(const char *dir, std::vector<std::string> *files)
+{
+    DIR *d = opendir(dir);
+    if (!d)
+    {
+        return;
+    }
+
+    std::vector<std::string> entries;
+    while (dirent *entry = readdir(d))
+    {
+        if (entry->d_name[0] != '.')
+        {
+            entries.push_back(entry->d_name);
+        }
+    }
+    closedir(d);
+    std::sort(entries.begin(), entries.end());
+
+    for (const std::string &name : entries)
+    {
+        const std::string path = std::string(dir) + "/" + name;
+
+        if (name.size() > 5 && name.compare(name.size() - 5, 5, ".json") == 0)
+        {
+            files->push_back(path);
+        }
+        else if (name.find('.') == std::string::npos)
+        {
+            SS_ListDdfFiles(path.c_str(), files);
+        }
+    }
+}
+
+static bool readFile(const std::string &path, std::string *data)
+{
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (!fp)
+    {
+        return false;
+    }
+
+    char tmp[4096];
+    size_t n;
+    data->clear();
+    while ((n = fread(tmp, 1, sizeof(tmp), fp)) > 0)
+    {
+        data->append(tmp, n);
+    }
+    fclose(fp);
+    return true;
+}
+
+/*! Same steps as the DeviceJs constructor, the arena allocator is replaced by malloc. */
+static duk_context *initJs()
+{
+    duk_context *ctx = duk_create_heap_default();
+    if (!ctx)
+    {
+        return nullptr;
+    }
+
+    duk_push_global_object(ctx);
+    duk_push_object(ctx);
+    duk_put_prop_string(ctx, -2, "Utils");
+    duk_pop(ctx);
+
+    duk_peval_string_noresult(ctx, "String.prototype.padStart = String.prototype.padStart || "
+                                   "function (targetLength, padString) { return this.toString(); } ");
+    duk_peval_string_noresult(ctx, "Utils.log10 = Math.log10");
+    return ctx;
+}
+
+/*! Device DDF as read and parsed by one worker. */
+struct SS_DdfFile
+{
+    std::string path;
+    std::string data;
+    std::vector<cj_token> tokens;
+    cj_ctx cj[1];
+    bool ok = false;
+};
+
+static void readDdfFile(SS_DdfFile *file)
+{
+    if (!readFile(file->path, &file->data))
+    {
+        return;
+    }
+
+    file->tokens.resize(file->data.size() / 2 + 16);
+    cj_parse_init(file->cj, file->data.data(), cj_size(file->data.size()), file->tokens.data(), cj_size(file->tokens.size()));
+    cj_parse(file->cj);
+    file->ok = file->cj->status == CJ_OK && file->cj->tokens_pos > 0 && file->tokens[0].type == CJ_TOKEN_OBJECT_BEG;
+}
+
+/*! Main thread part of a DDF, DeviceDescriptions takes the modelid entries of each file. */
+static void constructDdf(SS_DdfFile &file, SS_Result *result)
+{
+    if (!file.ok)
+    {
+        return;
+    }
+
+    result->ddfParsed++;
+    const cj_token_ref ref = cj_value_ref(file.cj, 0, "modelid");
+
+    if (ref == CJ_INVALID_TOKEN_INDEX)
+    {
+        return;
+    }
+
+    if (file.tokens[ref].type == CJ_TOKEN_STRING)
+    {
+        result->ddfModels++;
+        return;
+    }
+
+    for (cj_token_ref i = ref + 1; i < file.cj->tokens_pos && file.tokens[i].type != CJ_TOKEN_ARRAY_END; i++)
+    {
+        if (file.tokens[i].parent == ref)
+        {
+            result->ddfModels++;
+        }
+    }
+}
+
+/*! Runs the startup sequence of the DeRestPluginPrivate constructor against \p dbPath,
+    steps are in the same order and recorded as the same phases.
+ */
+bool SS_RunStartup(const char *dbPath, const char *ddfDir, SS_Result *result, SS_Mode mode)
+{
+    *result = SS_Result{};
+    std::vector<SS_Row> rows;
+    SP_Start();
+
+    duk_context *js = nullptr;
+    {
+        SP_Scope startupScope(SP_JsInit);
+        js = initJs();
+        result->jsInit = js != nullptr;
+    }
+
+    sqlite3 *db = nullptr;
+    {
+        SP_Scope startupScope(SP_DbOpen);
+        if (sqlite3_open_v2(dbPath, &db, SQLITE_OPEN_READWRITE, nullptr) != SQLITE_OK)
+        {
+            sqlite3_close(db);
+            duk_destroy_heap(js);
+            return false;
+        }
+        exec(db, "PRAGMA foreign_keys = ON");
+    }
+
+    {
+        SP_Scope startupScope(SP_DbInit);
+        exec(db, "PRAGMA page_count", &rows);
+        exec(db, "PRAGMA page_size", &rows);
+        exec(db, "PRAGMA freelist_count", &rows);
+        exec(db, "PRAGMA user_version", &rows);
+        for (size_t i = 0; ssSchema[i]; i++)
+        {
+            exec(db, ssSchema[i]);
+        }
+        rows.clear();
+    }
+
+    struct Table
+    {
+        SP_Phase phase;
+        const char *sql;
+        size_t *count;
+        const char *jsonColumns[3];
+    };
+
+    const Table tables[] = {
+        { SP_LoadAuth, "SELECT apikey,devicetype,createdate,lastusedate,useragent FROM auth", &result->auth, { } },
+        { SP_LoadConfig, "SELECT key,value FROM config2", &result->config, { } },
+        { SP_LoadUserparameter, "SELECT key,value FROM userparameter", &result->userparameter, { "value" } },
+        { SP_LoadGroups, "SELECT * FROM groups", &result->groups, { "devicemembership", "lightsequence" } },
+        { SP_LoadResourcelinks, "SELECT * FROM resourcelinks", &result->resourcelinks, { "json" } },
+        { SP_LoadScenes, "SELECT * FROM scenes", &result->scenes, { "lights" } },
+        { SP_LoadRules, "SELECT * FROM rules", &result->rules, { "actions", "conditions" } },
+        { SP_LoadSchedules, "SELECT * FROM schedules", &result->schedules, { "json" } },
+        { SP_LoadSensors, "SELECT * FROM sensors", &result->sensors, { "state", "config", "fingerprint" } }
+    };
+
+    DB_Preload preload;
+    if (mode == SS_Parallel)
+    {
+        std::vector<std::string> queries;
+        for (const Table &table : tables)
+        {
+            queries.push_back(table.sql);
+        }
+        preload.start(dbPath, queries);
+    }
+
+    {
+        SP_Scope startupScope(SP_DdfScan);
+        exec(db, "select DISTINCT RI.value as a, RI2.value as b"
+                 " from resource_items RI"
+                 " join resource_items RI2 on RI2.sub_device_id = RI.sub_device_id"
+                 " WHERE RI.item = 'attr/modelid' and RI2.item = 'attr/manufacturername'", &rows);
+        exec(db, "select DISTINCT modelid, manufacturername from sensors WHERE type LIKE 'ZHA%'", &rows);
+        result->identifiers = rows.size();
+        rows.clear();
+    }
+
+    {
+        SP_Scope startupScope(SP_DdfParse);
+        std::vector<std::string> paths;
+        SS_ListDdfFiles(ddfDir, &paths);
+        result->ddfFiles = paths.size();
+
+        // same batching as DeviceDescriptions::readAllRawJson()
+        const size_t batchSize = 64;
+        for (size_t batch = 0; batch < paths.size(); batch += batchSize)
+        {
+            const size_t count = std::min(batchSize, paths.size() - batch);
+            std::vector<SS_DdfFile> files(count);
+            for (size_t i = 0; i < count; i++)
+            {
+                files[i].path = paths[batch + i];
+            }
+
+            if (mode == SS_Parallel)
+            {
+                ParallelFor(count, ParallelThreadCount(), [&files](size_t i) { readDdfFile(&files[i]); });
+            }
+            else
+            {
+                for (SS_DdfFile &file : files)
+                {
+                    readDdfFile(&file);
+                }
+            }
+
+            for (SS_DdfFile &file : files)
+            {
+                constructDdf(file, result);
+            }
+        }
+    }
+
+    {
+        SP_Scope startupScope(SP_DdfBundles); // no bundles in the source tree
+    }
+
+    for (const Table &table : tables)
+    {
+        SP_Scope startupScope(table.phase);
+        rows.clear();
+
+        DB_PreloadResult preloaded;
+        if (preload.take(table.sql, &preloaded) && preloaded.rc == SQLITE_OK)
+        {
+            DB_ReplayRows(preloaded, rowCallback, &rows);
+        }
+        else
+        {
+            exec(db, table.sql, &rows);
+        }
+        *table.count = rows.size();
+
+        for (const SS_Row &row : rows)
+        {
+            for (const char *column : table.jsonColumns)
+            {
+                if (column)
+                {
+                    parseColumn(row, column, result);
+                }
+            }
+        }
+    }
+    preload.finish();
+
+    {
+        SP_Scope startupScope(SP_LoadAlarmSystems);
+        rows.clear();
+        exec(db, "SELECT uniqueid,as_id,flags FROM alarm_systems_devices", &rows);
+        result->alarmDevices = rows.size();
+    }
+
+    sqlite3_close(db);
+    duk_destroy_heap(js);
+    return true;
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef STARTUP_SIM_H
+#define STARTUP_SIM_H
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "aps_sim.h"
+
+/*! Headless replay of the plugin startup sequence.
+
+    The plugin constructor needs Qt and the deCONZ core, this runs the same steps with the
+    same SQL, row callbacks and JSON parsing against a fixture database so that changes to
+    the startup path can be benchmarked. Each step is recorded as startup_profile.h phase.
+
+    SS_Parallel uses DB_Preload and ParallelFor() like the plugin does, SS_Sequential is
+    the startup before both were introduced.
+ */
+
+enum SS_Mode
+{
+    SS_Sequential,
+    SS_Parallel
+};
+
+struct SS_FixtureConfig
+{
+    size_t devices = 250;
+    size_t groups = 40;
+    size_t scenesPerGroup = 6;
+    size_t rules = 80;
+    size_t schedules = 20;
+    size_t resourcelinks = 10;
+    size_t itemsPerSubDevice = 12; //! resource_items rows
+};
+
+/*! Row of a sqlite3_exec() callback, the plugin builds QVariantMaps from the same data. */
+typedef std::map<std::string, std::string> SS_Row;
+
+struct SS_Result
+{
+    size_t auth = 0;
+    size_t config = 0;
+    size_t userparameter = 0;
+    size_t groups = 0;
+    size_t resourcelinks = 0;
+    size_t scenes = 0;
+    size_t rules = 0;
+    size_t schedules = 0;
+    size_t sensors = 0;
+    size_t alarmDevices = 0;
+    size_t identifiers = 0;   //! distinct modelid/manufacturer pairs of DDF_LoadRecords
+    size_t ddfFiles = 0;
+    size_t ddfParsed = 0;
+    size_t ddfModels = 0;     //! modelid entries of the parsed DDFs
+    size_t jsonErrors = 0;    //! JSON columns which failed to parse
+    bool jsInit = false;
+};
+
+bool SS_CreateFixtureDb(const char *path, const std::vector<APS_SimProfile> &profiles, const SS_FixtureConfig &config);
+bool SS_RunStartup(const char *dbPath, const char *ddfDir, SS_Result *result, SS_Mode mode = SS_Sequential);
+void SS_ListDdfFiles(const char *dir, std::vector<std::string> *files);
+bool SS_ParseJson(const std::string &json);
+
+#endif // STARTUP_SIM_H
@@ -0,0 +1,293 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include "timer_wheel.h"
+
+#define TW_INDEX_BITS 20
+#define TW_INDEX_MASK ((1u << TW_INDEX_BITS) - 1)
+#define TW_GENERATION_MASK ((1u << (32 - TW_INDEX_BITS)) - 1)
+
+static int TW_LowestBit(uint64_t x)
+{
+    int n = 0;
+    while ((x & 1) == 0)
+    {
+        x >>= 1;
+        n++;
+    }
+    return n;
+}
+
+TimerWheel::TimerWheel(int64_t now, int64_t tickMs) :
+    m_tick(now / (tickMs > 0 ? tickMs : 1)),
+    m_tickMs(tickMs > 0 ? tickMs : 1)
+{
+}
+
+/*! Starts a timer which expires at monotonic time \p due.
+    \returns the timer id or 0 if the wheel is full.
+ */
+TimerWheel::Id TimerWheel::start(int64_t due, uint64_t tag)
+{
+    uint32_t idx;
+    if (!m_free.empty())
+    {
+        idx = m_free.back();
+        m_free.pop_back();
+    }
+    else if (m_nodes.size() < TW_INDEX_MASK)
+    {
+        idx = uint32_t(m_nodes.size());
+        m_nodes.emplace_back();
+    }
+    else
+    {
+        return 0;
+    }
+
+    Node &node = m_nodes[idx];
+    // round up, a timer never expires early
+    node.dueTick = (due + m_tickMs - 1) / m_tickMs;
+    node.tag = tag;
+    link(idx);
+    m_count++;
+
+    return (uint32_t(node.generation & TW_GENERATION_MASK) << TW_INDEX_BITS) | (idx + 1);
+}
+
+/*! Cancels timer \p id.
+    \returns false if the timer isn't active (expired or already cancelled).
+ */
+bool TimerWheel::cancel(Id id)
+{
+    if (!isActive(id))
+    {
+        return false;
+    }
+
+    const uint32_t idx = (id & TW_INDEX_MASK) - 1;
+    unlink(idx);
+    m_nodes[idx].generation++;
+    m_free.push_back(idx);
+    m_count--;
+    return true;
+}
+
+bool TimerWheel::isActive(Id id) const
+{
+    const uint32_t idx = id & TW_INDEX_MASK;
+    if (idx == 0 || idx > m_nodes.size())
+    {
+        return false;
+    }
+
+    const Node &node = m_nodes[idx - 1];
+    return node.slot >= 0 && (node.generation & TW_GENERATION_MASK) == (id >> TW_INDEX_BITS);
+}
+
+/*! Advances the wheel to \p now and appends the tags of all expired timers to \p tags.
+    \returns the number of expired timers.
+ */
+size_t TimerWheel::expire(int64_t now, std::vector<uint64_t> &tags)
+{
+    const int64_t target = now / m_tickMs;
+    size_t result = 0;
+
+    while (m_tick <= target)
+    {
+        const int pos = int(m_tick & (Slots - 1));
+        const uint64_t ahead = m_occupied[0] >> pos;
+
+        if (ahead == 0)
+        {
+            // nothing left in this round of level 0, jump to the next cascade
+            const int64_t boundary = (m_tick | (Slots - 1)) + 1;
+            m_tick = boundary > target ? target + 1 : boundary;
+            if (m_tick == boundary)
+            {
+                cascade(1);
+            }
+            continue;
+        }
+
+        const int64_t tick = m_tick + TW_LowestBit(ahead);
+        if (tick > target)
+        {
+            m_tick = target + 1;
+            break;
+        }
+
+        m_tick = tick;
+        const int slot = int(m_tick & (Slots - 1));
+        uint32_t n = m_head[slot];
+
+        while (n)
+        {
+            const uint32_t idx = n - 1;
+            n = m_nodes[idx].next;
+            unlink(idx);
+
+            if (m_nodes[idx].dueTick > m_tick)
+            {
+                link(idx); // clamped far timer, not yet due
+                continue;
+            }
+
+            tags.push_back(m_nodes[idx].tag);
+            m_nodes[idx].generation++;
+            m_free.push_back(idx);
+            m_count--;
+            result++;
+        }
+
+        m_tick++;
+        if ((m_tick & (Slots - 1)) == 0)
+        {
+            cascade(1);
+        }
+    }
+
+    return result;
+}
+
+/*! Sets \p due to a lower bound of the next expiry, the wheel needs to be advanced then.
+    \returns false if no timer is active.
+ */
+bool TimerWheel::nextExpiry(int64_t *due) const
+{
+    if (m_count == 0)
+    {
+        return false;
+    }
+
+    int64_t tick = -1;
+    for (int level = 0; level < Levels; level++)
+    {
+        if (m_occupied[level] == 0)
+        {
+            continue;
+        }
+
+        const int shift = level * SlotBits;
+        const int64_t block = m_tick >> shift;
+        const int pos = int(block & (Slots - 1));
+        // rotate so that bit 0 is the current slot of this level
+        const uint64_t rotated = pos == 0 ? m_occupied[level]
+                                          : (m_occupied[level] >> pos) | (m_occupied[level] << (Slots - pos));
+        int64_t t = (block + TW_LowestBit(rotated)) << shift;
+        if (level > 0 && t <= m_tick)
+        {
+            t = (block + Slots) << shift; // current slot of a higher level is cascaded next round
+        }
+
+        if (level == 0 && t < m_tick)
+        {
+            t = m_tick;
+        }
+
+        if (tick < 0 || t < tick)
+        {
+            tick = t;
+        }
+    }
+
+    *due = tick * m_tickMs;
+    return true;
+}
+
+void TimerWheel::link(uint32_t n)
+{
+    Node &node = m_nodes[n];
+    const int64_t due = node.dueTick < m_tick ? m_tick : node.dueTick;
+    const int64_t delta = due - m_tick;
+
+    int level = 0;
+    while (level < Levels - 1 && delta >= (int64_t(1) << ((level + 1) * SlotBits)))
+    {
+        level++;
+    }
+
+    int64_t t = due;
+    const int64_t maxDelta = (int64_t(1) << (Levels * SlotBits)) - 1;
+    if (delta > maxDelta)
+    {
+        t = m_tick + maxDelta; // relinked when reached
+    }
+
+    const int slot = int((t >> (level * SlotBits)) & (Slots - 1));
+    const int s = level * Slots + slot;
+
+    node.slot = int16_t(s);
+    node.prev = 0;
+    node.next = m_head[s];
+    if (node.next)
+    {
+        m_nodes[node.next - 1].prev = n + 1;
+    }
+    m_head[s] = n + 1;
+    m_occupied[level] |= uint64_t(1) << slot;
+}
+
+void TimerWheel::unlink(uint32_t n)
+{
+    Node &node = m_nodes[n];
+    const int s = node.slot;
+
+    if (node.prev)
+    {
+        m_nodes[node.prev - 1].next = node.next;
+    }
+    else
+    {
+        m_head[s] = node.next;
+    }
+
+    if (node.next)
+    {
+        m_nodes[node.next - 1].prev = node.prev;
+    }
+
+    if (m_head[s] == 0)
+    {
+        m_occupied[s / Slots] &= ~(uint64_t(1) << (s % Slots));
+    }
+
+    node.slot = -1;
+    node.prev = 0;
+    node.next = 0;
+}
+
+/*! Moves the timers of the current slot of \p level down, called when m_tick
+    reaches a slot boundary of the level.
+ */
+void TimerWheel::cascade(int level)
+{
+    if (level >= Levels)
+    {
+        return;
+    }
+
+    const int shift = level * SlotBits;
+    const int slot = int((m_tick >> shift) & (Slots - 1));
+
+    if (slot == 0)
+    {
+        cascade(level + 1);
+    }
+
+    uint32_t n = m_head[level * Slots + slot];
+    while (n)
+    {
+        const uint32_t idx = n - 1;
+        n = m_nodes[idx].next;
+        unlink(idx);
+        link(idx);
+    }
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*! \class TimerWheel
+
+    Hierarchical timer wheel for per-item deadlines, so that subsystems don't need to
+    poll for elapsed durations. Four levels of 64 slots each, a slot of level n covers
+    64^n ticks. Starting and cancelling a timer is O(1), timers of higher levels are
+    cascaded down once when their slot is reached.
+
+    Times are monotonic ms, each timer carries a 64-bit tag which is returned on expiry.
+ */
+class TimerWheel
+{
+public:
+    typedef uint32_t Id; //! 0 is an invalid id
+
+    enum Constants
+    {
+        Levels = 4,
+        SlotBits = 6,
+        Slots = 1 << SlotBits
+    };
+
+    explicit TimerWheel(int64_t now = 0, int64_t tickMs = 100);
+
+    Id start(int64_t due, uint64_t tag);
+    bool cancel(Id id);
+    bool isActive(Id id) const;
+    size_t expire(int64_t now, std::vector<uint64_t> &tags);
+    bool nextExpiry(int64_t *due) const;
+    size_t size() const { return m_count; }
+    int64_t tickMs() const { return m_tickMs; }
+
+private:
+    struct Node
+    {
+        int64_t dueTick = 0;
+        uint64_t tag = 0;
+        uint32_t prev = 0; //! node index + 1 in the slot list, 0 if none
+        uint32_t next = 0;
+        uint16_t generation = 0;
+        int16_t slot = -1; //! level * Slots + slot, -1 if unused
+    };
+
+    void link(uint32_t n);
+    void unlink(uint32_t n);
+    void cascade(int level);
+
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_free;
+    uint32_t m_head[Levels * Slots] = {}; //! node index + 1 of the first node per slot
+    uint64_t m_occupied[Levels] = {};     //! bit per non-empty slot
+    int64_t m_tick;                       //! next tick to process
+    int64_t m_tickMs;
+    size_t m_count = 0;
+};
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include "tuya_dp.h"
+
+static uint32_t readBigEndian(const uint8_t *p, unsigned length)
+{
+    uint32_t result = 0;
+    for (unsigned i = 0; i < length; i++)
+    {
+        result = (result << 8) | p[i];
+    }
+    return result;
+}
+
+/*! Decodes all datapoints of a Tuya TY_DATA_REPORT, TY_DATA_RESPONSE or
+    TY_DATA_STATUS_SEARCH payload.
+
+        seq U16 | (dpid U8 | type U8 | length U16 | value[length])*
+
+    Decoding stops at the first malformed datapoint, the ones before are still valid.
+    \returns true if at least one datapoint was decoded.
+ */
+bool TY_DecodeDataPoints(const uint8_t *payload, size_t size, TY_DataPoints *out)
+{
+    out->count = 0;
+    out->complete = false;
+    out->index.fill(0);
+
+    if (size < 2)
+    {
+        return false;
+    }
+
+    out->seq = uint16_t(readBigEndian(payload, 2));
+
+    size_t pos = 2;
+
+    while (pos < size)
+    {
+        if (size - pos < 4 || out->count == TY_DataPoints::MaxDataPoints)
+        {
+            return out->count > 0;
+        }
+
+        TY_DataPoint &dp = out->dp[out->count];
+        dp.dpid = payload[pos];
+        dp.type = payload[pos + 1];
+        dp.length = uint16_t(readBigEndian(&payload[pos + 2], 2));
+        dp.offset = uint16_t(pos + 4);
+        dp.value = 0;
+
+        if (size - dp.offset < dp.length)
+        {
+            return out->count > 0;
+        }
+
+        const uint8_t *data = &payload[dp.offset];
+
+        switch (dp.type)
+        {
+        case TuyaDataTypeRaw:
+        case TuyaDataTypeString:
+            break;
+
+        case TuyaDataTypeBool:
+        case TuyaDataTypeEnum:
+        {
+            if (dp.length != 1)
+            {
+                return out->count > 0;
+            }
+            dp.value = data[0];
+        }
+            break;
+
+        case TuyaDataTypeValue: // docs aren't clear, assume signed
+        {
+            if (dp.length != 4)
+            {
+                return out->count > 0;
+            }
+            dp.value = int32_t(readBigEndian(data, 4));
+        }
+            break;
+
+        case TuyaDataTypeBitmap:
+        {
+            if (dp.length != 1 && dp.length != 2 && dp.length != 4)
+            {
+                return out->count > 0;
+            }
+            dp.value = readBigEndian(data, dp.length);
+        }
+            break;
+
+        default:
+            return out->count > 0; // unknown datatype, length of following datapoints can't be trusted
+        }
+
+        out->count++;
+        out->index[dp.dpid] = out->count; // later duplicates win, as if each was applied in order
+        pos = dp.offset + dp.length;
+    }
+
+    out->complete = true;
+    return out->count > 0;
+}
+
+/*! Returns the datapoint with \p dpid or nullptr if the frame doesn't contain it.
+ */
+const TY_DataPoint *TY_FindDataPoint(const TY_DataPoints &dps, uint8_t dpid)
+{
+    const uint8_t pos = dps.index[dpid];
+    return pos > 0 ? &dps.dp[pos - 1] : nullptr;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef TUYA_DP_H
+#define TUYA_DP_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+enum TuyaDataType : unsigned char
+{
+    TuyaDataTypeRaw              = 0x00,
+    TuyaDataTypeBool             = 0x01,
+    TuyaDataTypeValue            = 0x02,
+    TuyaDataTypeString           = 0x03,
+    TuyaDataTypeEnum             = 0x04,
+    TuyaDataTypeBitmap           = 0x05
+};
+
+/*! A single decoded Tuya datapoint.
+
+    Numeric types (bool, enum, value, bitmap) are converted from big endian into
+    `value`. Raw and string datapoints reference `length` bytes at `offset` in the
+    ZCL payload which was decoded.
+ */
+struct TY_DataPoint
+{
+    int64_t value;
+    uint16_t offset;
+    uint16_t length;
+    uint8_t dpid;
+    uint8_t type;
+};
+
+/*! All datapoints of a Tuya data report/response frame.
+
+    A frame is decoded once by TY_DecodeDataPoints(), each parse handler then looks
+    up its DPID via TY_FindDataPoint() instead of walking the whole payload.
+ */
+struct TY_DataPoints
+{
+    enum Constants { MaxDataPoints = 64 };
+
+    uint16_t seq = 0;
+    uint8_t count = 0;
+    bool complete = false; //! false if the payload was truncated or contains unknown types
+    std::array<uint8_t, 256> index; //! DPID -> position + 1, 0 if not present
+    std::array<TY_DataPoint, MaxDataPoints> dp;
+};
+
+bool TY_DecodeDataPoints(const uint8_t *payload, size_t size, TY_DataPoints *out);
+const TY_DataPoint *TY_FindDataPoint(const TY_DataPoints &dps, uint8_t dpid);
+
+#endif // TUYA_DP_H
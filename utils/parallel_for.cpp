@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "parallel_for.h"
+
+size_t ParallelThreadCount(void)
+{
+    const size_t n = std::thread::hardware_concurrency();
+    return std::max<size_t>(1, std::min<size_t>(n, PARALLEL_MAX_THREADS));
+}
+
+void ParallelFor(size_t count, size_t maxThreads, const std::function<void(size_t)> &fn)
+{
+    std::atomic<size_t> next{0};
+
+    const auto worker = [&]()
+    {
+        for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1))
+        {
+            fn(i);
+        }
+    };
+
+    const size_t threads = std::min(count, std::max<size_t>(1, maxThreads));
+    std::vector<std::thread> helpers;
+    helpers.reserve(threads);
+
+    for (size_t t = 1; t < threads; t++)
+    {
+        helpers.emplace_back(worker);
+    }
+
+    worker();
+
+    for (std::thread &t : helpers)
+    {
+        t.join();
+    }
+}
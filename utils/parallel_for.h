@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <cstddef>
+#include <functional>
+
+#define PARALLEL_MAX_THREADS 4 // gateways have up to 4 cores
+
+/* Calls fn(i) for i in [0, count) on up to maxThreads threads including the calling one,
+   returns after all calls are done. fn must only touch data of its index, the scratch
+   memory, atom table and the plugin state are off limits. */
+void ParallelFor(size_t count, size_t maxThreads, const std::function<void(size_t)> &fn);
+size_t ParallelThreadCount(void);
+
+#endif // PARALLEL_FOR_H
@@ -54,3 +54,9 @@ void ScratchMemRewind(unsigned long pos)
         scratch_arena.size = pos;
     }
 }
+
+/* reserved size of the scratch arena */
+unsigned long ScratchMemSize(void)
+{
+    return scratch_arena._total_size;
+}
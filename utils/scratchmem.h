@@ -16,6 +16,7 @@ void ScratchMemDestroy(void);
 unsigned long ScratchMemPos(void);
 void *ScratchMemAlloc(unsigned long);
 void ScratchMemRewind(unsigned long);
+unsigned long ScratchMemSize(void);
 
 
 #define SCRATCH_ALLOC(type, size) (static_cast<type>(ScratchMemAlloc(size)))
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef SLAB_VECTOR_H
+#define SLAB_VECTOR_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*! \class SlabVector
+
+    A sequence container with a std::vector like interface whose elements never move.
+
+    Elements are stored in fixed size chunks which are allocated on demand. Unlike
+    std::vector, push_back() doesn't invalidate pointers or references to existing elements,
+    so these can be held by other parts of the code for the lifetime of the container.
+
+    Each slot carries a generation counter which is incremented when the element in the slot
+    is destroyed (pop_back(), clear()). A (index, generation) pair therefore identifies an
+    element and can be checked with isValid() before use.
+ */
+template <typename T, size_t ChunkSize = 64>
+class SlabVector
+{
+    static_assert(ChunkSize > 0, "ChunkSize must be > 0");
+
+    using Storage = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+    struct Chunk
+    {
+        Storage items[ChunkSize];
+        uint16_t generation[ChunkSize] = {};
+    };
+
+public:
+    template <typename V, typename C>
+    class Iterator
+    {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = typename std::remove_const<V>::type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = V*;
+        using reference = V&;
+
+        Iterator() = default;
+        Iterator(C *c, size_t i) : m_c(c), m_i(i) { }
+        // allow iterator -> const_iterator conversion
+        template <typename V2, typename C2, typename = typename std::enable_if<std::is_convertible<V2*, V*>::value>::type>
+        Iterator(const Iterator<V2, C2> &other) : m_c(other.m_c), m_i(other.m_i) { }
+
+        reference operator*() const { return (*m_c)[m_i]; }
+        pointer operator->() const { return &(*m_c)[m_i]; }
+        reference operator[](difference_type n) const { return (*m_c)[m_i + n]; }
+
+        Iterator &operator++() { ++m_i; return *this; }
+        Iterator operator++(int) { Iterator t = *this; ++m_i; return t; }
+        Iterator &operator--() { --m_i; return *this; }
+        Iterator operator--(int) { Iterator t = *this; --m_i; return t; }
+        Iterator &operator+=(difference_type n) { m_i += n; return *this; }
+        Iterator &operator-=(difference_type n) { m_i -= n; return *this; }
+        Iterator operator+(difference_type n) const { return Iterator(m_c, m_i + n); }
+        Iterator operator-(difference_type n) const { return Iterator(m_c, m_i - n); }
+        friend Iterator operator+(difference_type n, const Iterator &it) { return it + n; }
+        difference_type operator-(const Iterator &rhs) const { return difference_type(m_i) - difference_type(rhs.m_i); }
+
+        bool operator==(const Iterator &rhs) const { return m_i == rhs.m_i; }
+        bool operator!=(const Iterator &rhs) const { return m_i != rhs.m_i; }
+        bool operator<(const Iterator &rhs) const { return m_i < rhs.m_i; }
+        bool operator>(const Iterator &rhs) const { return m_i > rhs.m_i; }
+        bool operator<=(const Iterator &rhs) const { return m_i <= rhs.m_i; }
+        bool operator>=(const Iterator &rhs) const { return m_i >= rhs.m_i; }
+
+        /*! Returns the container index of the element. */
+        size_t index() const { return m_i; }
+
+    private:
+        template <typename, typename> friend class Iterator;
+        C *m_c = nullptr;
+        size_t m_i = 0;
+    };
+
+    using value_type = T;
+    using size_type = size_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using iterator = Iterator<T, SlabVector>;
+    using const_iterator = Iterator<const T, const SlabVector>;
+
+    SlabVector() = default;
+    SlabVector(const SlabVector &) = delete;
+    SlabVector &operator=(const SlabVector &) = delete;
+    SlabVector(SlabVector &&other) noexcept :
+        m_chunks(std::move(other.m_chunks)),
+        m_size(other.m_size)
+    {
+        other.m_size = 0;
+    }
+
+    ~SlabVector()
+    {
+        clear();
+    }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    size_t capacity() const { return m_chunks.size() * ChunkSize; }
+
+    /*! Preallocates chunks for at least \p n elements, existing elements aren't touched. */
+    void reserve(size_t n)
+    {
+        while (capacity() < n)
+        {
+            m_chunks.emplace_back(new Chunk);
+        }
+    }
+
+    T &operator[](size_t i)
+    {
+        assert(i < m_size);
+        return *reinterpret_cast<T*>(&m_chunks[i / ChunkSize]->items[i % ChunkSize]);
+    }
+
+    const T &operator[](size_t i) const
+    {
+        assert(i < m_size);
+        return *reinterpret_cast<const T*>(&m_chunks[i / ChunkSize]->items[i % ChunkSize]);
+    }
+
+    T &front() { return (*this)[0]; }
+    const T &front() const { return (*this)[0]; }
+    T &back() { return (*this)[m_size - 1]; }
+    const T &back() const { return (*this)[m_size - 1]; }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, m_size); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, m_size); }
+    const_iterator cbegin() const { return const_iterator(this, 0); }
+    const_iterator cend() const { return const_iterator(this, m_size); }
+
+    void push_back(const T &val) { emplace_back(val); }
+    void push_back(T &&val) { emplace_back(std::move(val)); }
+
+    template <typename... Args>
+    T &emplace_back(Args&&... args)
+    {
+        reserve(m_size + 1);
+        Chunk *chunk = m_chunks[m_size / ChunkSize].get();
+        T *p = new (&chunk->items[m_size % ChunkSize]) T(std::forward<Args>(args)...);
+        m_size++;
+        return *p;
+    }
+
+    void pop_back()
+    {
+        assert(m_size > 0);
+        m_size--;
+        Chunk *chunk = m_chunks[m_size / ChunkSize].get();
+        reinterpret_cast<T*>(&chunk->items[m_size % ChunkSize])->~T();
+        chunk->generation[m_size % ChunkSize]++;
+    }
+
+    /*! Destroys all elements, allocated chunks are kept for reuse. */
+    void clear()
+    {
+        while (m_size > 0)
+        {
+            pop_back();
+        }
+    }
+
+    /*! Returns the generation of the slot at \p i, also valid for yet unused slots. */
+    uint16_t generation(size_t i) const
+    {
+        if (i < capacity())
+        {
+            return m_chunks[i / ChunkSize]->generation[i % ChunkSize];
+        }
+        return 0;
+    }
+
+    /*! Returns true if \p i refers to a live element of generation \p gen. */
+    bool isValid(size_t i, uint16_t gen) const
+    {
+        return i < m_size && generation(i) == gen;
+    }
+
+private:
+    std::vector<std::unique_ptr<Chunk>> m_chunks;
+    size_t m_size = 0;
+};
+
+#endif // SLAB_VECTOR_H
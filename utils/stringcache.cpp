@@ -63,3 +63,33 @@ bool StringCacheGet(unsigned handle, const char **str, unsigned *length)
     *length = 0;
     return false;
 }
+
+/*! Returns the bytes of all strings in the atom table.
+
+    Atom indices are handed out consecutively starting at 1, the first index
+    without atom ends the walk.
+ */
+unsigned long StringCacheMemoryUsage(unsigned *count)
+{
+    unsigned long bytes = 0;
+    AT_AtomIndex ati;
+    ati.index = 1;
+
+    for (;; ati.index++)
+    {
+        const AT_Atom atom = AT_GetAtomByIndex(ati);
+        if (atom.len == 0 || !atom.data)
+        {
+            break;
+        }
+
+        bytes += atom.len + 1; // '\0' terminated
+    }
+
+    if (count)
+    {
+        *count = ati.index - 1;
+    }
+
+    return bytes;
+}
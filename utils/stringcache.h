@@ -31,5 +31,6 @@ enum StringCacheMode
  */
 unsigned StringCacheAdd(const char *str, unsigned length, StringCacheMode mode);
 bool StringCacheGet(unsigned handle, const char **str, unsigned *length);
+unsigned long StringCacheMemoryUsage(unsigned *count);
 
 #endif // STRING_CACHE_H
@@ -0,0 +1,578 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <array>
+#include <string.h>
+#include "deconz/dbg_trace.h"
+#include "utils/targz.h"
+
+#ifdef HAS_ZLIB
+#include <zlib.h>
+#endif
+
+#define TAR_BLOCK_SIZE 512
+#define GZ_STORED_BLOCK_MAX 65535
+
+static std::array<quint32, 256> crcTable()
+{
+    std::array<quint32, 256> table{};
+
+    for (quint32 i = 0; i < 256; i++)
+    {
+        quint32 c = i;
+        for (int k = 0; k < 8; k++)
+        {
+            c = (c & 1) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+        }
+        table[i] = c;
+    }
+
+    return table;
+}
+
+quint32 TGZ_Crc32(quint32 crc, const char *data, size_t length)
+{
+    static const std::array<quint32, 256> table = crcTable();
+
+    crc = crc ^ 0xFFFFFFFFU;
+    for (size_t i = 0; i < length; i++)
+    {
+        crc = table[(crc ^ quint8(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFU;
+}
+
+static void putLe32(char *p, quint32 val)
+{
+    p[0] = char(val & 0xFF);
+    p[1] = char((val >> 8) & 0xFF);
+    p[2] = char((val >> 16) & 0xFF);
+    p[3] = char((val >> 24) & 0xFF);
+}
+
+static quint32 getLe32(const char *p)
+{
+    return quint32(quint8(p[0])) | quint32(quint8(p[1])) << 8 | quint32(quint8(p[2])) << 16 | quint32(quint8(p[3])) << 24;
+}
+
+/*! Writes \p value as zero padded octal number with terminating NUL into \p field. */
+static void putOctal(char *field, size_t fieldSize, quint64 value)
+{
+    memset(field, '0', fieldSize - 1);
+    field[fieldSize - 1] = '\0';
+
+    for (size_t i = fieldSize - 1; i > 0 && value; i--)
+    {
+        field[i - 1] = char('0' + (value & 7));
+        value >>= 3;
+    }
+}
+
+static quint64 getOctal(const char *field, size_t fieldSize)
+{
+    quint64 value = 0;
+    for (size_t i = 0; i < fieldSize; i++)
+    {
+        if (field[i] >= '0' && field[i] <= '7')
+        {
+            value = (value << 3) | quint64(field[i] - '0');
+        }
+        else if (field[i] == '\0' || (field[i] == ' ' && value != 0))
+        {
+            break;
+        }
+    }
+    return value;
+}
+
+class TarGzWriterPrivate
+{
+public:
+    bool writeDeflate(const char *data, qint64 length, bool finish);
+    bool writeHeader(const QByteArray &name, qint64 size, qint64 mtime, char type);
+
+    QFile file;
+    quint32 crc = 0;
+    quint32 inputSize = 0; // modulo 2^32 as specified by gzip
+    qint64 fileRemaining = 0;
+    qint64 filePadding = 0;
+    bool isOpen = false;
+#ifdef HAS_ZLIB
+    z_stream zs{};
+#endif
+};
+
+bool TarGzWriterPrivate::writeDeflate(const char *data, qint64 length, bool finish)
+{
+    crc = TGZ_Crc32(crc, data, size_t(length));
+    inputSize += quint32(length);
+
+#ifdef HAS_ZLIB
+    char out[16384];
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    zs.avail_in = uInt(length);
+
+    do
+    {
+        zs.next_out = reinterpret_cast<Bytef*>(out);
+        zs.avail_out = sizeof(out);
+        const int ret = deflate(&zs, finish ? Z_FINISH : Z_NO_FLUSH);
+        if (ret == Z_STREAM_ERROR)
+        {
+            return false;
+        }
+
+        const qint64 n = qint64(sizeof(out) - zs.avail_out);
+        if (n > 0 && file.write(out, n) != n)
+        {
+            return false;
+        }
+    } while (zs.avail_out == 0);
+
+    return true;
+#else
+    // uncompressed deflate blocks (RFC 1951 BTYPE=00)
+    while (length > 0)
+    {
+        const quint16 n = quint16(qMin<qint64>(length, GZ_STORED_BLOCK_MAX));
+        const char hdr[5] = { 0x00, char(n & 0xFF), char(n >> 8), char(~n & 0xFF), char((~n >> 8) & 0xFF) };
+        if (file.write(hdr, sizeof(hdr)) != sizeof(hdr) || file.write(data, n) != n)
+        {
+            return false;
+        }
+        data += n;
+        length -= n;
+    }
+
+    if (finish)
+    {
+        const char hdr[5] = { 0x01, 0x00, 0x00, char(0xFF), char(0xFF) }; // empty final block
+        return file.write(hdr, sizeof(hdr)) == sizeof(hdr);
+    }
+
+    return true;
+#endif
+}
+
+TarGzWriter::TarGzWriter() :
+    d(new TarGzWriterPrivate)
+{
+}
+
+TarGzWriter::~TarGzWriter()
+{
+    if (d->isOpen)
+    {
+        abort();
+    }
+}
+
+bool TarGzWriter::open(const QString &path)
+{
+    if (d->isOpen)
+    {
+        return false;
+    }
+
+    d->file.setFileName(path);
+    if (!d->file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        DBG_Printf(DBG_ERROR, "targz: failed to open %s\n", qPrintable(path));
+        return false;
+    }
+
+#ifdef HAS_ZLIB
+    d->zs = z_stream{};
+    if (deflateInit2(&d->zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15 /* raw */, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        d->file.close();
+        return false;
+    }
+#endif
+
+    // gzip member header RFC 1952, no optional fields, OS = Unix
+    const char hdr[10] = { 0x1f, char(0x8b), 0x08, 0x00, 0, 0, 0, 0, 0x00, 0x03 };
+    if (d->file.write(hdr, sizeof(hdr)) != sizeof(hdr))
+    {
+        abort();
+        return false;
+    }
+
+    d->crc = 0;
+    d->inputSize = 0;
+    d->fileRemaining = 0;
+    d->filePadding = 0;
+    d->isOpen = true;
+    return true;
+}
+
+bool TarGzWriterPrivate::writeHeader(const QByteArray &name, qint64 size, qint64 mtime, char type)
+{
+    char hdr[TAR_BLOCK_SIZE];
+    memset(hdr, 0, sizeof(hdr));
+
+    memcpy(&hdr[0], name.constData(), size_t(qMin(name.size(), 99))); // name
+    putOctal(&hdr[100], 8, 0644);                // mode
+    putOctal(&hdr[108], 8, 0);                   // uid
+    putOctal(&hdr[116], 8, 0);                   // gid
+    putOctal(&hdr[124], 12, quint64(size));      // size
+    putOctal(&hdr[136], 12, quint64(qMax<qint64>(0, mtime))); // mtime
+    hdr[156] = type;
+    memcpy(&hdr[257], "ustar", 6);               // magic
+    memcpy(&hdr[263], "00", 2);                  // version
+
+    // checksum is calculated with the checksum field filled with spaces
+    memset(&hdr[148], ' ', 8);
+    unsigned chksum = 0;
+    for (size_t i = 0; i < sizeof(hdr); i++)
+    {
+        chksum += quint8(hdr[i]);
+    }
+    putOctal(&hdr[148], 7, chksum);
+    hdr[155] = ' ';
+
+    return writeDeflate(hdr, sizeof(hdr), false);
+}
+
+bool TarGzWriter::beginFile(const QString &name, qint64 size, qint64 mtime)
+{
+    const QByteArray name8 = name.toUtf8();
+
+    if (!d->isOpen || d->fileRemaining != 0 || name8.isEmpty() || size < 0)
+    {
+        return false;
+    }
+
+    if (name8.size() >= 100)
+    {
+        // GNU tar long name entry, the name is stored as data including the terminating NUL
+        const qint64 length = name8.size() + 1;
+        const char zeros[TAR_BLOCK_SIZE] = { 0 };
+        if (!d->writeHeader(QByteArray("././@LongLink"), length, 0, 'L') ||
+            !d->writeDeflate(name8.constData(), length, false) ||
+            !d->writeDeflate(zeros, (TAR_BLOCK_SIZE - (length % TAR_BLOCK_SIZE)) % TAR_BLOCK_SIZE, false))
+        {
+            return false;
+        }
+    }
+
+    d->fileRemaining = size;
+    d->filePadding = (TAR_BLOCK_SIZE - (size % TAR_BLOCK_SIZE)) % TAR_BLOCK_SIZE;
+    return d->writeHeader(name8, size, mtime, '0');
+}
+
+bool TarGzWriter::write(const char *data, qint64 length)
+{
+    if (!d->isOpen || length > d->fileRemaining)
+    {
+        return false;
+    }
+
+    d->fileRemaining -= length;
+    return d->writeDeflate(data, length, false);
+}
+
+bool TarGzWriter::endFile()
+{
+    if (!d->isOpen || d->fileRemaining != 0)
+    {
+        return false;
+    }
+
+    const char zeros[TAR_BLOCK_SIZE] = { 0 };
+    const qint64 padding = d->filePadding;
+    d->filePadding = 0;
+    return d->writeDeflate(zeros, padding, false);
+}
+
+bool TarGzWriter::close()
+{
+    if (!d->isOpen || d->fileRemaining != 0)
+    {
+        abort();
+        return false;
+    }
+
+    // end of archive: two zero blocks
+    const char zeros[TAR_BLOCK_SIZE * 2] = { 0 };
+    bool ok = d->writeDeflate(zeros, sizeof(zeros), true);
+
+    char trailer[8];
+    putLe32(&trailer[0], d->crc);
+    putLe32(&trailer[4], d->inputSize);
+    ok = ok && d->file.write(trailer, sizeof(trailer)) == sizeof(trailer);
+
+#ifdef HAS_ZLIB
+    deflateEnd(&d->zs);
+#endif
+
+    ok = ok && d->file.flush();
+    d->file.close();
+    d->isOpen = false;
+    return ok;
+}
+
+void TarGzWriter::abort()
+{
+    if (d->isOpen)
+    {
+#ifdef HAS_ZLIB
+        deflateEnd(&d->zs);
+#endif
+        d->isOpen = false;
+    }
+
+    if (d->file.isOpen())
+    {
+        d->file.close();
+    }
+    d->file.remove();
+}
+
+qint64 TarGzWriter::bytesWritten() const
+{
+    return d->file.isOpen() ? d->file.pos() : d->file.size();
+}
+
+/*! Decodes a gzip member into \p out, returns false on malformed input or CRC mismatch. */
+static bool gunzip(const QByteArray &in, QByteArray &out)
+{
+    if (in.size() < 18 || quint8(in[0]) != 0x1f || quint8(in[1]) != 0x8b || in[2] != 0x08)
+    {
+        return false;
+    }
+
+    const quint8 flags = quint8(in[3]);
+    int pos = 10;
+
+    if (flags & 0x04) // FEXTRA
+    {
+        if (pos + 2 > in.size()) { return false; }
+        pos += 2 + (quint8(in[pos]) | quint8(in[pos + 1]) << 8);
+    }
+    if (flags & 0x08) // FNAME
+    {
+        pos = in.indexOf('\0', pos);
+        if (pos < 0) { return false; }
+        pos++;
+    }
+    if (flags & 0x10) // FCOMMENT
+    {
+        pos = in.indexOf('\0', pos);
+        if (pos < 0) { return false; }
+        pos++;
+    }
+    if (flags & 0x02) // FHCRC
+    {
+        pos += 2;
+    }
+
+    if (pos + 8 > in.size())
+    {
+        return false;
+    }
+
+    const quint32 expectedCrc = getLe32(in.constData() + in.size() - 8);
+    const quint32 expectedSize = getLe32(in.constData() + in.size() - 4);
+
+    out.clear();
+    out.reserve(int(expectedSize));
+
+#ifdef HAS_ZLIB
+    z_stream zs{};
+    if (inflateInit2(&zs, -15 /* raw */) != Z_OK)
+    {
+        return false;
+    }
+
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.constData() + pos));
+    zs.avail_in = uInt(in.size() - pos - 8);
+
+    char buf[16384];
+    int ret = Z_OK;
+    while (ret == Z_OK)
+    {
+        zs.next_out = reinterpret_cast<Bytef*>(buf);
+        zs.avail_out = sizeof(buf);
+        ret = inflate(&zs, Z_NO_FLUSH);
+        out.append(buf, int(sizeof(buf) - zs.avail_out));
+        if (ret == Z_BUF_ERROR && zs.avail_in == 0)
+        {
+            break;
+        }
+    }
+    inflateEnd(&zs);
+
+    if (ret != Z_STREAM_END)
+    {
+        DBG_Printf(DBG_ERROR, "targz: inflate failed %d\n", ret);
+        return false;
+    }
+#else
+    // only uncompressed deflate blocks are supported without zlib
+    const int end = in.size() - 8;
+    for (;;)
+    {
+        if (pos + 5 > end) { return false; }
+        const quint8 bhdr = quint8(in[pos]);
+        if ((bhdr & 0x06) != 0)
+        {
+            DBG_Printf(DBG_ERROR, "targz: compressed archives require zlib support\n");
+            return false;
+        }
+        const int len = quint8(in[pos + 1]) | quint8(in[pos + 2]) << 8;
+        pos += 5;
+        if (pos + len > end) { return false; }
+        out.append(in.constData() + pos, len);
+        pos += len;
+        if (bhdr & 0x01) { break; } // BFINAL
+    }
+#endif
+
+    if (quint32(out.size()) != expectedSize || TGZ_Crc32(0, out.constData(), size_t(out.size())) != expectedCrc)
+    {
+        DBG_Printf(DBG_ERROR, "targz: gzip checksum mismatch\n");
+        return false;
+    }
+
+    return true;
+}
+
+static bool isSafeEntryName(const QString &name)
+{
+    if (name.isEmpty() || name.startsWith(QLatin1Char('/')) || name.contains(QLatin1Char('\\')))
+    {
+        return false;
+    }
+
+    const QStringList parts = name.split(QLatin1Char('/'));
+    for (const QString &p : parts)
+    {
+        if (p == QLatin1String(".."))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool TGZ_Extract(const QString &archivePath, const QString &destDir, QStringList *files)
+{
+    QFile archive(archivePath);
+    if (!archive.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    QByteArray data = archive.readAll();
+    archive.close();
+
+    if (data.size() >= 2 && quint8(data[0]) == 0x1f && quint8(data[1]) == 0x8b)
+    {
+        QByteArray tar;
+        if (!gunzip(data, tar))
+        {
+            return false;
+        }
+        data = tar;
+    }
+
+    QString longName; // GNU tar 'L' entry
+    int pos = 0;
+
+    while (pos + TAR_BLOCK_SIZE <= data.size())
+    {
+        const char *hdr = data.constData() + pos;
+
+        if (hdr[0] == '\0')
+        {
+            break; // end of archive
+        }
+
+        unsigned chksum = 0;
+        for (int i = 0; i < TAR_BLOCK_SIZE; i++)
+        {
+            chksum += (i >= 148 && i < 156) ? ' ' : quint8(hdr[i]);
+        }
+
+        if (chksum != getOctal(&hdr[148], 8))
+        {
+            DBG_Printf(DBG_ERROR, "targz: invalid tar header checksum\n");
+            return false;
+        }
+
+        const qint64 size = qint64(getOctal(&hdr[124], 12));
+        const char type = hdr[156];
+        pos += TAR_BLOCK_SIZE;
+
+        if (pos + size > data.size())
+        {
+            return false;
+        }
+
+        QString name = longName;
+        longName.clear();
+
+        if (name.isEmpty())
+        {
+            name = QString::fromUtf8(&hdr[0], int(strnlen(&hdr[0], 100)));
+            if (memcmp(&hdr[257], "ustar", 5) == 0 && hdr[345] != '\0')
+            {
+                name = QString::fromUtf8(&hdr[345], int(strnlen(&hdr[345], 155))) + QLatin1Char('/') + name;
+            }
+        }
+
+        if (name.startsWith(QLatin1String("./")))
+        {
+            name = name.mid(2);
+        }
+
+        if (type == 'L')
+        {
+            longName = QString::fromUtf8(data.constData() + pos, int(strnlen(data.constData() + pos, size_t(size))));
+        }
+        else if ((type == '0' || type == '\0') && !name.isEmpty())
+        {
+            if (!isSafeEntryName(name))
+            {
+                DBG_Printf(DBG_ERROR, "targz: reject entry %s\n", qPrintable(name));
+                return false;
+            }
+
+            const QString filePath = destDir + QLatin1Char('/') + name;
+            QDir().mkpath(QFileInfo(filePath).absolutePath());
+
+            QFile f(filePath);
+            if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate) || f.write(data.constData() + pos, size) != size)
+            {
+                DBG_Printf(DBG_ERROR, "targz: failed to write %s\n", qPrintable(filePath));
+                return false;
+            }
+            f.close();
+
+            if (files)
+            {
+                files->append(name);
+            }
+        }
+        else if (type == '5' && isSafeEntryName(name))
+        {
+            QDir().mkpath(destDir + QLatin1Char('/') + name);
+        }
+
+        pos += int((size + TAR_BLOCK_SIZE - 1) / TAR_BLOCK_SIZE * TAR_BLOCK_SIZE);
+    }
+
+    return true;
+}
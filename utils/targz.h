@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef TARGZ_H
+#define TARGZ_H
+
+#include <QString>
+#include <QStringList>
+#include <memory>
+
+class TarGzWriterPrivate;
+
+/*! \class TarGzWriter
+
+    Streaming writer for .tar.gz archives (ustar format).
+
+    The archive is written incrementally, so large files can be added in small
+    chunks across multiple event loop iterations. Without zlib support the
+    gzip stream uses uncompressed deflate blocks, which is still a valid archive.
+ */
+class TarGzWriter
+{
+public:
+    TarGzWriter();
+    ~TarGzWriter();
+    bool open(const QString &path);
+    bool beginFile(const QString &name, qint64 size, qint64 mtime);
+    bool write(const char *data, qint64 length);
+    bool endFile();
+    bool close();
+    void abort();
+    qint64 bytesWritten() const;
+
+private:
+    std::unique_ptr<TarGzWriterPrivate> d;
+};
+
+/*! Extracts all regular files of a .tar.gz (or plain .tar) archive into \p destDir.
+
+    Entries with absolute paths or ".." components are rejected.
+    \p files receives the relative paths of all extracted files.
+ */
+bool TGZ_Extract(const QString &archivePath, const QString &destDir, QStringList *files = nullptr);
+
+/*! CRC-32 (ISO 3309) as used by gzip, \p crc is the value of the previous chunk or 0. */
+quint32 TGZ_Crc32(quint32 crc, const char *data, size_t length);
+
+#endif // TARGZ_H
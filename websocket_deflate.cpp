@@ -0,0 +1,352 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#ifdef HAS_ZLIB
+#include <zlib.h>
+#endif
+#include "websocket_deflate.h"
+
+class WS_DeflateEncoder::Private
+{
+public:
+    bool noContextTakeover = false;
+    bool isInit = false;
+    int windowBits = 15;
+#ifdef HAS_ZLIB
+    z_stream zs{};
+#endif
+};
+
+WS_DeflateEncoder::WS_DeflateEncoder() :
+    d(new Private)
+{
+}
+
+WS_DeflateEncoder::~WS_DeflateEncoder()
+{
+#ifdef HAS_ZLIB
+    if (d->isInit)
+    {
+        deflateEnd(&d->zs);
+    }
+#endif
+}
+
+bool WS_DeflateEncoder::init(const WS_DeflateParams &params)
+{
+#ifdef HAS_ZLIB
+    if (d->isInit)
+    {
+        deflateEnd(&d->zs);
+        d->isInit = false;
+    }
+
+    d->zs = z_stream{};
+    d->noContextTakeover = params.serverNoContextTakeover;
+    d->windowBits = params.serverMaxWindowBits;
+    // raw deflate, the window must not exceed what the client accepts
+    if (deflateInit2(&d->zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -params.serverMaxWindowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        return false;
+    }
+
+    d->isInit = true;
+    return true;
+#else
+    (void)params;
+    return false;
+#endif
+}
+
+/*! Compresses one message into \p out as payload of a frame with RSV1 set.
+ */
+bool WS_DeflateEncoder::compress(const char *data, size_t length, std::vector<uint8_t> &out)
+{
+    out.clear();
+
+#ifdef HAS_ZLIB
+    if (!d->isInit)
+    {
+        return false;
+    }
+
+    uint8_t buf[4096];
+    d->zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    d->zs.avail_in = uInt(length);
+
+    do
+    {
+        d->zs.next_out = buf;
+        d->zs.avail_out = sizeof(buf);
+        if (deflate(&d->zs, Z_SYNC_FLUSH) == Z_STREAM_ERROR)
+        {
+            return false;
+        }
+        out.insert(out.end(), buf, buf + (sizeof(buf) - d->zs.avail_out));
+    } while (d->zs.avail_out == 0);
+
+    // RFC 7692 7.2.1: remove the 0x00 0x00 0xFF 0xFF tail of the sync flush
+    if (out.size() >= 4 && out[out.size() - 4] == 0x00 && out[out.size() - 3] == 0x00 &&
+        out[out.size() - 2] == 0xFF && out[out.size() - 1] == 0xFF)
+    {
+        out.resize(out.size() - 4);
+    }
+
+    if (d->noContextTakeover)
+    {
+        deflateReset(&d->zs);
+    }
+
+    return true;
+#else
+    (void)data;
+    (void)length;
+    return false;
+#endif
+}
+
+/*! Memory of the zlib deflate state, as given in zconf.h for memLevel 8 plus
+    about 6 KB for the stream structures.
+ */
+size_t WS_DeflateEncoder::memoryUsage() const
+{
+    if (!d->isInit)
+    {
+        return 0;
+    }
+
+    return (size_t(1) << (d->windowBits + 2)) + (size_t(1) << (8 + 9)) + 6 * 1024;
+}
+
+void WS_FrameReader::feed(const uint8_t *data, size_t length)
+{
+    m_buf.insert(m_buf.end(), data, data + length);
+}
+
+/*! Takes the next complete frame from the buffer.
+    \returns false if more data is needed or on protocol error, see hasError().
+ */
+bool WS_FrameReader::next(WS_Frame *frame)
+{
+    if (m_error || m_buf.size() < 2)
+    {
+        return false;
+    }
+
+    const uint8_t b0 = m_buf[0];
+    const uint8_t b1 = m_buf[1];
+    const bool masked = (b1 & 0x80) != 0;
+    const bool rsv1 = (b0 & 0x40) != 0;
+    const uint8_t opcode = b0 & 0x0F;
+    size_t pos = 2;
+    uint64_t length = b1 & 0x7F;
+
+    if ((b0 & 0x30) || masked != m_requireMask ||
+        (rsv1 && (!m_compression || opcode == WS_OPCODE_CONTINUATION || opcode >= WS_OPCODE_CLOSE)))
+    {
+        m_error = true; // RSV2, RSV3 or RSV1 without negotiated extension or not on the first data frame
+        return false;
+    }
+
+    if (length == 126)
+    {
+        if (m_buf.size() < pos + 2) { return false; }
+        length = (uint64_t(m_buf[2]) << 8) | m_buf[3];
+        pos += 2;
+    }
+    else if (length == 127)
+    {
+        if (m_buf.size() < pos + 8) { return false; }
+        length = 0;
+        for (int i = 0; i < 8; i++)
+        {
+            length = (length << 8) | m_buf[pos + size_t(i)];
+        }
+        pos += 8;
+    }
+
+    if (length > WS_MAX_FRAME_SIZE || (opcode >= WS_OPCODE_CLOSE && length > 125))
+    {
+        m_error = true;
+        return false;
+    }
+
+    uint8_t mask[4] = { };
+    if (masked)
+    {
+        if (m_buf.size() < pos + 4) { return false; }
+        memcpy(mask, &m_buf[pos], 4);
+        pos += 4;
+    }
+
+    if (m_buf.size() < pos + length)
+    {
+        return false;
+    }
+
+    frame->opcode = opcode;
+    frame->fin = (b0 & 0x80) != 0;
+    frame->rsv1 = rsv1;
+    frame->payload.assign(m_buf.begin() + long(pos), m_buf.begin() + long(pos + length));
+    if (masked)
+    {
+        for (size_t i = 0; i < frame->payload.size(); i++)
+        {
+            frame->payload[i] ^= mask[i & 3];
+        }
+    }
+
+    m_buf.erase(m_buf.begin(), m_buf.begin() + long(pos + length));
+    return true;
+}
+
+/*! Appends an unmasked server frame to \p out.
+ */
+void WS_EncodeFrame(uint8_t opcode, bool rsv1, const uint8_t *payload, size_t length, std::vector<uint8_t> &out)
+{
+    out.push_back(uint8_t(0x80 | (rsv1 ? 0x40 : 0x00) | (opcode & 0x0F)));
+
+    if (length < 126)
+    {
+        out.push_back(uint8_t(length));
+    }
+    else if (length <= 0xFFFF)
+    {
+        out.push_back(126);
+        out.push_back(uint8_t(length >> 8));
+        out.push_back(uint8_t(length));
+    }
+    else
+    {
+        out.push_back(127);
+        for (int i = 7; i >= 0; i--)
+        {
+            out.push_back(uint8_t(uint64_t(length) >> (i * 8)));
+        }
+    }
+
+    out.insert(out.end(), payload, payload + length);
+}
+
+bool WS_IsDeflateSupported()
+{
+#ifdef HAS_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+static std::string trimmed(const char *begin, const char *end)
+{
+    while (begin < end && (*begin == ' ' || *begin == '\t')) { begin++; }
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t')) { end--; }
+    if (end - begin >= 2 && *begin == '"' && end[-1] == '"') { begin++; end--; }
+    return std::string(begin, end);
+}
+
+/*! Parses one extension offer like "permessage-deflate; client_max_window_bits".
+    \returns false if the offer isn't permessage-deflate or has parameters which aren't supported.
+ */
+static bool parseDeflateOffer(const char *begin, const char *end, WS_DeflateParams *params, std::string *response)
+{
+    const char *p = begin;
+    const char *semi = std::find(p, end, ';');
+
+    if (trimmed(p, semi) != "permessage-deflate")
+    {
+        return false;
+    }
+
+    WS_DeflateParams result;
+    std::string rsp = "permessage-deflate";
+    bool seen[4] = { };
+
+    for (p = semi; p < end; p = semi)
+    {
+        p++; // skip ';'
+        semi = std::find(p, end, ';');
+        const char *eq = std::find(p, semi, '=');
+        const std::string name = trimmed(p, eq);
+        const std::string value = eq < semi ? trimmed(eq + 1, semi) : std::string();
+
+        int idx = -1;
+        if (name == "server_no_context_takeover" && value.empty())
+        {
+            idx = 0;
+            result.serverNoContextTakeover = true;
+            rsp += "; server_no_context_takeover";
+        }
+        else if (name == "client_no_context_takeover" && value.empty())
+        {
+            idx = 1;
+            result.clientNoContextTakeover = true;
+            rsp += "; client_no_context_takeover";
+        }
+        else if (name == "server_max_window_bits")
+        {
+            idx = 2;
+            const int bits = value.size() == 1 || value.size() == 2 ? atoi(value.c_str()) : 0;
+            if (bits < 9 || bits > 15)
+            {
+                return false; // 8 isn't supported by zlib raw deflate
+            }
+            result.serverMaxWindowBits = bits;
+            rsp += "; server_max_window_bits=" + value;
+        }
+        else if (name == "client_max_window_bits")
+        {
+            idx = 3; // hint only, received messages are never compressed by the server
+            if (!value.empty() && (atoi(value.c_str()) < 8 || atoi(value.c_str()) > 15))
+            {
+                return false;
+            }
+        }
+
+        if (idx == -1 || seen[idx])
+        {
+            return false;
+        }
+        seen[idx] = true;
+    }
+
+    *params = result;
+    *response = rsp;
+    return true;
+}
+
+/*! Selects the first acceptable permessage-deflate offer of a Sec-WebSocket-Extensions header.
+    \p response is set to the Sec-WebSocket-Extensions value of the handshake response.
+    \returns false if no offer is acceptable or compression isn't available, the connection
+             then continues without extension.
+ */
+bool WS_NegotiateDeflate(const char *offer, size_t length, WS_DeflateParams *params, std::string *response)
+{
+    if (!WS_IsDeflateSupported())
+    {
+        return false;
+    }
+
+    const char *end = offer + length;
+    for (const char *p = offer; p < end; )
+    {
+        const char *comma = std::find(p, end, ',');
+        if (parseDeflateOffer(p, comma, params, response))
+        {
+            return true;
+        }
+        p = comma < end ? comma + 1 : end;
+    }
+
+    return false;
+}
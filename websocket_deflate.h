@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef WEBSOCKET_DEFLATE_H
+#define WEBSOCKET_DEFLATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define WS_OPCODE_CONTINUATION 0x0
+#define WS_OPCODE_TEXT         0x1
+#define WS_OPCODE_BINARY       0x2
+#define WS_OPCODE_CLOSE        0x8
+#define WS_OPCODE_PING         0x9
+#define WS_OPCODE_PONG         0xA
+
+#define WS_MAX_FRAME_SIZE      (64 * 1024) // client messages are small, larger ones are a protocol error
+
+/*! Negotiated RFC 7692 permessage-deflate parameters.
+ */
+struct WS_DeflateParams
+{
+    bool serverNoContextTakeover = false;
+    bool clientNoContextTakeover = false;
+    int serverMaxWindowBits = 15;
+};
+
+/*! A websocket frame, the payload is unmasked.
+ */
+struct WS_Frame
+{
+    uint8_t opcode = 0;
+    bool fin = false;
+    bool rsv1 = false; //! compressed message
+    std::vector<uint8_t> payload;
+};
+
+/*! \class WS_DeflateEncoder
+
+    Compresses outgoing messages of one connection. With context takeover the
+    LZ77 window is kept between messages, so repeated keys of the event JSON
+    are encoded as back references into previous messages.
+ */
+class WS_DeflateEncoder
+{
+public:
+    WS_DeflateEncoder();
+    ~WS_DeflateEncoder();
+    WS_DeflateEncoder(const WS_DeflateEncoder&) = delete;
+    WS_DeflateEncoder &operator=(const WS_DeflateEncoder&) = delete;
+
+    bool init(const WS_DeflateParams &params);
+    bool compress(const char *data, size_t length, std::vector<uint8_t> &out);
+    size_t memoryUsage() const;
+
+private:
+    class Private;
+    std::unique_ptr<Private> d;
+};
+
+/*! \class WS_FrameReader
+
+    Incremental parser for received websocket frames.
+ */
+class WS_FrameReader
+{
+public:
+    explicit WS_FrameReader(bool requireMask = true) : m_requireMask(requireMask) { }
+
+    void setCompressionEnabled(bool enabled) { m_compression = enabled; }
+    void feed(const uint8_t *data, size_t length);
+    bool next(WS_Frame *frame);
+    bool hasError() const { return m_error; }
+
+private:
+    std::vector<uint8_t> m_buf;
+    bool m_requireMask;
+    bool m_compression = false;
+    bool m_error = false;
+};
+
+bool WS_IsDeflateSupported();
+bool WS_NegotiateDeflate(const char *offer, size_t length, WS_DeflateParams *params, std::string *response);
+void WS_EncodeFrame(uint8_t opcode, bool rsv1, const uint8_t *payload, size_t length, std::vector<uint8_t> &out);
+
+#endif // WEBSOCKET_DEFLATE_H
@@ -10,9 +10,15 @@
 
 #ifdef USE_WEBSOCKETS
 
+#include <algorithm>
+#include <QCryptographicHash>
+#include <QTcpSocket>
+#include <deconz/qhttprequest_compat.h>
 #include "deconz/u_assert.h"
 #include "deconz/dbg_trace.h"
 #include "deconz/util.h"
+#include "memory_stats.h"
+#include "metrics.h"
 #include "websocket_server.h"
 
 /*! Constructor.
@@ -21,6 +27,7 @@ WebSocketServer::WebSocketServer(QObject *parent, uint16_t wsPort) :
     QObject(parent)
 {
     srv = new QWebSocketServer("deconz", QWebSocketServer::NonSecureMode, this);
+    deflateEnabled = deCONZ::appArgumentNumeric("--ws-deflate", 0) == 1;
 
     QHostAddress address;
     QString addrArg = deCONZ::appArgumentString("--http-listen", QString());
@@ -60,6 +67,11 @@ WebSocketServer::WebSocketServer(QObject *parent, uint16_t wsPort) :
 void WebSocketServer::handleExternalTcpSocket(const QHttpRequestHeader &hdr, QTcpSocket *sock)
 {
     U_ASSERT(sock);
+    if (deflateEnabled && hdr.hasKey(QLatin1String("Sec-WebSocket-Extensions")) && acceptDeflateClient(hdr, sock))
+    {
+        return;
+    }
+
     if (srv)
     {
         srv->handleConnection(sock);
@@ -70,6 +82,153 @@ void WebSocketServer::handleExternalTcpSocket(const QHttpRequestHeader &hdr, QTc
     }
 }
 
+/*! Completes the handshake of a client which offers permessage-deflate.
+    \returns false if no offer is acceptable or the request isn't a plain websocket upgrade,
+    the client is then handled by \c srv.
+ */
+bool WebSocketServer::acceptDeflateClient(const QHttpRequestHeader &hdr, QTcpSocket *sock)
+{
+    if (hdr.httpMethod() != HttpGet || hdr.hasKey(QLatin1String("Sec-WebSocket-Protocol")))
+    {
+        return false; // subprotocol selection is left to QWebSocketServer
+    }
+
+    const QString connection(hdr.value(QLatin1String("Connection")));
+    if (!connection.contains(QLatin1String("upgrade"), Qt::CaseInsensitive))
+    {
+        return false;
+    }
+
+    WS_DeflateParams params;
+    std::string extResponse;
+    const QLatin1String ext = hdr.value(QLatin1String("Sec-WebSocket-Extensions"));
+
+    if (!WS_NegotiateDeflate(ext.data(), size_t(ext.size()), &params, &extResponse))
+    {
+        return false;
+    }
+
+    if (!hdr.hasKey(QLatin1String("Sec-WebSocket-Key")) || hdr.value(QLatin1String("Sec-WebSocket-Version")) != QLatin1String("13"))
+    {
+        return false; // let QWebSocketServer reject it
+    }
+
+    // the handshake request is still in the socket buffer, as for QWebSocketServer::handleConnection()
+    const QByteArray pending = sock->peek(sock->bytesAvailable());
+    const int end = pending.indexOf("\r\n\r\n");
+    if (end < 0)
+    {
+        return false;
+    }
+
+    auto client = std::make_unique<DeflateClient>();
+    if (!client->encoder.init(params))
+    {
+        return false;
+    }
+
+    sock->read(end + 4);
+
+    const QLatin1String wsKey = hdr.value(QLatin1String("Sec-WebSocket-Key"));
+    const QByteArray key = QByteArray(wsKey.data(), wsKey.size()) + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    const QByteArray accept = QCryptographicHash::hash(key, QCryptographicHash::Sha1).toBase64();
+
+    QByteArray rsp;
+    rsp += "HTTP/1.1 101 Switching Protocols\r\n";
+    rsp += "Upgrade: websocket\r\n";
+    rsp += "Connection: Upgrade\r\n";
+    rsp += "Sec-WebSocket-Accept: " + accept + "\r\n";
+    rsp += "Sec-WebSocket-Extensions: " + QByteArray(extResponse.c_str()) + "\r\n";
+    rsp += "\r\n";
+    sock->write(rsp);
+    sock->flush();
+
+    DBG_Printf(DBG_INFO, "New websocket %s:%u (%s)\n", qPrintable(sock->peerAddress().toString()), sock->peerPort(), extResponse.c_str());
+
+    client->sock = sock;
+    client->reader.setCompressionEnabled(true);
+    sock->setParent(this);
+    connect(sock, &QTcpSocket::readyRead, this, &WebSocketServer::onDeflateReadyRead);
+    connect(sock, &QTcpSocket::disconnected, this, &WebSocketServer::onDeflateDisconnected);
+    DeflateClient *c = client.get();
+    deflateClients.push_back(std::move(client));
+    MET_Set(MET_WebsocketClients, int64_t(clients.size() + deflateClients.size()));
+
+    if (sock->bytesAvailable() > 0)
+    {
+        processDeflateClient(c); // frames sent along with the handshake won't signal readyRead() again
+    }
+
+    return true;
+}
+
+/*! Sends an uncompressed frame, \p payload is compressed already for data frames.
+ */
+void WebSocketServer::sendDeflateFrame(DeflateClient *client, uint8_t opcode, const QByteArray &payload)
+{
+    frameBuf.clear();
+    WS_EncodeFrame(opcode, false, reinterpret_cast<const uint8_t*>(payload.constData()), size_t(payload.size()), frameBuf);
+    client->sock->write(reinterpret_cast<const char*>(frameBuf.data()), qint64(frameBuf.size()));
+}
+
+void WebSocketServer::onDeflateReadyRead()
+{
+    QTcpSocket *sock = qobject_cast<QTcpSocket*>(sender());
+    auto i = std::find_if(deflateClients.begin(), deflateClients.end(), [sock](const auto &c) { return c->sock == sock; });
+
+    if (sock && i != deflateClients.end())
+    {
+        processDeflateClient(i->get());
+    }
+}
+
+/*! Handles control frames of permessage-deflate clients, data frames are ignored
+    like in onTextMessageReceived().
+ */
+void WebSocketServer::processDeflateClient(DeflateClient *client)
+{
+    QTcpSocket *sock = client->sock;
+    const QByteArray data = sock->readAll();
+    client->reader.feed(reinterpret_cast<const uint8_t*>(data.constData()), size_t(data.size()));
+
+    WS_Frame frame;
+    while (client->reader.next(&frame))
+    {
+        const QByteArray payload(reinterpret_cast<const char*>(frame.payload.data()), int(frame.payload.size()));
+
+        if (frame.opcode == WS_OPCODE_PING)
+        {
+            sendDeflateFrame(client, WS_OPCODE_PONG, payload);
+        }
+        else if (frame.opcode == WS_OPCODE_CLOSE)
+        {
+            sendDeflateFrame(client, WS_OPCODE_CLOSE, payload.left(2)); // echo status code
+            sock->disconnectFromHost();
+            return;
+        }
+    }
+
+    if (client->reader.hasError())
+    {
+        DBG_Printf(DBG_INFO, "Websocket %s:%u protocol error\n", qPrintable(sock->peerAddress().toString()), sock->peerPort());
+        sendDeflateFrame(client, WS_OPCODE_CLOSE, QByteArray("\x03\xEA", 2)); // 1002 protocol error
+        sock->disconnectFromHost();
+    }
+}
+
+void WebSocketServer::onDeflateDisconnected()
+{
+    QTcpSocket *sock = qobject_cast<QTcpSocket*>(sender());
+    auto i = std::find_if(deflateClients.begin(), deflateClients.end(), [sock](const auto &c) { return c->sock == sock; });
+
+    if (i != deflateClients.end())
+    {
+        sock->deleteLater();
+        deflateClients.erase(i);
+        MET_Set(MET_WebsocketClients, int64_t(clients.size() + deflateClients.size()));
+    }
+}
+
 /*! Returns the websocket server port.
     \return the active server port, or 0 if not listening on extra port
  */
@@ -91,6 +250,8 @@ void WebSocketServer::onNewConnection()
         connect(sock, &QWebSocket::textMessageReceived, this, &WebSocketServer::onTextMessageReceived);
         clients.push_back(sock);
     }
+
+    MET_Set(MET_WebsocketClients, int64_t(clients.size() + deflateClients.size()));
 }
 
 /*! Handle websocket disconnected signal.
@@ -108,6 +269,8 @@ void WebSocketServer::onSocketDisconnected()
             clients.pop_back();
         }
     }
+
+    MET_Set(MET_WebsocketClients, int64_t(clients.size() + deflateClients.size()));
 }
 
 /*! Handle websocket error signal.
@@ -127,6 +290,8 @@ void WebSocketServer::onSocketError(QAbstractSocket::SocketError err)
             clients.pop_back();
         }
     }
+
+    MET_Set(MET_WebsocketClients, int64_t(clients.size() + deflateClients.size()));
 }
 
 void WebSocketServer::onTextMessageReceived(const QString &message)
@@ -140,13 +305,53 @@ void WebSocketServer::onTextMessageReceived(const QString &message)
  */
 void WebSocketServer::broadcastTextMessage(const QString &msg)
 {
+    uint64_t bytes = 0;
+
     for (size_t i = 0; i < clients.size(); i++)
     {
         QWebSocket *sock = clients[i];
         qint64 ret = sock->sendTextMessage(msg);
         DBG_Printf(DBG_INFO_L2, "Websocket %s:%u send message: %s (ret = %d)\n", qPrintable(sock->peerAddress().toString()), sock->peerPort(), qPrintable(msg), (int)ret);
         sock->flush();
+        if (ret > 0)
+        {
+            bytes += uint64_t(ret);
+        }
+    }
+
+    MET_Add(MET_WebsocketMessages);
+
+    if (deflateClients.empty())
+    {
+        MET_Add(MET_WebsocketBytesSent, bytes);
+        return;
+    }
+
+    const QByteArray utf8 = msg.toUtf8();
+
+    for (auto &client : deflateClients)
+    {
+        if (client->sock->state() != QAbstractSocket::ConnectedState)
+        {
+            continue;
+        }
+
+        frameBuf.clear();
+        if (client->encoder.compress(utf8.constData(), size_t(utf8.size()), payloadBuf))
+        {
+            WS_EncodeFrame(WS_OPCODE_TEXT, true, payloadBuf.data(), payloadBuf.size(), frameBuf);
+        }
+        else
+        {
+            WS_EncodeFrame(WS_OPCODE_TEXT, false, reinterpret_cast<const uint8_t*>(utf8.constData()), size_t(utf8.size()), frameBuf);
+        }
+
+        client->sock->write(reinterpret_cast<const char*>(frameBuf.data()), qint64(frameBuf.size()));
+        client->sock->flush();
+        bytes += frameBuf.size();
     }
+
+    MET_Add(MET_WebsocketBytesSent, bytes);
 }
 
 /*! Flush the sockets of all connected clients.
@@ -162,6 +367,34 @@ void WebSocketServer::flush()
             sock->flush();
         }
     }
+
+    for (auto &client : deflateClients)
+    {
+        if (client->sock->state() == QAbstractSocket::ConnectedState)
+        {
+            client->sock->flush();
+        }
+    }
+}
+
+/*! Unsent data of all clients, compression state and frame buffers, for MEM_WebsocketBuffers.
+ */
+void WebSocketServer::memoryUsage(MEM_Report &report) const
+{
+    size_t bytes = MEM_VectorBytes(clients) + MEM_VectorBytes(deflateClients) +
+                   MEM_VectorBytes(frameBuf) + MEM_VectorBytes(payloadBuf);
+
+    for (const QWebSocket *sock : clients)
+    {
+        bytes += size_t(sock->bytesToWrite());
+    }
+
+    for (const auto &client : deflateClients)
+    {
+        bytes += MEM_HeapBytes(sizeof(DeflateClient)) + client->encoder.memoryUsage() + size_t(client->sock->bytesToWrite());
+    }
+
+    report.add(MEM_WebsocketBuffers, bytes, clients.size() + deflateClients.size());
 }
 
 #else // no websockets
@@ -171,4 +404,5 @@ void WebSocketServer::flush()
   void WebSocketServer::onNewConnection() { }
   void WebSocketServer::broadcastTextMessage(const QString &) { }
   quint16 WebSocketServer::port() const {  return 0; }
+  void WebSocketServer::memoryUsage(MEM_Report &) const { }
 #endif
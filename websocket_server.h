@@ -2,7 +2,9 @@
 #define WEBSOCKET_SERVER_H
 
 #include <QObject>
+#include <memory>
 #include <vector>
+#include "websocket_deflate.h"
 #ifdef USE_WEBSOCKETS
 #include <QWebSocket>
 #include <QWebSocketServer>
@@ -11,10 +13,16 @@
 class QWebSocket;
 class QWebSocketServer;
 class QHttpRequestHeader;
+struct MEM_Report;
 
 /*! \class WebSocketServer
 
     Basic websocket server to broadcast messages to clients.
+
+    With --ws-deflate=1 clients on the REST API ports which offer RFC 7692 permessage-deflate
+    are handled without QWebSocketServer, since it doesn't support extensions. Their messages
+    are compressed with context takeover. Clients which request a subprotocol and all other
+    clients use QWebSocketServer, which is also the default for every client.
  */
 class WebSocketServer : public QObject
 {
@@ -23,6 +31,7 @@ public:
     explicit WebSocketServer(QObject *parent, uint16_t wsPort);
     quint16 port() const;
     void handleExternalTcpSocket(const QHttpRequestHeader &hdr, QTcpSocket *sock);
+    void memoryUsage(MEM_Report &report) const;
 
 signals:
 
@@ -35,10 +44,27 @@ private slots:
     void onSocketDisconnected();
     void onSocketError(QAbstractSocket::SocketError err);
     void onTextMessageReceived(const QString &message);
+    void onDeflateReadyRead();
+    void onDeflateDisconnected();
 
 private:
+    struct DeflateClient
+    {
+        QTcpSocket *sock = nullptr;
+        WS_DeflateEncoder encoder;
+        WS_FrameReader reader;
+    };
+
+    bool acceptDeflateClient(const QHttpRequestHeader &hdr, QTcpSocket *sock);
+    void sendDeflateFrame(DeflateClient *client, uint8_t opcode, const QByteArray &payload);
+    void processDeflateClient(DeflateClient *client);
+
     QWebSocketServer *srv;
+    bool deflateEnabled = false;
     std::vector<QWebSocket*> clients;
+    std::vector<std::unique_ptr<DeflateClient>> deflateClients;
+    std::vector<uint8_t> frameBuf;
+    std::vector<uint8_t> payloadBuf;
 };
 
 #endif // WEBSOCKET_SERVER_H
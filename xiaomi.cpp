@@ -1,8 +1,10 @@
 #include <math.h>
 #include "de_web_plugin.h"
 #include "de_web_plugin_private.h"
+#include "device_access_fn.h"
 #include "utils/utils.h"
 #include "xiaomi.h"
+#include "xiaomi_special.h"
 
 /*! Handle packets related to the Xiaomi/Lumi FCC0 cluster.
     \param ind the APS level data indication containing the ZCL packet
@@ -113,7 +115,7 @@ void DeRestPluginPrivate::handleXiaomiLumiClusterIndication(const deCONZ::ApsDat
                         if (item2 && item2->toNumber() > 0)
                         {
                             // As unoccupied state is not reportable, add duration seconds after a occupied = true to automatically set to false
-                            sensor->durationDue = item->lastSet().addSecs(item2->toNumber());
+                            setSensorDurationDue(sensor, item->lastSet().addSecs(item2->toNumber()));
                         }
                     }
     
@@ -182,61 +184,15 @@ void DeRestPluginPrivate::handleZclAttributeReportIndicationXiaomiSpecial(const
         }
     }
 
-    quint16 attrId = 0;
-    quint8 dataType = 0;
-    quint8 length = 0;
+    // shared with the xiaomi:special DDF parse functions, decoded only once per frame
+    const XM_SpecialReport &report = DA_XiaomiSpecialReport(zclFrame);
 
-    QDataStream stream(zclFrame.payload());
-    stream.setByteOrder(QDataStream::LittleEndian);
-    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
-
-    while (attrId == 0)
-    {
-        if (stream.atEnd())
-        {
-            break;
-        }
-
-        quint16 a;
-        stream >> a;
-        stream >> dataType;
-
-        if (dataType == deCONZ::ZclCharacterString || dataType == deCONZ::ZclOctedString)
-        {
-            stream >> length;
-        }
-
-        if (a == 0xff01 && dataType == deCONZ::ZclCharacterString)
-        {
-            attrId = a;
-        }
-        else if (a == 0xff02 && dataType == 0x4c /*deCONZ::ZclStruct*/)
-        {
-            attrId = a;
-        }
-        else if (a == 0x00f7 && dataType == deCONZ::ZclOctedString)
-        {
-            attrId = a;
-        }
-
-        if (dataType == deCONZ::ZclCharacterString && attrId != 0xff01)
-        {
-            DBG_Printf(DBG_INFO_L2, "0x%016llX skip Xiaomi attribute 0x%04X\n", ind.srcAddress().ext(), attrId);
-            for (; length > 0; length--) // skip
-            {
-                quint8 dummy;
-                stream >> dummy;
-            }
-        }
-    }
-
-    if (stream.atEnd() || attrId == 0)
+    if (report.attrId == 0 || report.count == 0)
     {
         return;
     }
 
-    quint8 structIndex = 0; // only attribute id 0xff02
-    quint16 structSize = 0; // only attribute id 0xff02
+    const quint16 attrId = report.attrId;
 
     quint8 batteryPercentage = UINT8_MAX;
     quint16 battery = 0;
@@ -258,63 +214,36 @@ void DeRestPluginPrivate::handleZclAttributeReportIndicationXiaomiSpecial(const
 
     QString dateCode;
 
-    while (!stream.atEnd())
+    for (unsigned i = 0; i < report.count; i++)
     {
-        qint8 s8;
-        qint16 s16;
-        quint8 u8;
-        quint16 u16;
-        qint32 s32;
-        quint32 u32;
-        quint64 u64;
-        float f;
-
-        quint8 tag = 0;
-
-        if (attrId == 0xff01 || attrId == 0x00f7)
-        {
-            stream >> tag;
-        }
-        else if (attrId == 0xff02)
-        {
-            if (structIndex == 0)
-            {
-                stream >> structSize; // number of elements
-            }
-            structIndex++;
-        }
-
-        stream >> dataType;
+        const XM_Tag &t = report.tags[i];
+        const quint8 tag = attrId == 0xff02 ? 0 : t.tag;
+        const quint8 structIndex = attrId == 0xff02 ? t.tag + 1 : 0; // 1-based, only attribute id 0xff02
+        const quint8 dataType = t.dataType;
+
+        const qint8 s8 = qint8(t.value.s64);
+        const qint16 s16 = qint16(t.value.s64);
+        const quint8 u8 = quint8(t.value.u64);
+        const quint16 u16 = quint16(t.value.u64);
+        const qint32 s32 = qint32(t.value.s64);
+        const quint32 u32 = quint32(t.value.u64);
+        const quint64 u64 = t.value.u64;
+        const float f = t.value.real;
 
         switch (dataType)
         {
-        case deCONZ::ZclBoolean: stream >> u8; break;
-        case deCONZ::Zcl8BitInt: stream >> s8; break;
-        case deCONZ::Zcl8BitUint: stream >> u8; break;
-        case deCONZ::Zcl16BitInt: stream >> s16; break;
-        case deCONZ::Zcl16BitUint: stream >> u16; break;
-        case deCONZ::Zcl32BitInt: stream >> s32; break;
-        case deCONZ::Zcl32BitUint: stream >> u32; break;
+        case deCONZ::ZclBoolean:
+        case deCONZ::Zcl8BitInt:
+        case deCONZ::Zcl8BitUint:
+        case deCONZ::Zcl16BitInt:
+        case deCONZ::Zcl16BitUint:
+        case deCONZ::Zcl32BitInt:
+        case deCONZ::Zcl32BitUint:
         case deCONZ::Zcl40BitUint:
-            u64 = 0;
-            for (int i = 0; i < 5; i++)
-            {
-                u64 <<= 8;
-                stream >> u8;
-                u64 |= u8;
-            }
-            break;
         case deCONZ::Zcl48BitUint:
-            u64 = 0;
-            for (int i = 0; i < 6; i++)
-            {
-                u64 <<= 8;
-                stream >> u8;
-                u64 |= u8;
-            }
+        case deCONZ::Zcl64BitUint:
+        case deCONZ::ZclSingleFloat:
             break;
-        case deCONZ::Zcl64BitUint: stream >> u64; break;
-        case deCONZ::ZclSingleFloat: stream >> f; break;
         default:
         {
             DBG_Printf(DBG_INFO, "\tUnsupported datatype 0x%02X (tag 0x%02X)\n", dataType, tag);
@@ -559,6 +488,12 @@ void DeRestPluginPrivate::handleZclAttributeReportIndicationXiaomiSpecial(const
         }
     }
 
+    if (!report.complete)
+    {
+        DBG_Printf(DBG_INFO, "\tUnsupported datatype after tag 0x%02X\n", report.tags[report.count - 1].tag);
+        return;
+    }
+
     RestNodeBase *restNodePending = nullptr;
     ResourceItem *item = nullptr;
     QString modelId;
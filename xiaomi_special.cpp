@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include <cstring>
+#include "xiaomi_special.h"
+#include "zcl/attribute_view.h"
+
+#define XM_TYPE_INT8         0x28
+#define XM_TYPE_SINGLE_FLOAT 0x39
+#define XM_TYPE_OCTET_STRING 0x41
+#define XM_TYPE_CHAR_STRING  0x42
+#define XM_TYPE_STRUCT       0x4c
+
+static void decodeValue(XM_Tag &t, const uint8_t *data)
+{
+    t.value.u64 = 0;
+
+    if (t.dataType == XM_TYPE_SINGLE_FLOAT)
+    {
+        uint32_t u32 = uint32_t(data[0]) | uint32_t(data[1]) << 8 | uint32_t(data[2]) << 16 | uint32_t(data[3]) << 24;
+        memcpy(&t.value.real, &u32, sizeof(u32));
+        return;
+    }
+
+    if (t.dataType == XM_TYPE_OCTET_STRING || t.dataType == XM_TYPE_CHAR_STRING || t.length > 8)
+    {
+        return;
+    }
+
+    for (unsigned i = t.length; i > 0; i--)
+    {
+        t.value.u64 = (t.value.u64 << 8) | data[i - 1];
+    }
+
+    if (t.dataType >= XM_TYPE_INT8 && t.dataType <= 0x2f && t.length < 8)
+    {
+        const uint64_t sign = uint64_t(1) << (t.length * 8 - 1);
+        if (t.value.u64 & sign)
+        {
+            t.value.u64 |= ~((sign << 1) - 1);
+        }
+    }
+}
+
+/*! Decodes the first Xiaomi special attribute 0xff01, 0xff02 or 0x00f7 in a ZCL
+    attribute report payload into a tag table.
+
+    Other attributes preceding the special one are skipped.
+    \returns true if at least one element was decoded.
+ */
+bool XM_DecodeSpecialReport(const uint8_t *payload, size_t size, XM_SpecialReport *out)
+{
+    out->attrId = 0;
+    out->count = 0;
+    out->complete = false;
+    out->index.fill(0);
+
+    size_t pos = 0;
+
+    while (out->attrId == 0)
+    {
+        if (pos + 3 > size)
+        {
+            return false;
+        }
+
+        const uint16_t attrId = uint16_t(payload[pos] | payload[pos + 1] << 8);
+        const uint8_t dataType = payload[pos + 2];
+        pos += 3;
+
+        if ((attrId == 0xff01 && dataType == XM_TYPE_CHAR_STRING) ||
+            (attrId == 0x00f7 && dataType == XM_TYPE_OCTET_STRING))
+        {
+            out->attrId = attrId;
+            pos += 1; // length, elements are read until end of payload
+        }
+        else if (attrId == 0xff02 && dataType == XM_TYPE_STRUCT)
+        {
+            out->attrId = attrId;
+            pos += 2; // number of elements
+        }
+        else
+        {
+            const size_t n = ZCL_DataTypeSize(dataType, &payload[pos], size - pos);
+            if (n == 0)
+            {
+                return false;
+            }
+            pos += n;
+        }
+    }
+
+    uint8_t structIndex = 0;
+
+    while (pos < size)
+    {
+        if (out->count == XM_SpecialReport::MaxTags)
+        {
+            return true;
+        }
+
+        XM_Tag &t = out->tags[out->count];
+
+        if (out->attrId == 0xff02)
+        {
+            t.tag = structIndex++;
+        }
+        else
+        {
+            if (size - pos < 2)
+            {
+                return out->count > 0;
+            }
+            t.tag = payload[pos++];
+        }
+
+        t.dataType = payload[pos++];
+        const size_t n = ZCL_DataTypeSize(t.dataType, &payload[pos], size - pos);
+
+        if (n == 0)
+        {
+            return out->count > 0;
+        }
+
+        t.offset = uint16_t(pos);
+        t.length = uint16_t(n);
+        decodeValue(t, &payload[pos]);
+        pos += n;
+
+        out->count++;
+        if (out->index[t.tag] == 0) // first occurrence wins, like the previous stream search
+        {
+            out->index[t.tag] = out->count;
+        }
+    }
+
+    out->complete = true;
+    return out->count > 0;
+}
+
+/*! Returns the element with \p tag (or struct index) or nullptr if not present.
+ */
+const XM_Tag *XM_FindTag(const XM_SpecialReport &report, uint8_t tag)
+{
+    const uint8_t pos = report.index[tag];
+    return pos > 0 ? &report.tags[pos - 1] : nullptr;
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef XIAOMI_SPECIAL_H
+#define XIAOMI_SPECIAL_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/*! A single element of a Xiaomi special report.
+
+    For attributes 0xff01 and 0x00f7 `tag` is the tag preceding the element,
+    for the 0xff02 struct it is the 0-based index of the element.
+    The encoded value, including the length prefix of strings, is at `offset`
+    in the decoded ZCL payload.
+ */
+struct XM_Tag
+{
+    union
+    {
+        uint64_t u64;
+        int64_t s64;
+        float real;
+    } value;     //! little endian integer, sign extended for signed types
+    uint16_t offset;
+    uint16_t length;
+    uint8_t tag;
+    uint8_t dataType;
+};
+
+/*! The decoded TLV structure of a Xiaomi 0xff01, 0xff02 or 0x00f7 attribute report.
+
+    A report is decoded once by XM_DecodeSpecialReport(), all xiaomi:special items
+    and the legacy handler look up their tags in the result.
+ */
+struct XM_SpecialReport
+{
+    enum Constants { MaxTags = 64 };
+
+    uint16_t attrId = 0; //! 0xff01, 0xff02, 0x00f7 or 0 if the payload has none
+    uint8_t count = 0;
+    bool complete = false; //! false if decoding stopped at an unsupported data type or truncated element
+    std::array<uint8_t, 256> index; //! tag -> position + 1, 0 if not present
+    std::array<XM_Tag, MaxTags> tags;
+};
+
+bool XM_DecodeSpecialReport(const uint8_t *payload, size_t size, XM_SpecialReport *out);
+const XM_Tag *XM_FindTag(const XM_SpecialReport &report, uint8_t tag);
+
+#endif // XIAOMI_SPECIAL_H
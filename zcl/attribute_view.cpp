@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include "attribute_view.h"
+
+/*! Returns the encoded size of a value with \p dataType at \p data.
+
+    \param size - available bytes at \p data.
+    \returns size including the length prefix of strings, 0 if the type is unsupported
+             (arrays, structures, sets) or the value is truncated.
+ */
+size_t ZCL_DataTypeSize(uint8_t dataType, const uint8_t *data, size_t size)
+{
+    size_t n = 0;
+
+    if      (dataType >= 0x08 && dataType <= 0x0f) { n = dataType - 0x07u; } // data8 .. data64
+    else if (dataType == 0x10)                     { n = 1; }                 // boolean
+    else if (dataType >= 0x18 && dataType <= 0x1f) { n = dataType - 0x17u; } // bitmap8 .. bitmap64
+    else if (dataType >= 0x20 && dataType <= 0x27) { n = dataType - 0x1fu; } // uint8 .. uint64
+    else if (dataType >= 0x28 && dataType <= 0x2f) { n = dataType - 0x27u; } // int8 .. int64
+    else if (dataType == 0x30)                     { n = 1; }                 // enum8
+    else if (dataType == 0x31)                     { n = 2; }                 // enum16
+    else if (dataType == 0x38)                     { n = 2; }                 // semi float
+    else if (dataType == 0x39)                     { n = 4; }                 // single float
+    else if (dataType == 0x3a)                     { n = 8; }                 // double float
+    else if (dataType == 0x41 || dataType == 0x42) // octet, character string
+    {
+        if (size < 1 || data[0] == 0xff) { return 0; } // 0xff: invalid string
+        n = 1 + data[0];
+    }
+    else if (dataType == 0x43 || dataType == 0x44) // long octet, long character string
+    {
+        if (size < 2) { return 0; }
+        const unsigned len = unsigned(data[0]) | unsigned(data[1]) << 8;
+        if (len == 0xffff) { return 0; } // invalid string
+        n = 2 + len;
+    }
+    else if (dataType >= 0xe0 && dataType <= 0xe2) { n = 4; }                 // time of day, date, UTC time
+    else if (dataType == 0xe8 || dataType == 0xe9) { n = 2; }                 // cluster id, attribute id
+    else if (dataType == 0xea)                     { n = 4; }                 // BACnet OID
+    else if (dataType == 0xf0)                     { n = 8; }                 // IEEE address
+    else if (dataType == 0xf1)                     { n = 16; }                // 128-bit security key
+
+    return n <= size ? n : 0;
+}
+
+static uint64_t decodeNumeric(uint8_t dataType, const uint8_t *data, size_t length)
+{
+    if (length > 8 || dataType == 0x41 || dataType == 0x42 || dataType == 0x43 || dataType == 0x44)
+    {
+        return 0;
+    }
+
+    uint64_t value = 0;
+    for (size_t i = length; i > 0; i--)
+    {
+        value = (value << 8) | data[i - 1];
+    }
+
+    if (dataType >= 0x28 && dataType <= 0x2f && length < 8) // sign extend
+    {
+        const uint64_t sign = uint64_t(1) << (length * 8 - 1);
+        if (value & sign)
+        {
+            value |= ~((sign << 1) - 1);
+        }
+    }
+
+    return value;
+}
+
+/*! Decodes the attribute records of a ZCL read attributes response or report.
+
+    \param hasStatus - true for read attributes responses, records with a status other
+                       than success have no data type and value.
+    \returns true if the whole payload was decoded.
+ */
+bool ZCL_DecodeAttributeRecords(const uint8_t *payload, size_t size, bool hasStatus, ZCL_AttributeView *out)
+{
+    out->count = 0;
+    out->complete = false;
+
+    size_t pos = 0;
+
+    while (pos < size)
+    {
+        if (out->count == ZCL_AttributeView::MaxRecords || size - pos < 2)
+        {
+            return false;
+        }
+
+        ZCL_AttributeRecord &rec = out->records[out->count];
+        rec.id = uint16_t(payload[pos] | payload[pos + 1] << 8);
+        rec.status = 0x00;
+        rec.dataType = 0x00;
+        rec.offset = 0;
+        rec.length = 0;
+        rec.value = 0;
+        pos += 2;
+
+        if (hasStatus)
+        {
+            if (pos >= size)
+            {
+                return false;
+            }
+
+            rec.status = payload[pos++];
+
+            if (rec.status != 0x00)
+            {
+                out->count++;
+                continue;
+            }
+        }
+
+        if (pos >= size)
+        {
+            return false;
+        }
+
+        rec.dataType = payload[pos++];
+        const size_t n = ZCL_DataTypeSize(rec.dataType, &payload[pos], size - pos);
+
+        if (n == 0)
+        {
+            return false;
+        }
+
+        rec.offset = uint16_t(pos);
+        rec.length = uint16_t(n);
+        rec.value = decodeNumeric(rec.dataType, &payload[pos], n);
+        pos += n;
+        out->count++;
+    }
+
+    out->complete = true;
+    return true;
+}
+
+/*! Returns the index of the first record of \p attrId in \p view or -1 if not found.
+ */
+int ZCL_FindAttributeRecord(const ZCL_AttributeView &view, uint16_t attrId)
+{
+    for (unsigned i = 0; i < view.count; i++)
+    {
+        if (view.records[i].id == attrId)
+        {
+            return int(i);
+        }
+    }
+
+    return -1;
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef ZCL_ATTRIBUTE_VIEW_H
+#define ZCL_ATTRIBUTE_VIEW_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/*! A single attribute record of a ZCL read attributes response or attribute report.
+
+    The encoded value, including the length prefix of strings, is at `offset` in the
+    decoded ZCL payload. For numeric types up to 64-bit `value` holds the little endian
+    integer (sign extended for signed types).
+ */
+struct ZCL_AttributeRecord
+{
+    uint64_t value;
+    uint16_t id;
+    uint16_t offset;
+    uint16_t length;
+    uint8_t dataType;
+    uint8_t status; //! always success (0x00) for reports
+};
+
+/*! All attribute records of a ZCL read attributes response or attribute report.
+
+    A frame is decoded once by ZCL_DecodeAttributeRecords() and shared by all parse
+    functions of the items watching the cluster.
+ */
+struct ZCL_AttributeView
+{
+    enum Constants { MaxRecords = 48 };
+
+    uint8_t count = 0;
+    bool complete = false; //! false if the payload was truncated or has data types which can't be sized
+    std::array<ZCL_AttributeRecord, MaxRecords> records;
+};
+
+size_t ZCL_DataTypeSize(uint8_t dataType, const uint8_t *data, size_t size);
+bool ZCL_DecodeAttributeRecords(const uint8_t *payload, size_t size, bool hasStatus, ZCL_AttributeView *out);
+int ZCL_FindAttributeRecord(const ZCL_AttributeView &view, uint16_t attrId);
+
+#endif // ZCL_ATTRIBUTE_VIEW_H
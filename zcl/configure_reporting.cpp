@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#include "configure_reporting.h"
+
+/*! Packs the records of \p param into as few configure reporting requests as possible.
+
+    A request isn't larger than \p maxPayload. The order of records is kept, duplicate
+    attributes are only sent once. Records with another manufacturer code need their own
+    \c ZCL_ConfigureReportingParam.
+ */
+std::vector<ZCL_ReportingFrame> ZCL_PackReportingRecords(const ZCL_ConfigureReportingParam &param, size_t maxPayload)
+{
+    const std::vector<ZCL_ConfigureReportingParam::Record> &records = param.records;
+    std::vector<ZCL_ReportingFrame> frames;
+
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        const ZCL_ConfigureReportingParam::Record &rec = records[i];
+        const size_t size = ZCL_ConfigureReportingRecordSize(rec);
+        ZCL_ReportingFrame *frame = nullptr;
+        bool duplicate = false;
+
+        for (ZCL_ReportingFrame &f : frames)
+        {
+            for (size_t j : f.records)
+            {
+                if (records[j].attributeId == rec.attributeId && records[j].direction == rec.direction)
+                {
+                    duplicate = true;
+                }
+            }
+
+            if (f.payloadSize + size <= maxPayload)
+            {
+                frame = &f;
+            }
+        }
+
+        if (duplicate)
+        {
+            continue;
+        }
+
+        if (!frame)
+        {
+            frames.push_back({});
+            frame = &frames.back();
+        }
+
+        frame->records.push_back(i);
+        frame->payloadSize = uint16_t(frame->payloadSize + size);
+    }
+
+    return frames;
+}
+
+/*! Writes \p rec to \p buf.
+    \returns the number of bytes written or 0 if \p size is too small.
+ */
+size_t ZCL_WriteReportingRecord(const ZCL_ConfigureReportingParam::Record &rec, uint8_t *buf, size_t size)
+{
+    const size_t n = ZCL_ConfigureReportingRecordSize(rec);
+    const size_t changeSize = n - (1 + 2 + 1 + 2 + 2); // 0 for discrete data types
+    if (n > size || changeSize > 8)
+    {
+        return 0;
+    }
+
+    size_t pos = 0;
+    buf[pos++] = rec.direction;
+    buf[pos++] = uint8_t(rec.attributeId & 0xff);
+    buf[pos++] = uint8_t(rec.attributeId >> 8);
+    buf[pos++] = rec.dataType;
+    buf[pos++] = uint8_t(rec.minInterval & 0xff);
+    buf[pos++] = uint8_t(rec.minInterval >> 8);
+    buf[pos++] = uint8_t(rec.maxInterval & 0xff);
+    buf[pos++] = uint8_t(rec.maxInterval >> 8);
+
+    uint64_t change = rec.reportableChange;
+    for (size_t i = 0; i < changeSize; i++)
+    {
+        buf[pos++] = uint8_t(change & 0xff);
+        change >>= 8;
+    }
+
+    return pos;
+}
+
+/*! Sets the status of each attribute of a configure reporting request from its response.
+
+    A response with a single status applies to all attributes. Otherwise the response
+    only lists the attributes which failed, the ones not listed were successful.
+
+    \param attrs - attribute id and direction of each attribute in the request.
+    \returns false if the payload is malformed.
+ */
+bool ZCL_ConfigureReportingRspStatus(const uint8_t *payload, size_t size, ZCL_ReportingStatus *attrs, size_t count)
+{
+    if (size == 0)
+    {
+        return false;
+    }
+
+    if (size == 1)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            attrs[i].status = payload[0];
+        }
+        return true;
+    }
+
+    if (size % 4 != 0)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        attrs[i].status = 0x00; // success
+    }
+
+    for (size_t pos = 0; pos + 4 <= size; pos += 4)
+    {
+        const uint8_t status = payload[pos];
+        const uint8_t direction = payload[pos + 1];
+        const uint16_t attrId = uint16_t(payload[pos + 2] | payload[pos + 3] << 8);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            if (attrs[i].attributeId == attrId && attrs[i].direction == direction)
+            {
+                attrs[i].status = status;
+            }
+        }
+    }
+
+    return true;
+}
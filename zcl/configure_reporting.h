@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2024 dresden elektronik ingenieurtechnik gmbh.
+ * All rights reserved.
+ *
+ * The software in this package is published under the terms of the BSD
+ * style license a copy of which has been included with this distribution in
+ * the LICENSE.txt file.
+ *
+ */
+
+#ifndef ZCL_CONFIGURE_REPORTING_H
+#define ZCL_CONFIGURE_REPORTING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <deconz.h>
+#include "zcl/zcl.h"
+
+/*! Max. ZCL payload of a configure reporting request.
+
+    Unfragmented APS payload of 82 bytes minus the manufacturer specific ZCL header,
+    with some room for source routing.
+ */
+#define ZCL_CONFIGURE_REPORTING_MAX_PAYLOAD 70
+
+/*! Records of a ZCL_ConfigureReportingParam which are sent in a single configure reporting request.
+ */
+struct ZCL_ReportingFrame
+{
+    uint16_t payloadSize = 0;
+    std::vector<size_t> records; //! indexes into ZCL_ConfigureReportingParam::records
+};
+
+/*! Status of an attribute in a configure reporting response.
+ */
+struct ZCL_ReportingStatus
+{
+    uint16_t attributeId;
+    uint8_t direction;
+    uint8_t status;
+};
+
+std::vector<ZCL_ReportingFrame> ZCL_PackReportingRecords(const ZCL_ConfigureReportingParam &param, size_t maxPayload);
+size_t ZCL_WriteReportingRecord(const ZCL_ConfigureReportingParam::Record &rec, uint8_t *buf, size_t size);
+bool ZCL_ConfigureReportingRspStatus(const uint8_t *payload, size_t size, ZCL_ReportingStatus *attrs, size_t count);
+
+#endif // ZCL_CONFIGURE_REPORTING_H
@@ -347,6 +347,19 @@ size_t ZCL_DataTypeSize(deCONZ::ZclDataTypeId type)
     return dt->size;
 }
 
+/*! Returns the encoded size of \p record in a configure reporting request. */
+size_t ZCL_ConfigureReportingRecordSize(const ZCL_ConfigureReportingParam::Record &record)
+{
+    size_t size = 1 + 2 + 1 + 2 + 2; // direction, attribute id, data type, min. and max. interval
+
+    if (ZCL_IsDataTypeAnalog(deCONZ::ZclDataTypeId(record.dataType)))
+    {
+        size += ZCL_DataTypeSize(deCONZ::ZclDataTypeId(record.dataType));
+    }
+
+    return size;
+}
+
 ZCL_ReadReportConfigurationRsp ZCL_ParseReadReportConfigurationRsp(const deCONZ::ApsDataIndication &ind, const deCONZ::ZclFrame &zclFrame)
 {
     ZCL_ReadReportConfigurationRsp result{};
@@ -123,6 +123,7 @@ ZCL_Result ZCL_WriteAttribute(const ZCL_Param &param, quint64 extAddress, quint1
 ZCL_Result ZCL_SendCommand(const ZCL_Param &param, quint64 extAddress, quint16 nwkAddress, deCONZ::ApsController *apsCtrl, std::vector<uint8_t> *payload);
 ZCL_Result ZCL_ReadReportConfiguration(const ZCL_ReadReportConfigurationParam &param, deCONZ::ApsController *apsCtrl);
 ZCL_Result ZCL_ConfigureReporting(const ZCL_ConfigureReportingParam &param, deCONZ::ApsController *apsCtrl);
+size_t ZCL_ConfigureReportingRecordSize(const ZCL_ConfigureReportingParam::Record &record);
 ZCL_ReadReportConfigurationRsp ZCL_ParseReadReportConfigurationRsp(const deCONZ::ApsDataIndication &ind, const deCONZ::ZclFrame &zclFrame);
 
 #endif // ZCL_H
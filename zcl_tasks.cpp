@@ -223,6 +223,13 @@ bool DeRestPluginPrivate::addTaskSetBrightness(TaskItem &task, uint8_t bri, bool
                 task.lightNode->addStateChange(change);
                 return true;
             }
+            else if (withOnOff && bri > 0) // only verify after classic command, like addTaskSetOnOff()
+            {
+                StateChange change(StateChange::StateWaitSync, SC_SetOnOff, task.req.dstEndpoint());
+                change.addTargetValue(RStateOn, 1);
+                change.addParameter(QLatin1String("cmd"), ONOFF_COMMAND_ON);
+                task.lightNode->addStateChange(change);
+            }
         }
     }
 
@@ -17,8 +17,8 @@
  */
 void DeRestPluginPrivate::handleDeviceAnnceIndication(const deCONZ::ApsDataIndication &ind)
 {
-    std::vector<LightNode>::iterator i = nodes.begin();
-    std::vector<LightNode>::iterator end = nodes.end();
+    SlabVector<LightNode>::iterator i = nodes.begin();
+    SlabVector<LightNode>::iterator end = nodes.end();
 
     quint16 nwk;
     quint64 ext;
@@ -42,6 +42,11 @@ void DeRestPluginPrivate::handleDeviceAnnceIndication(const deCONZ::ApsDataIndic
 
     const QDateTime now = QDateTime::currentDateTimeUtc();
 
+    if (bindingTableCache.invalidate(ext)) // device might have been reset
+    {
+        deleteBindingTable(ext);
+    }
+
     for (Resource *r : device->subDevices())
     {
         r->setValue(RAttrLastAnnounced, now);
@@ -160,8 +165,8 @@ void DeRestPluginPrivate::handleDeviceAnnceIndication(const deCONZ::ApsDataIndic
     }
 
     int found = 0;
-    std::vector<Sensor>::iterator si = sensors.begin();
-    std::vector<Sensor>::iterator send = sensors.end();
+    SlabVector<Sensor>::iterator si = sensors.begin();
+    SlabVector<Sensor>::iterator send = sensors.end();
 
     for (; si != send; ++si)
     {